@@ -0,0 +1,341 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+/* ========================================================================
+   GERADOR DE CARGA DO MODO SERVIÇO
+   ========================================================================
+   Mantém N conexões keep-alive abertas com o serviço e, em cada uma,
+   envia GET /cep/{cep} assim que a resposta anterior chega (carga em
+   malha fechada). Ao final reporta a vazão e os percentis de latência.
+   
+   Os CEPs vêm de um arquivo (um por linha) ou são gerados a partir de
+   um conjunto fixo de prefixos.
+   ======================================================================== */
+
+#define TAMANHO_RESPOSTA 16384
+#define EVENTOS 256
+
+typedef struct {
+    int fd;
+    char resposta[TAMANHO_RESPOSTA];
+    size_t tamanho;
+    double inicio;
+    int ativa;
+} Cliente;
+
+typedef struct {
+    char (*ceps)[16];
+    long total_ceps;
+    long proximo_cep;
+    double *latencias;
+    long quantidade;
+    long capacidade;
+    long status[6];             /* por centena: 1xx..5xx, [0] = erro de conexão */
+    long limite;                /* requisições a enviar (0 = por tempo) */
+    long enviadas;
+} Carga;
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int comparar_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentil(const double *ordenadas, long quantidade, double p) {
+    if (quantidade == 0) {
+        return 0.0;
+    }
+    long i = (long)(p / 100.0 * (quantidade - 1) + 0.5);
+    return ordenadas[i];
+}
+
+static void registrar(Carga *carga, double latencia, int status) {
+    if (carga->quantidade == carga->capacidade) {
+        long nova = carga->capacidade ? carga->capacidade * 2 : 65536;
+        double *ptr = realloc(carga->latencias, nova * sizeof(double));
+        if (!ptr) {
+            fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+            exit(1);
+        }
+        carga->latencias = ptr;
+        carga->capacidade = nova;
+    }
+    carga->latencias[carga->quantidade++] = latencia;
+    carga->status[status >= 100 && status < 600 ? status / 100 : 0]++;
+}
+
+static int conectar(const struct sockaddr_in *destino) {
+    int um = 1;
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    
+    if (fd < 0 || connect(fd, (const struct sockaddr *)destino, sizeof(*destino)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+    
+    return fd;
+}
+
+/* Envia a próxima requisição; retorna 0 se não houver mais o que enviar */
+static int enviar_requisicao(Carga *carga, Cliente *c) {
+    char requisicao[128];
+    
+    if (carga->limite > 0 && carga->enviadas >= carga->limite) {
+        c->ativa = 0;
+        return 0;
+    }
+    
+    const char *cep = carga->ceps[carga->proximo_cep++ % carga->total_ceps];
+    int len = snprintf(requisicao, sizeof(requisicao),
+                       "GET /cep/%s HTTP/1.1\r\nHost: localhost\r\n\r\n", cep);
+    
+    c->tamanho = 0;
+    c->inicio = agora_ms();
+    if (send(c->fd, requisicao, len, MSG_NOSIGNAL) != len) {
+        c->ativa = 0;
+        return -1;
+    }
+    carga->enviadas++;
+    
+    return 1;
+}
+
+/* Retorna o status se a resposta em c->resposta estiver completa, 0 se não */
+static int resposta_completa(Cliente *c) {
+    char *fim;
+    int status = 0;
+    long corpo = 0;
+    
+    c->resposta[c->tamanho] = '\0';
+    fim = strstr(c->resposta, "\r\n\r\n");
+    if (!fim) {
+        return 0;
+    }
+    sscanf(c->resposta, "HTTP/1.%*d %d", &status);
+    for (char *p = strstr(c->resposta, "\r\n"); p && p < fim; p = strstr(p + 2, "\r\n")) {
+        if (strncasecmp(p + 2, "Content-Length:", 15) == 0) {
+            corpo = atol(p + 17);
+        }
+    }
+    
+    if ((size_t)(fim + 4 - c->resposta) + corpo > c->tamanho) {
+        return 0;
+    }
+    
+    return status > 0 ? status : -1;
+}
+
+static long carregar_ceps(Carga *carga, const char *arquivo) {
+    char linha[64];
+    long capacidade = 1024;
+    
+    carga->ceps = malloc(capacidade * sizeof(*carga->ceps));
+    carga->total_ceps = 0;
+    
+    if (!arquivo) {
+        /* Conjunto sintético: 10 mil CEPs distintos */
+        static const char *prefixos[] = {"01310", "20040", "30130", "40020", "88015"};
+        capacidade = 10000;
+        carga->ceps = realloc(carga->ceps, capacidade * sizeof(*carga->ceps));
+        for (long i = 0; i < capacidade; i++) {
+            snprintf(carga->ceps[i], sizeof(carga->ceps[i]), "%s%03ld", prefixos[i % 5], i / 5 % 1000);
+        }
+        carga->total_ceps = capacidade;
+        return carga->total_ceps;
+    }
+    
+    FILE *f = fopen(arquivo, "r");
+    if (!f) {
+        perror("[ERRO] Não foi possível abrir o arquivo de CEPs");
+        return -1;
+    }
+    while (fgets(linha, sizeof(linha), f)) {
+        linha[strcspn(linha, "\r\n \t")] = '\0';
+        if (linha[0] == '\0') {
+            continue;
+        }
+        if (carga->total_ceps == capacidade) {
+            capacidade *= 2;
+            carga->ceps = realloc(carga->ceps, capacidade * sizeof(*carga->ceps));
+        }
+        snprintf(carga->ceps[carga->total_ceps++], sizeof(carga->ceps[0]), "%.15s", linha);
+    }
+    fclose(f);
+    
+    return carga->total_ceps;
+}
+
+static void exibir_uso(const char *programa) {
+    fprintf(stderr, "\nUso: %s [-p PORTA] [-c CONEXOES] [-d SEGUNDOS | -n TOTAL] [-a ARQUIVO]\n", programa);
+    fprintf(stderr, "  -H, --host IP        Endereço do serviço (padrão: 127.0.0.1)\n");
+    fprintf(stderr, "  -p, --porta N        Porta do serviço (padrão: 18090)\n");
+    fprintf(stderr, "  -c, --conexoes N     Conexões keep-alive simultâneas (padrão: 64)\n");
+    fprintf(stderr, "  -d, --duracao N      Duração do teste em segundos (padrão: 10)\n");
+    fprintf(stderr, "  -n, --total N        Envia N requisições em vez de rodar por tempo\n");
+    fprintf(stderr, "  -a, --arquivo ARQ    CEPs a consultar, um por linha\n\n");
+}
+
+int main(int argc, char *argv[]) {
+    Carga carga;
+    struct sockaddr_in destino;
+    struct epoll_event eventos[EVENTOS];
+    const char *host = "127.0.0.1";
+    const char *arquivo = NULL;
+    int porta = 18090;
+    int conexoes = 64;
+    double duracao = 10.0;
+    int opt;
+    
+    static const struct option opcoes[] = {
+        {"host",     required_argument, NULL, 'H'},
+        {"porta",    required_argument, NULL, 'p'},
+        {"conexoes", required_argument, NULL, 'c'},
+        {"duracao",  required_argument, NULL, 'd'},
+        {"total",    required_argument, NULL, 'n'},
+        {"arquivo",  required_argument, NULL, 'a'},
+        {"help",     no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    memset(&carga, 0, sizeof(carga));
+    while ((opt = getopt_long(argc, argv, "H:p:c:d:n:a:h", opcoes, NULL)) != -1) {
+        switch (opt) {
+            case 'H': host = optarg; break;
+            case 'p': porta = atoi(optarg); break;
+            case 'c': conexoes = atoi(optarg); break;
+            case 'd': duracao = atof(optarg); break;
+            case 'n': carga.limite = atol(optarg); break;
+            case 'a': arquivo = optarg; break;
+            default:
+                exibir_uso(argv[0]);
+                return 1;
+        }
+    }
+    
+    if (conexoes <= 0 || carregar_ceps(&carga, arquivo) <= 0) {
+        exibir_uso(argv[0]);
+        return 1;
+    }
+    
+    memset(&destino, 0, sizeof(destino));
+    destino.sin_family = AF_INET;
+    destino.sin_port = htons((uint16_t)porta);
+    if (inet_pton(AF_INET, host, &destino.sin_addr) != 1) {
+        fprintf(stderr, "[ERRO] Endereço inválido: %s\n", host);
+        return 1;
+    }
+    
+    Cliente *clientes = calloc(conexoes, sizeof(Cliente));
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    int ativas = 0;
+    
+    for (int i = 0; i < conexoes; i++) {
+        struct epoll_event ev;
+    
+        clientes[i].fd = conectar(&destino);
+        if (clientes[i].fd < 0) {
+            perror("[ERRO] Não foi possível conectar ao serviço");
+            return 1;
+        }
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = &clientes[i];
+        epoll_ctl(ep, EPOLL_CTL_ADD, clientes[i].fd, &ev);
+        clientes[i].ativa = 1;
+    }
+    
+    double inicio = agora_ms();
+    double fim = inicio + duracao * 1e3;
+    
+    for (int i = 0; i < conexoes; i++) {
+        if (enviar_requisicao(&carga, &clientes[i]) > 0) {
+            ativas++;
+        }
+    }
+    
+    while (ativas > 0) {
+        int n = epoll_wait(ep, eventos, EVENTOS, 1000);
+        double agora = agora_ms();
+    
+        for (int i = 0; i < n; i++) {
+            Cliente *c = (Cliente *)eventos[i].data.ptr;
+            ssize_t lido = recv(c->fd, c->resposta + c->tamanho, sizeof(c->resposta) - 1 - c->tamanho, 0);
+    
+            if (lido <= 0) {
+                if (lido < 0 && errno == EINTR) {
+                    continue;
+                }
+                registrar(&carga, agora - c->inicio, 0);
+                epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+                close(c->fd);
+                c->fd = -1;
+                c->ativa = 0;
+                ativas--;
+                continue;
+            }
+            c->tamanho += lido;
+    
+            int status = resposta_completa(c);
+            if (status == 0) {
+                continue;
+            }
+            registrar(&carga, agora - c->inicio, status);
+    
+            if ((carga.limite == 0 && agora >= fim) || enviar_requisicao(&carga, c) <= 0) {
+                c->ativa = 0;
+                ativas--;
+            }
+        }
+    
+        if (n == 0 && carga.limite == 0 && agora >= fim + 5000) {
+            fprintf(stderr, "[AVISO] %d conexões sem resposta; encerrando\n", ativas);
+            break;
+        }
+    }
+    
+    double segundos = (agora_ms() - inicio) / 1e3;
+    
+    qsort(carga.latencias, carga.quantidade, sizeof(double), comparar_double);
+    printf("Requisições: %ld em %.2f s (%d conexões)\n", carga.quantidade, segundos, conexoes);
+    printf("Vazão: %.1f req/s\n", segundos > 0 ? carga.quantidade / segundos : 0.0);
+    printf("Status: 2xx=%ld 4xx=%ld 5xx=%ld erros=%ld\n",
+           carga.status[2], carga.status[4], carga.status[5], carga.status[0]);
+    printf("Latência (ms): p50=%.2f p90=%.2f p99=%.2f max=%.2f\n",
+           percentil(carga.latencias, carga.quantidade, 50),
+           percentil(carga.latencias, carga.quantidade, 90),
+           percentil(carga.latencias, carga.quantidade, 99),
+           carga.quantidade ? carga.latencias[carga.quantidade - 1] : 0.0);
+    
+    for (int i = 0; i < conexoes; i++) {
+        if (clientes[i].fd >= 0) {
+            close(clientes[i].fd);
+        }
+    }
+    close(ep);
+    free(clientes);
+    free(carga.latencias);
+    free(carga.ceps);
+    
+    return carga.status[0] > 0 || carga.status[5] > 0 ? 1 : 0;
+}
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Curva de escalonamento do lote paralelo: o mesmo lote com 1, 2, 4...
+# threads de E/S contra as APIs simuladas (dados sintéticos, um CEP
+# diferente por linha, para que cada um vá à rede).
+#
+# Uso: bench/escalonamento.sh [LATENCIA_MS] [JITTER_MS] [CEPS] [CONCORRENCIA] [THREADS...]
+
+LATENCIA=${1:-5}
+JITTER=${2:-2}
+CEPS=${3:-50000}
+CONCORRENCIA=${4:-512}
+if [ $# -ge 4 ]; then shift 4; else shift $#; fi
+THREADS=${*:-"1 2 4 8"}
+PORTA_MOCK=${PORTA_MOCK:-18082}
+URL="http://127.0.0.1:$PORTA_MOCK"
+URLS="--url-viacep $URL --url-ibge $URL --url-brasilapi $URL"
+LOTE=$(mktemp)
+RESUMO=$(mktemp)
+
+cd "$(dirname "$0")/.." || exit 1
+
+./bench/mock_upstream --porta "$PORTA_MOCK" --latencia "$LATENCIA" --jitter "$JITTER" &
+MOCK=$!
+trap 'kill -INT $MOCK 2>/dev/null; wait $MOCK 2>/dev/null; rm -f "$LOTE" "$RESUMO"' EXIT
+sleep 0.3
+
+awk -v total="$CEPS" 'BEGIN { for (i = 0; i < total; i++) printf "%08d\n", 1000000 + (i * 7919) % 98000000 }' > "$LOTE"
+
+echo ""
+echo "═══ Lote: $CEPS CEPs, concorrência $CONCORRENCIA, latência ${LATENCIA}±${JITTER} ms, $(nproc) CPUs ═══"
+printf "%8s %12s %10s\n" "threads" "CEPs/s" "ganho"
+BASE=""
+for N in $THREADS; do
+    ./integrador_apis --lote "$LOTE" --concorrencia "$CONCORRENCIA" --threads "$N" $URLS \
+        > /dev/null 2> "$RESUMO"
+    VAZAO=$(sed -n 's/.*Vazão: \([0-9.]*\).*/\1/p' "$RESUMO")
+    [ -z "$BASE" ] && BASE=$VAZAO
+    printf "%8s %12s %9.2fx\n" "$N" "$VAZAO" "$(echo "$VAZAO $BASE" | awk '{ print $1 / $2 }')"
+done
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Benchmark reprodutível: as três APIs são simuladas localmente com as
+# respostas gravadas em bench/fixtures, com latência e jitter fixos.
+#
+# Cargas:
+#   1. consulta única - serviço com uma conexão, um CEP por vez
+#   2. lote           - --lote com CEPS_LOTE CEPs e CONCORRENCIA em andamento
+#
+# Uso: bench/executar_bench.sh [LATENCIA_MS] [JITTER_MS] [CEPS_LOTE] [CONCORRENCIA]
+
+LATENCIA=${1:-20}
+JITTER=${2:-10}
+CEPS_LOTE=${3:-5000}
+CONCORRENCIA=${4:-64}
+CONSULTAS_UNICAS=${CONSULTAS_UNICAS:-200}
+PORTA_MOCK=${PORTA_MOCK:-18081}
+PORTA_SERVICO=${PORTA_SERVICO:-18090}
+URL="http://127.0.0.1:$PORTA_MOCK"
+URLS="--url-viacep $URL --url-ibge $URL --url-brasilapi $URL"
+FIXTURES=bench/fixtures
+LOTE=$(mktemp)
+
+cd "$(dirname "$0")/.." || exit 1
+
+./bench/mock_upstream --porta "$PORTA_MOCK" --latencia "$LATENCIA" --jitter "$JITTER" \
+    --fixtures "$FIXTURES" &
+MOCK=$!
+trap 'kill -INT $MOCK 2>/dev/null; wait $MOCK 2>/dev/null; rm -f "$LOTE"' EXIT
+sleep 0.3
+
+echo ""
+echo "═══ Consulta única: $CONSULTAS_UNICAS consultas, uma por vez ═══"
+./integrador_apis --servico "$PORTA_SERVICO" $URLS &
+SERVICO=$!
+sleep 0.5
+./bench/carga --porta "$PORTA_SERVICO" --conexoes 1 --total "$CONSULTAS_UNICAS" \
+    --arquivo "$FIXTURES/ceps.txt"
+kill -INT $SERVICO
+wait $SERVICO
+
+echo ""
+echo "═══ Lote: $CEPS_LOTE CEPs, concorrência $CONCORRENCIA ═══"
+awk -v total="$CEPS_LOTE" '{ ceps[n++] = $0 } END { for (i = 0; i < total; i++) print ceps[i % n] }' \
+    "$FIXTURES/ceps.txt" > "$LOTE"
+./integrador_apis --lote "$LOTE" --concorrencia "$CONCORRENCIA" $URLS > /dev/null
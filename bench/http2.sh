@@ -0,0 +1,64 @@
+#!/bin/sh
+# HTTP/1.1 x HTTP/2 contra as APIs simuladas por TLS: o mesmo lote com
+# --http 1.1 e com --http 2, e por fim com --http 2 diante de um
+# servidor que só fala HTTP/1.1 (o cliente tem que voltar ao 1.1 sem
+# ficar preso ao limite de conexões do HTTP/2). Conexões e fração em
+# HTTP/2 são as do ViaCEP, o host com mais requisições.
+#
+# Uso: bench/http2.sh [LATENCIA_MS] [JITTER_MS] [CEPS] [CONCORRENCIA...]
+
+LATENCIA=${1:-5}
+JITTER=${2:-2}
+CEPS=${3:-20000}
+if [ $# -ge 3 ]; then shift 3; else shift $#; fi
+CONCORRENCIAS=${*:-"64 256 1024"}
+PORTA_MOCK=${PORTA_MOCK:-18083}
+URL="https://127.0.0.1:$PORTA_MOCK"
+LOTE=$(mktemp)
+RESUMO=$(mktemp)
+CERTIFICADO=$(mktemp)
+URLS="--url-viacep $URL --url-ibge $URL --url-brasilapi $URL --cacert $CERTIFICADO"
+MOCK=""
+
+cd "$(dirname "$0")/.." || exit 1
+
+iniciar_mock() {
+    ./bench/mock_upstream --porta "$PORTA_MOCK" --latencia "$LATENCIA" --jitter "$JITTER" \
+        --tls "$CERTIFICADO" "$@" 2> /dev/null &
+    MOCK=$!
+    sleep 0.5
+}
+
+parar_mock() {
+    [ -n "$MOCK" ] && kill -INT "$MOCK" 2>/dev/null && wait "$MOCK" 2>/dev/null
+    MOCK=""
+}
+
+trap 'parar_mock; rm -f "$LOTE" "$RESUMO" "$CERTIFICADO"' EXIT
+
+rodar() {
+    ROTULO=$1
+    VERSAO=$2
+    for C in $CONCORRENCIAS; do
+        ./integrador_apis --lote "$LOTE" --concorrencia "$C" --http "$VERSAO" $URLS \
+            > /dev/null 2> "$RESUMO"
+        VAZAO=$(sed -n 's/.*Vazão: \([0-9.]*\).*/\1/p' "$RESUMO")
+        CONEXOES=$(sed -n 's/.*  viacep: \([0-9]*\) conexões.*/\1/p' "$RESUMO")
+        HTTP2=$(sed -n 's/.*  viacep: .*, \([0-9]*%\) em HTTP\/2.*/\1/p' "$RESUMO")
+        printf "%-18s %12s %12s %10s %8s\n" "$ROTULO" "$C" "$VAZAO" "$CONEXOES" "$HTTP2"
+    done
+}
+
+awk -v total="$CEPS" 'BEGIN { for (i = 0; i < total; i++) printf "%08d\n", 1000000 + (i * 7919) % 98000000 }' > "$LOTE"
+
+echo ""
+echo "═══ Lote: $CEPS CEPs, latência ${LATENCIA}±${JITTER} ms, TLS, $(nproc) CPUs ═══"
+printf "%-18s %12s %12s %10s %8s\n" "protocolo" "concorrência" "CEPs/s" "conexões" "HTTP/2"
+
+iniciar_mock
+rodar "--http 1.1" 1.1
+rodar "--http 2" 2
+parar_mock
+
+iniciar_mock --http1
+rodar "--http 2 (só 1.1)" 2
@@ -0,0 +1,1759 @@
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+/* ========================================================================
+   SERVIDOR SIMULADO DAS APIs
+   ========================================================================
+   Responde as mesmas rotas usadas pelo integrador (ViaCEP, IBGE e Brasil
+   API) com dados sintéticos, para testes de carga e benchmarks sem
+   depender da rede. Cada resposta é atrasada por uma latência fixa mais
+   um jitter aleatório, simulando as APIs reais sem bloquear o laço:
+   as respostas prontas esperam em um heap ordenado pelo horário de envio.
+   Para exercitar prazos, duplicação e novas tentativas, uma fração das
+   respostas pode ganhar um atraso longo (--cauda) ou sair como 503
+   (--erros). Com --limite, o que passar de N requisições por segundo
+   sai como 429 com Retry-After, como fazem as APIs públicas.
+   
+   Fala HTTP/1.1 e HTTP/2: uma conexão que começa com o prefácio do
+   HTTP/2 passa a receber as requisições em streams, todas em andamento
+   ao mesmo tempo, cada resposta com o seu próprio atraso. Sem TLS, é o
+   h2c com conhecimento prévio; com --tls, o HTTP/2 é negociado por ALPN
+   como nas APIs reais (e --http1 faz o papel de um servidor que só
+   oferece HTTP/1.1). Assim o benchmark compara uma conexão por
+   requisição simultânea (HTTP/1.1) com poucas conexões multiplexadas
+   (ver bench/http2.sh).
+   
+   Dados sintéticos (determinísticos):
+   - CEPs começando com "99" não existem ({"erro": true})
+   - o código IBGE do CEP é 35 + (5 primeiros dígitos % 100)
+   
+   Com --fixtures DIR, as respostas vêm de arquivos gravados no formato
+   das APIs reais (ver bench/fixtures):
+   - DIR/viacep/<cep>.json          resposta do ViaCEP
+   - DIR/municipios/<codigo>.json   município do IBGE (a lista completa é
+                                    a junção de todos)
+   - DIR/populacao/<codigo>.json    elemento de "res" do indicador de
+                                    população (requisições com vários
+                                    códigos juntam os elementos)
+   - DIR/feriados/<ano>.json        resposta da Brasil API
+   O que não tiver fixture responde como a API real: {"erro": true} para
+   CEP inexistente e 404 para o resto.
+   ======================================================================== */
+
+#define H2_MAX_FRAME 16384          /* SETTINGS_MAX_FRAME_SIZE padrão */
+#define TAMANHO_REQUISICAO (H2_MAX_FRAME + 64)     /* cabe um frame inteiro */
+#define EVENTOS 256
+#define FLUXOS_PADRAO 100
+
+typedef struct {
+    char *dados;
+    size_t tamanho;
+    size_t capacidade;
+} Buffer;
+
+/* Entrada da tabela dinâmica do HPACK */
+typedef struct {
+    char *nome;
+    char *valor;
+    size_t tamanho;             /* nome + valor + 32, como conta a RFC 7541 */
+} CampoHPACK;
+
+/* Tabela dinâmica do HPACK, da entrada mais antiga para a mais nova */
+typedef struct {
+    CampoHPACK *campos;
+    int total;
+    int capacidade;
+    size_t tamanho;
+    size_t maximo;
+} TabelaHPACK;
+
+struct Conexao;
+
+/* Uma resposta montada, esperando no heap pelo horário de envio */
+typedef struct Resposta {
+    struct Conexao *conexao;
+    double envio;
+    uint32_t fluxo;             /* stream do HTTP/2 (0 = HTTP/1.1) */
+    int status;
+    int cancelada;              /* RST_STREAM do cliente antes do envio */
+    Buffer corpo;
+    size_t enviado;             /* HTTP/2: bytes do corpo já em frames DATA */
+    long janela;                /* HTTP/2: janela de envio do stream */
+    struct Resposta *proxima;   /* HTTP/2: fila à espera de janela */
+} Resposta;
+
+typedef struct Conexao {
+    int fd;
+    SSL *ssl;                   /* NULL = sem TLS */
+    char entrada[TAMANHO_REQUISICAO];
+    size_t tamanho_entrada;
+    Buffer saida;
+    size_t enviado;
+    int pendentes;              /* respostas esperando no heap */
+    int fechada;                /* cliente saiu (liberada sem pendentes) */
+    long requisicoes;
+    struct Conexao *proxima_liberar;
+    
+    /* HTTP/2 */
+    int http2;
+    TabelaHPACK tabela;
+    Buffer bloco;               /* HEADERS + CONTINUATION até END_HEADERS */
+    uint32_t fluxo_bloco;       /* != 0: bloco de cabeçalhos incompleto */
+    long janela;                /* janela de envio da conexão */
+    long janela_inicial;        /* SETTINGS_INITIAL_WINDOW_SIZE do cliente */
+    Resposta *fila;             /* cabeçalhos enviados, corpo pendente */
+    Resposta *fim_fila;
+} Conexao;
+
+/* Uma resposta gravada, identificada por "<pasta>/<nome sem .json>" */
+typedef struct {
+    char chave[64];
+    char *conteudo;
+    size_t tamanho;
+} Fixture;
+
+typedef struct {
+    int epoll;
+    double latencia_ms;
+    double jitter_ms;
+    double cauda_fracao;        /* fração das respostas com atraso longo */
+    double cauda_ms;
+    double erros_fracao;        /* fração das respostas com 503 */
+    int limite;                 /* requisições por segundo (0 = sem limite) */
+    int fluxos;                 /* SETTINGS_MAX_CONCURRENT_STREAMS */
+    SSL_CTX *tls;               /* NULL = sem TLS */
+    int somente_http1;          /* não oferece nem aceita HTTP/2 */
+    double inicio_janela;
+    int requisicoes_janela;
+    long recusadas;
+    Resposta **heap;
+    int tamanho_heap;
+    int capacidade_heap;
+    long requisicoes;
+    long conexoes;
+    long conexoes_http2;
+    Conexao *liberar;           /* fechadas, liberadas ao fim da rodada */
+    Fixture *fixtures;          /* NULL = dados sintéticos */
+    int total_fixtures;
+} Servidor;
+
+static const char *UFS[5] = {"SP", "RJ", "MG", "BA", "SC"};
+static const char *REGIOES[5] = {"Sudeste", "Sudeste", "Sudeste", "Nordeste", "Sul"};
+
+static volatile sig_atomic_t parar = 0;
+
+static void tratar_sinal(int sinal) {
+    (void)sinal;
+    parar = 1;
+}
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* ========================================================================
+   FUNÇÕES: heap_*
+   ========================================================================
+   Heap mínimo de respostas prontas, pelo horário de envio.
+   ======================================================================== */
+static void heap_inserir(Servidor *s, Resposta *r) {
+    if (s->tamanho_heap == s->capacidade_heap) {
+        int nova = s->capacidade_heap ? s->capacidade_heap * 2 : 256;
+        Resposta **ptr = realloc(s->heap, nova * sizeof(Resposta *));
+        if (!ptr) {
+            fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+            exit(1);
+        }
+        s->heap = ptr;
+        s->capacidade_heap = nova;
+    }
+    
+    int i = s->tamanho_heap++;
+    while (i > 0 && s->heap[(i - 1) / 2]->envio > r->envio) {
+        s->heap[i] = s->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    s->heap[i] = r;
+}
+
+static Resposta *heap_remover(Servidor *s) {
+    Resposta *topo = s->heap[0];
+    Resposta *ultimo = s->heap[--s->tamanho_heap];
+    int i = 0;
+    
+    for (;;) {
+        int filho = 2 * i + 1;
+        if (filho >= s->tamanho_heap) {
+            break;
+        }
+        if (filho + 1 < s->tamanho_heap && s->heap[filho + 1]->envio < s->heap[filho]->envio) {
+            filho++;
+        }
+        if (ultimo->envio <= s->heap[filho]->envio) {
+            break;
+        }
+        s->heap[i] = s->heap[filho];
+        i = filho;
+    }
+    if (s->tamanho_heap > 0) {
+        s->heap[i] = ultimo;
+    }
+    
+    return topo;
+}
+
+static void buffer_reservar(Buffer *b, size_t adicional) {
+    if (b->tamanho + adicional <= b->capacidade) {
+        return;
+    }
+    
+    size_t nova = b->capacidade ? b->capacidade : 16384;
+    while (nova < b->tamanho + adicional) {
+        nova *= 2;
+    }
+    char *ptr = realloc(b->dados, nova);
+    if (!ptr) {
+        fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+        exit(1);
+    }
+    b->dados = ptr;
+    b->capacidade = nova;
+}
+
+static void buffer_adicionar(Buffer *b, const void *dados, size_t tamanho) {
+    buffer_reservar(b, tamanho);
+    memcpy(b->dados + b->tamanho, dados, tamanho);
+    b->tamanho += tamanho;
+}
+
+static void escrever(Buffer *b, const char *formato, ...) __attribute__((format(printf, 2, 3)));
+
+static void escrever(Buffer *b, const char *formato, ...) {
+    va_list args;
+    
+    buffer_reservar(b, 1);
+    for (;;) {
+        size_t livre = b->capacidade - b->tamanho;
+        va_start(args, formato);
+        int n = vsnprintf(b->dados + b->tamanho, livre, formato, args);
+        va_end(args);
+    
+        if (n >= 0 && (size_t)n < livre) {
+            b->tamanho += n;
+            return;
+        }
+        buffer_reservar(b, n >= 0 ? (size_t)n + 1 : livre + 1);
+    }
+}
+
+static void escrever_municipio(Buffer *b, long codigo) {
+    escrever(b, "{\"id\":%ld,\"nome\":\"Cidade %ld\",\"microrregiao\":{\"id\":1,\"nome\":\"Micro\","
+                "\"mesorregiao\":{\"id\":2,\"nome\":\"Meso\",\"UF\":{\"id\":35,\"sigla\":\"%s\","
+                "\"nome\":\"Estado\",\"regiao\":{\"id\":3,\"sigla\":\"XX\",\"nome\":\"%s\"}}}}}",
+             codigo, codigo, UFS[codigo % 5], REGIOES[codigo % 5]);
+}
+
+/* ========================================================================
+   FUNÇÃO: carregar_fixtures
+   ========================================================================
+   Lê para a memória todos os .json das pastas de fixtures.
+   ======================================================================== */
+static int carregar_fixtures(Servidor *s, const char *diretorio) {
+    static const char *pastas[] = {"viacep", "municipios", "populacao", "feriados"};
+    char caminho[1024];
+    int capacidade = 0;
+    
+    for (size_t i = 0; i < sizeof(pastas) / sizeof(pastas[0]); i++) {
+        snprintf(caminho, sizeof(caminho), "%s/%s", diretorio, pastas[i]);
+        DIR *dir = opendir(caminho);
+        if (!dir) {
+            continue;
+        }
+    
+        struct dirent *entrada;
+        while ((entrada = readdir(dir))) {
+            size_t len = strlen(entrada->d_name);
+            if (len <= 5 || strcmp(entrada->d_name + len - 5, ".json") != 0) {
+                continue;
+            }
+    
+            snprintf(caminho, sizeof(caminho), "%s/%s/%s", diretorio, pastas[i], entrada->d_name);
+            FILE *f = fopen(caminho, "rb");
+            if (!f) {
+                continue;
+            }
+            fseek(f, 0, SEEK_END);
+            long tamanho = ftell(f);
+            fseek(f, 0, SEEK_SET);
+    
+            if (s->total_fixtures == capacidade) {
+                capacidade = capacidade ? capacidade * 2 : 64;
+                s->fixtures = realloc(s->fixtures, capacidade * sizeof(Fixture));
+            }
+            Fixture *fx = &s->fixtures[s->total_fixtures];
+            fx->conteudo = malloc(tamanho);
+            fx->tamanho = fread(fx->conteudo, 1, tamanho, f);
+            fclose(f);
+    
+            /* Sem a quebra de linha final, para poder juntar em arrays */
+            while (fx->tamanho > 0 && (fx->conteudo[fx->tamanho - 1] == '\n' ||
+                                       fx->conteudo[fx->tamanho - 1] == '\r')) {
+                fx->tamanho--;
+            }
+            snprintf(fx->chave, sizeof(fx->chave), "%s/%.*s", pastas[i], (int)(len - 5), entrada->d_name);
+            s->total_fixtures++;
+        }
+        closedir(dir);
+    }
+    
+    if (s->total_fixtures == 0) {
+        fprintf(stderr, "[ERRO] Nenhuma fixture encontrada em %s\n", diretorio);
+        return -1;
+    }
+    
+    return 0;
+}
+
+static const Fixture *buscar_fixture(const Servidor *s, const char *pasta, const char *nome, size_t tamanho) {
+    char chave[64];
+    
+    snprintf(chave, sizeof(chave), "%s/%.*s", pasta, (int)tamanho, nome);
+    for (int i = 0; i < s->total_fixtures; i++) {
+        if (strcmp(s->fixtures[i].chave, chave) == 0) {
+            return &s->fixtures[i];
+        }
+    }
+    
+    return NULL;
+}
+
+/* ========================================================================
+   FUNÇÃO: montar_corpo_fixture
+   ========================================================================
+   Como montar_corpo, mas a partir das respostas gravadas.
+   ======================================================================== */
+static int montar_corpo_fixture(const Servidor *s, Buffer *b, const char *caminho) {
+    const Fixture *fx;
+    char cep[9];
+    int n = 0;
+    
+    if (sscanf(caminho, "/ws/%8[0-9]/json%n", cep, &n) == 1 && n > 0) {
+        fx = buscar_fixture(s, "viacep", cep, strlen(cep));
+        if (!fx) {
+            escrever(b, "{\"erro\":\"true\"}");
+            return 200;
+        }
+        buffer_adicionar(b, fx->conteudo, fx->tamanho);
+        return 200;
+    }
+    
+    if (strcmp(caminho, "/api/v1/localidades/municipios") == 0 ||
+        strcmp(caminho, "/api/v1/localidades/municipios/") == 0) {
+        int primeiro = 1;
+        escrever(b, "[");
+        for (int i = 0; i < s->total_fixtures; i++) {
+            if (strncmp(s->fixtures[i].chave, "municipios/", 11) == 0) {
+                escrever(b, "%s", primeiro ? "" : ",");
+                buffer_adicionar(b, s->fixtures[i].conteudo, s->fixtures[i].tamanho);
+                primeiro = 0;
+            }
+        }
+        escrever(b, "]");
+        return 200;
+    }
+    
+    const char *prefixo = "/api/v1/localidades/municipios/";
+    if (strncmp(caminho, prefixo, strlen(prefixo)) == 0) {
+        const char *codigo = caminho + strlen(prefixo);
+        fx = buscar_fixture(s, "municipios", codigo, strlen(codigo));
+        if (fx) {
+            buffer_adicionar(b, fx->conteudo, fx->tamanho);
+            return 200;
+        }
+    }
+    
+    prefixo = "/api/v1/pesquisas/indicadores/47001/resultados/";
+    if (strncmp(caminho, prefixo, strlen(prefixo)) == 0) {
+        const char *p = caminho + strlen(prefixo);
+        int primeiro = 1;
+    
+        escrever(b, "[{\"id\":47001,\"res\":[");
+        while (*p) {
+            size_t tamanho = strcspn(p, "|%");
+            fx = buscar_fixture(s, "populacao", p, tamanho);
+            if (fx) {
+                escrever(b, "%s", primeiro ? "" : ",");
+                buffer_adicionar(b, fx->conteudo, fx->tamanho);
+                primeiro = 0;
+            }
+            p += tamanho;
+            if (*p == '|') {
+                p++;
+            } else if (strncasecmp(p, "%7C", 3) == 0) {
+                p += 3;
+            } else {
+                break;
+            }
+        }
+        escrever(b, "]}]");
+        return 200;
+    }
+    
+    prefixo = "/api/feriados/v1/";
+    if (strncmp(caminho, prefixo, strlen(prefixo)) == 0) {
+        const char *ano = caminho + strlen(prefixo);
+        fx = buscar_fixture(s, "feriados", ano, strlen(ano));
+        if (fx) {
+            buffer_adicionar(b, fx->conteudo, fx->tamanho);
+            return 200;
+        }
+    }
+    
+    escrever(b, "{\"erro\":\"nao encontrado\"}");
+    return 404;
+}
+
+/* ========================================================================
+   FUNÇÃO: montar_corpo
+   ========================================================================
+   Escreve o corpo da resposta para 'caminho' no buffer de saída e
+   retorna o status HTTP.
+   ======================================================================== */
+static int montar_corpo(Buffer *b, const char *caminho) {
+    char cep[9];
+    long codigo;
+    int ano;
+    int n = 0;
+    
+    if (sscanf(caminho, "/ws/%8[0-9]/json%n", cep, &n) == 1 && n > 0 && strlen(cep) == 8) {
+        if (strncmp(cep, "99", 2) == 0) {
+            escrever(b, "{\"erro\":true}");
+            return 200;
+        }
+        codigo = 3500000 + atol(cep) / 1000 % 100;
+        escrever(b, "{\"cep\":\"%.5s-%s\",\"logradouro\":\"Rua %s\",\"complemento\":\"\","
+                    "\"bairro\":\"Bairro %.3s\",\"localidade\":\"Cidade %ld\",\"uf\":\"%s\","
+                    "\"ibge\":\"%ld\",\"gia\":\"\",\"ddd\":\"11\",\"siafi\":\"1\"}",
+                 cep, cep + 5, cep, cep, codigo, UFS[codigo % 5], codigo);
+        return 200;
+    }
+    
+    if (strcmp(caminho, "/api/v1/localidades/municipios") == 0 ||
+        strcmp(caminho, "/api/v1/localidades/municipios/") == 0) {
+        escrever(b, "[");
+        for (int i = 0; i < 100; i++) {
+            if (i > 0) {
+                escrever(b, ",");
+            }
+            escrever_municipio(b, 3500000 + i);
+        }
+        escrever(b, "]");
+        return 200;
+    }
+    
+    if (sscanf(caminho, "/api/v1/localidades/municipios/%ld%n", &codigo, &n) == 1 && caminho[n] == '\0') {
+        escrever_municipio(b, codigo);
+        return 200;
+    }
+    
+    const char *prefixo = "/api/v1/pesquisas/indicadores/47001/resultados/";
+    if (strncmp(caminho, prefixo, strlen(prefixo)) == 0) {
+        const char *p = caminho + strlen(prefixo);
+        int primeiro = 1;
+    
+        escrever(b, "[{\"id\":47001,\"res\":[");
+        while (*p) {
+            codigo = strtol(p, (char **)&p, 10);
+            escrever(b, "%s{\"localidade\":\"%ld\",\"res\":{\"2010\":\"%ld\",\"2021\":\"%ld\"}}",
+                     primeiro ? "" : ",", codigo, codigo % 100000, codigo % 100000 + 7);
+            primeiro = 0;
+            if (*p == '|') {
+                p++;
+            } else if (strncasecmp(p, "%7C", 3) == 0) {
+                p += 3;
+            } else {
+                break;
+            }
+        }
+        escrever(b, "]}]");
+        return 200;
+    }
+    
+    if (sscanf(caminho, "/api/feriados/v1/%4d%n", &ano, &n) == 1 && caminho[n] == '\0') {
+        static const char *feriados[][2] = {
+            {"01-01", "Confraternização mundial"}, {"04-21", "Tiradentes"},
+            {"05-01", "Dia do trabalho"}, {"09-07", "Independência do Brasil"},
+            {"10-12", "Nossa Senhora Aparecida"}, {"11-02", "Finados"},
+            {"11-15", "Proclamação da República"}, {"12-25", "Natal"}
+        };
+        escrever(b, "[");
+        for (int i = 0; i < 8; i++) {
+            escrever(b, "%s{\"date\":\"%d-%s\",\"name\":\"%s\",\"type\":\"national\"}",
+                     i ? "," : "", ano, feriados[i][0], feriados[i][1]);
+        }
+        escrever(b, "]");
+        return 200;
+    }
+    
+    escrever(b, "{\"erro\":\"nao encontrado\"}");
+    return 404;
+}
+
+/* ========================================================================
+   FUNÇÃO: preparar_resposta
+   ========================================================================
+   Monta o corpo e o status da resposta a 'caminho' e a agenda no heap.
+   'fluxo' é o stream da requisição no HTTP/2 (0 no HTTP/1.1).
+   ======================================================================== */
+static void preparar_resposta(Servidor *s, Conexao *c, char *caminho, uint32_t fluxo) {
+    Resposta *r = calloc(1, sizeof(Resposta));
+    if (!r) {
+        fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+        exit(1);
+    }
+    r->conexao = c;
+    r->fluxo = fluxo;
+    
+    caminho[strcspn(caminho, "?")] = '\0';
+    double agora = agora_ms();
+    if (agora - s->inicio_janela >= 1000) {
+        s->inicio_janela = agora;
+        s->requisicoes_janela = 0;
+    }
+    if (s->limite > 0 && ++s->requisicoes_janela > s->limite) {
+        escrever(&r->corpo, "{\"erro\": \"requisições demais\"}");
+        r->status = 429;
+        s->recusadas++;
+    } else if (s->erros_fracao > 0 && rand() / (double)RAND_MAX < s->erros_fracao) {
+        escrever(&r->corpo, "{\"erro\": \"indisponível\"}");
+        r->status = 503;
+    } else {
+        r->status = s->fixtures ? montar_corpo_fixture(s, &r->corpo, caminho) : montar_corpo(&r->corpo, caminho);
+    }
+    
+    double atraso = s->latencia_ms + s->jitter_ms * (rand() / (double)RAND_MAX);
+    if (s->cauda_fracao > 0 && rand() / (double)RAND_MAX < s->cauda_fracao) {
+        atraso += s->cauda_ms;
+    }
+    r->envio = agora + atraso;
+    c->pendentes++;
+    c->requisicoes++;
+    heap_inserir(s, r);
+    s->requisicoes++;
+}
+
+static void liberar_resposta(Resposta *r) {
+    free(r->corpo.dados);
+    free(r);
+}
+
+/* Fecha o socket; a conexão só é liberada quando não houver mais
+   respostas dela no heap, e sempre ao fim da rodada de eventos (pode
+   haver outros eventos dela na mesma rodada) */
+static void fechar(Servidor *s, Conexao *c) {
+    if (c->fd >= 0) {
+        SSL_free(c->ssl);
+        c->ssl = NULL;
+        close(c->fd);
+        c->fd = -1;
+    }
+    if (!c->fechada && c->pendentes == 0) {
+        c->proxima_liberar = s->liberar;
+        s->liberar = c;
+    }
+    c->fechada = 1;
+}
+
+static void liberar_conexao(Conexao *c) {
+    while (c->fila) {
+        Resposta *proxima = c->fila->proxima;
+        liberar_resposta(c->fila);
+        c->fila = proxima;
+    }
+    for (int i = 0; i < c->tabela.total; i++) {
+        free(c->tabela.campos[i].nome);
+        free(c->tabela.campos[i].valor);
+    }
+    free(c->tabela.campos);
+    free(c->bloco.dados);
+    free(c->saida.dados);
+    free(c);
+}
+
+/* Traduz um erro do OpenSSL para o que recv/send teriam retornado */
+static ssize_t erro_tls(Conexao *c, int retorno) {
+    int erro = SSL_get_error(c->ssl, retorno);
+    
+    if (erro == SSL_ERROR_WANT_READ || erro == SSL_ERROR_WANT_WRITE) {
+        errno = EAGAIN;
+        return -1;
+    }
+    ERR_clear_error();
+    if (erro == SSL_ERROR_ZERO_RETURN) {
+        return 0;
+    }
+    errno = ECONNRESET;
+    return -1;
+}
+
+/* recv/send com ou sem TLS. Com TLS, o handshake acontece dentro das
+   primeiras leituras (a conexão já nasce em modo de aceitação). */
+static ssize_t receber(Conexao *c, void *dados, size_t tamanho) {
+    if (!c->ssl) {
+        return recv(c->fd, dados, tamanho, 0);
+    }
+    int n = SSL_read(c->ssl, dados, (int)tamanho);
+    return n > 0 ? n : erro_tls(c, n);
+}
+
+static ssize_t transmitir(Conexao *c, const void *dados, size_t tamanho) {
+    if (!c->ssl) {
+        return send(c->fd, dados, tamanho, MSG_NOSIGNAL);
+    }
+    int n = SSL_write(c->ssl, dados, tamanho > (1 << 30) ? 1 << 30 : (int)tamanho);
+    return n > 0 ? n : erro_tls(c, n);
+}
+
+/* ALPN: h2 se o cliente oferecer (e não for --http1), senão http/1.1 */
+static int escolher_protocolo(SSL *ssl, const unsigned char **escolhido, unsigned char *tamanho,
+                              const unsigned char *oferecidos, unsigned int total, void *dados) {
+    static const unsigned char PROTOCOLOS[] = "\x02h2\x08http/1.1";
+    const Servidor *s = (const Servidor *)dados;
+    const unsigned char *nossos = s->somente_http1 ? PROTOCOLOS + 3 : PROTOCOLOS;
+    
+    (void)ssl;
+    if (SSL_select_next_proto((unsigned char **)escolhido, tamanho, nossos,
+                              (unsigned int)(PROTOCOLOS + sizeof(PROTOCOLOS) - 1 - nossos),
+                              oferecidos, total) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    return SSL_TLSEXT_ERR_OK;
+}
+
+static int adicionar_extensao(X509 *certificado, int nid, const char *valor) {
+    X509V3_CTX contexto;
+    
+    X509V3_set_ctx_nodb(&contexto);
+    X509V3_set_ctx(&contexto, certificado, certificado, NULL, NULL, 0);
+    X509_EXTENSION *extensao = X509V3_EXT_conf_nid(NULL, &contexto, nid, valor);
+    if (!extensao) {
+        return -1;
+    }
+    int ret = X509_add_ext(certificado, extensao, -1);
+    X509_EXTENSION_free(extensao);
+    return ret ? 0 : -1;
+}
+
+/* ========================================================================
+   FUNÇÃO: criar_contexto_tls
+   ========================================================================
+   Gera na partida uma chave e um certificado autoassinado para
+   127.0.0.1/localhost, válido por uma semana, e grava o certificado em
+   'arquivo' para o cliente confiar nele (--cacert). Nada fica em disco
+   além disso: cada execução tem o seu.
+   ======================================================================== */
+static SSL_CTX *criar_contexto_tls(Servidor *s, const char *arquivo) {
+    SSL_CTX *contexto = NULL;
+    X509 *certificado = X509_new();
+    EVP_PKEY *chave = EVP_EC_gen("P-256");
+    FILE *f = NULL;
+    
+    if (!certificado || !chave) {
+        goto fim;
+    }
+    X509_set_version(certificado, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(certificado), (long)time(NULL));
+    X509_gmtime_adj(X509_getm_notBefore(certificado), -3600);
+    X509_gmtime_adj(X509_getm_notAfter(certificado), 7 * 24 * 3600);
+    X509_set_pubkey(certificado, chave);
+    X509_NAME *nome = X509_get_subject_name(certificado);
+    X509_NAME_add_entry_by_txt(nome, "CN", MBSTRING_ASC, (const unsigned char *)"127.0.0.1", -1, -1, 0);
+    X509_set_issuer_name(certificado, nome);
+    if (adicionar_extensao(certificado, NID_basic_constraints, "critical,CA:TRUE") != 0 ||
+        adicionar_extensao(certificado, NID_subject_alt_name, "IP:127.0.0.1,DNS:localhost") != 0 ||
+        !X509_sign(certificado, chave, EVP_sha256())) {
+        goto fim;
+    }
+    
+    f = fopen(arquivo, "w");
+    if (!f || !PEM_write_X509(f, certificado)) {
+        fprintf(stderr, "[ERRO] Não foi possível gravar o certificado em %s\n", arquivo);
+        goto fim;
+    }
+    
+    contexto = SSL_CTX_new(TLS_server_method());
+    if (!contexto || !SSL_CTX_use_certificate(contexto, certificado) || !SSL_CTX_use_PrivateKey(contexto, chave)) {
+        SSL_CTX_free(contexto);
+        contexto = NULL;
+        goto fim;
+    }
+    SSL_CTX_set_alpn_select_cb(contexto, escolher_protocolo, s);
+    SSL_CTX_set_mode(contexto, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    
+fim:
+    if (!contexto) {
+        ERR_print_errors_fp(stderr);
+    }
+    if (f) {
+        fclose(f);
+    }
+    X509_free(certificado);
+    EVP_PKEY_free(chave);
+    return contexto;
+}
+
+static void processar(Servidor *s, Conexao *c);
+
+static void enviar(Servidor *s, Conexao *c) {
+    struct epoll_event ev;
+    
+    while (c->enviado < c->saida.tamanho) {
+        ssize_t n = transmitir(c, c->saida.dados + c->enviado, c->saida.tamanho - c->enviado);
+        if (n > 0) {
+            c->enviado += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN | EPOLLOUT;
+            ev.data.ptr = c;
+            epoll_ctl(s->epoll, EPOLL_CTL_MOD, c->fd, &ev);
+            return;
+        }
+        fechar(s, c);
+        return;
+    }
+    
+    int esperava_saida = c->saida.tamanho > 0;
+    c->saida.tamanho = 0;
+    c->enviado = 0;
+    if (esperava_saida) {
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(s->epoll, EPOLL_CTL_MOD, c->fd, &ev);
+    }
+    if (!c->http2) {
+        processar(s, c);
+    }
+}
+
+/* ========================================================================
+   HTTP/2 SEM TLS (h2c)
+   ========================================================================
+   O suficiente para o curl (nghttp2) com conhecimento prévio: SETTINGS,
+   PING, WINDOW_UPDATE, RST_STREAM, GOAWAY e HEADERS/CONTINUATION, com o
+   HPACK completo na leitura (tabela dinâmica e Huffman) e controle de
+   fluxo no envio. As respostas saem com campos literais, sem indexação
+   nem Huffman, o que dispensa um codificador de verdade. Sem prioridades
+   nem push, e o corpo das requisições (só há GETs) é ignorado.
+   ======================================================================== */
+
+#define H2_PREFACIO "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define H2_TAMANHO_PREFACIO 24
+#define H2_CABECALHO_FRAME 9
+#define H2_JANELA_PADRAO 65535
+#define H2_JANELA_MAXIMA 0x7fffffffL
+#define HPACK_TABELA_PADRAO 4096
+
+enum {
+    H2_DATA = 0x0,
+    H2_HEADERS = 0x1,
+    H2_RST_STREAM = 0x3,
+    H2_SETTINGS = 0x4,
+    H2_PING = 0x6,
+    H2_GOAWAY = 0x7,
+    H2_WINDOW_UPDATE = 0x8,
+    H2_CONTINUATION = 0x9
+};
+
+#define H2_FIM_FLUXO 0x1            /* END_STREAM */
+#define H2_ACK 0x1
+#define H2_FIM_CABECALHOS 0x4       /* END_HEADERS */
+#define H2_PREENCHIDO 0x8           /* PADDED */
+#define H2_PRIORIDADE 0x20          /* PRIORITY */
+
+#define H2_CONFIG_MAX_FLUXOS 0x3
+#define H2_CONFIG_JANELA_INICIAL 0x4
+
+#define H2_ERRO_PROTOCOLO 0x1
+#define H2_ERRO_FLUXO 0x3           /* FLOW_CONTROL_ERROR */
+#define H2_ERRO_COMPRESSAO 0x9
+
+/* Tabela estática do HPACK (RFC 7541, apêndice A); índice 1 em [0] */
+static const char *const HPACK_ESTATICA[][2] = {
+    {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"},
+    {":path", "/index.html"}, {":scheme", "http"}, {":scheme", "https"}, {":status", "200"},
+    {":status", "204"}, {":status", "206"}, {":status", "304"}, {":status", "400"},
+    {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""},
+    {"accept", ""}, {"access-control-allow-origin", ""}, {"age", ""}, {"allow", ""},
+    {"authorization", ""}, {"cache-control", ""}, {"content-disposition", ""},
+    {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+    {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""},
+    {"date", ""}, {"etag", ""}, {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""},
+    {"if-match", ""}, {"if-modified-since", ""}, {"if-none-match", ""}, {"if-range", ""},
+    {"if-unmodified-since", ""}, {"last-modified", ""}, {"link", ""}, {"location", ""},
+    {"max-forwards", ""}, {"proxy-authenticate", ""}, {"proxy-authorization", ""}, {"range", ""},
+    {"referer", ""}, {"refresh", ""}, {"retry-after", ""}, {"server", ""}, {"set-cookie", ""},
+    {"strict-transport-security", ""}, {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""},
+    {"via", ""}, {"www-authenticate", ""}
+};
+
+#define HPACK_TOTAL_ESTATICA ((int)(sizeof(HPACK_ESTATICA) / sizeof(HPACK_ESTATICA[0])))
+
+/* Tamanho em bits do código de Huffman de cada símbolo do HPACK (RFC
+   7541, apêndice B, sem o EOS). O código é canônico, então os códigos
+   em si saem dos tamanhos (ver huffman_iniciar). */
+static const unsigned char HUFFMAN_TAMANHOS[256] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26
+};
+
+#define HUFFMAN_MAX_BITS 30
+
+/* No código canônico, os códigos de cada tamanho são consecutivos, na
+   ordem dos símbolos. Basta, por tamanho, o primeiro código, quantos há
+   e onde começam em 'simbolos' para decodificar um bit de cada vez. */
+static struct {
+    uint32_t primeiro[HUFFMAN_MAX_BITS + 1];
+    uint32_t quantidade[HUFFMAN_MAX_BITS + 1];
+    int inicio[HUFFMAN_MAX_BITS + 1];
+    unsigned char simbolos[256];
+} huffman;
+
+static void huffman_iniciar(void) {
+    uint32_t codigo = 0;
+    int total = 0;
+    
+    for (int bits = 1; bits <= HUFFMAN_MAX_BITS; bits++) {
+        huffman.primeiro[bits] = codigo;
+        huffman.inicio[bits] = total;
+        for (int simbolo = 0; simbolo < 256; simbolo++) {
+            if (HUFFMAN_TAMANHOS[simbolo] == bits) {
+                huffman.simbolos[total++] = (unsigned char)simbolo;
+                huffman.quantidade[bits]++;
+            }
+        }
+        codigo = (codigo + huffman.quantidade[bits]) << 1;
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: huffman_decodificar
+   ========================================================================
+   Decodifica 'tamanho' bytes para 'saida' (que comporta tamanho * 8 / 5
+   caracteres: o código mais curto tem 5 bits). Retorna o número de
+   caracteres, ou -1 se houver um código inválido ou se o preenchimento
+   final não for de menos de 8 bits em 1.
+   ======================================================================== */
+static int huffman_decodificar(const unsigned char *dados, size_t tamanho, char *saida) {
+    uint32_t codigo = 0;
+    int bits = 0;
+    int n = 0;
+    
+    for (size_t i = 0; i < tamanho; i++) {
+        for (int b = 7; b >= 0; b--) {
+            codigo = (codigo << 1) | ((dados[i] >> b) & 1);
+            bits++;
+            if (codigo - huffman.primeiro[bits] < huffman.quantidade[bits]) {
+                saida[n++] = (char)huffman.simbolos[huffman.inicio[bits] + codigo - huffman.primeiro[bits]];
+                codigo = 0;
+                bits = 0;
+            } else if (bits == HUFFMAN_MAX_BITS) {
+                return -1;
+            }
+        }
+    }
+    
+    if (bits >= 8 || codigo != (1u << bits) - 1) {
+        return -1;
+    }
+    return n;
+}
+
+/* Inteiro com prefixo de 'bits' bits (RFC 7541, 5.1); 'marca' são os
+   bits altos do primeiro byte */
+static void hpack_escrever_inteiro(Buffer *b, unsigned char marca, int bits, size_t valor) {
+    size_t maximo = ((size_t)1 << bits) - 1;
+    unsigned char byte;
+    
+    if (valor < maximo) {
+        byte = marca | (unsigned char)valor;
+        buffer_adicionar(b, &byte, 1);
+        return;
+    }
+    byte = marca | (unsigned char)maximo;
+    buffer_adicionar(b, &byte, 1);
+    valor -= maximo;
+    while (valor >= 128) {
+        byte = (unsigned char)(valor % 128 + 128);
+        buffer_adicionar(b, &byte, 1);
+        valor /= 128;
+    }
+    byte = (unsigned char)valor;
+    buffer_adicionar(b, &byte, 1);
+}
+
+/* Campo literal sem indexação, com o nome pelo índice da tabela
+   estática e o valor sem Huffman (RFC 7541, 6.2.2) */
+static void hpack_escrever_campo(Buffer *b, int indice_nome, const char *valor) {
+    size_t tamanho = strlen(valor);
+    
+    hpack_escrever_inteiro(b, 0x00, 4, (size_t)indice_nome);
+    hpack_escrever_inteiro(b, 0x00, 7, tamanho);
+    buffer_adicionar(b, valor, tamanho);
+}
+
+static int hpack_ler_inteiro(const unsigned char **p, const unsigned char *fim, int bits, size_t *valor) {
+    size_t maximo = ((size_t)1 << bits) - 1;
+    int deslocamento = 0;
+    
+    if (*p >= fim) {
+        return -1;
+    }
+    *valor = *(*p)++ & maximo;
+    if (*valor < maximo) {
+        return 0;
+    }
+    while (*p < fim && deslocamento <= 28) {
+        unsigned char byte = *(*p)++;
+        *valor += (size_t)(byte & 0x7f) << deslocamento;
+        deslocamento += 7;
+        if (!(byte & 0x80)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Lê uma string (literal ou Huffman) para um texto alocado; NULL se for
+   inválida */
+static char *hpack_ler_texto(const unsigned char **p, const unsigned char *fim) {
+    size_t tamanho;
+    char *texto;
+    
+    if (*p >= fim) {
+        return NULL;
+    }
+    int comprimido = **p & 0x80;
+    if (hpack_ler_inteiro(p, fim, 7, &tamanho) != 0 || tamanho > (size_t)(fim - *p)) {
+        return NULL;
+    }
+    
+    texto = malloc(comprimido ? tamanho * 8 / 5 + 1 : tamanho + 1);
+    if (!texto) {
+        fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+        exit(1);
+    }
+    if (comprimido) {
+        int n = huffman_decodificar(*p, tamanho, texto);
+        if (n < 0) {
+            free(texto);
+            return NULL;
+        }
+        texto[n] = '\0';
+    } else {
+        memcpy(texto, *p, tamanho);
+        texto[tamanho] = '\0';
+    }
+    *p += tamanho;
+    
+    return texto;
+}
+
+/* Descarta as entradas mais antigas até caber em 'maximo' */
+static void tabela_ajustar(TabelaHPACK *t, size_t maximo) {
+    int descartadas = 0;
+    
+    while (t->tamanho > maximo) {
+        CampoHPACK *campo = &t->campos[descartadas++];
+        t->tamanho -= campo->tamanho;
+        free(campo->nome);
+        free(campo->valor);
+    }
+    if (descartadas > 0) {
+        t->total -= descartadas;
+        memmove(t->campos, t->campos + descartadas, t->total * sizeof(CampoHPACK));
+    }
+}
+
+/* Insere o campo (a tabela passa a ser dona de nome e valor) */
+static void tabela_inserir(TabelaHPACK *t, char *nome, char *valor) {
+    size_t tamanho = strlen(nome) + strlen(valor) + 32;
+    
+    if (tamanho > t->maximo) {
+        /* Maior que a tabela inteira: esvazia e não entra (RFC 7541, 4.4) */
+        tabela_ajustar(t, 0);
+        free(nome);
+        free(valor);
+        return;
+    }
+    tabela_ajustar(t, t->maximo - tamanho);
+    
+    if (t->total == t->capacidade) {
+        int nova = t->capacidade ? t->capacidade * 2 : 32;
+        CampoHPACK *ptr = realloc(t->campos, nova * sizeof(CampoHPACK));
+        if (!ptr) {
+            fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+            exit(1);
+        }
+        t->campos = ptr;
+        t->capacidade = nova;
+    }
+    t->campos[t->total].nome = nome;
+    t->campos[t->total].valor = valor;
+    t->campos[t->total].tamanho = tamanho;
+    t->total++;
+    t->tamanho += tamanho;
+}
+
+/* Campo pelo índice: primeiro a tabela estática, depois a dinâmica da
+   entrada mais nova para a mais antiga. Retorna -1 se não existir. */
+static int tabela_campo(const TabelaHPACK *t, size_t indice, const char **nome, const char **valor) {
+    if (indice >= 1 && indice <= (size_t)HPACK_TOTAL_ESTATICA) {
+        *nome = HPACK_ESTATICA[indice - 1][0];
+        *valor = HPACK_ESTATICA[indice - 1][1];
+        return 0;
+    }
+    indice -= HPACK_TOTAL_ESTATICA + 1;
+    if (indice >= (size_t)t->total) {
+        return -1;
+    }
+    *nome = t->campos[t->total - 1 - indice].nome;
+    *valor = t->campos[t->total - 1 - indice].valor;
+    return 0;
+}
+
+static void copiar_caminho(char *caminho, size_t tamanho_caminho, const char *nome, const char *valor) {
+    if (strcmp(nome, ":path") == 0) {
+        snprintf(caminho, tamanho_caminho, "%s", valor);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: hpack_decodificar
+   ========================================================================
+   Decodifica um bloco de cabeçalhos inteiro, mantendo a tabela dinâmica
+   em dia, e copia o :path para 'caminho'. Retorna -1 se o bloco for
+   inválido: é um erro de compressão, que derruba a conexão inteira
+   (a tabela dos dois lados deixaria de concordar).
+   ======================================================================== */
+static int hpack_decodificar(TabelaHPACK *t, const unsigned char *p, size_t tamanho,
+                             char *caminho, size_t tamanho_caminho) {
+    const unsigned char *fim = p + tamanho;
+    const char *nome;
+    const char *valor;
+    size_t indice;
+    
+    while (p < fim) {
+        unsigned char byte = *p;
+    
+        if (byte & 0x80) {
+            /* Campo indexado */
+            if (hpack_ler_inteiro(&p, fim, 7, &indice) != 0 || tabela_campo(t, indice, &nome, &valor) != 0) {
+                return -1;
+            }
+            copiar_caminho(caminho, tamanho_caminho, nome, valor);
+            continue;
+        }
+    
+        if ((byte & 0xe0) == 0x20) {
+            /* Novo tamanho da tabela dinâmica, até o anunciado (o padrão) */
+            if (hpack_ler_inteiro(&p, fim, 5, &indice) != 0 || indice > HPACK_TABELA_PADRAO) {
+                return -1;
+            }
+            t->maximo = indice;
+            tabela_ajustar(t, t->maximo);
+            continue;
+        }
+    
+        /* Literal com indexação (01), sem indexação (0000) ou nunca
+           indexado (0001) */
+        int indexar = (byte & 0xc0) == 0x40;
+        char *nome_lido;
+        if (hpack_ler_inteiro(&p, fim, indexar ? 6 : 4, &indice) != 0) {
+            return -1;
+        }
+        if (indice > 0) {
+            if (tabela_campo(t, indice, &nome, &valor) != 0) {
+                return -1;
+            }
+            nome_lido = strdup(nome);
+        } else {
+            nome_lido = hpack_ler_texto(&p, fim);
+        }
+        char *valor_lido = nome_lido ? hpack_ler_texto(&p, fim) : NULL;
+        if (!valor_lido) {
+            free(nome_lido);
+            return -1;
+        }
+    
+        copiar_caminho(caminho, tamanho_caminho, nome_lido, valor_lido);
+        if (indexar) {
+            tabela_inserir(t, nome_lido, valor_lido);
+        } else {
+            free(nome_lido);
+            free(valor_lido);
+        }
+    }
+    
+    return 0;
+}
+
+static uint32_t ler_32(const unsigned char *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void h2_frame(Conexao *c, int tipo, int flags, uint32_t fluxo, const void *carga, size_t tamanho) {
+    unsigned char cabecalho[H2_CABECALHO_FRAME] = {
+        (unsigned char)(tamanho >> 16), (unsigned char)(tamanho >> 8), (unsigned char)tamanho,
+        (unsigned char)tipo, (unsigned char)flags,
+        (unsigned char)((fluxo >> 24) & 0x7f), (unsigned char)(fluxo >> 16),
+        (unsigned char)(fluxo >> 8), (unsigned char)fluxo
+    };
+    
+    buffer_adicionar(&c->saida, cabecalho, sizeof(cabecalho));
+    if (tamanho > 0) {
+        buffer_adicionar(&c->saida, carga, tamanho);
+    }
+}
+
+/* Encerra a conexão por erro de protocolo, avisando o cliente */
+static void h2_abandonar(Servidor *s, Conexao *c, uint32_t erro) {
+    unsigned char carga[8] = {0, 0, 0, 0, erro >> 24, erro >> 16, erro >> 8, erro};
+    
+    h2_frame(c, H2_GOAWAY, 0, 0, carga, sizeof(carga));
+    enviar(s, c);
+    fechar(s, c);
+}
+
+/* ========================================================================
+   FUNÇÃO: h2_escoar
+   ========================================================================
+   Envia em frames DATA o corpo das respostas cujos cabeçalhos já
+   saíram, na ordem em que ficaram prontas, enquanto houver janela na
+   conexão e no stream. Uma resposta sem janela segura as seguintes até
+   o cliente mandar WINDOW_UPDATE (com as janelas que o curl anuncia,
+   nunca acontece com estes corpos pequenos).
+   ======================================================================== */
+static void h2_escoar(Conexao *c) {
+    while (c->fila) {
+        Resposta *r = c->fila;
+    
+        while (r->enviado < r->corpo.tamanho) {
+            long n = (long)(r->corpo.tamanho - r->enviado);
+            if (n > H2_MAX_FRAME) n = H2_MAX_FRAME;
+            if (n > c->janela) n = c->janela;
+            if (n > r->janela) n = r->janela;
+            if (n <= 0) {
+                return;
+            }
+            int fim = r->enviado + n == r->corpo.tamanho;
+            h2_frame(c, H2_DATA, fim ? H2_FIM_FLUXO : 0, r->fluxo, r->corpo.dados + r->enviado, n);
+            r->enviado += n;
+            c->janela -= n;
+            r->janela -= n;
+        }
+    
+        c->fila = r->proxima;
+        liberar_resposta(r);
+    }
+    c->fim_fila = NULL;
+}
+
+/* ========================================================================
+   FUNÇÃO: h2_entregar
+   ========================================================================
+   A resposta saiu do heap: envia os cabeçalhos (HEADERS) e põe o corpo
+   na fila de h2_escoar.
+   ======================================================================== */
+static void h2_entregar(Conexao *c, Resposta *r) {
+    Buffer campos = {0};
+    char numero[32];
+    
+    snprintf(numero, sizeof(numero), "%d", r->status);
+    hpack_escrever_campo(&campos, 8, numero);                   /* :status */
+    hpack_escrever_campo(&campos, 31, "application/json");      /* content-type */
+    snprintf(numero, sizeof(numero), "%zu", r->corpo.tamanho);
+    hpack_escrever_campo(&campos, 28, numero);                  /* content-length */
+    if (r->status == 429) {
+        hpack_escrever_campo(&campos, 53, "1");                 /* retry-after */
+    }
+    h2_frame(c, H2_HEADERS, H2_FIM_CABECALHOS | (r->corpo.tamanho ? 0 : H2_FIM_FLUXO), r->fluxo,
+             campos.dados, campos.tamanho);
+    free(campos.dados);
+    
+    r->janela = c->janela_inicial;
+    r->proxima = NULL;
+    if (c->fim_fila) {
+        c->fim_fila->proxima = r;
+    } else {
+        c->fila = r;
+    }
+    c->fim_fila = r;
+    h2_escoar(c);
+}
+
+/* Cancela a resposta de um stream que o cliente abandonou (RST_STREAM):
+   no heap ela é só marcada; na fila de envio, sai dela */
+static void h2_cancelar(Servidor *s, Conexao *c, uint32_t fluxo) {
+    for (int i = 0; i < s->tamanho_heap; i++) {
+        if (s->heap[i]->conexao == c && s->heap[i]->fluxo == fluxo) {
+            s->heap[i]->cancelada = 1;
+            return;
+        }
+    }
+    
+    Resposta *anterior = NULL;
+    for (Resposta *r = c->fila; r; anterior = r, r = r->proxima) {
+        if (r->fluxo != fluxo) {
+            continue;
+        }
+        if (anterior) {
+            anterior->proxima = r->proxima;
+        } else {
+            c->fila = r->proxima;
+        }
+        if (c->fim_fila == r) {
+            c->fim_fila = anterior;
+        }
+        liberar_resposta(r);
+        return;
+    }
+}
+
+static void h2_requisicao(Servidor *s, Conexao *c, uint32_t fluxo, const unsigned char *bloco, size_t tamanho) {
+    char caminho[TAMANHO_REQUISICAO];
+    
+    caminho[0] = '\0';
+    if (hpack_decodificar(&c->tabela, bloco, tamanho, caminho, sizeof(caminho)) != 0) {
+        h2_abandonar(s, c, H2_ERRO_COMPRESSAO);
+        return;
+    }
+    preparar_resposta(s, c, caminho, fluxo);
+}
+
+/* ========================================================================
+   FUNÇÃO: h2_configurar
+   ========================================================================
+   Aplica um SETTINGS do cliente e confirma. Só a janela inicial importa
+   aqui: a diferença vale também para os streams já abertos.
+   ======================================================================== */
+static int h2_configurar(Conexao *c, const unsigned char *carga, size_t tamanho) {
+    if (tamanho % 6 != 0) {
+        return -1;
+    }
+    
+    for (size_t i = 0; i < tamanho; i += 6) {
+        unsigned int id = (unsigned int)carga[i] << 8 | carga[i + 1];
+        uint32_t valor = ler_32(carga + i + 2);
+        if (id != H2_CONFIG_JANELA_INICIAL) {
+            continue;
+        }
+        if (valor > H2_JANELA_MAXIMA) {
+            return -1;
+        }
+        for (Resposta *r = c->fila; r; r = r->proxima) {
+            r->janela += (long)valor - c->janela_inicial;
+        }
+        c->janela_inicial = valor;
+    }
+    
+    h2_frame(c, H2_SETTINGS, H2_ACK, 0, NULL, 0);
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: h2_frame_recebido
+   ========================================================================
+   Trata um frame completo do cliente. Retorna -1 se a conexão deve cair
+   (já com o GOAWAY enviado).
+   ======================================================================== */
+static int h2_frame_recebido(Servidor *s, Conexao *c, int tipo, int flags, uint32_t fluxo,
+                             const unsigned char *carga, size_t tamanho) {
+    /* Um bloco de cabeçalhos aberto só pode continuar com CONTINUATION */
+    if (c->fluxo_bloco && (tipo != H2_CONTINUATION || fluxo != c->fluxo_bloco)) {
+        h2_abandonar(s, c, H2_ERRO_PROTOCOLO);
+        return -1;
+    }
+    
+    switch (tipo) {
+        case H2_SETTINGS:
+            if (!(flags & H2_ACK) && h2_configurar(c, carga, tamanho) != 0) {
+                h2_abandonar(s, c, H2_ERRO_PROTOCOLO);
+                return -1;
+            }
+            break;
+    
+        case H2_PING:
+            if (!(flags & H2_ACK) && tamanho == 8) {
+                h2_frame(c, H2_PING, H2_ACK, 0, carga, tamanho);
+            }
+            break;
+    
+        case H2_WINDOW_UPDATE: {
+            if (tamanho != 4) {
+                h2_abandonar(s, c, H2_ERRO_PROTOCOLO);
+                return -1;
+            }
+            uint32_t incremento = ler_32(carga) & 0x7fffffff;
+            if (fluxo == 0) {
+                c->janela += incremento;
+                if (c->janela > H2_JANELA_MAXIMA) {
+                    h2_abandonar(s, c, H2_ERRO_FLUXO);
+                    return -1;
+                }
+            } else {
+                for (Resposta *r = c->fila; r; r = r->proxima) {
+                    if (r->fluxo == fluxo) {
+                        r->janela += incremento;
+                        break;
+                    }
+                }
+            }
+            h2_escoar(c);
+            break;
+        }
+    
+        case H2_RST_STREAM:
+            h2_cancelar(s, c, fluxo);
+            break;
+    
+        case H2_GOAWAY:
+            fechar(s, c);
+            return -1;
+    
+        case H2_HEADERS: {
+            size_t inicio = 0;
+            size_t preenchimento = 0;
+            if (flags & H2_PREENCHIDO) {
+                preenchimento = tamanho > 0 ? carga[0] : tamanho;
+                inicio = 1;
+            }
+            if (flags & H2_PRIORIDADE) {
+                inicio += 5;
+            }
+            if (fluxo == 0 || inicio + preenchimento > tamanho) {
+                h2_abandonar(s, c, H2_ERRO_PROTOCOLO);
+                return -1;
+            }
+            if (flags & H2_FIM_CABECALHOS) {
+                h2_requisicao(s, c, fluxo, carga + inicio, tamanho - inicio - preenchimento);
+            } else {
+                c->bloco.tamanho = 0;
+                buffer_adicionar(&c->bloco, carga + inicio, tamanho - inicio - preenchimento);
+                c->fluxo_bloco = fluxo;
+            }
+            break;
+        }
+    
+        case H2_CONTINUATION:
+            if (!c->fluxo_bloco) {
+                h2_abandonar(s, c, H2_ERRO_PROTOCOLO);
+                return -1;
+            }
+            buffer_adicionar(&c->bloco, carga, tamanho);
+            if (flags & H2_FIM_CABECALHOS) {
+                c->fluxo_bloco = 0;
+                h2_requisicao(s, c, fluxo, (unsigned char *)c->bloco.dados, c->bloco.tamanho);
+            }
+            break;
+    
+        default:
+            /* DATA (GETs não têm corpo), PRIORITY e tipos desconhecidos */
+            break;
+    }
+    
+    return c->fd >= 0 ? 0 : -1;
+}
+
+/* ========================================================================
+   FUNÇÃO: h2_processar
+   ========================================================================
+   Trata todos os frames completos do buffer de entrada; um frame pela
+   metade espera o resto. Tudo o que os frames geraram (ACKs, PINGs,
+   corpos liberados por WINDOW_UPDATE) sai de uma vez no fim.
+   ======================================================================== */
+static void h2_processar(Servidor *s, Conexao *c) {
+    size_t inicio = 0;
+    
+    while (c->tamanho_entrada - inicio >= H2_CABECALHO_FRAME) {
+        const unsigned char *f = (const unsigned char *)c->entrada + inicio;
+        size_t tamanho = (size_t)f[0] << 16 | (size_t)f[1] << 8 | f[2];
+    
+        if (tamanho > H2_MAX_FRAME) {
+            h2_abandonar(s, c, H2_ERRO_PROTOCOLO);
+            return;
+        }
+        if (c->tamanho_entrada - inicio < H2_CABECALHO_FRAME + tamanho) {
+            break;
+        }
+        if (h2_frame_recebido(s, c, f[3], f[4], ler_32(f + 5) & 0x7fffffff,
+                              f + H2_CABECALHO_FRAME, tamanho) != 0) {
+            return;
+        }
+        inicio += H2_CABECALHO_FRAME + tamanho;
+    }
+    
+    memmove(c->entrada, c->entrada + inicio, c->tamanho_entrada - inicio);
+    c->tamanho_entrada -= inicio;
+    enviar(s, c);
+}
+
+/* Troca a conexão para HTTP/2 depois do prefácio do cliente, anunciando
+   quantos streams ela aceita ao mesmo tempo */
+static void h2_iniciar(Servidor *s, Conexao *c) {
+    unsigned char configuracao[6] = {
+        0, H2_CONFIG_MAX_FLUXOS,
+        (unsigned char)(s->fluxos >> 24), (unsigned char)(s->fluxos >> 16),
+        (unsigned char)(s->fluxos >> 8), (unsigned char)s->fluxos
+    };
+    
+    c->http2 = 1;
+    c->janela = H2_JANELA_PADRAO;
+    c->janela_inicial = H2_JANELA_PADRAO;
+    c->tabela.maximo = HPACK_TABELA_PADRAO;
+    memmove(c->entrada, c->entrada + H2_TAMANHO_PREFACIO, c->tamanho_entrada - H2_TAMANHO_PREFACIO);
+    c->tamanho_entrada -= H2_TAMANHO_PREFACIO;
+    h2_frame(c, H2_SETTINGS, 0, 0, configuracao, sizeof(configuracao));
+    s->conexoes_http2++;
+}
+
+/* ========================================================================
+   FUNÇÃO: entregar
+   ========================================================================
+   Envia uma resposta que saiu do heap: no HTTP/1.1, cabeçalho e corpo
+   de uma vez; no HTTP/2, pelo stream da requisição.
+   ======================================================================== */
+static void entregar(Servidor *s, Resposta *r) {
+    Conexao *c = r->conexao;
+    
+    if (r->fluxo) {
+        h2_entregar(c, r);
+        enviar(s, c);
+        return;
+    }
+    
+    const char *motivo = r->status == 200 ? "OK" : r->status == 503 ? "Service Unavailable" :
+                         r->status == 429 ? "Too Many Requests" : "Not Found";
+    escrever(&c->saida, "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n%s"
+                        "Content-Length: %zu\r\n\r\n",
+             r->status, motivo, r->status == 429 ? "Retry-After: 1\r\n" : "", r->corpo.tamanho);
+    buffer_adicionar(&c->saida, r->corpo.dados, r->corpo.tamanho);
+    liberar_resposta(r);
+    enviar(s, c);
+}
+
+/* Atende a próxima requisição completa do buffer de entrada, se houver.
+   Uma conexão que começa com o prefácio do HTTP/2 passa a falar h2c. */
+static void processar(Servidor *s, Conexao *c) {
+    char *fim;
+    
+    if (c->fd < 0 || c->tamanho_entrada == 0) {
+        return;
+    }
+    if (c->http2) {
+        h2_processar(s, c);
+        return;
+    }
+    if (c->requisicoes == 0 && c->entrada[0] == 'P' && !s->somente_http1) {
+        size_t n = c->tamanho_entrada < H2_TAMANHO_PREFACIO ? c->tamanho_entrada : H2_TAMANHO_PREFACIO;
+        if (memcmp(c->entrada, H2_PREFACIO, n) == 0) {
+            if (n == H2_TAMANHO_PREFACIO) {
+                h2_iniciar(s, c);
+                h2_processar(s, c);
+            }
+            return;
+        }
+    }
+    
+    if (c->pendentes || c->saida.tamanho > 0) {
+        return;
+    }
+    c->entrada[c->tamanho_entrada] = '\0';
+    fim = strstr(c->entrada, "\r\n\r\n");
+    if (!fim) {
+        if (c->tamanho_entrada >= sizeof(c->entrada) - 1) {
+            fechar(s, c);
+        }
+        return;
+    }
+    
+    size_t consumido = (size_t)(fim - c->entrada) + 4;
+    char *caminho = strchr(c->entrada, ' ');
+    if (!caminho) {
+        fechar(s, c);
+        return;
+    }
+    caminho++;
+    caminho[strcspn(caminho, " \r")] = '\0';
+    preparar_resposta(s, c, caminho, 0);
+    
+    memmove(c->entrada, c->entrada + consumido, c->tamanho_entrada - consumido);
+    c->tamanho_entrada -= consumido;
+}
+
+/* Lê até o socket esvaziar. Com o buffer cheio, atende o que já veio
+   antes de continuar: com TLS, o que o OpenSSL já decifrou não volta a
+   acordar o epoll. */
+static void ler(Servidor *s, Conexao *c) {
+    for (;;) {
+        size_t livre = sizeof(c->entrada) - 1 - c->tamanho_entrada;
+        if (livre == 0) {
+            processar(s, c);
+            if (c->fd < 0 || c->tamanho_entrada == sizeof(c->entrada) - 1) {
+                return;
+            }
+            continue;
+        }
+        ssize_t n = receber(c, c->entrada + c->tamanho_entrada, livre);
+        if (n > 0) {
+            c->tamanho_entrada += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        fechar(s, c);
+        return;
+    }
+    
+    processar(s, c);
+}
+
+static void exibir_uso(const char *programa) {
+    fprintf(stderr, "\nUso: %s [-p PORTA] [-l LATENCIA_MS] [-j JITTER_MS] [-t PCT:MS] [-e PCT] [-r N] [-s N]\n"
+                    "       [-T CERTIFICADO] [-1] [-f DIR]\n", programa);
+    fprintf(stderr, "  -p, --porta N     Porta de escuta (padrão: 18081)\n");
+    fprintf(stderr, "  -l, --latencia N  Atraso fixo de cada resposta em ms (padrão: 0)\n");
+    fprintf(stderr, "  -j, --jitter N    Atraso aleatório adicional, de 0 a N ms (padrão: 0)\n");
+    fprintf(stderr, "  -t, --cauda P:N   P%% das respostas atrasam mais N ms (ex.: 2:3000)\n");
+    fprintf(stderr, "  -e, --erros P     P%% das respostas saem como 503\n");
+    fprintf(stderr, "  -r, --limite N    Acima de N requisições por segundo responde 429 (Retry-After: 1)\n");
+    fprintf(stderr, "  -s, --fluxos N    Streams simultâneos por conexão HTTP/2 (padrão: %d)\n", FLUXOS_PADRAO);
+    fprintf(stderr, "  -T, --tls ARQ     Atende por TLS (HTTP/2 por ALPN), com um certificado autoassinado\n"
+                    "                    gerado na partida e gravado em ARQ (para o --cacert do cliente)\n");
+    fprintf(stderr, "  -1, --http1       Só HTTP/1.1: não oferece h2 no ALPN nem aceita o prefácio do HTTP/2\n");
+    fprintf(stderr, "  -f, --fixtures D  Responde com os arquivos gravados em D (ex.: bench/fixtures)\n\n");
+}
+
+int main(int argc, char *argv[]) {
+    Servidor s;
+    struct epoll_event eventos[EVENTOS];
+    struct sockaddr_in endereco;
+    int porta = 18081;
+    const char *arquivo_certificado = NULL;
+    int um = 1;
+    int opt;
+    
+    static const struct option opcoes[] = {
+        {"porta",    required_argument, NULL, 'p'},
+        {"latencia", required_argument, NULL, 'l'},
+        {"jitter",   required_argument, NULL, 'j'},
+        {"cauda",    required_argument, NULL, 't'},
+        {"erros",    required_argument, NULL, 'e'},
+        {"limite",   required_argument, NULL, 'r'},
+        {"fluxos",   required_argument, NULL, 's'},
+        {"tls",      required_argument, NULL, 'T'},
+        {"http1",    no_argument,       NULL, '1'},
+        {"fixtures", required_argument, NULL, 'f'},
+        {"help",     no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    memset(&s, 0, sizeof(s));
+    s.fluxos = FLUXOS_PADRAO;
+    while ((opt = getopt_long(argc, argv, "p:l:j:t:e:r:s:T:1f:h", opcoes, NULL)) != -1) {
+        switch (opt) {
+            case 'p': porta = atoi(optarg); break;
+            case 'l': s.latencia_ms = atof(optarg); break;
+            case 'j': s.jitter_ms = atof(optarg); break;
+            case 't':
+                if (sscanf(optarg, "%lf:%lf", &s.cauda_fracao, &s.cauda_ms) != 2) {
+                    exibir_uso(argv[0]);
+                    return 1;
+                }
+                s.cauda_fracao /= 100;
+                break;
+            case 'e': s.erros_fracao = atof(optarg) / 100; break;
+            case 'r': s.limite = atoi(optarg); break;
+            case 's':
+                s.fluxos = atoi(optarg);
+                if (s.fluxos <= 0) {
+                    exibir_uso(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'T':
+                arquivo_certificado = optarg;
+                break;
+            case '1': s.somente_http1 = 1; break;
+            case 'f':
+                if (carregar_fixtures(&s, optarg) != 0) {
+                    return 1;
+                }
+                break;
+            default:
+                exibir_uso(argv[0]);
+                return 1;
+        }
+    }
+    
+    int escuta = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    setsockopt(escuta, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+    memset(&endereco, 0, sizeof(endereco));
+    endereco.sin_family = AF_INET;
+    endereco.sin_port = htons((uint16_t)porta);
+    endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(escuta, (struct sockaddr *)&endereco, sizeof(endereco)) != 0 || listen(escuta, SOMAXCONN) != 0) {
+        perror("[ERRO] Não foi possível escutar na porta");
+        return 1;
+    }
+    
+    s.epoll = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    epoll_ctl(s.epoll, EPOLL_CTL_ADD, escuta, &ev);
+    
+    if (arquivo_certificado) {
+        s.tls = criar_contexto_tls(&s, arquivo_certificado);
+        if (!s.tls) {
+            fprintf(stderr, "[ERRO] Falha ao preparar o TLS\n");
+            return 1;
+        }
+    }
+    
+    signal(SIGINT, tratar_sinal);
+    signal(SIGTERM, tratar_sinal);
+    signal(SIGPIPE, SIG_IGN);       /* o SSL_write não tem MSG_NOSIGNAL */
+    srand((unsigned)time(NULL));
+    huffman_iniciar();
+    
+    fprintf(stderr, "[MOCK] Escutando em %s://127.0.0.1:%d (latência %.1f ms + jitter até %.1f ms, %s; %s)\n",
+            s.tls ? "https" : "http", porta, s.latencia_ms, s.jitter_ms,
+            s.fixtures ? "fixtures" : "dados sintéticos",
+            s.somente_http1 ? "só HTTP/1.1" : s.tls ? "HTTP/1.1 e HTTP/2 por ALPN" : "HTTP/1.1 e h2c");
+    
+    while (!parar) {
+        int espera = -1;
+        if (s.tamanho_heap > 0) {
+            double restante = s.heap[0]->envio - agora_ms();
+            espera = restante > 0 ? (int)restante + 1 : 0;
+        }
+    
+        int n = epoll_wait(s.epoll, eventos, EVENTOS, espera);
+        for (int i = 0; i < n; i++) {
+            Conexao *c = (Conexao *)eventos[i].data.ptr;
+    
+            if (!c) {
+                int fd;
+                while ((fd = accept4(escuta, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    c = calloc(1, sizeof(Conexao));
+                    c->fd = fd;
+                    s.conexoes++;
+                    if (s.tls) {
+                        c->ssl = SSL_new(s.tls);
+                        SSL_set_fd(c->ssl, fd);
+                        SSL_set_accept_state(c->ssl);
+                    }
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+                    memset(&ev, 0, sizeof(ev));
+                    ev.events = EPOLLIN;
+                    ev.data.ptr = c;
+                    epoll_ctl(s.epoll, EPOLL_CTL_ADD, fd, &ev);
+                }
+                continue;
+            }
+    
+            if (c->fd < 0) {
+                continue;
+            }
+            if (eventos[i].events & EPOLLOUT) {
+                enviar(&s, c);
+            }
+            if (c->fd >= 0 && (eventos[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                ler(&s, c);
+            }
+        }
+    
+        double agora = agora_ms();
+        while (s.tamanho_heap > 0 && s.heap[0]->envio <= agora) {
+            Resposta *r = heap_remover(&s);
+            Conexao *c = r->conexao;
+            c->pendentes--;
+            if (c->fechada || r->cancelada) {
+                liberar_resposta(r);
+                if (c->fechada && c->pendentes == 0) {
+                    c->proxima_liberar = s.liberar;
+                    s.liberar = c;
+                }
+                continue;
+            }
+            entregar(&s, r);
+        }
+    
+        while (s.liberar) {
+            Conexao *c = s.liberar;
+            s.liberar = c->proxima_liberar;
+            liberar_conexao(c);
+        }
+    }
+    
+    fprintf(stderr, "\n[MOCK] %ld requisições atendidas (%ld recusadas com 429) em %ld conexões "
+            "(%ld com HTTP/2)\n", s.requisicoes, s.recusadas, s.conexoes, s.conexoes_http2);
+    close(escuta);
+    close(s.epoll);
+    free(s.heap);
+    SSL_CTX_free(s.tls);
+    for (int i = 0; i < s.total_fixtures; i++) {
+        free(s.fixtures[i].conteudo);
+    }
+    free(s.fixtures);
+    
+    return 0;
+}
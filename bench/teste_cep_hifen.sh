@@ -0,0 +1,46 @@
+#!/bin/sh
+# CEP com hífen seguido do mesmo CEP sem hífen, contra o servidor
+# simulado: as duas formas têm que ir à mesma URL e dividir as chaves de
+# cache, sem que uma resposta errada de uma delas vá para o cache de
+# CEPs inexistentes (nem para o snapshot, na execução seguinte).
+#
+# Uso: bench/teste_cep_hifen.sh
+
+PORTA_MOCK=${PORTA_MOCK:-18084}
+URL="http://127.0.0.1:$PORTA_MOCK"
+URLS="--url-viacep $URL --url-ibge $URL --url-brasilapi $URL"
+SNAPSHOT=$(mktemp -u)
+SAIDA=$(mktemp)
+
+cd "$(dirname "$0")/.." || exit 1
+
+./bench/mock_upstream --porta "$PORTA_MOCK" 2> /dev/null &
+MOCK=$!
+trap 'kill -INT $MOCK 2>/dev/null; wait $MOCK 2>/dev/null; rm -f "$SNAPSHOT" "$SAIDA"' EXIT
+sleep 0.3
+
+conferir() {
+    DESCRICAO=$1
+    ESPERADAS=$2
+    if [ "$(grep -c "	OK	" "$SAIDA")" -ne "$ESPERADAS" ]; then
+        echo "✗ $DESCRICAO:"
+        cat "$SAIDA"
+        exit 1
+    fi
+    echo "✓ $DESCRICAO"
+}
+
+printf "01310-100\n01310100\n" | ./integrador_apis --lote - --concorrencia 1 --snapshot "$SNAPSHOT" $URLS \
+    > "$SAIDA" 2> /dev/null
+conferir "lote com e sem hífen" 2
+
+printf "01310100\n" | ./integrador_apis --lote - --snapshot "$SNAPSHOT" $URLS > "$SAIDA" 2> /dev/null
+conferir "CEP sem hífen depois do snapshot" 1
+
+./integrador_apis 01310-100 $URLS > "$SAIDA" 2>&1
+if ! grep -q "/ws/01310100/json/" "$SAIDA"; then
+    echo "✗ consulta única com hífen:"
+    cat "$SAIDA"
+    exit 1
+fi
+echo "✓ consulta única com hífen"
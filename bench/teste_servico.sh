@@ -0,0 +1,24 @@
+#!/bin/sh
+# Teste de carga do modo serviço contra o servidor simulado das APIs.
+#
+# Uso: bench/teste_servico.sh [CONEXOES] [DURACAO_S] [LATENCIA_MS] [JITTER_MS]
+
+CONEXOES=${1:-64}
+DURACAO=${2:-10}
+LATENCIA=${3:-20}
+JITTER=${4:-10}
+PORTA_MOCK=${PORTA_MOCK:-18081}
+PORTA_SERVICO=${PORTA_SERVICO:-18090}
+URL="http://127.0.0.1:$PORTA_MOCK"
+
+cd "$(dirname "$0")/.." || exit 1
+
+./bench/mock_upstream --porta "$PORTA_MOCK" --latencia "$LATENCIA" --jitter "$JITTER" &
+MOCK=$!
+./integrador_apis --servico "$PORTA_SERVICO" \
+    --url-viacep "$URL" --url-ibge "$URL" --url-brasilapi "$URL" &
+SERVICO=$!
+trap 'kill -INT $SERVICO $MOCK 2>/dev/null; wait $SERVICO $MOCK 2>/dev/null' EXIT
+
+sleep 0.5
+./bench/carga --porta "$PORTA_SERVICO" --conexoes "$CONEXOES" --duracao "$DURACAO"
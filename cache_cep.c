@@ -0,0 +1,336 @@
+#define _GNU_SOURCE  /* mremap */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cache_cep.h"
+
+/* ========================================================================
+   CACHE DE CEPs EM ARQUIVO MAPEADO
+   ========================================================================
+   O arquivo tem três regiões:
+   
+   1. Cabeçalho (uma página): identificação, versão e contadores.
+   2. Índice: tabela hash de endereçamento aberto com 'capacidade_indice'
+      slots de 64 bits. Cada slot guarda (CEP + 1) nos 32 bits altos e o
+      número do registro nos 32 bits baixos; 0 indica slot vazio.
+   3. Registros: DadosEndereco de tamanho fixo, só acrescentados ao final.
+   
+   Uma busca calcula o hash do CEP numérico e sonda poucos slots, sem
+   ler o resto do arquivo: um processo recém-iniciado encontra CEPs já
+   gravados tocando só as páginas necessárias.
+   
+   Concorrência entre processos: quem grava segura flock(LOCK_EX) durante
+   a inserção, escreve o registro primeiro e só depois publica o slot com
+   um store atômico de 64 bits. Leitores não usam trava: um slot visível
+   sempre aponta para um registro completo. Se o registro estiver além
+   da região mapeada (o arquivo cresceu em outro processo), o leitor
+   remapeia antes de copiar.
+   ======================================================================== */
+
+#define CACHE_CEP_MAGICO "CEPCACHE"
+#define CACHE_CEP_VERSAO 1
+#define CACHE_CEP_TAMANHO_CABECALHO 4096
+#define CACHE_CEP_CAPACIDADE_INDICE (1u << 22)   /* ~4M slots, 32 MB esparsos */
+#define CACHE_CEP_REGISTROS_INICIAIS 1024
+#define CACHE_CEP_CARGA_MAXIMA 0.7
+
+typedef struct {
+    char magico[8];
+    uint32_t versao;
+    uint32_t tamanho_registro;
+    uint32_t capacidade_indice;
+    uint32_t total_registros;       /* atualizado atomicamente */
+    uint32_t capacidade_registros;  /* atualizado atomicamente */
+} CabecalhoCacheCEP;
+
+typedef struct {
+    uint32_t cep;
+    uint32_t gravado_em;            /* segundos desde a época */
+    DadosEndereco endereco;
+} RegistroCEP;
+
+static CabecalhoCacheCEP *cabecalho(CacheCEP *cache) {
+    return (CabecalhoCacheCEP *)cache->mapa;
+}
+
+static uint64_t *indice(CacheCEP *cache) {
+    return (uint64_t *)(cache->mapa + CACHE_CEP_TAMANHO_CABECALHO);
+}
+
+static size_t deslocamento_registro(uint32_t capacidade_indice, uint32_t numero) {
+    return CACHE_CEP_TAMANHO_CABECALHO + (size_t)capacidade_indice * sizeof(uint64_t)
+           + (size_t)numero * sizeof(RegistroCEP);
+}
+
+static uint32_t hash_cep(uint32_t cep, uint32_t capacidade) {
+    return (uint32_t)(((uint64_t)cep * 0x9E3779B97F4A7C15ull) >> 32) & (capacidade - 1);
+}
+
+/* ========================================================================
+   FUNÇÃO: cep_para_numero
+   ========================================================================
+   Converte "01310100" ou "01310-100" no número 1310100.
+   Retorna 0 se o CEP tem exatamente 8 dígitos, -1 caso contrário.
+   ======================================================================== */
+int cep_para_numero(const char *cep, uint32_t *numero) {
+    uint32_t valor = 0;
+    int digitos = 0;
+    
+    for (const char *p = cep; *p; p++) {
+        if (*p >= '0' && *p <= '9') {
+            valor = valor * 10 + (uint32_t)(*p - '0');
+            digitos++;
+        } else if (*p != '-' || digitos != 5) {
+            return -1;
+        }
+    }
+    
+    if (digitos != 8) {
+        return -1;
+    }
+    
+    *numero = valor;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: remapear
+   ========================================================================
+   Ajusta o mapeamento ao tamanho atual do arquivo.
+   ======================================================================== */
+static int remapear(CacheCEP *cache) {
+    struct stat st;
+    
+    if (fstat(cache->fd, &st) != 0) {
+        return -1;
+    }
+    if ((size_t)st.st_size == cache->tamanho_mapa) {
+        return 0;
+    }
+    
+    void *novo = mremap(cache->mapa, cache->tamanho_mapa, st.st_size, MREMAP_MAYMOVE);
+    if (novo == MAP_FAILED) {
+        fprintf(stderr, "[ERRO] Falha ao remapear cache de CEPs: %s\n", strerror(errno));
+        return -1;
+    }
+    
+    cache->mapa = novo;
+    cache->tamanho_mapa = st.st_size;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_cep_abrir
+   ========================================================================
+   Abre (ou cria) o arquivo de cache e o mapeia em memória. Se não houver
+   permissão de escrita, abre somente para leitura.
+   ======================================================================== */
+int cache_cep_abrir(CacheCEP *cache, const char *caminho) {
+    struct stat st;
+    int prot = PROT_READ | PROT_WRITE;
+    
+    memset(cache, 0, sizeof(*cache));
+    cache->escrita = 1;
+    cache->fd = open(caminho, O_RDWR | O_CREAT, 0644);
+    if (cache->fd < 0) {
+        cache->escrita = 0;
+        prot = PROT_READ;
+        cache->fd = open(caminho, O_RDONLY);
+    }
+    if (cache->fd < 0) {
+        fprintf(stderr, "[ERRO] Não foi possível abrir o cache de CEPs %s: %s\n",
+                caminho, strerror(errno));
+        return -1;
+    }
+    
+    /* Inicializa o arquivo novo sob trava, caso outro processo o crie junto */
+    if (cache->escrita) {
+        flock(cache->fd, LOCK_EX);
+        if (fstat(cache->fd, &st) == 0 && st.st_size == 0) {
+            CabecalhoCacheCEP novo = {0};
+            memcpy(novo.magico, CACHE_CEP_MAGICO, sizeof(novo.magico));
+            novo.versao = CACHE_CEP_VERSAO;
+            novo.tamanho_registro = sizeof(RegistroCEP);
+            novo.capacidade_indice = CACHE_CEP_CAPACIDADE_INDICE;
+            novo.capacidade_registros = CACHE_CEP_REGISTROS_INICIAIS;
+            if (ftruncate(cache->fd, deslocamento_registro(novo.capacidade_indice,
+                                                         novo.capacidade_registros)) != 0 ||
+                pwrite(cache->fd, &novo, sizeof(novo), 0) != (ssize_t)sizeof(novo)) {
+                fprintf(stderr, "[ERRO] Falha ao criar cache de CEPs: %s\n", strerror(errno));
+                flock(cache->fd, LOCK_UN);
+                close(cache->fd);
+                return -1;
+            }
+        }
+        flock(cache->fd, LOCK_UN);
+    }
+    
+    if (fstat(cache->fd, &st) != 0 || (size_t)st.st_size < CACHE_CEP_TAMANHO_CABECALHO) {
+        fprintf(stderr, "[ERRO] Cache de CEPs inválido: %s\n", caminho);
+        close(cache->fd);
+        return -1;
+    }
+    
+    cache->tamanho_mapa = st.st_size;
+    cache->mapa = mmap(NULL, cache->tamanho_mapa, prot, MAP_SHARED, cache->fd, 0);
+    if (cache->mapa == MAP_FAILED) {
+        fprintf(stderr, "[ERRO] Falha ao mapear cache de CEPs: %s\n", strerror(errno));
+        close(cache->fd);
+        return -1;
+    }
+    
+    CabecalhoCacheCEP *cab = cabecalho(cache);
+    if (memcmp(cab->magico, CACHE_CEP_MAGICO, sizeof(cab->magico)) != 0 ||
+        cab->versao != CACHE_CEP_VERSAO || cab->tamanho_registro != sizeof(RegistroCEP) ||
+        (cab->capacidade_indice & (cab->capacidade_indice - 1)) != 0) {
+        fprintf(stderr, "[ERRO] Cache de CEPs incompatível: %s\n", caminho);
+        cache_cep_fechar(cache);
+        return -1;
+    }
+    cache->capacidade_indice = cab->capacidade_indice;
+    
+    return 0;
+}
+
+void cache_cep_fechar(CacheCEP *cache) {
+    if (cache->mapa && cache->mapa != MAP_FAILED) {
+        munmap(cache->mapa, cache->tamanho_mapa);
+    }
+    if (cache->fd >= 0) {
+        close(cache->fd);
+    }
+    cache->mapa = NULL;
+    cache->fd = -1;
+}
+
+/* ========================================================================
+   FUNÇÃO: localizar_slot
+   ========================================================================
+   Sonda o índice a partir do hash do CEP. Retorna o valor do slot que
+   contém o CEP (ou 0 se não estiver no cache) e, em 'posicao', o slot
+   encontrado ou o primeiro slot vazio da sequência.
+   ======================================================================== */
+static uint64_t localizar_slot(CacheCEP *cache, uint32_t numero, uint32_t *posicao) {
+    uint64_t *slots = indice(cache);
+    uint32_t mascara = cache->capacidade_indice - 1;
+    uint32_t i = hash_cep(numero, cache->capacidade_indice);
+    
+    for (uint32_t sondas = 0; sondas < cache->capacidade_indice; sondas++, i = (i + 1) & mascara) {
+        uint64_t slot = __atomic_load_n(&slots[i], __ATOMIC_ACQUIRE);
+        if (slot == 0) {
+            *posicao = i;
+            return 0;
+        }
+        if ((uint32_t)(slot >> 32) == numero + 1) {
+            *posicao = i;
+            return slot;
+        }
+    }
+    
+    *posicao = cache->capacidade_indice;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_cep_buscar
+   ========================================================================
+   Retorna 1 e preenche 'endereco' se o CEP estiver no cache, 0 caso
+   contrário.
+   ======================================================================== */
+int cache_cep_buscar(CacheCEP *cache, const char *cep, DadosEndereco *endereco) {
+    uint32_t numero;
+    uint32_t posicao;
+    
+    if (cep_para_numero(cep, &numero) != 0) {
+        return 0;
+    }
+    
+    uint64_t slot = localizar_slot(cache, numero, &posicao);
+    if (slot == 0) {
+        cache->faltas++;
+        return 0;
+    }
+    
+    size_t deslocamento = deslocamento_registro(cache->capacidade_indice, (uint32_t)slot);
+    if (deslocamento + sizeof(RegistroCEP) > cache->tamanho_mapa &&
+        (remapear(cache) != 0 || deslocamento + sizeof(RegistroCEP) > cache->tamanho_mapa)) {
+        cache->faltas++;
+        return 0;
+    }
+    
+    const RegistroCEP *registro = (const RegistroCEP *)(cache->mapa + deslocamento);
+    memcpy(endereco, &registro->endereco, sizeof(*endereco));
+    cache->acertos++;
+    
+    return 1;
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_cep_gravar
+   ========================================================================
+   Acrescenta o endereço ao cache (se ainda não estiver lá). Cresce a
+   região de registros dobrando a capacidade quando necessário.
+   Retorna 0 em caso de sucesso e -1 em caso de erro ou cache cheio.
+   ======================================================================== */
+int cache_cep_gravar(CacheCEP *cache, const char *cep, const DadosEndereco *endereco) {
+    uint32_t numero;
+    uint32_t posicao;
+    int ret = -1;
+    
+    if (!cache->escrita || cep_para_numero(cep, &numero) != 0) {
+        return -1;
+    }
+    
+    flock(cache->fd, LOCK_EX);
+    
+    /* Outro processo pode ter crescido o arquivo desde o último acesso */
+    if (remapear(cache) != 0) {
+        goto fim;
+    }
+    
+    CabecalhoCacheCEP *cab = cabecalho(cache);
+    uint32_t total = __atomic_load_n(&cab->total_registros, __ATOMIC_ACQUIRE);
+    
+    if (localizar_slot(cache, numero, &posicao) != 0) {
+        ret = 0;
+        goto fim;
+    }
+    if (posicao >= cache->capacidade_indice ||
+        total + 1 > cache->capacidade_indice * CACHE_CEP_CARGA_MAXIMA) {
+        goto fim;
+    }
+    
+    if (total >= cab->capacidade_registros) {
+        uint32_t nova_capacidade = cab->capacidade_registros * 2;
+        if (ftruncate(cache->fd, deslocamento_registro(cache->capacidade_indice, nova_capacidade)) != 0 ||
+            remapear(cache) != 0) {
+            fprintf(stderr, "[ERRO] Falha ao crescer cache de CEPs: %s\n", strerror(errno));
+            goto fim;
+        }
+        cab = cabecalho(cache);
+        __atomic_store_n(&cab->capacidade_registros, nova_capacidade, __ATOMIC_RELEASE);
+    }
+    
+    /* Registro primeiro, slot depois: leitores nunca veem registro parcial */
+    RegistroCEP *registro = (RegistroCEP *)(cache->mapa +
+                            deslocamento_registro(cache->capacidade_indice, total));
+    registro->cep = numero;
+    registro->gravado_em = (uint32_t)time(NULL);
+    memcpy(&registro->endereco, endereco, sizeof(*endereco));
+    
+    __atomic_store_n(&cab->total_registros, total + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&indice(cache)[posicao], ((uint64_t)(numero + 1) << 32) | total,
+                     __ATOMIC_RELEASE);
+    ret = 0;
+    
+fim:
+    flock(cache->fd, LOCK_UN);
+    return ret;
+}
@@ -0,0 +1,26 @@
+#ifndef CACHE_CEP_H
+#define CACHE_CEP_H
+
+#include <stdint.h>
+#include "integrador__apis.h"
+
+/* Cache persistente de endereços em arquivo mapeado em memória.
+   Layout do arquivo (ver cache_cep.c):
+     [cabeçalho][índice hash: slots de 64 bits][registros de tamanho fixo] */
+struct CacheCEP {
+    int fd;
+    int escrita;                /* 0 = somente leitura */
+    unsigned char *mapa;
+    size_t tamanho_mapa;
+    uint32_t capacidade_indice;
+    long acertos;
+    long faltas;
+};
+
+int cache_cep_abrir(CacheCEP *cache, const char *caminho);
+void cache_cep_fechar(CacheCEP *cache);
+int cache_cep_buscar(CacheCEP *cache, const char *cep, DadosEndereco *endereco);
+int cache_cep_gravar(CacheCEP *cache, const char *cep, const DadosEndereco *endereco);
+int cep_para_numero(const char *cep, uint32_t *numero);
+
+#endif
@@ -0,0 +1,529 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "cache_feriados.h"
+#include "extrator_json.h"
+
+/* ========================================================================
+   CACHE DE FERIADOS
+   ========================================================================
+   A lista de feriados muda uma vez por ano, então é baixada uma única vez
+   por ano e processo (ou lida do diretório de persistência) e guardada
+   como um array compacto ordenado por dia, com as datas convertidas em
+   números de dia. "Próximo feriado a partir de X" vira uma busca binária;
+   se não restar nenhum no ano, a busca continua na tabela do ano seguinte.
+   
+   Cada tabela tem validade de 'ttl' segundos. Vencido o TTL, ela ainda é
+   servida por mais 'janela' segundos enquanto o motor a renova em
+   segundo plano (cache_feriados_ano_velho); depois disso, conta como
+   ausente e volta a ser baixada antes de responder.
+   ======================================================================== */
+
+/* ========================================================================
+   FUNÇÃO: dia_de_data
+   ========================================================================
+   Converte uma data do calendário civil em dias desde 1970-01-01
+   (algoritmo days_from_civil de H. Hinnant).
+   ======================================================================== */
+int dia_de_data(int ano, int mes, int dia) {
+    ano -= mes <= 2;
+    int era = (ano >= 0 ? ano : ano - 399) / 400;
+    int ano_da_era = ano - era * 400;
+    int dia_do_ano = (153 * (mes + (mes > 2 ? -3 : 9)) + 2) / 5 + dia - 1;
+    int dia_da_era = ano_da_era * 365 + ano_da_era / 4 - ano_da_era / 100 + dia_do_ano;
+    return era * 146097 + dia_da_era - 719468;
+}
+
+static void data_de_dia(int dias, char *data, size_t tamanho) {
+    dias += 719468;
+    int era = (dias >= 0 ? dias : dias - 146096) / 146097;
+    int dia_da_era = dias - era * 146097;
+    int ano_da_era = (dia_da_era - dia_da_era / 1460 + dia_da_era / 36524 - dia_da_era / 146096) / 365;
+    int dia_do_ano = dia_da_era - (365 * ano_da_era + ano_da_era / 4 - ano_da_era / 100);
+    int mp = (5 * dia_do_ano + 2) / 153;
+    int dia = dia_do_ano - (153 * mp + 2) / 5 + 1;
+    int mes = mp < 10 ? mp + 3 : mp - 9;
+    int ano = ano_da_era + era * 400 + (mes <= 2);
+    snprintf(data, tamanho, "%04d-%02d-%02d", ano, mes, dia);
+}
+
+static int comparar_feriados(const void *a, const void *b) {
+    const Feriado *fa = (const Feriado *)a;
+    const Feriado *fb = (const Feriado *)b;
+    return (fa->dia > fb->dia) - (fa->dia < fb->dia);
+}
+
+static void liberar_tabela(TabelaFeriados *tabela) {
+    free(tabela->feriados);
+    free(tabela->textos);
+    memset(tabela, 0, sizeof(*tabela));
+}
+
+/* ========================================================================
+   FUNÇÃO: guardar_texto
+   ========================================================================
+   Copia um texto para o pool da tabela e retorna seu deslocamento.
+   ======================================================================== */
+static int guardar_texto(TabelaFeriados *tabela, size_t *capacidade, const char *texto) {
+    size_t len = strlen(texto) + 1;
+    
+    if (tabela->tamanho_textos + len > UINT16_MAX) {
+        return -1;
+    }
+    if (tabela->tamanho_textos + len > *capacidade) {
+        size_t nova = *capacidade ? *capacidade * 2 : 1024;
+        while (nova < tabela->tamanho_textos + len) nova *= 2;
+        char *ptr = realloc(tabela->textos, nova);
+        if (!ptr) {
+            return -1;
+        }
+        tabela->textos = ptr;
+        *capacidade = nova;
+    }
+    
+    memcpy(tabela->textos + tabela->tamanho_textos, texto, len);
+    tabela->tamanho_textos += len;
+    return (int)(tabela->tamanho_textos - len);
+}
+
+/* Estado da extração de uma lista de feriados */
+typedef struct {
+    TabelaFeriados *tabela;
+    size_t capacidade_feriados;
+    size_t capacidade_textos;
+    char data[16];
+    char nome[256];
+    char tipo[64];
+    int falhou;
+} ColetorFeriados;
+
+enum {
+    CAMPO_DATA,
+    CAMPO_NOME,
+    CAMPO_TIPO,
+    CAMPO_FIM_FERIADO
+};
+
+static const CampoJSON CAMPOS_FERIADO[] = {
+    {"[].date", CAMPO_DATA},
+    {"[].name", CAMPO_NOME},
+    {"[].type", CAMPO_TIPO},
+    {"[]", CAMPO_FIM_FERIADO}
+};
+
+/* ========================================================================
+   FUNÇÃO: acrescentar_feriado
+   ========================================================================
+   Guarda na tabela o feriado cujos campos acabaram de ser lidos.
+   ======================================================================== */
+static void acrescentar_feriado(ColetorFeriados *coletor) {
+    TabelaFeriados *tabela = coletor->tabela;
+    int a, m, d;
+    
+    if (coletor->falhou || !coletor->nome[0] ||
+        sscanf(coletor->data, "%d-%d-%d", &a, &m, &d) != 3) {
+        return;
+    }
+    
+    if ((size_t)tabela->quantidade == coletor->capacidade_feriados) {
+        size_t nova = coletor->capacidade_feriados ? coletor->capacidade_feriados * 2 : 16;
+        Feriado *ptr = realloc(tabela->feriados, nova * sizeof(Feriado));
+        if (!ptr) {
+            coletor->falhou = 1;
+            return;
+        }
+        tabela->feriados = ptr;
+        coletor->capacidade_feriados = nova;
+    }
+    
+    int nome = guardar_texto(tabela, &coletor->capacidade_textos, coletor->nome);
+    int tipo = guardar_texto(tabela, &coletor->capacidade_textos,
+                             coletor->tipo[0] ? coletor->tipo : "national");
+    if (nome < 0 || tipo < 0) {
+        coletor->falhou = 1;
+        return;
+    }
+    
+    Feriado *f = &tabela->feriados[tabela->quantidade++];
+    f->dia = dia_de_data(a, m, d);
+    f->nome = (uint16_t)nome;
+    f->tipo = (uint16_t)tipo;
+}
+
+static void receber_feriado(void *destino, int campo, const char *valor, const char *chave) {
+    ColetorFeriados *coletor = (ColetorFeriados *)destino;
+    (void)chave;
+    
+    switch (campo) {
+        case CAMPO_DATA:
+            snprintf(coletor->data, sizeof(coletor->data), "%s", valor ? valor : "");
+            break;
+        case CAMPO_NOME:
+            snprintf(coletor->nome, sizeof(coletor->nome), "%s", valor ? valor : "");
+            break;
+        case CAMPO_TIPO:
+            snprintf(coletor->tipo, sizeof(coletor->tipo), "%s", valor ? valor : "");
+            break;
+        case CAMPO_FIM_FERIADO:
+            acrescentar_feriado(coletor);
+            coletor->data[0] = coletor->nome[0] = coletor->tipo[0] = '\0';
+            break;
+        default:
+            break;
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: montar_tabela
+   ========================================================================
+   Parseia a lista de feriados da Brasil API em uma tabela ordenada,
+   extraindo só data, nome e tipo de cada item (ver extrator_json.c).
+   ======================================================================== */
+static int montar_tabela(int ano, const char *json, TabelaFeriados *tabela) {
+    ExtratorJSON ex;
+    ColetorFeriados coletor;
+    
+    memset(tabela, 0, sizeof(*tabela));
+    memset(&coletor, 0, sizeof(coletor));
+    tabela->ano = ano;
+    tabela->atualizado = time(NULL);
+    coletor.tabela = tabela;
+    
+    json += strspn(json, " \t\r\n");
+    if (*json != '[') {
+        fprintf(stderr, "[ERRO] Resposta não é um array\n");
+        return -1;
+    }
+    
+    extrator_json_iniciar(&ex, CAMPOS_FERIADO, sizeof(CAMPOS_FERIADO) / sizeof(CAMPOS_FERIADO[0]),
+                          receber_feriado, &coletor);
+    extrator_json_alimentar(&ex, json, strlen(json));
+    
+    if (extrator_json_concluir(&ex) != 0 || coletor.falhou) {
+        fprintf(stderr, "[ERRO] Falha ao parsear JSON: %s\n",
+                coletor.falhou ? "sem memória" : extrator_json_erro(&ex));
+        liberar_tabela(tabela);
+        tabela->ano = ano;
+        return -1;
+    }
+    
+    qsort(tabela->feriados, tabela->quantidade, sizeof(Feriado), comparar_feriados);
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: buscar_tabela
+   ======================================================================== */
+static TabelaFeriados *buscar_tabela(CacheFeriados *cache, int ano) {
+    for (int i = 0; i < cache->total; i++) {
+        if (cache->anos[i].ano == ano) {
+            return &cache->anos[i];
+        }
+    }
+    return NULL;
+}
+
+/* ========================================================================
+   FUNÇÃO: instalar_tabela
+   ========================================================================
+   Guarda a tabela no cache, substituindo o ano mais antigo se cheio.
+   ======================================================================== */
+static void instalar_tabela(CacheFeriados *cache, TabelaFeriados *tabela) {
+    TabelaFeriados *destino = buscar_tabela(cache, tabela->ano);
+    
+    if (!destino && cache->total < CACHE_FERIADOS_MAX_ANOS) {
+        destino = &cache->anos[cache->total++];
+    } else if (!destino) {
+        destino = &cache->anos[0];
+        for (int i = 1; i < cache->total; i++) {
+            if (cache->anos[i].ano < destino->ano) {
+                destino = &cache->anos[i];
+            }
+        }
+    }
+    
+    liberar_tabela(destino);
+    *destino = *tabela;
+}
+
+/* ========================================================================
+   FUNÇÃO: ler_arquivo_ano / gravar_arquivo_ano
+   ========================================================================
+   Persistência opcional: a resposta da Brasil API de cada ano é guardada
+   como está em <diretorio>/feriados-<ano>.json. A data de modificação do
+   arquivo é a data em que a lista foi obtida.
+   ======================================================================== */
+static char *ler_arquivo_ano(const CacheFeriados *cache, int ano, time_t *modificado) {
+    char caminho[1024];
+    FILE *fp;
+    long tamanho;
+    char *conteudo;
+    struct stat st;
+    
+    snprintf(caminho, sizeof(caminho), "%s/feriados-%d.json", cache->diretorio, ano);
+    fp = fopen(caminho, "rb");
+    if (!fp) {
+        return NULL;
+    }
+    *modificado = fstat(fileno(fp), &st) == 0 ? st.st_mtime : 0;
+    
+    fseek(fp, 0, SEEK_END);
+    tamanho = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    
+    conteudo = tamanho > 0 ? malloc(tamanho + 1) : NULL;
+    if (conteudo && fread(conteudo, 1, tamanho, fp) != (size_t)tamanho) {
+        free(conteudo);
+        conteudo = NULL;
+    }
+    if (conteudo) {
+        conteudo[tamanho] = '\0';
+    }
+    
+    fclose(fp);
+    return conteudo;
+}
+
+static void gravar_arquivo_ano(const CacheFeriados *cache, int ano, const char *json) {
+    char caminho[1024];
+    char temporario[1100];
+    FILE *fp;
+    
+    snprintf(caminho, sizeof(caminho), "%s/feriados-%d.json", cache->diretorio, ano);
+    snprintf(temporario, sizeof(temporario), "%s.%d.tmp", caminho, (int)getpid());
+    
+    fp = fopen(temporario, "wb");
+    if (!fp) {
+        return;
+    }
+    size_t len = strlen(json);
+    int ok = fwrite(json, 1, len, fp) == len;
+    ok = (fclose(fp) == 0) && ok;
+    
+    /* rename é atômico: leitores nunca veem um arquivo pela metade */
+    if (!ok || rename(temporario, caminho) != 0) {
+        unlink(temporario);
+    }
+}
+
+void cache_feriados_iniciar(CacheFeriados *cache, const char *diretorio) {
+    memset(cache, 0, sizeof(*cache));
+    cache->diretorio = diretorio;
+}
+
+void cache_feriados_finalizar(CacheFeriados *cache) {
+    for (int i = 0; i < cache->total; i++) {
+        liberar_tabela(&cache->anos[i]);
+    }
+    cache->total = 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_feriados_carregar_json
+   ========================================================================
+   Instala a tabela de um ano a partir da resposta da Brasil API e, se
+   houver diretório de persistência, grava a resposta em disco.
+   ======================================================================== */
+int cache_feriados_carregar_json(CacheFeriados *cache, int ano, const char *json) {
+    TabelaFeriados tabela;
+    
+    if (montar_tabela(ano, json, &tabela) != 0) {
+        liberar_tabela(&tabela);
+        return -1;
+    }
+    
+    instalar_tabela(cache, &tabela);
+    cache->downloads++;
+    
+    if (cache->diretorio) {
+        gravar_arquivo_ano(cache, ano, json);
+    }
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_feriados_marcar_vazio
+   ========================================================================
+   Instala uma tabela vazia para o ano (usado quando o ano seguinte não
+   pôde ser obtido), evitando novas tentativas a cada consulta.
+   ======================================================================== */
+void cache_feriados_marcar_vazio(CacheFeriados *cache, int ano) {
+    TabelaFeriados tabela = {0};
+    tabela.ano = ano;
+    tabela.atualizado = time(NULL);
+    instalar_tabela(cache, &tabela);
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_feriados_restaurar
+   ========================================================================
+   Instala a tabela de um ano guardada em um snapshot (ver snapshot.c),
+   obtida em 'atualizado', conferindo a ordem dos dias e os
+   deslocamentos dos textos. Retorna 0 em caso de sucesso e -1 se os
+   dados forem inconsistentes ou faltar memória.
+   ======================================================================== */
+int cache_feriados_restaurar(CacheFeriados *cache, int ano, const Feriado *feriados, int quantidade,
+                             const char *textos, size_t tamanho_textos, time_t atualizado) {
+    TabelaFeriados tabela = {0};
+    
+    if (quantidade <= 0 || tamanho_textos == 0 || tamanho_textos > UINT16_MAX + 1u ||
+        textos[tamanho_textos - 1] != '\0') {
+        return -1;
+    }
+    
+    for (int i = 0; i < quantidade; i++) {
+        if (feriados[i].nome >= tamanho_textos || feriados[i].tipo >= tamanho_textos ||
+            (i > 0 && feriados[i].dia < feriados[i - 1].dia)) {
+            return -1;
+        }
+    }
+    
+    tabela.ano = ano;
+    tabela.quantidade = quantidade;
+    tabela.tamanho_textos = tamanho_textos;
+    tabela.atualizado = atualizado;
+    tabela.feriados = malloc(quantidade * sizeof(Feriado));
+    tabela.textos = malloc(tamanho_textos);
+    if (!tabela.feriados || !tabela.textos) {
+        liberar_tabela(&tabela);
+        return -1;
+    }
+    
+    memcpy(tabela.feriados, feriados, quantidade * sizeof(Feriado));
+    memcpy(tabela.textos, textos, tamanho_textos);
+    instalar_tabela(cache, &tabela);
+    return 0;
+}
+
+static int primeiro_a_partir_de(const TabelaFeriados *tabela, int dia) {
+    int inicio = 0;
+    int fim = tabela->quantidade;
+    
+    while (inicio < fim) {
+        int meio = inicio + (fim - inicio) / 2;
+        if (tabela->feriados[meio].dia < dia) {
+            inicio = meio + 1;
+        } else {
+            fim = meio;
+        }
+    }
+    
+    return inicio;
+}
+
+/* ========================================================================
+   FUNÇÃO: obter_tabela
+   ========================================================================
+   Busca a tabela em memória e, se não estiver, tenta o diretório de
+   persistência. Uma tabela vencida (além da janela de revalidação) conta
+   como ausente.
+   ======================================================================== */
+static TabelaFeriados *obter_tabela(CacheFeriados *cache, int ano) {
+    TabelaFeriados *tabela = buscar_tabela(cache, ano);
+    
+    if (!tabela && cache->diretorio) {
+        time_t modificado = 0;
+        char *json = ler_arquivo_ano(cache, ano, &modificado);
+        TabelaFeriados nova;
+        if (json && montar_tabela(ano, json, &nova) == 0) {
+            nova.atualizado = modificado;
+            instalar_tabela(cache, &nova);
+            tabela = buscar_tabela(cache, ano);
+        } else if (json) {
+            liberar_tabela(&nova);
+        }
+        free(json);
+    }
+    
+    if (tabela && estado_dado(tabela->atualizado, cache->ttl, cache->janela, time(NULL)) == DADO_VENCIDO) {
+        return NULL;
+    }
+    return tabela;
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_feriados_ano_pendente
+   ========================================================================
+   Retorna o ano cuja tabela precisa ser baixada para responder "próximo
+   feriado a partir de hoje", ou 0 se o cache já tem tudo o que precisa.
+   ======================================================================== */
+int cache_feriados_ano_pendente(CacheFeriados *cache, const struct tm *hoje) {
+    int ano = hoje->tm_year + 1900;
+    int dia = dia_de_data(ano, hoje->tm_mon + 1, hoje->tm_mday);
+    TabelaFeriados *tabela = obter_tabela(cache, ano);
+    
+    if (!tabela) {
+        return ano;
+    }
+    
+    if (primeiro_a_partir_de(tabela, dia) >= tabela->quantidade && !obter_tabela(cache, ano + 1)) {
+        return ano + 1;
+    }
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_feriados_ano_velho
+   ========================================================================
+   Retorna um ano (o atual ou seguinte) cuja tabela passou do TTL mas
+   ainda está sendo servida, para ser renovada em segundo plano, ou 0 se
+   nenhuma precisa.
+   ======================================================================== */
+int cache_feriados_ano_velho(CacheFeriados *cache, const struct tm *hoje) {
+    int ano = hoje->tm_year + 1900;
+    time_t agora = time(NULL);
+    
+    for (int i = 0; i < cache->total; i++) {
+        const TabelaFeriados *t = &cache->anos[i];
+        if (t->ano >= ano && estado_dado(t->atualizado, cache->ttl, cache->janela, agora) == DADO_VELHO) {
+            return t->ano;
+        }
+    }
+    return 0;
+}
+
+static void copiar_feriado(const TabelaFeriados *tabela, int indice, DadosFeriados *feriados) {
+    const Feriado *f = &tabela->feriados[indice];
+    
+    strncpy(feriados->proximo_feriado, tabela->textos + f->nome, sizeof(feriados->proximo_feriado) - 1);
+    strncpy(feriados->tipo_feriado, tabela->textos + f->tipo, sizeof(feriados->tipo_feriado) - 1);
+    data_de_dia(f->dia, feriados->data_feriado, sizeof(feriados->data_feriado));
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_feriados_preencher
+   ========================================================================
+   Preenche DadosFeriados para a data 'hoje': total de feriados do ano e
+   próximo feriado (busca binária), passando para o ano seguinte quando
+   não resta nenhum no ano atual. Deve ser chamada depois que
+   cache_feriados_ano_pendente retornar 0.
+   ======================================================================== */
+void cache_feriados_preencher(CacheFeriados *cache, const struct tm *hoje, DadosFeriados *feriados) {
+    int ano = hoje->tm_year + 1900;
+    int dia = dia_de_data(ano, hoje->tm_mon + 1, hoje->tm_mday);
+    TabelaFeriados *tabela = buscar_tabela(cache, ano);
+    TabelaFeriados *seguinte;
+    
+    memset(feriados, 0, sizeof(*feriados));
+    if (!tabela) {
+        return;
+    }
+    
+    feriados->quantidade_feriados = tabela->quantidade;
+    
+    int indice = primeiro_a_partir_de(tabela, dia);
+    if (indice < tabela->quantidade) {
+        copiar_feriado(tabela, indice, feriados);
+    } else if ((seguinte = buscar_tabela(cache, ano + 1)) && seguinte->quantidade > 0) {
+        copiar_feriado(seguinte, 0, feriados);
+    } else {
+        snprintf(feriados->proximo_feriado, sizeof(feriados->proximo_feriado), 
+                 "Nenhum feriado restante em %d", ano);
+        snprintf(feriados->data_feriado, sizeof(feriados->data_feriado), "N/A");
+        snprintf(feriados->tipo_feriado, sizeof(feriados->tipo_feriado), "N/A");
+    }
+}
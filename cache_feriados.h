@@ -0,0 +1,50 @@
+#ifndef CACHE_FERIADOS_H
+#define CACHE_FERIADOS_H
+
+#include <stdint.h>
+#include <time.h>
+#include "integrador__apis.h"
+
+/* Um feriado compactado: dia como inteiro e textos em um pool */
+typedef struct {
+    int32_t dia;        /* dias desde 1970-01-01 */
+    uint16_t nome;      /* deslocamento em TabelaFeriados.textos */
+    uint16_t tipo;      /* deslocamento em TabelaFeriados.textos */
+} Feriado;
+
+/* Feriados de um ano, ordenados por dia */
+typedef struct {
+    int ano;
+    int quantidade;
+    Feriado *feriados;
+    char *textos;
+    size_t tamanho_textos;
+    time_t atualizado;      /* quando a lista foi obtida */
+} TabelaFeriados;
+
+#define CACHE_FERIADOS_MAX_ANOS 4
+#define CACHE_FERIADOS_TTL_PADRAO (7 * 86400)
+
+/* Tabelas anuais mantidas em memória durante todo o processo */
+struct CacheFeriados {
+    TabelaFeriados anos[CACHE_FERIADOS_MAX_ANOS];
+    int total;
+    const char *diretorio;      /* persistência opcional (NULL = só memória) */
+    int ttl;                    /* validade de cada tabela em segundos (0 = não vence) */
+    int janela;                 /* depois do TTL, segundos servindo a tabela velha */
+    long downloads;
+};
+
+void cache_feriados_iniciar(CacheFeriados *cache, const char *diretorio);
+void cache_feriados_finalizar(CacheFeriados *cache);
+int cache_feriados_ano_pendente(CacheFeriados *cache, const struct tm *hoje);
+int cache_feriados_ano_velho(CacheFeriados *cache, const struct tm *hoje);
+int cache_feriados_carregar_json(CacheFeriados *cache, int ano, const char *json);
+void cache_feriados_marcar_vazio(CacheFeriados *cache, int ano);
+int cache_feriados_restaurar(CacheFeriados *cache, int ano, const Feriado *feriados, int quantidade,
+                             const char *textos, size_t tamanho_textos, time_t atualizado);
+void cache_feriados_preencher(CacheFeriados *cache, const struct tm *hoje, DadosFeriados *feriados);
+
+int dia_de_data(int ano, int mes, int dia);
+
+#endif
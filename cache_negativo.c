@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cache_negativo.h"
+
+/* ========================================================================
+   CACHE DE CEPs INEXISTENTES
+   ========================================================================
+   Boa parte dos CEPs de um lote real não existe, e cada um custava uma
+   ida ao ViaCEP só para receber {"erro": true} de novo. Os CEPs
+   inexistentes ficam aqui por 'ttl' segundos como pares (CEP, vencimento)
+   de 8 bytes, em uma tabela hash de sondagem linear sobre o CEP numérico:
+   uma consulta repetida é respondida com poucos acessos à memória.
+   
+   Entradas vencidas não são removidas (a sondagem linear não permite
+   buracos): são sobrescritas se o mesmo CEP voltar a faltar e descartadas
+   quando a tabela cresce.
+   ======================================================================== */
+
+static uint32_t espalhar(uint32_t cep, uint32_t capacidade) {
+    /* Multiplicação de Fibonacci tomando os bits altos do produto, que
+       dependem de todos os dígitos: nos bits baixos, CEPs terminados em
+       000 caíam todos nos mesmos poucos slots */
+    return (uint32_t)(((uint64_t)cep * 0x9E3779B97F4A7C15ull) >> 32) & (capacidade - 1);
+}
+
+void cache_negativo_iniciar(CacheNegativo *cache, int ttl) {
+    memset(cache, 0, sizeof(*cache));
+    cache->ttl = ttl;
+}
+
+void cache_negativo_finalizar(CacheNegativo *cache) {
+    free(cache->entradas);
+    memset(cache, 0, sizeof(*cache));
+}
+
+/* Slot do CEP, ou o slot vazio onde ele entraria */
+static EntradaNegativa *sondar(EntradaNegativa *entradas, uint32_t capacidade, uint32_t cep) {
+    uint32_t i = espalhar(cep, capacidade);
+    
+    while (entradas[i].expira != 0 && entradas[i].cep != cep) {
+        i = (i + 1) & (capacidade - 1);
+    }
+    return &entradas[i];
+}
+
+/* ========================================================================
+   FUNÇÃO: crescer
+   ========================================================================
+   Dobra a tabela (ou a cria), levando só as entradas ainda válidas.
+   Retorna 0 em caso de sucesso e -1 se faltar memória.
+   ======================================================================== */
+static int crescer(CacheNegativo *cache, time_t agora) {
+    uint32_t capacidade = cache->capacidade ? cache->capacidade * 2 : CACHE_NEGATIVO_CAPACIDADE_INICIAL;
+    EntradaNegativa *entradas = calloc(capacidade, sizeof(EntradaNegativa));
+    uint32_t ocupadas = 0;
+    
+    if (!entradas) {
+        return -1;
+    }
+    
+    for (uint32_t i = 0; i < cache->capacidade; i++) {
+        EntradaNegativa *e = &cache->entradas[i];
+        if (e->expira != 0 && (time_t)e->expira > agora) {
+            *sondar(entradas, capacidade, e->cep) = *e;
+            ocupadas++;
+        }
+    }
+    
+    free(cache->entradas);
+    cache->entradas = entradas;
+    cache->capacidade = capacidade;
+    cache->ocupadas = ocupadas;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_negativo_contem
+   ========================================================================
+   Retorna 1 se 'cep' foi respondido como inexistente há menos de 'ttl'
+   segundos, 0 caso contrário.
+   ======================================================================== */
+int cache_negativo_contem(CacheNegativo *cache, uint32_t cep, time_t agora) {
+    if (cache->capacidade > 0) {
+        EntradaNegativa *e = sondar(cache->entradas, cache->capacidade, cep);
+        if (e->expira != 0 && (time_t)e->expira > agora) {
+            cache->acertos++;
+            return 1;
+        }
+    }
+    
+    cache->faltas++;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_negativo_gravar
+   ========================================================================
+   Registra 'cep' como inexistente até agora + ttl. Retorna 0 em caso de
+   sucesso e -1 se faltar memória (o CEP apenas não fica no cache).
+   ======================================================================== */
+int cache_negativo_gravar(CacheNegativo *cache, uint32_t cep, time_t agora) {
+    return cache_negativo_restaurar(cache, cep, agora + cache->ttl, agora);
+}
+
+/* ========================================================================
+   FUNÇÃO: cache_negativo_restaurar
+   ========================================================================
+   Registra 'cep' como inexistente até 'expira' (uma entrada lida de um
+   snapshot, ver snapshot.c), sem passar de agora + ttl caso o TTL tenha
+   sido reduzido desde a gravação. Entradas já vencidas são ignoradas.
+   Retorna 0 em caso de sucesso e -1 se faltar memória.
+   ======================================================================== */
+int cache_negativo_restaurar(CacheNegativo *cache, uint32_t cep, time_t expira, time_t agora) {
+    EntradaNegativa *e;
+    
+    if (expira > agora + cache->ttl) {
+        expira = agora + cache->ttl;
+    }
+    if (expira <= agora) {
+        return 0;
+    }
+    
+    if ((cache->ocupadas + 1) * 2 > cache->capacidade && crescer(cache, agora) != 0) {
+        return -1;
+    }
+    
+    e = sondar(cache->entradas, cache->capacidade, cep);
+    if (e->expira == 0) {
+        cache->ocupadas++;
+    }
+    e->cep = cep;
+    e->expira = (uint32_t)expira;
+    return 0;
+}
+
+size_t cache_negativo_memoria(const CacheNegativo *cache) {
+    return (size_t)cache->capacidade * sizeof(EntradaNegativa);
+}
@@ -0,0 +1,35 @@
+#ifndef CACHE_NEGATIVO_H
+#define CACHE_NEGATIVO_H
+
+#include <stdint.h>
+#include <time.h>
+#include "integrador__apis.h"
+
+/* Um CEP inexistente e até quando isso vale (8 bytes) */
+typedef struct {
+    uint32_t cep;           /* CEP numérico */
+    uint32_t expira;        /* time() do vencimento; 0 = slot vazio */
+} EntradaNegativa;
+
+/* CEPs que o ViaCEP respondeu como inexistentes, em uma tabela hash de
+   endereçamento aberto com no máximo metade dos slots ocupados */
+struct CacheNegativo {
+    EntradaNegativa *entradas;
+    uint32_t capacidade;    /* potência de 2 */
+    uint32_t ocupadas;
+    int ttl;                /* segundos */
+    long acertos;
+    long faltas;
+};
+
+#define CACHE_NEGATIVO_TTL_PADRAO 86400
+#define CACHE_NEGATIVO_CAPACIDADE_INICIAL 1024
+
+void cache_negativo_iniciar(CacheNegativo *cache, int ttl);
+void cache_negativo_finalizar(CacheNegativo *cache);
+int cache_negativo_contem(CacheNegativo *cache, uint32_t cep, time_t agora);
+int cache_negativo_gravar(CacheNegativo *cache, uint32_t cep, time_t agora);
+int cache_negativo_restaurar(CacheNegativo *cache, uint32_t cep, time_t expira, time_t agora);
+size_t cache_negativo_memoria(const CacheNegativo *cache);
+
+#endif
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "canal.h"
+
+/* ========================================================================
+   FUNÇÃO: canal_iniciar
+   ========================================================================
+   Reserva 'capacidade' itens (arredondada para potência de 2) de
+   'tamanho_item' bytes. Os índices correm livres e são reduzidos pela
+   máscara só no acesso, então cheio e vazio não se confundem.
+   Retorna 0 em caso de sucesso e -1 se faltar memória.
+   ======================================================================== */
+int canal_iniciar(Canal *canal, uint32_t capacidade, size_t tamanho_item) {
+    uint32_t potencia = 1;
+    
+    while (potencia < capacidade) potencia *= 2;
+    
+    memset(canal, 0, sizeof(*canal));
+    canal->itens = malloc((size_t)potencia * tamanho_item);
+    if (!canal->itens) {
+        fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+        return -1;
+    }
+    canal->capacidade = potencia;
+    canal->tamanho_item = tamanho_item;
+    atomic_init(&canal->inicio, 0);
+    atomic_init(&canal->fim, 0);
+    
+    return 0;
+}
+
+void canal_finalizar(Canal *canal) {
+    free(canal->itens);
+    memset(canal, 0, sizeof(*canal));
+}
+
+/* ========================================================================
+   FUNÇÃO: canal_enviar
+   ========================================================================
+   Copia o item para o canal (só o produtor chama). Retorna 0 em caso de
+   sucesso e -1 se o canal estiver cheio.
+   ======================================================================== */
+int canal_enviar(Canal *canal, const void *item) {
+    unsigned int fim = atomic_load_explicit(&canal->fim, memory_order_relaxed);
+    unsigned int inicio = atomic_load_explicit(&canal->inicio, memory_order_acquire);
+    
+    if (fim - inicio >= canal->capacidade) {
+        return -1;
+    }
+    
+    memcpy(canal->itens + (size_t)(fim & (canal->capacidade - 1)) * canal->tamanho_item,
+           item, canal->tamanho_item);
+    atomic_store_explicit(&canal->fim, fim + 1, memory_order_release);
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: canal_receber
+   ========================================================================
+   Copia o item mais antigo do canal para 'item' (só o consumidor chama).
+   Retorna 0 em caso de sucesso e -1 se o canal estiver vazio.
+   ======================================================================== */
+int canal_receber(Canal *canal, void *item) {
+    unsigned int inicio = atomic_load_explicit(&canal->inicio, memory_order_relaxed);
+    unsigned int fim = atomic_load_explicit(&canal->fim, memory_order_acquire);
+    
+    if (inicio == fim) {
+        return -1;
+    }
+    
+    memcpy(item, canal->itens + (size_t)(inicio & (canal->capacidade - 1)) * canal->tamanho_item,
+           canal->tamanho_item);
+    atomic_store_explicit(&canal->inicio, inicio + 1, memory_order_release);
+    return 0;
+}
+
+int canal_vazio(Canal *canal) {
+    return canal_quantidade(canal) == 0;
+}
+
+/* Itens no canal; do outro lado, só uma estimativa (ele pode ter mudado) */
+uint32_t canal_quantidade(Canal *canal) {
+    unsigned int inicio = atomic_load_explicit(&canal->inicio, memory_order_acquire);
+    unsigned int fim = atomic_load_explicit(&canal->fim, memory_order_acquire);
+    
+    return fim - inicio;
+}
+
+void campainha_iniciar(Campainha *campainha) {
+    atomic_init(&campainha->esperando, 0);
+    campainha->tocada = 0;
+    pthread_mutex_init(&campainha->trava, NULL);
+    pthread_cond_init(&campainha->sinal, NULL);
+}
+
+void campainha_finalizar(Campainha *campainha) {
+    pthread_cond_destroy(&campainha->sinal);
+    pthread_mutex_destroy(&campainha->trava);
+}
+
+/* ========================================================================
+   FUNÇÃO: campainha_preparar
+   ========================================================================
+   Anuncia que a thread vai esperar. Depois disto, quem espera confere o
+   canal de novo e chama campainha_esperar (se ainda não há nada) ou
+   campainha_cancelar. Um toque dado entre a conferência e a espera não
+   se perde: fica marcado em 'tocada'.
+   ======================================================================== */
+void campainha_preparar(Campainha *campainha) {
+    atomic_store(&campainha->esperando, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void campainha_cancelar(Campainha *campainha) {
+    atomic_store(&campainha->esperando, 0);
+}
+
+/* ========================================================================
+   FUNÇÃO: campainha_esperar
+   ========================================================================
+   Dorme até um toque ou até 'espera_ms', o que vier antes. O limite é
+   só uma rede de segurança: quem chama confere o canal de novo de
+   qualquer forma.
+   ======================================================================== */
+void campainha_esperar(Campainha *campainha, int espera_ms) {
+    struct timespec limite;
+    
+    clock_gettime(CLOCK_REALTIME, &limite);
+    limite.tv_sec += espera_ms / 1000;
+    limite.tv_nsec += (long)(espera_ms % 1000) * 1000000L;
+    if (limite.tv_nsec >= 1000000000L) {
+        limite.tv_sec++;
+        limite.tv_nsec -= 1000000000L;
+    }
+    
+    pthread_mutex_lock(&campainha->trava);
+    while (!campainha->tocada) {
+        if (pthread_cond_timedwait(&campainha->sinal, &campainha->trava, &limite) == ETIMEDOUT) {
+            break;
+        }
+    }
+    campainha->tocada = 0;
+    pthread_mutex_unlock(&campainha->trava);
+    atomic_store(&campainha->esperando, 0);
+}
+
+/* ========================================================================
+   FUNÇÃO: campainha_tocar
+   ========================================================================
+   Chamada depois de mexer no canal. A barreira emparelha com a de
+   campainha_preparar: ou quem espera vê o canal já alterado, ou esta
+   thread o vê esperando e o acorda.
+   ======================================================================== */
+void campainha_tocar(Campainha *campainha) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&campainha->esperando, memory_order_relaxed)) {
+        return;
+    }
+    
+    pthread_mutex_lock(&campainha->trava);
+    campainha->tocada = 1;
+    pthread_cond_signal(&campainha->sinal);
+    pthread_mutex_unlock(&campainha->trava);
+}
@@ -0,0 +1,51 @@
+#ifndef CANAL_H
+#define CANAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define CANAL_LINHA_CACHE 64
+
+/* Fila circular limitada entre duas threads: um produtor e um consumidor,
+   sem trava. Cada lado só escreve o seu índice; o do outro é lido com
+   acquire, de modo que um item copiado antes do release já está visível
+   quando o índice avança. Os índices ficam a uma linha de cache um do
+   outro para que produtor e consumidor não disputem a mesma linha. */
+typedef struct {
+    atomic_uint inicio;     /* só o consumidor escreve */
+    char separador_inicio[CANAL_LINHA_CACHE];
+    atomic_uint fim;        /* só o produtor escreve */
+    char separador_fim[CANAL_LINHA_CACHE];
+    unsigned char *itens;
+    size_t tamanho_item;
+    uint32_t capacidade;    /* potência de 2 */
+} Canal;
+
+/* Para quem esperaria em um canal vazio (ou cheio) sem girar: o lado
+   que espera se anuncia antes de conferir o canal uma última vez, e o
+   outro lado só toca (e só então toma a trava) se houver alguém
+   esperando. Com as duas threads ocupadas, ninguém toma a trava. */
+typedef struct {
+    atomic_int esperando;
+    int tocada;
+    pthread_mutex_t trava;
+    pthread_cond_t sinal;
+} Campainha;
+
+int canal_iniciar(Canal *canal, uint32_t capacidade, size_t tamanho_item);
+void canal_finalizar(Canal *canal);
+int canal_enviar(Canal *canal, const void *item);
+int canal_receber(Canal *canal, void *item);
+int canal_vazio(Canal *canal);
+uint32_t canal_quantidade(Canal *canal);
+
+void campainha_iniciar(Campainha *campainha);
+void campainha_finalizar(Campainha *campainha);
+void campainha_preparar(Campainha *campainha);
+void campainha_cancelar(Campainha *campainha);
+void campainha_esperar(Campainha *campainha, int espera_ms);
+void campainha_tocar(Campainha *campainha);
+
+#endif
@@ -0,0 +1,561 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <jansson.h>
+#include "cliente_http.h"
+
+#define HTTP_RESPOSTA_CAPACIDADE_INICIAL 4096
+
+ContadorAlocacoes contador_alocacoes;
+
+static const char *NOMES_UPSTREAMS[TOTAL_UPSTREAMS] = { "viacep", "ibge", "brasilapi" };
+
+/* Valores aceitos por cliente_http_configurar_versao */
+static const struct {
+    const char *nome;
+    long versao;
+} VERSOES_HTTP[] = {
+    {"1.1", CURL_HTTP_VERSION_1_1},
+    {"2",   CURL_HTTP_VERSION_2TLS}
+};
+
+const char *nome_upstream(Upstream upstream) {
+    return NOMES_UPSTREAMS[upstream];
+}
+
+/* ========================================================================
+   FUNÇÃO: reservar_resposta
+   ========================================================================
+   Garante espaço para 'necessario' bytes (incluindo o '\0' final).
+   Retorna 0 em caso de sucesso e -1 se faltar memória.
+   ======================================================================== */
+static int reservar_resposta(HTTPResponse *response, size_t necessario, int exato) {
+    size_t capacidade;
+    
+    if (necessario <= response->capacidade) {
+        return 0;
+    }
+    
+    if (exato) {
+        capacidade = necessario;
+    } else {
+        capacidade = response->capacidade ? response->capacidade : HTTP_RESPOSTA_CAPACIDADE_INICIAL;
+        while (capacidade < necessario) capacidade *= 2;
+    }
+    
+    char *ptr = realloc(response->data, capacidade);
+    if (ptr == NULL) {
+        fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+        return -1;
+    }
+    
+    contador_alocacoes.respostas++;
+    response->data = ptr;
+    response->capacidade = capacidade;
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: write_callback
+   ========================================================================
+   Callback para libcurl armazenar dados recebidos da API.
+   ======================================================================== */
+size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    HTTPResponse *response = (HTTPResponse *)userp;
+    
+    if (reservar_resposta(response, response->size + realsize + 1, 0) != 0) {
+        return 0;
+    }
+    
+    memcpy(&(response->data[response->size]), contents, realsize);
+    response->size += realsize;
+    response->data[response->size] = 0;
+    
+    return realsize;
+}
+
+/* ========================================================================
+   FUNÇÃO: header_callback
+   ========================================================================
+   Reserva o buffer da resposta de uma vez quando o servidor informa o
+   Content-Length, evitando crescer a cada pedaço recebido.
+   ======================================================================== */
+size_t header_callback(char *buffer, size_t size, size_t nitems, void *userp) {
+    size_t realsize = size * nitems;
+    HTTPResponse *response = (HTTPResponse *)userp;
+    static const char campo[] = "Content-Length:";
+    
+    if (realsize > sizeof(campo) - 1 && strncasecmp(buffer, campo, sizeof(campo) - 1) == 0) {
+        size_t tamanho = (size_t)strtoull(buffer + sizeof(campo) - 1, NULL, 10);
+        if (tamanho > 0 && tamanho < HTTP_RESPOSTA_CAPACIDADE_MAXIMA * 64) {
+            reservar_resposta(response, response->size + tamanho + 1, 1);
+        }
+    }
+    
+    return realsize;
+}
+
+/* ========================================================================
+   FUNÇÃO: resposta_http_resetar
+   ========================================================================
+   Prepara o buffer para a próxima requisição sem liberá-lo. Só buffers
+   excepcionalmente grandes (ex.: lista completa de municípios) voltam
+   para o sistema.
+   ======================================================================== */
+void resposta_http_resetar(HTTPResponse *resposta) {
+    if (resposta->capacidade > HTTP_RESPOSTA_CAPACIDADE_MAXIMA) {
+        resposta_http_liberar(resposta);
+        return;
+    }
+    
+    resposta->size = 0;
+    if (resposta->data) {
+        resposta->data[0] = '\0';
+    }
+}
+
+void resposta_http_liberar(HTTPResponse *resposta) {
+    free(resposta->data);
+    resposta->data = NULL;
+    resposta->size = 0;
+    resposta->capacidade = 0;
+}
+
+static void *json_malloc_contado(size_t tamanho) {
+    contador_alocacoes.json++;
+    return malloc(tamanho);
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_contar_alocacoes
+   ========================================================================
+   Faz o jansson alocar através de um contador. Deve ser chamada antes de
+   qualquer uso do jansson.
+   ======================================================================== */
+void cliente_http_contar_alocacoes(void) {
+    json_set_alloc_funcs(json_malloc_contado, free);
+}
+
+/* ========================================================================
+   FUNÇÃO: travar_share
+   ========================================================================
+   Callbacks de trava do share: DNS, sessões TLS e conexões têm cada um a
+   sua trava, então threads que só disputam tipos diferentes não se
+   esperam.
+   ======================================================================== */
+static void travar_share(CURL *handle, curl_lock_data dado, curl_lock_access acesso, void *userptr) {
+    ClienteHTTP *cliente = (ClienteHTTP *)userptr;
+    
+    (void)handle;
+    (void)acesso;
+    pthread_mutex_lock(&cliente->travas_share[dado]);
+}
+
+static void destravar_share(CURL *handle, curl_lock_data dado, void *userptr) {
+    ClienteHTTP *cliente = (ClienteHTTP *)userptr;
+    
+    (void)handle;
+    pthread_mutex_unlock(&cliente->travas_share[dado]);
+}
+
+static CURLSH *criar_share(ClienteHTTP *cliente, int conexoes) {
+    CURLSH *share = curl_share_init();
+    if (!share) {
+        return NULL;
+    }
+    
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, travar_share);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, destravar_share);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, (void *)cliente);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    if (conexoes) {
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    }
+    
+    return share;
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_iniciar
+   ========================================================================
+   Cria os shares (DNS, sessões TLS e, no dos handles persistentes, cache
+   de conexões) e um handle persistente para cada host.
+   ======================================================================== */
+int cliente_http_iniciar(ClienteHTTP *cliente) {
+    memset(cliente, 0, sizeof(*cliente));
+    
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&cliente->travas_share[i], NULL);
+    }
+    pthread_mutex_init(&cliente->trava, NULL);
+    cliente->versao_http = CURL_HTTP_VERSION_2TLS;
+    
+    cliente->share = criar_share(cliente, 1);
+    cliente->share_motor = criar_share(cliente, 0);
+    if (!cliente->share || !cliente->share_motor) {
+        fprintf(stderr, "[ERRO] Falha ao inicializar CURL share\n");
+        cliente_http_finalizar(cliente);
+        return -1;
+    }
+    
+    for (int i = 0; i < TOTAL_UPSTREAMS; i++) {
+        cliente->handles[i] = cliente_http_novo_handle(cliente);
+        if (!cliente->handles[i]) {
+            cliente_http_finalizar(cliente);
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_finalizar
+   ========================================================================
+   Libera handles e share. Os handles precisam ser liberados antes do
+   share, que não pode ser destruído enquanto estiver em uso.
+   ======================================================================== */
+void cliente_http_finalizar(ClienteHTTP *cliente) {
+    for (int i = 0; i < TOTAL_UPSTREAMS; i++) {
+        if (cliente->handles[i]) {
+            curl_easy_cleanup(cliente->handles[i]);
+            cliente->handles[i] = NULL;
+        }
+    }
+    
+    if (cliente->share) {
+        curl_share_cleanup(cliente->share);
+        cliente->share = NULL;
+    }
+    if (cliente->share_motor) {
+        curl_share_cleanup(cliente->share_motor);
+        cliente->share_motor = NULL;
+    }
+    
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_destroy(&cliente->travas_share[i]);
+    }
+    pthread_mutex_destroy(&cliente->trava);
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_novo_handle
+   ========================================================================
+   Cria um handle já ligado ao share e com as opções comuns a todas as
+   requisições. Usado pelos handles persistentes e pelo modo lote.
+   Sem PIPEWAIT: quem evita a rajada de conexões enquanto a primeira
+   ainda negocia o HTTP/2 é o limite por host do motor (ver
+   motor_iniciar).
+   ======================================================================== */
+CURL *cliente_http_novo_handle(ClienteHTTP *cliente) {
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        fprintf(stderr, "[ERRO] Falha ao inicializar CURL\n");
+        return NULL;
+    }
+    
+    curl_easy_setopt(curl, CURLOPT_SHARE, cliente->share);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "IntegradorAPIs/1.0");
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, cliente->versao_http);
+    if (cliente->certificados) {
+        curl_easy_setopt(curl, CURLOPT_CAINFO, cliente->certificados);
+    }
+    
+    return curl;
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_iniciar_prazo
+   ========================================================================
+   Começa a contar o orçamento de uma consulta: as chamadas seguintes a
+   cliente_http_get dividem entre si os prazo_ms restantes, cada uma
+   limitada ao que as anteriores deixaram.
+   ======================================================================== */
+void cliente_http_iniciar_prazo(ClienteHTTP *cliente) {
+    cliente->fim_prazo = cliente->prazo_ms > 0 ? metricas_agora_ns() / 1e6 + cliente->prazo_ms : 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_travar
+   ========================================================================
+   Protege os caches e os limites por host do cliente quando ele é
+   compartilhado entre threads. Sem 'compartilhado', não faz
+   nada: os modos de uma thread só não pagam pela trava.
+   ======================================================================== */
+void cliente_http_travar(ClienteHTTP *cliente) {
+    if (cliente->compartilhado) {
+        pthread_mutex_lock(&cliente->trava);
+    }
+}
+
+void cliente_http_destravar(ClienteHTTP *cliente) {
+    if (cliente->compartilhado) {
+        pthread_mutex_unlock(&cliente->trava);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_resultado
+   ========================================================================
+   Resultado de uma transferência concluída, tratando como falha
+   (CURLE_HTTP_RETURNED_ERROR) as respostas 408, 429 e 5xx: o corpo delas
+   não é a resposta da API e não deve chegar ao extrator.
+   ======================================================================== */
+CURLcode cliente_http_resultado(CURL *curl, CURLcode resultado) {
+    long status = 0;
+    
+    if (resultado != CURLE_OK) {
+        return resultado;
+    }
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    return status == 408 || status == 429 || status >= 500 ? CURLE_HTTP_RETURNED_ERROR : CURLE_OK;
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_falha_transitoria
+   ========================================================================
+   Indica se vale repetir a requisição: falhas de conexão, de transporte
+   e de prazo, e respostas 408, 429, 502, 503 e 504. Erros permanentes
+   (URL inválida, 404, 500, JSON inválido...) não melhoram com outra
+   tentativa.
+   ======================================================================== */
+int cliente_http_falha_transitoria(CURL *curl, CURLcode resultado) {
+    long status = 0;
+    
+    switch (resultado) {
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+            return 1;
+        case CURLE_HTTP_RETURNED_ERROR:
+            break;
+        default:
+            return 0;
+    }
+    
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    return status == 408 || status == 429 || status == 502 || status == 503 || status == 504;
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_avaliar_resposta
+   ========================================================================
+   Ajusta o limite do host pela resposta: 429 ou Retry-After (lido pelo
+   curl em segundos) é recusa; outras respostas completas, aceitação.
+   ======================================================================== */
+void cliente_http_avaliar_resposta(ClienteHTTP *cliente, Upstream upstream, CURL *curl, CURLcode resultado) {
+    Limitador *limite = &cliente->limites[upstream];
+    curl_off_t retry_after = 0;
+    long status = 0;
+    
+    if (resultado != CURLE_OK && resultado != CURLE_HTTP_RETURNED_ERROR) {
+        return;
+    }
+    
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after);
+    if (status == 429 || retry_after > 0) {
+        limitador_recusado(limite, metricas_agora_ns() / 1e6, retry_after * 1000.0);
+    } else if (resultado == CURLE_OK) {
+        limitador_sucesso(limite);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: aguardar_limite
+   ========================================================================
+   Espera, bloqueando, até o host aceitar mais uma requisição e a
+   registra. Usada só pelo caminho bloqueante (cliente_http_get); o motor
+   põe as requisições em fila.
+   ======================================================================== */
+static void aguardar_limite(Limitador *limite) {
+    double espera = limitador_espera_ms(limite, metricas_agora_ns() / 1e6);
+    
+    if (espera > 0) {
+        limite->enfileiradas++;
+    }
+    while (espera > 0) {
+        long us = (long)(espera * 1000);
+        struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+        espera = limitador_espera_ms(limite, metricas_agora_ns() / 1e6);
+    }
+    limitador_consumir(limite, metricas_agora_ns() / 1e6);
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_get
+   ========================================================================
+   Executa um GET bloqueante no handle persistente do host, acumulando o
+   corpo em 'resposta'. Quem chama é responsável por liberar resposta->data.
+   Quem usa CURLOPT_WRITEDATA deve apontar CURLOPT_HEADERDATA para a
+   mesma resposta.
+   
+   Com um orçamento em andamento (cliente_http_iniciar_prazo), a
+   requisição só tem o tempo que resta dele. Falhas transitórias são
+   repetidas uma vez, se ainda houver orçamento.
+   ======================================================================== */
+CURLcode cliente_http_get(ClienteHTTP *cliente, Upstream upstream, const char *url,
+                          HTTPResponse *resposta) {
+    CURL *curl = cliente->handles[upstream];
+    CURLcode res = CURLE_OPERATION_TIMEDOUT;
+    
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)resposta);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)resposta);
+    
+    for (int tentativa = 1; tentativa <= HTTP_TENTATIVAS; tentativa++) {
+        long restante = 0;
+    
+        aguardar_limite(&cliente->limites[upstream]);
+        if (cliente->fim_prazo > 0) {
+            restante = (long)(cliente->fim_prazo - metricas_agora_ns() / 1e6);
+            if (restante < (tentativa == 1 ? 1 : HTTP_MIN_REPETIR_MS)) {
+                limitador_liberar(&cliente->limites[upstream]);
+                break;
+            }
+        }
+        if (tentativa > 1) {
+            resposta_http_resetar(resposta);
+        }
+    
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, restante);
+        res = cliente_http_resultado(curl, curl_easy_perform(curl));
+        metricas_registrar_curl(&cliente->metricas[upstream], curl, res);
+        limitador_liberar(&cliente->limites[upstream]);
+        cliente_http_avaliar_resposta(cliente, upstream, curl, res);
+    
+        if (!cliente_http_falha_transitoria(curl, res)) {
+            break;
+        }
+    }
+    
+    return res;
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_configurar_limite
+   ========================================================================
+   Interpreta "host=TAXA[:SIMULTANEAS]" (ex.: "viacep=20:8"), com o host
+   pelo nome usado nas métricas. Retorna 0 em caso de sucesso e -1 se a
+   especificação for inválida.
+   ======================================================================== */
+int cliente_http_configurar_limite(ClienteHTTP *cliente, const char *especificacao) {
+    const char *igual = strchr(especificacao, '=');
+    double taxa = 0;
+    int simultaneas = 0;
+    
+    if (!igual || sscanf(igual + 1, "%lf:%d", &taxa, &simultaneas) < 1 || taxa < 0 || simultaneas < 0) {
+        return -1;
+    }
+    
+    for (int i = 0; i < TOTAL_UPSTREAMS; i++) {
+        if (strlen(NOMES_UPSTREAMS[i]) == (size_t)(igual - especificacao) &&
+            strncmp(NOMES_UPSTREAMS[i], especificacao, igual - especificacao) == 0) {
+            limitador_configurar(&cliente->limites[i], taxa, simultaneas);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_configurar_versao
+   ========================================================================
+   Escolhe a versão do HTTP pelo nome:
+   - "2" (padrão): HTTP/2 negociado por ALPN nos hosts https, com volta
+     ao HTTP/1.1 se o servidor não o oferecer; hosts http ficam no 1.1
+   - "1.1": sempre HTTP/1.1, uma conexão por requisição simultânea
+   Não há HTTP/2 sem TLS (h2c): na libcurl 7.88, a segunda requisição em
+   uma conexão h2c com conhecimento prévio falha ("Error in the HTTP2
+   framing layer"), o que anula a multiplexação.
+   Vale para os handles persistentes e para os criados depois. Retorna 0
+   em caso de sucesso e -1 se o nome for desconhecido.
+   ======================================================================== */
+int cliente_http_configurar_versao(ClienteHTTP *cliente, const char *nome) {
+    for (size_t i = 0; i < sizeof(VERSOES_HTTP) / sizeof(VERSOES_HTTP[0]); i++) {
+        if (strcmp(VERSOES_HTTP[i].nome, nome) != 0) {
+            continue;
+        }
+        cliente->versao_http = VERSOES_HTTP[i].versao;
+        for (int u = 0; u < TOTAL_UPSTREAMS; u++) {
+            curl_easy_setopt(cliente->handles[u], CURLOPT_HTTP_VERSION, cliente->versao_http);
+        }
+        return 0;
+    }
+    return -1;
+}
+
+/* Confia nas autoridades de 'arquivo' (PEM) em vez das do sistema, em
+   todos os handles: um proxy corporativo ou o certificado do
+   bench/mock_upstream --tls */
+void cliente_http_configurar_certificados(ClienteHTTP *cliente, const char *arquivo) {
+    cliente->certificados = arquivo;
+    for (int u = 0; u < TOTAL_UPSTREAMS; u++) {
+        curl_easy_setopt(cliente->handles[u], CURLOPT_CAINFO, arquivo);
+    }
+}
+
+const char *cliente_http_nome_versao(const ClienteHTTP *cliente) {
+    for (size_t i = 0; i < sizeof(VERSOES_HTTP) / sizeof(VERSOES_HTTP[0]); i++) {
+        if (VERSOES_HTTP[i].versao == cliente->versao_http) {
+            return VERSOES_HTTP[i].nome;
+        }
+    }
+    return "?";
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_imprimir_conexoes
+   ========================================================================
+   Uma linha por host consultado: conexões abertas e quantas respostas
+   vieram por HTTP/2.
+   ======================================================================== */
+void cliente_http_imprimir_conexoes(const ClienteHTTP *cliente, FILE *saida, const char *prefixo) {
+    for (int i = 0; i < TOTAL_UPSTREAMS; i++) {
+        const MetricasUpstream *m = &cliente->metricas[i];
+        if (m->requisicoes == 0) {
+            continue;
+        }
+        fprintf(saida, "%s%s: %ld conexões para %ld requisições (%.1f por conexão), %.0f%% em HTTP/2\n",
+                prefixo, NOMES_UPSTREAMS[i], m->conexoes, m->requisicoes,
+                m->conexoes ? (double)m->requisicoes / m->conexoes : 0.0,
+                100.0 * m->respostas_http2 / m->requisicoes);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_imprimir_limites
+   ========================================================================
+   Uma linha por host que foi limitado, configurado ou recusou requisições.
+   ======================================================================== */
+void cliente_http_imprimir_limites(const ClienteHTTP *cliente, FILE *saida, const char *prefixo) {
+    for (int i = 0; i < TOTAL_UPSTREAMS; i++) {
+        const Limitador *l = &cliente->limites[i];
+        if (l->taxa <= 0 && l->max_simultaneas == 0 && l->recusas == 0) {
+            continue;
+        }
+        fprintf(saida, "%s", prefixo);
+        limitador_imprimir(saida, NOMES_UPSTREAMS[i], l);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: cliente_http_exportar_metricas
+   ========================================================================
+   Grava os histogramas de fases de todos os hosts (ver metricas.c).
+   ======================================================================== */
+void cliente_http_exportar_metricas(const ClienteHTTP *cliente, FILE *saida, FormatoMetricas formato) {
+    metricas_exportar(saida, formato, cliente->metricas, NOMES_UPSTREAMS, TOTAL_UPSTREAMS);
+}
@@ -0,0 +1,117 @@
+#ifndef CLIENTE_HTTP_H
+#define CLIENTE_HTTP_H
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include <curl/curl.h>
+#include "metricas.h"
+#include "limitador.h"
+
+/* Hosts consultados pelo integrador */
+typedef enum {
+    UPSTREAM_VIACEP,
+    UPSTREAM_IBGE,
+    UPSTREAM_BRASILAPI,
+    TOTAL_UPSTREAMS
+} Upstream;
+
+/* Estrutura para resposta HTTP.
+   O buffer é reaproveitado entre requisições (resposta_http_resetar) e
+   só cresce: já começa do tamanho do Content-Length, quando o servidor o
+   envia, e dobra de capacidade quando não há Content-Length. */
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacidade;
+} HTTPResponse;
+
+/* Buffers maiores que isto são devolvidos ao sistema no reset */
+#define HTTP_RESPOSTA_CAPACIDADE_MAXIMA (1024 * 1024)
+
+/* Contadores de alocação, para conferir o custo por CEP em regime
+   (atômicos: o lote paralelo aloca de várias threads) */
+typedef struct {
+    atomic_long respostas;  /* malloc/realloc de buffers de resposta */
+    atomic_long json;       /* alocações feitas pelo jansson */
+} ContadorAlocacoes;
+
+extern ContadorAlocacoes contador_alocacoes;
+
+/* Caches opcionais consultados antes da rede */
+typedef struct CacheCEP CacheCEP;
+typedef struct CacheNegativo CacheNegativo;
+typedef struct CacheFeriados CacheFeriados;
+typedef struct IndiceIBGE IndiceIBGE;
+
+/* Contexto HTTP de longa duração.
+   O share guarda cache de DNS, sessões TLS e conexões abertas; cada host
+   tem um handle persistente, de modo que a 2ª requisição em diante para o
+   mesmo host reaproveita a conexão em vez de refazer DNS, TCP e TLS.
+   Também carrega os caches opcionais, consultados antes de ir à rede.
+   
+   Por padrão os handles negociam HTTP/2 por ALPN nos hosts https (e
+   ficam no HTTP/1.1 quando o servidor não o oferece): as requisições
+   simultâneas ao mesmo host passam a dividir poucas conexões, em
+   streams, em vez de abrir uma conexão por requisição em andamento
+   (ver cliente_http_configurar_versao).
+   
+   Os handles dos motores usam 'share_motor', sem o cache de conexões:
+   cada curl_multi guarda as suas, e o limite de conexões por host do
+   motor conta só as dele (ver motor_iniciar).
+   
+   Os shares têm uma trava por tipo de dado, então podem ser usados por
+   handles de várias threads. Com 'compartilhado', os caches e os limites
+   por host também passam a ser protegidos por 'trava' (ver
+   cliente_http_travar), tomada pelos motores do lote paralelo. */
+typedef struct {
+    CURLSH *share;
+    CURLSH *share_motor;        /* DNS e sessões TLS, sem as conexões */
+    CURL *handles[TOTAL_UPSTREAMS];
+    CacheCEP *cache_cep;        /* NULL = sem cache de endereços */
+    CacheNegativo *cache_negativo;  /* NULL = sem cache de CEPs inexistentes */
+    CacheFeriados *cache_feriados;
+    int ano_feriados_em_andamento;  /* tabela sendo baixada por um dos motores (0 = nenhuma) */
+    const char *erro_feriados;      /* resultado do último download (NULL = sucesso) */
+    IndiceIBGE *indice_ibge;    /* NULL = sem pré-carga do IBGE */
+    MetricasUpstream metricas[TOTAL_UPSTREAMS];
+    Limitador limites[TOTAL_UPSTREAMS];     /* taxa e simultâneas por host */
+    int prazo_ms;               /* orçamento de uma consulta inteira (0 = sem prazo) */
+    int duplicar;               /* duplica requisições que passam do p95 do host (motor) */
+    double fim_prazo;           /* fim do orçamento da consulta em cliente_http_get (ms) */
+    long versao_http;           /* CURLOPT_HTTP_VERSION de todos os handles */
+    const char *certificados;   /* CURLOPT_CAINFO (NULL = do sistema) */
+    pthread_mutex_t travas_share[CURL_LOCK_DATA_LAST];
+    pthread_mutex_t trava;      /* caches e limites entre threads */
+    int compartilhado;          /* usado por mais de uma thread: 'trava' vale */
+} ClienteHTTP;
+
+#define HTTP_PRAZO_PADRAO_MS 5000
+#define HTTP_TENTATIVAS 2           /* por requisição, contando a primeira */
+#define HTTP_MIN_REPETIR_MS 100     /* orçamento mínimo restante para repetir */
+
+int cliente_http_iniciar(ClienteHTTP *cliente);
+void cliente_http_finalizar(ClienteHTTP *cliente);
+CURL *cliente_http_novo_handle(ClienteHTTP *cliente);
+CURLcode cliente_http_get(ClienteHTTP *cliente, Upstream upstream, const char *url,
+                          HTTPResponse *resposta);
+size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp);
+size_t header_callback(char *buffer, size_t size, size_t nitems, void *userp);
+void resposta_http_resetar(HTTPResponse *resposta);
+void resposta_http_liberar(HTTPResponse *resposta);
+void cliente_http_contar_alocacoes(void);
+void cliente_http_iniciar_prazo(ClienteHTTP *cliente);
+void cliente_http_travar(ClienteHTTP *cliente);
+void cliente_http_destravar(ClienteHTTP *cliente);
+CURLcode cliente_http_resultado(CURL *curl, CURLcode resultado);
+int cliente_http_falha_transitoria(CURL *curl, CURLcode resultado);
+void cliente_http_avaliar_resposta(ClienteHTTP *cliente, Upstream upstream, CURL *curl, CURLcode resultado);
+int cliente_http_configurar_limite(ClienteHTTP *cliente, const char *especificacao);
+int cliente_http_configurar_versao(ClienteHTTP *cliente, const char *nome);
+void cliente_http_configurar_certificados(ClienteHTTP *cliente, const char *arquivo);
+const char *cliente_http_nome_versao(const ClienteHTTP *cliente);
+void cliente_http_imprimir_conexoes(const ClienteHTTP *cliente, FILE *saida, const char *prefixo);
+void cliente_http_imprimir_limites(const ClienteHTTP *cliente, FILE *saida, const char *prefixo);
+const char *nome_upstream(Upstream upstream);
+void cliente_http_exportar_metricas(const ClienteHTTP *cliente, FILE *saida, FormatoMetricas formato);
+
+#endif
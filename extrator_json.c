@@ -0,0 +1,414 @@
+#include <stdio.h>
+#include <string.h>
+#include "extrator_json.h"
+
+/* ========================================================================
+   EXTRATOR INCREMENTAL DE JSON
+   ========================================================================
+   As respostas das APIs têm dezenas de campos, dos quais o integrador
+   usa meia dúzia. Em vez de acumular o corpo inteiro e montar a árvore
+   com json_loads, o extrator percorre os bytes à medida que chegam,
+   mantendo só a pilha de objetos/arrays abertos, o caminho atual e o
+   valor em leitura. Um valor cujo caminho casa com um campo declarado
+   é entregue ao retorno, que preenche as estruturas de destino.
+   
+   Tokens podem ser cortados em qualquer ponto entre dois pedaços; todo
+   o estado necessário para continuar fica em ExtratorJSON.
+   ======================================================================== */
+
+/* Estado léxico */
+enum {
+    LEX_ESTRUTURA,
+    LEX_STRING,
+    LEX_ESCAPE,
+    LEX_UNICODE,
+    LEX_LITERAL
+};
+
+/* Tipo de cada nível da pilha */
+enum {
+    NIVEL_RAIZ,
+    NIVEL_OBJETO,
+    NIVEL_ARRAY
+};
+
+/* O que o nível espera a seguir */
+enum {
+    ESPERA_VALOR,
+    ESPERA_VALOR_OU_FIM,
+    ESPERA_CHAVE,
+    ESPERA_CHAVE_OU_FIM,
+    ESPERA_DOIS_PONTOS,
+    ESPERA_VIRGULA_OU_FIM,
+    ESPERA_NADA
+};
+
+void extrator_json_iniciar(ExtratorJSON *ex, const CampoJSON *campos, int total_campos,
+                           RetornoCampoJSON retorno, void *destino) {
+    memset(ex, 0, sizeof(*ex));
+    ex->campos = campos;
+    ex->total_campos = total_campos;
+    ex->retorno = retorno;
+    ex->destino = destino;
+    ex->tipo[0] = NIVEL_RAIZ;
+    ex->espera[0] = ESPERA_VALOR;
+}
+
+const char *extrator_json_erro(const ExtratorJSON *ex) {
+    return ex->erro ? ex->erro : "documento incompleto";
+}
+
+static int falhar(ExtratorJSON *ex, const char *motivo) {
+    if (!ex->erro) {
+        ex->erro = motivo;
+    }
+    return -1;
+}
+
+/* Casa o caminho atual com o de um campo; '*' casa com um trecho inteiro */
+static int caminho_casa(const char *padrao, const char *caminho) {
+    while (*padrao) {
+        if (*padrao == '*') {
+            padrao++;
+            while (*caminho && *caminho != '.' && *caminho != '[') caminho++;
+            continue;
+        }
+        if (*padrao != *caminho) {
+            return 0;
+        }
+        padrao++;
+        caminho++;
+    }
+    return *caminho == '\0';
+}
+
+static void avisar(ExtratorJSON *ex, const char *valor) {
+    for (int i = 0; i < ex->total_campos; i++) {
+        if (caminho_casa(ex->campos[i].caminho, ex->caminho)) {
+            ex->retorno(ex->destino, ex->campos[i].campo, valor, ex->caminho + ex->inicio_chave);
+        }
+    }
+}
+
+/* Troca o último trecho do caminho (a partir do início do nível atual) */
+static int definir_trecho(ExtratorJSON *ex, const char *trecho, size_t tamanho, int ponto) {
+    size_t base = ex->inicio[ex->profundidade];
+    size_t extra = (ponto && base > 0) ? 1 : 0;
+    
+    if (base + extra + tamanho >= sizeof(ex->caminho)) {
+        return falhar(ex, "caminho longo demais");
+    }
+    
+    if (extra) {
+        ex->caminho[base] = '.';
+    }
+    memcpy(ex->caminho + base + extra, trecho, tamanho);
+    ex->tamanho_caminho = base + extra + tamanho;
+    ex->caminho[ex->tamanho_caminho] = '\0';
+    ex->inicio_chave = base + extra;
+    
+    return 0;
+}
+
+static void restaurar_caminho(ExtratorJSON *ex) {
+    ex->tamanho_caminho = ex->inicio[ex->profundidade];
+    ex->caminho[ex->tamanho_caminho] = '\0';
+}
+
+/* Um valor do nível atual terminou: o nível passa a esperar ',' ou o fim */
+static void valor_concluido(ExtratorJSON *ex) {
+    ex->espera[ex->profundidade] =
+        ex->tipo[ex->profundidade] == NIVEL_RAIZ ? ESPERA_NADA : ESPERA_VIRGULA_OU_FIM;
+}
+
+/* Posiciona o caminho no valor que está começando */
+static int iniciar_valor(ExtratorJSON *ex) {
+    if (ex->tipo[ex->profundidade] == NIVEL_ARRAY) {
+        return definir_trecho(ex, "[]", 2, 0);
+    }
+    return 0;
+}
+
+static int abrir(ExtratorJSON *ex, int tipo) {
+    if (iniciar_valor(ex) != 0) {
+        return -1;
+    }
+    if (ex->profundidade + 1 >= EXTRATOR_JSON_PROFUNDIDADE) {
+        return falhar(ex, "documento profundo demais");
+    }
+    
+    ex->profundidade++;
+    ex->tipo[ex->profundidade] = tipo;
+    ex->espera[ex->profundidade] = tipo == NIVEL_OBJETO ? ESPERA_CHAVE_OU_FIM : ESPERA_VALOR_OU_FIM;
+    ex->inicio[ex->profundidade] = (unsigned short)ex->tamanho_caminho;
+    ex->chave[ex->profundidade] = (unsigned short)ex->inicio_chave;
+    
+    return 0;
+}
+
+static void fechar(ExtratorJSON *ex) {
+    ex->inicio_chave = ex->chave[ex->profundidade];
+    ex->profundidade--;
+    
+    /* O caminho ainda aponta para o objeto/array que terminou */
+    avisar(ex, NULL);
+    restaurar_caminho(ex);
+    valor_concluido(ex);
+}
+
+static void acrescentar(ExtratorJSON *ex, char c) {
+    if (ex->tamanho_valor < sizeof(ex->valor) - 1) {
+        ex->valor[ex->tamanho_valor++] = c;
+    }
+}
+
+static void acrescentar_utf8(ExtratorJSON *ex, unsigned int cp) {
+    if (cp < 0x80) {
+        acrescentar(ex, (char)cp);
+    } else if (cp < 0x800) {
+        acrescentar(ex, (char)(0xC0 | (cp >> 6)));
+        acrescentar(ex, (char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        acrescentar(ex, (char)(0xE0 | (cp >> 12)));
+        acrescentar(ex, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        acrescentar(ex, (char)(0x80 | (cp & 0x3F)));
+    } else {
+        acrescentar(ex, (char)(0xF0 | (cp >> 18)));
+        acrescentar(ex, (char)(0x80 | ((cp >> 12) & 0x3F)));
+        acrescentar(ex, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        acrescentar(ex, (char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+/* Metade alta de um par surrogate sem a metade baixa vira U+FFFD */
+static void descartar_alta(ExtratorJSON *ex) {
+    if (ex->alta) {
+        acrescentar_utf8(ex, 0xFFFD);
+        ex->alta = 0;
+    }
+}
+
+static int concluir_string(ExtratorJSON *ex) {
+    descartar_alta(ex);
+    ex->valor[ex->tamanho_valor] = '\0';
+    ex->estado = LEX_ESTRUTURA;
+    
+    if (ex->lendo_chave) {
+        ex->lendo_chave = 0;
+        ex->espera[ex->profundidade] = ESPERA_DOIS_PONTOS;
+        return definir_trecho(ex, ex->valor, ex->tamanho_valor, 1);
+    }
+    
+    avisar(ex, ex->valor);
+    restaurar_caminho(ex);
+    valor_concluido(ex);
+    return 0;
+}
+
+static int concluir_literal(ExtratorJSON *ex) {
+    ex->valor[ex->tamanho_valor] = '\0';
+    ex->estado = LEX_ESTRUTURA;
+    
+    if (strcmp(ex->valor, "true") != 0 && strcmp(ex->valor, "false") != 0 &&
+        strcmp(ex->valor, "null") != 0 && strspn(ex->valor, "-+.0123456789eE") != ex->tamanho_valor) {
+        return falhar(ex, "literal inválido");
+    }
+    
+    avisar(ex, ex->valor);
+    restaurar_caminho(ex);
+    valor_concluido(ex);
+    return 0;
+}
+
+static int valor_hex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* ========================================================================
+   FUNÇÃO: processar_estrutura
+   ========================================================================
+   Trata um caractere fora de strings e literais, conforme o que o nível
+   atual espera.
+   ======================================================================== */
+static int processar_estrutura(ExtratorJSON *ex, char c) {
+    int nivel = ex->profundidade;
+    int espera = ex->espera[nivel];
+    
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        return 0;
+    }
+    
+    switch (espera) {
+        case ESPERA_VALOR:
+        case ESPERA_VALOR_OU_FIM:
+            if (c == ']' && espera == ESPERA_VALOR_OU_FIM) {
+                fechar(ex);
+                return 0;
+            }
+            if (c == '{') {
+                return abrir(ex, NIVEL_OBJETO);
+            }
+            if (c == '[') {
+                return abrir(ex, NIVEL_ARRAY);
+            }
+            if (c == '"') {
+                ex->tamanho_valor = 0;
+                ex->estado = LEX_STRING;
+                return iniciar_valor(ex);
+            }
+            if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+                ex->tamanho_valor = 0;
+                acrescentar(ex, c);
+                ex->estado = LEX_LITERAL;
+                return iniciar_valor(ex);
+            }
+            return falhar(ex, "valor esperado");
+        case ESPERA_CHAVE:
+        case ESPERA_CHAVE_OU_FIM:
+            if (c == '}' && espera == ESPERA_CHAVE_OU_FIM) {
+                fechar(ex);
+                return 0;
+            }
+            if (c == '"') {
+                ex->tamanho_valor = 0;
+                ex->lendo_chave = 1;
+                ex->estado = LEX_STRING;
+                return 0;
+            }
+            return falhar(ex, "chave esperada");
+        case ESPERA_DOIS_PONTOS:
+            if (c == ':') {
+                ex->espera[nivel] = ESPERA_VALOR;
+                return 0;
+            }
+            return falhar(ex, "':' esperado");
+        case ESPERA_VIRGULA_OU_FIM:
+            if (c == ',') {
+                ex->espera[nivel] = ex->tipo[nivel] == NIVEL_OBJETO ? ESPERA_CHAVE : ESPERA_VALOR;
+                return 0;
+            }
+            if ((c == '}' && ex->tipo[nivel] == NIVEL_OBJETO) ||
+                (c == ']' && ex->tipo[nivel] == NIVEL_ARRAY)) {
+                fechar(ex);
+                return 0;
+            }
+            return falhar(ex, "',' ou fim esperado");
+        default:
+            return falhar(ex, "conteúdo após o fim do documento");
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: extrator_json_alimentar
+   ========================================================================
+   Processa mais um pedaço do documento. Retorna 0 ou -1 se o documento
+   for inválido (a partir daí, o resto é ignorado).
+   ======================================================================== */
+int extrator_json_alimentar(ExtratorJSON *ex, const char *dados, size_t tamanho) {
+    if (ex->erro) {
+        return -1;
+    }
+    
+    for (size_t i = 0; i < tamanho; i++, ex->posicao++) {
+        char c = dados[i];
+    
+        switch (ex->estado) {
+            case LEX_ESTRUTURA:
+                if (processar_estrutura(ex, c) != 0) {
+                    return -1;
+                }
+                break;
+            case LEX_STRING:
+                if (c == '"') {
+                    if (concluir_string(ex) != 0) {
+                        return -1;
+                    }
+                } else if (c == '\\') {
+                    ex->estado = LEX_ESCAPE;
+                } else if ((unsigned char)c < 0x20) {
+                    return falhar(ex, "caractere de controle em string");
+                } else {
+                    descartar_alta(ex);
+                    acrescentar(ex, c);
+                }
+                break;
+            case LEX_ESCAPE:
+                ex->estado = LEX_STRING;
+                if (c == 'u') {
+                    ex->estado = LEX_UNICODE;
+                    ex->unicode = 0;
+                    ex->digitos_unicode = 0;
+                    break;
+                }
+                descartar_alta(ex);
+                switch (c) {
+                    case '"': case '\\': case '/': acrescentar(ex, c); break;
+                    case 'b': acrescentar(ex, '\b'); break;
+                    case 'f': acrescentar(ex, '\f'); break;
+                    case 'n': acrescentar(ex, '\n'); break;
+                    case 'r': acrescentar(ex, '\r'); break;
+                    case 't': acrescentar(ex, '\t'); break;
+                    default: return falhar(ex, "escape inválido");
+                }
+                break;
+            case LEX_UNICODE: {
+                int h = valor_hex(c);
+                if (h < 0) {
+                    return falhar(ex, "escape \\u inválido");
+                }
+                ex->unicode = (ex->unicode << 4) | (unsigned int)h;
+                if (++ex->digitos_unicode < 4) {
+                    break;
+                }
+                ex->estado = LEX_STRING;
+                if (ex->unicode >= 0xD800 && ex->unicode <= 0xDBFF) {
+                    descartar_alta(ex);
+                    ex->alta = ex->unicode;
+                } else if (ex->unicode >= 0xDC00 && ex->unicode <= 0xDFFF && ex->alta) {
+                    acrescentar_utf8(ex, 0x10000 + ((ex->alta - 0xD800) << 10) + (ex->unicode - 0xDC00));
+                    ex->alta = 0;
+                } else {
+                    descartar_alta(ex);
+                    acrescentar_utf8(ex, ex->unicode);
+                }
+                break;
+            }
+            case LEX_LITERAL:
+                if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+                    c == '-' || c == '+' || c == '.' || c == 'E') {
+                    acrescentar(ex, c);
+                    break;
+                }
+                if (concluir_literal(ex) != 0 || processar_estrutura(ex, c) != 0) {
+                    return -1;
+                }
+                break;
+        }
+    }
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: extrator_json_concluir
+   ========================================================================
+   Marca o fim do documento. Retorna 0 se ele estava completo e válido.
+   ======================================================================== */
+int extrator_json_concluir(ExtratorJSON *ex) {
+    if (ex->erro) {
+        return -1;
+    }
+    
+    if (ex->estado == LEX_LITERAL && concluir_literal(ex) != 0) {
+        return -1;
+    }
+    
+    if (ex->estado != LEX_ESTRUTURA || ex->profundidade != 0 || ex->espera[0] != ESPERA_NADA) {
+        return falhar(ex, "documento incompleto");
+    }
+    
+    return 0;
+}
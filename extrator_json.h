@@ -0,0 +1,59 @@
+#ifndef EXTRATOR_JSON_H
+#define EXTRATOR_JSON_H
+
+#include <stddef.h>
+
+#define EXTRATOR_JSON_PROFUNDIDADE 32
+#define EXTRATOR_JSON_CAMINHO 256
+#define EXTRATOR_JSON_VALOR 512
+
+/* Campo de interesse, identificado pelo caminho a partir da raiz:
+   chaves separadas por '.', "[]" para elementos de array e '*' para
+   qualquer chave. Ex.: "microrregiao.mesorregiao.UF.regiao.nome",
+   "[].date", "[].res[].res.*". */
+typedef struct {
+    const char *caminho;
+    int campo;              /* identificador repassado ao retorno */
+} CampoJSON;
+
+/* Chamado para cada valor cujo caminho casa com um campo declarado.
+   'valor' é o texto já decodificado (strings) ou o literal como veio
+   (números, true, false, null); é NULL quando o que terminou foi um
+   objeto ou array. 'chave' é o último trecho do caminho. */
+typedef void (*RetornoCampoJSON)(void *destino, int campo, const char *valor, const char *chave);
+
+/* Extrator incremental: recebe o documento em pedaços de qualquer
+   tamanho (ex.: direto do write callback) e avisa os campos declarados
+   sem montar a árvore do documento. Não aloca memória. */
+typedef struct {
+    const CampoJSON *campos;
+    int total_campos;
+    RetornoCampoJSON retorno;
+    void *destino;
+    
+    int estado;
+    int profundidade;
+    unsigned char tipo[EXTRATOR_JSON_PROFUNDIDADE];
+    unsigned char espera[EXTRATOR_JSON_PROFUNDIDADE];
+    unsigned short inicio[EXTRATOR_JSON_PROFUNDIDADE];
+    unsigned short chave[EXTRATOR_JSON_PROFUNDIDADE];
+    char caminho[EXTRATOR_JSON_CAMINHO];
+    size_t tamanho_caminho;
+    size_t inicio_chave;
+    char valor[EXTRATOR_JSON_VALOR];
+    size_t tamanho_valor;
+    int lendo_chave;
+    unsigned int unicode;
+    int digitos_unicode;
+    unsigned int alta;      /* primeira metade de um par surrogate */
+    long posicao;
+    const char *erro;
+} ExtratorJSON;
+
+void extrator_json_iniciar(ExtratorJSON *ex, const CampoJSON *campos, int total_campos,
+                           RetornoCampoJSON retorno, void *destino);
+int extrator_json_alimentar(ExtratorJSON *ex, const char *dados, size_t tamanho);
+int extrator_json_concluir(ExtratorJSON *ex);
+const char *extrator_json_erro(const ExtratorJSON *ex);
+
+#endif
@@ -0,0 +1,401 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "indice_ibge.h"
+
+/* ========================================================================
+   ÍNDICE DE MUNICÍPIOS DO IBGE
+   ========================================================================
+   O Brasil tem cerca de 5.570 municípios. Em vez de duas requisições ao
+   IBGE por CEP, a lista completa e a população de todos são obtidas uma
+   vez (ou lidas de um snapshot local) e guardadas em um array de
+   registros de 16 bytes ordenado pelo código IBGE, com os nomes em um
+   único pool de texto e a região como índice em uma tabela fixa. A
+   etapa do IBGE vira uma busca binária em memória.
+   ======================================================================== */
+
+#define INDICE_IBGE_CODIGOS_POR_REQUISICAO 100
+#define INDICE_IBGE_CABECALHO "# indice-ibge v1"
+
+static const char *REGIOES_IBGE[] = {
+    "", "Norte", "Nordeste", "Sudeste", "Sul", "Centro-Oeste"
+};
+#define TOTAL_REGIOES_IBGE (sizeof(REGIOES_IBGE) / sizeof(REGIOES_IBGE[0]))
+
+static uint8_t indice_regiao(const char *regiao) {
+    for (uint8_t i = 1; i < TOTAL_REGIOES_IBGE; i++) {
+        if (strcmp(REGIOES_IBGE[i], regiao) == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+static int comparar_municipios(const void *a, const void *b) {
+    const MunicipioIBGE *ma = (const MunicipioIBGE *)a;
+    const MunicipioIBGE *mb = (const MunicipioIBGE *)b;
+    return (ma->codigo > mb->codigo) - (ma->codigo < mb->codigo);
+}
+
+void indice_ibge_iniciar(IndiceIBGE *indice) {
+    memset(indice, 0, sizeof(*indice));
+}
+
+/* Libera os registros; a validade configurada (ttl, janela) é mantida */
+void indice_ibge_finalizar(IndiceIBGE *indice) {
+    int ttl = indice->ttl;
+    int janela = indice->janela;
+    
+    free(indice->municipios);
+    free(indice->nomes);
+    memset(indice, 0, sizeof(*indice));
+    indice->ttl = ttl;
+    indice->janela = janela;
+}
+
+size_t indice_ibge_memoria(const IndiceIBGE *indice) {
+    return (size_t)indice->capacidade * sizeof(MunicipioIBGE) + indice->capacidade_nomes;
+}
+
+/* ========================================================================
+   FUNÇÃO: inserir_municipio
+   ========================================================================
+   Acrescenta um município ao final do array (a ordenação é feita uma vez
+   ao fim da construção).
+   ======================================================================== */
+static int inserir_municipio(IndiceIBGE *indice, uint32_t codigo, const char *nome,
+                             const char *regiao, int populacao) {
+    size_t len = strlen(nome) + 1;
+    
+    if (indice->quantidade == indice->capacidade) {
+        int nova = indice->capacidade ? indice->capacidade * 2 : 8192;
+        MunicipioIBGE *ptr = realloc(indice->municipios, nova * sizeof(MunicipioIBGE));
+        if (!ptr) {
+            return -1;
+        }
+        indice->municipios = ptr;
+        indice->capacidade = nova;
+    }
+    
+    if (indice->tamanho_nomes + len > indice->capacidade_nomes) {
+        size_t nova = indice->capacidade_nomes ? indice->capacidade_nomes * 2 : 128 * 1024;
+        while (nova < indice->tamanho_nomes + len) nova *= 2;
+        char *ptr = realloc(indice->nomes, nova);
+        if (!ptr) {
+            return -1;
+        }
+        indice->nomes = ptr;
+        indice->capacidade_nomes = nova;
+    }
+    
+    MunicipioIBGE *m = &indice->municipios[indice->quantidade++];
+    memset(m, 0, sizeof(*m));
+    m->codigo = codigo;
+    m->populacao = populacao;
+    m->nome = (uint32_t)indice->tamanho_nomes;
+    m->regiao = indice_regiao(regiao);
+    memcpy(indice->nomes + indice->tamanho_nomes, nome, len);
+    indice->tamanho_nomes += len;
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: concluir_indice
+   ========================================================================
+   Ordena os registros por código e devolve a folga das alocações.
+   ======================================================================== */
+static void concluir_indice(IndiceIBGE *indice) {
+    qsort(indice->municipios, indice->quantidade, sizeof(MunicipioIBGE), comparar_municipios);
+    
+    if (indice->quantidade > 0) {
+        MunicipioIBGE *m = realloc(indice->municipios, indice->quantidade * sizeof(MunicipioIBGE));
+        char *n = realloc(indice->nomes, indice->tamanho_nomes);
+        if (m) {
+            indice->municipios = m;
+            indice->capacidade = indice->quantidade;
+        }
+        if (n) {
+            indice->nomes = n;
+            indice->capacidade_nomes = indice->tamanho_nomes;
+        }
+    }
+}
+
+static MunicipioIBGE *localizar_municipio(IndiceIBGE *indice, uint32_t codigo) {
+    MunicipioIBGE chave;
+    chave.codigo = codigo;
+    return bsearch(&chave, indice->municipios, indice->quantidade,
+                   sizeof(MunicipioIBGE), comparar_municipios);
+}
+
+/* ========================================================================
+   FUNÇÃO: indice_ibge_buscar
+   ========================================================================
+   Retorna 1 e preenche nome, região e população se o município estiver
+   no índice, 0 caso contrário.
+   ======================================================================== */
+int indice_ibge_buscar(IndiceIBGE *indice, const char *codigo_ibge, DadosIBGE *dados) {
+    MunicipioIBGE *m = localizar_municipio(indice, (uint32_t)strtoul(codigo_ibge, NULL, 10));
+    
+    if (!m) {
+        indice->faltas++;
+        return 0;
+    }
+    
+    strncpy(dados->nome_completo, indice->nomes + m->nome, sizeof(dados->nome_completo) - 1);
+    strncpy(dados->regiao, REGIOES_IBGE[m->regiao], sizeof(dados->regiao) - 1);
+    dados->populacao = m->populacao;
+    indice->acertos++;
+    
+    return 1;
+}
+
+/* ========================================================================
+   FUNÇÃO: indice_ibge_definir_populacao
+   ========================================================================
+   Atualiza a população de um município já indexado (construção do índice
+   e revalidação em segundo plano pelo motor). Retorna 1 se o código
+   estava no índice, 0 caso contrário.
+   ======================================================================== */
+int indice_ibge_definir_populacao(IndiceIBGE *indice, const char *codigo_ibge, int populacao) {
+    MunicipioIBGE *m = localizar_municipio(indice, (uint32_t)strtoul(codigo_ibge, NULL, 10));
+    
+    if (!m) {
+        return 0;
+    }
+    m->populacao = populacao;
+    return 1;
+}
+
+static void aplicar_populacao(const char *codigo_ibge, int populacao, void *contexto) {
+    indice_ibge_definir_populacao((IndiceIBGE *)contexto, codigo_ibge, populacao);
+}
+
+EstadoDado indice_ibge_estado(const IndiceIBGE *indice, time_t agora) {
+    return estado_dado(indice->atualizado, indice->ttl, indice->janela, agora);
+}
+
+/* ========================================================================
+   FUNÇÃO: indice_ibge_preparar
+   ========================================================================
+   Constrói o índice pela rede: uma requisição para a lista completa de
+   municípios e uma requisição de população para cada grupo de
+   INDICE_IBGE_CODIGOS_POR_REQUISICAO códigos (separados por '|').
+   ======================================================================== */
+int indice_ibge_preparar(IndiceIBGE *indice, ClienteHTTP *cliente) {
+    HTTPResponse response = {NULL, 0, 0};
+    char url[2048];
+    char codigos[1536];
+    CURLcode res;
+    json_error_t error;
+    
+    montar_url_municipios(url, sizeof(url));
+    fprintf(stderr, "[IBGE] Baixando lista de municípios: %s\n", url);
+    
+    res = cliente_http_get(cliente, UPSTREAM_IBGE, url, &response);
+    if (res != CURLE_OK) {
+        fprintf(stderr, "[ERRO] curl_easy_perform() falhou: %s\n", curl_easy_strerror(res));
+        free(response.data);
+        return -1;
+    }
+    
+    json_t *root = json_loads(response.data ? response.data : "", 0, &error);
+    resposta_http_liberar(&response);
+    
+    if (!json_is_array(root)) {
+        fprintf(stderr, "[ERRO] Lista de municípios inválida: %s\n", root ? "não é um array" : error.text);
+        json_decref(root);
+        return -1;
+    }
+    
+    size_t i;
+    json_t *item;
+    json_array_foreach(root, i, item) {
+        DadosIBGE dados = {0};
+        json_t *id = json_object_get(item, "id");
+        if (!json_is_integer(id)) {
+            continue;
+        }
+        extrair_municipio(item, &dados);
+        if (inserir_municipio(indice, (uint32_t)json_integer_value(id), dados.nome_completo,
+                              dados.regiao, 0) != 0) {
+            fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+            json_decref(root);
+            return -1;
+        }
+    }
+    json_decref(root);
+    
+    concluir_indice(indice);
+    
+    /* População: vários códigos por requisição */
+    for (int inicio = 0; inicio < indice->quantidade; inicio += INDICE_IBGE_CODIGOS_POR_REQUISICAO) {
+        int fim = inicio + INDICE_IBGE_CODIGOS_POR_REQUISICAO;
+        size_t usado = 0;
+        if (fim > indice->quantidade) fim = indice->quantidade;
+        for (int j = inicio; j < fim; j++) {
+            usado += snprintf(codigos + usado, sizeof(codigos) - usado, "%s%u",
+                              j > inicio ? "|" : "", indice->municipios[j].codigo);
+        }
+    
+        montar_url_populacao(url, sizeof(url), codigos);
+        res = cliente_http_get(cliente, UPSTREAM_IBGE, url, &response);
+        if (res != CURLE_OK || !response.data ||
+            parsear_populacoes(response.data, aplicar_populacao, indice) < 0) {
+            fprintf(stderr, "[AVISO] População indisponível para os códigos %u a %u\n",
+                    indice->municipios[inicio].codigo, indice->municipios[fim - 1].codigo);
+        }
+        resposta_http_resetar(&response);
+    }
+    resposta_http_liberar(&response);
+    
+    indice->atualizado = time(NULL);
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: indice_ibge_restaurar
+   ========================================================================
+   Copia para o índice (vazio) os registros e o pool de nomes guardados
+   em um snapshot (ver snapshot.c), obtidos em 'atualizado', conferindo
+   ordem, região e nomes.
+   Retorna 0 em caso de sucesso e -1 se os dados forem inconsistentes ou
+   faltar memória.
+   ======================================================================== */
+int indice_ibge_restaurar(IndiceIBGE *indice, const MunicipioIBGE *municipios, int quantidade,
+                          const char *nomes, size_t tamanho_nomes, time_t atualizado) {
+    if (quantidade <= 0 || tamanho_nomes == 0 || nomes[tamanho_nomes - 1] != '\0') {
+        return -1;
+    }
+    
+    for (int i = 0; i < quantidade; i++) {
+        const MunicipioIBGE *m = &municipios[i];
+        if (m->nome >= tamanho_nomes || m->regiao >= TOTAL_REGIOES_IBGE ||
+            (i > 0 && m->codigo <= municipios[i - 1].codigo)) {
+            return -1;
+        }
+    }
+    
+    indice->municipios = malloc(quantidade * sizeof(MunicipioIBGE));
+    indice->nomes = malloc(tamanho_nomes);
+    if (!indice->municipios || !indice->nomes) {
+        indice_ibge_finalizar(indice);
+        return -1;
+    }
+    
+    memcpy(indice->municipios, municipios, quantidade * sizeof(MunicipioIBGE));
+    memcpy(indice->nomes, nomes, tamanho_nomes);
+    indice->quantidade = indice->capacidade = quantidade;
+    indice->tamanho_nomes = indice->capacidade_nomes = tamanho_nomes;
+    indice->atualizado = atualizado;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: indice_ibge_salvar
+   ========================================================================
+   Grava o índice como snapshot de texto, uma linha por município:
+   código, população, região e nome separados por tabulação. O cabeçalho
+   traz o total de municípios, conferido na leitura. O arquivo é escrito
+   ao lado e renomeado, para que uma gravação interrompida nunca deixe um
+   snapshot pela metade no lugar do anterior.
+   ======================================================================== */
+int indice_ibge_salvar(const IndiceIBGE *indice, const char *caminho) {
+    char temporario[1100];
+    FILE *fp;
+    
+    snprintf(temporario, sizeof(temporario), "%s.%d.tmp", caminho, (int)getpid());
+    fp = fopen(temporario, "w");
+    if (!fp) {
+        perror("[ERRO] Não foi possível gravar o snapshot do IBGE");
+        return -1;
+    }
+    
+    fprintf(fp, "%s %d\n", INDICE_IBGE_CABECALHO, indice->quantidade);
+    for (int i = 0; i < indice->quantidade; i++) {
+        const MunicipioIBGE *m = &indice->municipios[i];
+        fprintf(fp, "%u\t%d\t%s\t%s\n", m->codigo, m->populacao,
+                REGIOES_IBGE[m->regiao], indice->nomes + m->nome);
+    }
+    
+    int ok = !ferror(fp);
+    ok = (fclose(fp) == 0) && ok;
+    
+    /* rename é atômico: quem lê vê o snapshot antigo ou o novo inteiro */
+    if (!ok || rename(temporario, caminho) != 0) {
+        perror("[ERRO] Não foi possível gravar o snapshot do IBGE");
+        unlink(temporario);
+        return -1;
+    }
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: indice_ibge_carregar
+   ========================================================================
+   Lê um snapshot gravado por indice_ibge_salvar.
+   Retorna 0 em caso de sucesso e -1 se o arquivo não existir ou for
+   inválido, inclusive quando o número de municípios lidos não bate com
+   o do cabeçalho (arquivo truncado): o chamador volta a buscar na rede.
+   ======================================================================== */
+int indice_ibge_carregar(IndiceIBGE *indice, const char *caminho) {
+    FILE *fp = fopen(caminho, "r");
+    char linha[1024];
+    struct stat st;
+    int esperados = -1;
+    int lidos = 0;
+    
+    if (!fp) {
+        return -1;
+    }
+    
+    /* O snapshot tem a idade do arquivo */
+    indice->atualizado = fstat(fileno(fp), &st) == 0 ? st.st_mtime : 0;
+    
+    if (!fgets(linha, sizeof(linha), fp) ||
+        strncmp(linha, INDICE_IBGE_CABECALHO, strlen(INDICE_IBGE_CABECALHO)) != 0 ||
+        sscanf(linha + strlen(INDICE_IBGE_CABECALHO), "%d", &esperados) != 1 || esperados < 0) {
+        fprintf(stderr, "[ERRO] Snapshot do IBGE inválido: %s\n", caminho);
+        fclose(fp);
+        return -1;
+    }
+    
+    while (fgets(linha, sizeof(linha), fp)) {
+        char *campos[4];
+        char *p = linha;
+        int n = 0;
+    
+        linha[strcspn(linha, "\r\n")] = '\0';
+        while (n < 4) {
+            campos[n++] = p;
+            p = strchr(p, '\t');
+            if (!p) break;
+            *p++ = '\0';
+        }
+        if (n != 4) {
+            continue;
+        }
+    
+        if (inserir_municipio(indice, (uint32_t)strtoul(campos[0], NULL, 10), campos[3],
+                              campos[2], atoi(campos[1])) != 0) {
+            fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+            fclose(fp);
+            return -1;
+        }
+        lidos++;
+    }
+    
+    fclose(fp);
+    
+    if (lidos != esperados) {
+        fprintf(stderr, "[AVISO] Snapshot do IBGE incompleto (%d de %d municípios): %s\n",
+                lidos, esperados, caminho);
+        return -1;
+    }
+    
+    concluir_indice(indice);
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef INDICE_IBGE_H
+#define INDICE_IBGE_H
+
+#include <stdint.h>
+#include "integrador__apis.h"
+
+/* Registro compacto de um município (16 bytes) */
+typedef struct {
+    uint32_t codigo;        /* código IBGE de 7 dígitos */
+    int32_t populacao;
+    uint32_t nome;          /* deslocamento em IndiceIBGE.nomes */
+    uint8_t regiao;         /* índice em REGIOES_IBGE */
+} MunicipioIBGE;
+
+/* Índice em memória de todos os municípios, ordenado por código */
+struct IndiceIBGE {
+    MunicipioIBGE *municipios;
+    int quantidade;
+    int capacidade;
+    char *nomes;
+    size_t tamanho_nomes;
+    size_t capacidade_nomes;
+    time_t atualizado;          /* quando as populações foram obtidas */
+    int ttl;                    /* validade em segundos (0 = não vence) */
+    int janela;                 /* depois do TTL, segundos servindo o índice velho */
+    long acertos;
+    long faltas;
+};
+
+#define INDICE_IBGE_TTL_PADRAO (30 * 86400)
+
+void indice_ibge_iniciar(IndiceIBGE *indice);
+void indice_ibge_finalizar(IndiceIBGE *indice);
+int indice_ibge_preparar(IndiceIBGE *indice, ClienteHTTP *cliente);
+int indice_ibge_carregar(IndiceIBGE *indice, const char *caminho);
+int indice_ibge_salvar(const IndiceIBGE *indice, const char *caminho);
+int indice_ibge_restaurar(IndiceIBGE *indice, const MunicipioIBGE *municipios, int quantidade,
+                          const char *nomes, size_t tamanho_nomes, time_t atualizado);
+int indice_ibge_buscar(IndiceIBGE *indice, const char *codigo_ibge, DadosIBGE *dados);
+int indice_ibge_definir_populacao(IndiceIBGE *indice, const char *codigo_ibge, int populacao);
+EstadoDado indice_ibge_estado(const IndiceIBGE *indice, time_t agora);
+size_t indice_ibge_memoria(const IndiceIBGE *indice);
+
+#endif
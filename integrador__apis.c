@@ -1,29 +1,429 @@
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "integrador__apis.h"
+#include "cache_cep.h"
+#include "cache_negativo.h"
+#include "cache_feriados.h"
+#include "indice_ibge.h"
+
+/* URLs base padrão das APIs (podem ser sobrescritas em tempo de
+   compilação, ex.: -DURL_BASE_VIACEP=\"http://127.0.0.1:8080\", ou em
+   tempo de execução com configurar_url_base) */
+#ifndef URL_BASE_VIACEP
+#define URL_BASE_VIACEP "https://viacep.com.br"
+#endif
+#ifndef URL_BASE_IBGE
+#define URL_BASE_IBGE "https://servicodados.ibge.gov.br"
+#endif
+#ifndef URL_BASE_BRASILAPI
+#define URL_BASE_BRASILAPI "https://brasilapi.com.br"
+#endif
+
+static const char *urls_base[TOTAL_UPSTREAMS] = {
+    URL_BASE_VIACEP,
+    URL_BASE_IBGE,
+    URL_BASE_BRASILAPI
+};
+
+/* ========================================================================
+   FUNÇÃO: configurar_url_base
+   ========================================================================
+   Aponta um upstream para outra URL base (sem barra final), ex.: um
+   servidor local para testes de carga e benchmarks.
+   ======================================================================== */
+void configurar_url_base(Upstream upstream, const char *url) {
+    urls_base[upstream] = url;
+}
+
+static int silencioso = 0;
 
 /* ========================================================================
-   FUNÇÃO: write_callback
+   FUNÇÃO: configurar_silencioso
    ========================================================================
-   Callback para libcurl armazenar dados recebidos da API.
+   Suprime os avisos de andamento das funções buscar_* ([API n], URL,
+   [SUCESSO], [CACHE]). Erros continuam na saída de erro.
    ======================================================================== */
-static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    HTTPResponse *response = (HTTPResponse *)userp;
+void configurar_silencioso(int ativo) {
+    silencioso = ativo;
+}
+
+static void avisar(const char *formato, ...) {
+    va_list args;
     
-    char *ptr = realloc(response->data, response->size + realsize + 1);
-    if (ptr == NULL) {
-        fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
-        return 0;
+    if (silencioso) {
+        return;
+    }
+    va_start(args, formato);
+    vprintf(formato, args);
+    va_end(args);
+}
+
+/* ========================================================================
+   FUNÇÃO: cep_valido
+   ========================================================================
+   Verifica, sem ir à rede, se 'cep' pode existir: 8 dígitos (com hífen
+   opcional depois do quinto) e a partir de 01000-000, o menor CEP dos
+   Correios. Retorna 0 e o CEP numérico em 'numero' se for válido e -1
+   caso contrário.
+   ======================================================================== */
+int cep_valido(const char *cep, uint32_t *numero) {
+    if (cep_para_numero(cep, numero) != 0 || *numero < CEP_MINIMO) {
+        return -1;
+    }
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: estado_dado
+   ========================================================================
+   Classifica um dado obtido em 'atualizado': fresco até 'ttl' segundos,
+   velho (ainda servido enquanto é renovado em segundo plano) por mais
+   'janela' segundos e vencido depois disso. ttl 0 = nunca vence.
+   ======================================================================== */
+EstadoDado estado_dado(time_t atualizado, int ttl, int janela, time_t agora) {
+    if (ttl <= 0 || agora - atualizado < ttl) {
+        return DADO_FRESCO;
+    }
+    return agora - atualizado < (time_t)ttl + janela ? DADO_VELHO : DADO_VENCIDO;
+}
+
+/* ========================================================================
+   FUNÇÕES: montar_url_*
+   ========================================================================
+   Montam as URLs de cada etapa. Compartilhadas entre o modo de CEP único
+   e o modo lote, para que ambos consultem exatamente os mesmos endpoints.
+   montar_url_populacao aceita vários códigos separados por '|'.
+   ======================================================================== */
+void montar_url_endereco(char *url, size_t tamanho, const char *cep) {
+    snprintf(url, tamanho, "%s/ws/%s/json/", urls_base[UPSTREAM_VIACEP], cep);
+}
+
+void montar_url_municipio(char *url, size_t tamanho, const char *codigo_ibge) {
+    snprintf(url, tamanho, "%s/api/v1/localidades/municipios/%s", urls_base[UPSTREAM_IBGE], codigo_ibge);
+}
+
+void montar_url_municipios(char *url, size_t tamanho) {
+    snprintf(url, tamanho, "%s/api/v1/localidades/municipios", urls_base[UPSTREAM_IBGE]);
+}
+
+void montar_url_populacao(char *url, size_t tamanho, const char *codigo_ibge) {
+    snprintf(url, tamanho, "%s/api/v1/pesquisas/indicadores/47001/resultados/%s",
+             urls_base[UPSTREAM_IBGE], codigo_ibge);
+}
+
+void montar_url_feriados(char *url, size_t tamanho, int ano) {
+    snprintf(url, tamanho, "%s/api/feriados/v1/%d", urls_base[UPSTREAM_BRASILAPI], ano);
+}
+
+/* ========================================================================
+   EXTRAÇÃO DAS RESPOSTAS
+   ========================================================================
+   Cada resposta é lida pelo extrator incremental (extrator_json.c), que
+   preenche DadosEndereco/DadosIBGE direto dos campos abaixo, sem montar
+   a árvore do documento. O motor alimenta o extrator no write callback,
+   enquanto a resposta chega; as funções parsear_* fazem o mesmo com uma
+   resposta já completa em memória.
+   ======================================================================== */
+
+enum {
+    CAMPO_CEP,
+    CAMPO_LOGRADOURO,
+    CAMPO_BAIRRO,
+    CAMPO_CIDADE,
+    CAMPO_UF,
+    CAMPO_IBGE,
+    CAMPO_NOME,
+    CAMPO_REGIAO,
+    CAMPO_LOCALIDADE,
+    CAMPO_VALOR_ANO,
+    CAMPO_FIM_LOCALIDADE
+};
+
+static const CampoJSON CAMPOS_ENDERECO[] = {
+    {"cep", CAMPO_CEP},
+    {"logradouro", CAMPO_LOGRADOURO},
+    {"bairro", CAMPO_BAIRRO},
+    {"localidade", CAMPO_CIDADE},
+    {"uf", CAMPO_UF},
+    {"ibge", CAMPO_IBGE}
+};
+
+static const CampoJSON CAMPOS_MUNICIPIO[] = {
+    {"nome", CAMPO_NOME},
+    {"microrregiao.mesorregiao.UF.regiao.nome", CAMPO_REGIAO}
+};
+
+static const CampoJSON CAMPOS_POPULACAO[] = {
+    {"[].res[].localidade", CAMPO_LOCALIDADE},
+    {"[].res[].res.*", CAMPO_VALOR_ANO},
+    {"[].res[]", CAMPO_FIM_LOCALIDADE}
+};
+
+#define TOTAL_CAMPOS(campos) ((int)(sizeof(campos) / sizeof(campos[0])))
+
+static void copiar_campo(char *destino, size_t tamanho, const char *valor) {
+    /* null e valores que não são texto ficam vazios */
+    if (valor && strcmp(valor, "null") != 0) {
+        snprintf(destino, tamanho, "%s", valor);
+    }
+}
+
+static void receber_endereco(void *destino, int campo, const char *valor, const char *chave) {
+    DadosEndereco *endereco = (DadosEndereco *)destino;
+    (void)chave;
+    
+    switch (campo) {
+        case CAMPO_CEP:        copiar_campo(endereco->cep, sizeof(endereco->cep), valor); break;
+        case CAMPO_LOGRADOURO: copiar_campo(endereco->logradouro, sizeof(endereco->logradouro), valor); break;
+        case CAMPO_BAIRRO:     copiar_campo(endereco->bairro, sizeof(endereco->bairro), valor); break;
+        case CAMPO_CIDADE:     copiar_campo(endereco->cidade, sizeof(endereco->cidade), valor); break;
+        case CAMPO_UF:         copiar_campo(endereco->uf, sizeof(endereco->uf), valor); break;
+        case CAMPO_IBGE:       copiar_campo(endereco->codigo_ibge, sizeof(endereco->codigo_ibge), valor); break;
+        default: break;
+    }
+}
+
+static void receber_municipio(void *destino, int campo, const char *valor, const char *chave) {
+    DadosIBGE *dados = (DadosIBGE *)destino;
+    (void)chave;
+    
+    if (campo == CAMPO_NOME) {
+        copiar_campo(dados->nome_completo, sizeof(dados->nome_completo), valor);
+    } else if (campo == CAMPO_REGIAO) {
+        copiar_campo(dados->regiao, sizeof(dados->regiao), valor);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: receber_populacao
+   ========================================================================
+   Cada localidade traz um objeto "res" ano → valor; como antes, vale o
+   último ano listado. Ao fim da localidade, o valor é repassado.
+   ======================================================================== */
+static void receber_populacao(void *destino, int campo, const char *valor, const char *chave) {
+    ColetorPopulacao *coletor = (ColetorPopulacao *)destino;
+    (void)chave;
+    
+    switch (campo) {
+        case CAMPO_LOCALIDADE:
+            copiar_campo(coletor->localidade, sizeof(coletor->localidade), valor);
+            break;
+        case CAMPO_VALOR_ANO:
+            if (valor && strcmp(valor, "null") != 0) {
+                coletor->populacao = atoi(valor);
+            }
+            break;
+        case CAMPO_FIM_LOCALIDADE:
+            if (coletor->localidade[0] && coletor->populacao >= 0) {
+                coletor->retorno(coletor->localidade, coletor->populacao, coletor->contexto);
+                coletor->encontradas++;
+            }
+            coletor->localidade[0] = '\0';
+            coletor->populacao = -1;
+            break;
+        default:
+            break;
+    }
+}
+
+/* ========================================================================
+   FUNÇÕES: extrator_*_iniciar
+   ========================================================================
+   Preparam um extrator para uma resposta de cada etapa. Os dados de
+   destino devem estar zerados e permanecer válidos até a conclusão.
+   ======================================================================== */
+void extrator_endereco_iniciar(ExtratorJSON *ex, DadosEndereco *endereco) {
+    extrator_json_iniciar(ex, CAMPOS_ENDERECO, TOTAL_CAMPOS(CAMPOS_ENDERECO), receber_endereco, endereco);
+}
+
+void extrator_municipio_iniciar(ExtratorJSON *ex, DadosIBGE *dados) {
+    extrator_json_iniciar(ex, CAMPOS_MUNICIPIO, TOTAL_CAMPOS(CAMPOS_MUNICIPIO), receber_municipio, dados);
+}
+
+void extrator_populacoes_iniciar(ExtratorJSON *ex, ColetorPopulacao *coletor,
+                                 RetornoPopulacao retorno, void *contexto) {
+    memset(coletor, 0, sizeof(*coletor));
+    coletor->retorno = retorno;
+    coletor->contexto = contexto;
+    coletor->populacao = -1;
+    extrator_json_iniciar(ex, CAMPOS_POPULACAO, TOTAL_CAMPOS(CAMPOS_POPULACAO), receber_populacao, coletor);
+}
+
+/* ========================================================================
+   FUNÇÃO: concluir_extracao
+   ========================================================================
+   Encerra a extração de uma resposta. Retorna 0 se o JSON era válido.
+   ======================================================================== */
+int concluir_extracao(ExtratorJSON *ex) {
+    if (extrator_json_concluir(ex) != 0) {
+        fprintf(stderr, "[ERRO] Falha ao parsear JSON: %s\n", extrator_json_erro(ex));
+        return -1;
+    }
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: concluir_endereco
+   ========================================================================
+   Encerra a extração de uma resposta do ViaCEP. Retorna -1 se o JSON for
+   inválido e CEP_NAO_ENCONTRADO se o CEP não existir (o ViaCEP responde
+   {"erro": true}, sem o campo "cep").
+   ======================================================================== */
+int concluir_endereco(ExtratorJSON *ex, DadosEndereco *endereco) {
+    if (concluir_extracao(ex) != 0) {
+        return -1;
+    }
+    
+    if (endereco->cep[0] == '\0') {
+        return CEP_NAO_ENCONTRADO;
+    }
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: parsear_endereco
+   ========================================================================
+   Parseia a resposta JSON do ViaCEP e preenche DadosEndereco.
+   Retorna 0 em caso de sucesso, -1 em caso de erro e CEP_NAO_ENCONTRADO
+   se o CEP não existir.
+   ======================================================================== */
+int parsear_endereco(const char *json, DadosEndereco *endereco) {
+    ExtratorJSON ex;
+    
+    if (!json) {
+        return -1;      /* corpo vazio: o buffer nem chegou a ser alocado */
+    }
+    
+    extrator_endereco_iniciar(&ex, endereco);
+    extrator_json_alimentar(&ex, json, strlen(json));
+    
+    int ret = concluir_endereco(&ex, endereco);
+    if (ret == CEP_NAO_ENCONTRADO) {
+        fprintf(stderr, "[ERRO] CEP não encontrado\n");
+    }
+    
+    return ret;
+}
+
+/* ========================================================================
+   FUNÇÃO: extrair_municipio
+   ========================================================================
+   Extrai nome e região de um objeto de município já carregado pelo
+   jansson. Usada na lista completa de municípios (indice_ibge.c).
+   ======================================================================== */
+void extrair_municipio(json_t *root, DadosIBGE *dados) {
+    //Extrai nome completo do município
+    json_t *nome = json_object_get(root, "nome");
+    if (json_is_string(nome)) {
+        strncpy(dados->nome_completo, json_string_value(nome), sizeof(dados->nome_completo) - 1);
+    }
+    
+    //Extrai região
+    json_t *microrregiao = json_object_get(root, "microrregiao");
+    if (json_is_object(microrregiao)) {
+        json_t *mesorregiao = json_object_get(microrregiao, "mesorregiao");
+        if (json_is_object(mesorregiao)) {
+            json_t *uf = json_object_get(mesorregiao, "UF");
+            if (json_is_object(uf)) {
+                json_t *regiao = json_object_get(uf, "regiao");
+                if (json_is_object(regiao)) {
+                    json_t *nome_regiao = json_object_get(regiao, "nome");
+                    if (json_is_string(nome_regiao)) {
+                        strncpy(dados->regiao, json_string_value(nome_regiao), sizeof(dados->regiao) - 1);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: parsear_municipio
+   ========================================================================
+   Parseia a resposta de localidades/municipios do IBGE (nome e região).
+   ======================================================================== */
+int parsear_municipio(const char *json, DadosIBGE *dados) {
+    ExtratorJSON ex;
+    
+    if (!json) {
+        return -1;      /* corpo vazio: o buffer nem chegou a ser alocado */
+    }
+    
+    extrator_municipio_iniciar(&ex, dados);
+    extrator_json_alimentar(&ex, json, strlen(json));
+    
+    return concluir_extracao(&ex);
+}
+
+static void definir_populacao(const char *codigo_ibge, int populacao, void *contexto) {
+    DadosIBGE *dados = (DadosIBGE *)contexto;
+    (void)codigo_ibge;
+    dados->populacao = populacao;
+}
+
+/* ========================================================================
+   FUNÇÃO: parsear_populacao
+   ========================================================================
+   Parseia a resposta do indicador 47001 (população estimada) e guarda o
+   valor mais recente em dados->populacao.
+   ======================================================================== */
+int parsear_populacao(const char *json, DadosIBGE *dados) {
+    ExtratorJSON ex;
+    ColetorPopulacao coletor;
+    
+    if (!json) {
+        return -1;      /* corpo vazio: o buffer nem chegou a ser alocado */
+    }
+    
+    extrator_populacoes_iniciar(&ex, &coletor, definir_populacao, dados);
+    extrator_json_alimentar(&ex, json, strlen(json));
+    
+    return extrator_json_concluir(&ex) == 0 ? 0 : -1;
+}
+
+/* ========================================================================
+   FUNÇÃO: parsear_populacoes
+   ========================================================================
+   Parseia uma resposta do indicador 47001 com várias localidades e chama
+   'retorno' com o valor mais recente de cada uma. Retorna o número de
+   localidades encontradas ou -1 se o JSON for inválido.
+   ======================================================================== */
+int parsear_populacoes(const char *json, RetornoPopulacao retorno, void *contexto) {
+    ExtratorJSON ex;
+    ColetorPopulacao coletor;
+    
+    if (!json) {
+        return -1;      /* corpo vazio: o buffer nem chegou a ser alocado */
     }
     
-    response->data = ptr;
-    memcpy(&(response->data[response->size]), contents, realsize);
-    response->size += realsize;
-    response->data[response->size] = 0;
+    extrator_populacoes_iniciar(&ex, &coletor, retorno, contexto);
+    extrator_json_alimentar(&ex, json, strlen(json));
     
-    return realsize;
+    if (extrator_json_concluir(&ex) != 0) {
+        return -1;
+    }
+    
+    return coletor.encontradas;
+}
+
+/* ========================================================================
+   FUNÇÃO: finalizar_dados_municipio
+   ========================================================================
+   Calcula área e densidade depois que nome, região e população já foram
+   preenchidos.
+   ======================================================================== */
+void finalizar_dados_municipio(DadosIBGE *dados) {
+    /* Calcula área e densidade (valores aproximados baseados no código IBGE) */
+    /* Nota: A API do IBGE tem endpoints específicos para área, mas para simplificar
+       estamos usando valores estimados. Em produção, faça uma chamada adicional. */
+    dados->area = 500.0; /* km² - valor placeholder */
+    if (dados->populacao > 0) {
+        dados->densidade = dados->populacao / dados->area;
+    }
 }
 
 /* ========================================================================
@@ -32,90 +432,76 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, void *us
    Busca dados de endereço na API ViaCEP.
    
    Fluxo:
-   1. Monta URL com o CEP
-   2. Faz requisição HTTP GET
-   3. Parseia JSON de resposta
-   4. Extrai campos relevantes (incluindo código IBGE)
-   5. Preenche estrutura DadosEndereco
+   1. Recusa CEPs inválidos ou já respondidos como inexistentes
+   2. Consulta o cache local de CEPs, se houver
+   3. Monta URL com o CEP
+   4. Faz requisição HTTP GET
+   5. Parseia JSON de resposta
+   6. Extrai campos relevantes (incluindo código IBGE)
+   7. Preenche estrutura DadosEndereco e grava no cache (ou no cache
+      de CEPs inexistentes)
    ======================================================================== */
-int buscar_endereco(const char *cep, DadosEndereco *endereco) {
-    CURL *curl;
+int buscar_endereco(ClienteHTTP *cliente, const char *cep, DadosEndereco *endereco) {
     CURLcode res;
-    HTTPResponse response = {NULL, 0};
+    HTTPResponse response = {NULL, 0, 0};
     char url[256];
+    char digitos[9];
+    uint32_t numero;
     
-    printf("\n[API 1] Consultando ViaCEP...\n");
-    snprintf(url, sizeof(url), "https://viacep.com.br/ws/%s/json/", cep);
-    printf("URL: %s\n", url);
+    avisar("\n[API 1] Consultando ViaCEP...\n");
     
-    curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "[ERRO] Falha ao inicializar CURL\n");
+    if (cep_valido(cep, &numero) != 0) {
+        fprintf(stderr, "[ERRO] CEP inválido: %s\n", cep);
+        return -1;
+    }
+    /* Só os dígitos na URL e no cache, com ou sem hífen na entrada */
+    snprintf(digitos, sizeof(digitos), "%08u", (unsigned)numero);
+    cep = digitos;
+    if (cliente->cache_negativo && cache_negativo_contem(cliente->cache_negativo, numero, time(NULL))) {
+        fprintf(stderr, "[ERRO] CEP não encontrado (cache)\n");
         return -1;
     }
     
-    //Configura requisição
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "IntegradorAPIs/1.0");
+    if (cliente->cache_cep && cache_cep_buscar(cliente->cache_cep, cep, endereco)) {
+        avisar("[CACHE] Endereço encontrado no cache local: %s - %s/%s\n",
+               endereco->logradouro, endereco->cidade, endereco->uf);
+        avisar("Código IBGE: %s\n", endereco->codigo_ibge);
+        return 0;
+    }
+    
+    montar_url_endereco(url, sizeof(url), cep);
+    avisar("URL: %s\n", url);
     
-    //executa requisição
-    res = curl_easy_perform(curl);
+    //executa requisição no handle persistente do ViaCEP
+    res = cliente_http_get(cliente, UPSTREAM_VIACEP, url, &response);
     
     if (res != CURLE_OK) {
         fprintf(stderr, "[ERRO] curl_easy_perform() falhou: %s\n",
                 curl_easy_strerror(res));
-        curl_easy_cleanup(curl);
+        free(response.data);
         return -1;
     }
     
-    curl_easy_cleanup(curl);
-    
     //Parseia JSON
-    json_error_t error;
-    json_t *root = json_loads(response.data, 0, &error);
+    long inicio_parse = metricas_agora_ns();
+    int ret = parsear_endereco(response.data, endereco);
+    metricas_registrar_parse(&cliente->metricas[UPSTREAM_VIACEP], metricas_agora_ns() - inicio_parse);
     free(response.data);
     
-    if (!root) {
-        fprintf(stderr, "[ERRO] Falha ao parsear JSON: %s\n", error.text);
+    if (ret == CEP_NAO_ENCONTRADO && cliente->cache_negativo) {
+        cache_negativo_gravar(cliente->cache_negativo, numero, time(NULL));
+    }
+    if (ret != 0) {
         return -1;
     }
     
-    //Verifica se o CEP foi encontrado
-    json_t *erro = json_object_get(root, "erro");
-    if (erro && json_is_boolean(erro) && json_boolean_value(erro)) {
-        fprintf(stderr, "[ERRO] CEP não encontrado\n");
-        json_decref(root);
-        return -1;
+    if (cliente->cache_cep) {
+        cache_cep_gravar(cliente->cache_cep, cep, endereco);
     }
-
-    //extrai dados
-    json_t *j_cep = json_object_get(root, "cep");
-    json_t *j_logr = json_object_get(root, "logradouro");
-    json_t *j_bairro = json_object_get(root, "bairro");
-    json_t *j_cidade = json_object_get(root, "localidade");
-    json_t *j_uf = json_object_get(root, "uf");
-    json_t *j_ibge = json_object_get(root, "ibge");
-    
-    if (json_is_string(j_cep))
-        strncpy(endereco->cep, json_string_value(j_cep), sizeof(endereco->cep) - 1);
-    if (json_is_string(j_logr))
-        strncpy(endereco->logradouro, json_string_value(j_logr), sizeof(endereco->logradouro) - 1);
-    if (json_is_string(j_bairro))
-        strncpy(endereco->bairro, json_string_value(j_bairro), sizeof(endereco->bairro) - 1);
-    if (json_is_string(j_cidade))
-        strncpy(endereco->cidade, json_string_value(j_cidade), sizeof(endereco->cidade) - 1);
-    if (json_is_string(j_uf))
-        strncpy(endereco->uf, json_string_value(j_uf), sizeof(endereco->uf) - 1);
-    if (json_is_string(j_ibge))
-        strncpy(endereco->codigo_ibge, json_string_value(j_ibge), sizeof(endereco->codigo_ibge) - 1);
-    
-    json_decref(root);
-    
-    printf("[SUCESSO] Endereço encontrado: %s - %s/%s\n", 
+    
+    avisar("[SUCESSO] Endereço encontrado: %s - %s/%s\n", 
            endereco->logradouro, endereco->cidade, endereco->uf);
-    printf("Código IBGE: %s\n", endereco->codigo_ibge);
+    avisar("Código IBGE: %s\n", endereco->codigo_ibge);
     
     return 0;
 }
@@ -132,134 +518,60 @@ int buscar_endereco(const char *cep, DadosEndereco *endereco) {
    4. Extrai população, área, densidade, região
    5. Preenche estrutura DadosIBGE
    ======================================================================== */
-int buscar_dados_municipio(const char *codigo_ibge, DadosIBGE *dados) {
-    CURL *curl;
+int buscar_dados_municipio(ClienteHTTP *cliente, const char *codigo_ibge, DadosIBGE *dados) {
     CURLcode res;
-    HTTPResponse response = {NULL, 0};
+    HTTPResponse response = {NULL, 0, 0};
     char url[512];
     
-    printf("\n[API 2] Consultando IBGE...\n");
-    snprintf(url, sizeof(url), 
-             "https://servicodados.ibge.gov.br/api/v1/localidades/municipios/%s", 
-             codigo_ibge);
-    printf("URL: %s\n", url);
-    
-    curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "[ERRO] Falha ao inicializar CURL\n");
-        return -1;
+    if (cliente->indice_ibge && indice_ibge_buscar(cliente->indice_ibge, codigo_ibge, dados)) {
+        avisar("\n[INDICE] Município encontrado no índice do IBGE: %s\n", dados->nome_completo);
+        finalizar_dados_municipio(dados);
+        return 0;
     }
     
-    //Configura requisição
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "IntegradorAPIs/1.0");
+    avisar("\n[API 2] Consultando IBGE...\n");
+    montar_url_municipio(url, sizeof(url), codigo_ibge);
+    avisar("URL: %s\n", url);
     
-    //Executa requisição
-    res = curl_easy_perform(curl);
+    //Executa requisição no handle persistente do IBGE
+    res = cliente_http_get(cliente, UPSTREAM_IBGE, url, &response);
     
     if (res != CURLE_OK) {
         fprintf(stderr, "[ERRO] curl_easy_perform() falhou: %s\n",
                 curl_easy_strerror(res));
-        curl_easy_cleanup(curl);
+        free(response.data);
         return -1;
     }
     
-    curl_easy_cleanup(curl);
-    
     //Parseia JSON
-    json_error_t error;
-    json_t *root = json_loads(response.data, 0, &error);
+    long inicio_parse = metricas_agora_ns();
+    int ret = parsear_municipio(response.data, dados);
+    metricas_registrar_parse(&cliente->metricas[UPSTREAM_IBGE], metricas_agora_ns() - inicio_parse);
     
-    if (!root) {
-        fprintf(stderr, "[ERRO] Falha ao parsear JSON: %s\n", error.text);
-        free(response.data);
+    if (ret != 0) {
+        resposta_http_liberar(&response);
         return -1;
     }
     
-    free(response.data);
-    
-    //Extrai nome completo do município
-    json_t *nome = json_object_get(root, "nome");
-    if (json_is_string(nome)) {
-        strncpy(dados->nome_completo, json_string_value(nome), sizeof(dados->nome_completo) - 1);
-    }
+    /* Busca dados adicionais (população estimada) */
+    montar_url_populacao(url, sizeof(url), codigo_ibge);
     
-    //Extrai região
-    json_t *microrregiao = json_object_get(root, "microrregiao");
-    if (json_is_object(microrregiao)) {
-        json_t *mesorregiao = json_object_get(microrregiao, "mesorregiao");
-        if (json_is_object(mesorregiao)) {
-            json_t *uf = json_object_get(mesorregiao, "UF");
-            if (json_is_object(uf)) {
-                json_t *regiao = json_object_get(uf, "regiao");
-                if (json_is_object(regiao)) {
-                    json_t *nome_regiao = json_object_get(regiao, "nome");
-                    if (json_is_string(nome_regiao)) {
-                        strncpy(dados->regiao, json_string_value(nome_regiao), sizeof(dados->regiao) - 1);
-                    }
-                }
-            }
-        }
-    }
+    /* O buffer da resposta anterior é reaproveitado */
+    resposta_http_resetar(&response);
     
-    json_decref(root);
+    /* Mesmo host da consulta anterior: a conexão já aberta é reaproveitada */
+    res = cliente_http_get(cliente, UPSTREAM_IBGE, url, &response);
     
-    /* Busca dados adicionais (população estimada) */
-    snprintf(url, sizeof(url),
-             "https://servicodados.ibge.gov.br/api/v1/pesquisas/indicadores/47001/resultados/%s",
-             codigo_ibge);
-    
-    response.data = NULL;
-    response.size = 0;
-    
-    curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, url);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, "IntegradorAPIs/1.0");
-        
-        res = curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
-        
-        if (res == CURLE_OK && response.data) {
-            json_t *root2 = json_loads(response.data, 0, &error);
-            if (root2 && json_is_array(root2) && json_array_size(root2) > 0) {
-                json_t *item = json_array_get(root2, 0);
-                json_t *res_obj = json_object_get(item, "res");
-                if (json_is_array(res_obj) && json_array_size(res_obj) > 0) {
-                    json_t *res_item = json_array_get(res_obj, 0);
-                    json_t *res_data = json_object_get(res_item, "res");
-                    if (json_is_object(res_data)) {
-                        /* Pega o valor mais recente */
-                        const char *key;
-                        json_t *value;
-                        json_object_foreach(res_data, key, value) {
-                            if (json_is_integer(value)) {
-                                dados->populacao = json_integer_value(value);
-                            } else if (json_is_string(value)) {
-                                dados->populacao = atoi(json_string_value(value));
-                            }
-                        }
-                    }
-                }
-            }
-            if (root2) json_decref(root2);
-            free(response.data);
-        }
+    if (res == CURLE_OK && response.data) {
+        inicio_parse = metricas_agora_ns();
+        parsear_populacao(response.data, dados);
+        metricas_registrar_parse(&cliente->metricas[UPSTREAM_IBGE], metricas_agora_ns() - inicio_parse);
     }
+    free(response.data);
     
-    /* Calcula área e densidade (valores aproximados baseados no código IBGE) */
-    /* Nota: A API do IBGE tem endpoints específicos para área, mas para simplificar
-       estamos usando valores estimados. Em produção, faça uma chamada adicional. */
-    dados->area = 500.0; /* km² - valor placeholder */
-    if (dados->populacao > 0) {
-        dados->densidade = dados->populacao / dados->area;
-    }
+    finalizar_dados_municipio(dados);
     
-    printf("[SUCESSO] Dados do município obtidos\n");
+    avisar("[SUCESSO] Dados do município obtidos\n");
     
     return 0;
 }
@@ -270,132 +582,95 @@ int buscar_dados_municipio(const char *codigo_ibge, DadosIBGE *dados) {
    Busca informações sobre feriados na API Brasil API.
    
    Fluxo:
-   1. Obtém ano atual
-   2. Monta URL com ano
-   3. Faz requisição HTTP GET
-   4. Parseia JSON de resposta
-   5. Identifica próximo feriado a partir da data atual
-   6. Preenche estrutura DadosFeriados
+   1. Obtém data atual
+   2. Verifica se a tabela de feriados do ano já está no cache
+   3. Se não estiver, monta URL com ano, faz requisição HTTP GET e
+      carrega a resposta no cache (também o ano seguinte, se não restar
+      nenhum feriado no ano atual)
+   4. Identifica próximo feriado a partir da data atual (busca binária)
+   5. Preenche estrutura DadosFeriados
    
    Nota: O parâmetro 'uf' não é utilizado pois a API retorna feriados
          nacionais. Mantido para compatibilidade com a assinatura.
    ======================================================================== */
-int buscar_feriados(const char *uf __attribute__((unused)), DadosFeriados *feriados) {
-    CURL *curl;
+int buscar_feriados(ClienteHTTP *cliente, const char *uf __attribute__((unused)), DadosFeriados *feriados) {
     CURLcode res;
-    HTTPResponse response = {NULL, 0};
+    HTTPResponse response = {NULL, 0, 0};
     char url[512];
     time_t now;
-    struct tm *timeinfo;
+    struct tm timeinfo;
     int ano_atual;
-    
-    // Obtém ano atual
-    time(&now);
-    timeinfo = localtime(&now);
-    ano_atual = timeinfo->tm_year + 1900;
-    
-    printf("\n[API 3] Consultando Brasil API (Feriados)...\n");
-    snprintf(url, sizeof(url), 
-             "https://brasilapi.com.br/api/feriados/v1/%d", 
-             ano_atual);
-    printf("URL: %s\n", url);
-    
-    curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "[ERRO] Falha ao inicializar CURL\n");
-        return -1;
+    int ano;
+    int ret = 0;
+    CacheFeriados local;
+    CacheFeriados *cache = cliente->cache_feriados;
+    
+    // Sem cache compartilhado, usa um temporário só para esta chamada
+    if (!cache) {
+        cache_feriados_iniciar(&local, NULL);
+        cache = &local;
     }
     
-    // Configura requisição
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "IntegradorAPIs/1.0");
+    // Obtém data atual
+    time(&now);
+    localtime_r(&now, &timeinfo);
+    ano_atual = timeinfo.tm_year + 1900;
     
-    // Executa requisição
-    res = curl_easy_perform(curl);
+    avisar("\n[API 3] Consultando Brasil API (Feriados)...\n");
     
-    if (res != CURLE_OK) {
-        fprintf(stderr, "[ERRO] curl_easy_perform() falhou: %s\n",
-                curl_easy_strerror(res));
-        curl_easy_cleanup(curl);
-        return -1;
+    if (cache_feriados_ano_pendente(cache, &timeinfo) == 0) {
+        avisar("[CACHE] Tabela de feriados de %d já carregada\n", ano_atual);
     }
     
-    curl_easy_cleanup(curl);
-    
-    // Parseia JSON
-    json_error_t error;
-    json_t *root = json_loads(response.data, 0, &error);
-    
-    if (!root) {
-        fprintf(stderr, "[ERRO] Falha ao parsear JSON: %s\n", error.text);
-        free(response.data);
-        return -1;
-    }
+    while ((ano = cache_feriados_ano_pendente(cache, &timeinfo)) != 0) {
+        montar_url_feriados(url, sizeof(url), ano);
+        avisar("URL: %s\n", url);
     
-    free(response.data);
+        // Executa requisição no handle persistente da Brasil API
+        res = cliente_http_get(cliente, UPSTREAM_BRASILAPI, url, &response);
     
-    if (!json_is_array(root)) {
-        fprintf(stderr, "[ERRO] Resposta não é um array\n");
-        json_decref(root);
-        return -1;
-    }
+        if (res != CURLE_OK) {
+            fprintf(stderr, "[ERRO] curl_easy_perform() falhou: %s\n",
+                    curl_easy_strerror(res));
+        }
     
-    // Inicializa contadores
-    feriados->quantidade_feriados = 0;
-    int proximo_encontrado = 0;
-    
-    // Data atual no formato YYYY-MM-DD
-    char data_hoje[16];
-    strftime(data_hoje, sizeof(data_hoje), "%Y-%m-%d", timeinfo);
-    
-    // Percorre todos os feriados
-    size_t array_size = json_array_size(root);
-    for (size_t i = 0; i < array_size; i++) {
-        json_t *feriado = json_array_get(root, i);
-        
-        json_t *j_date = json_object_get(feriado, "date");
-        json_t *j_name = json_object_get(feriado, "name");
-        json_t *j_type = json_object_get(feriado, "type");
-        
-        if (!json_is_string(j_date) || !json_is_string(j_name)) {
-            continue;
+        // Parseia JSON e guarda a tabela do ano no cache
+        long inicio_parse = metricas_agora_ns();
+        int invalida = res != CURLE_OK ||
+                       cache_feriados_carregar_json(cache, ano, response.data ? response.data : "") != 0;
+        if (res == CURLE_OK) {
+            metricas_registrar_parse(&cliente->metricas[UPSTREAM_BRASILAPI], metricas_agora_ns() - inicio_parse);
         }
-        
-        const char *data = json_string_value(j_date);
-        const char *nome = json_string_value(j_name);
-        const char *tipo = json_is_string(j_type) ? json_string_value(j_type) : "national";
-        
-        // Conta todos os feriados
-        feriados->quantidade_feriados++;
-        
-        // Procura o próximo feriado (após hoje)
-        if (!proximo_encontrado && strcmp(data, data_hoje) >= 0) {
-            strncpy(feriados->proximo_feriado, nome, sizeof(feriados->proximo_feriado) - 1);
-            strncpy(feriados->data_feriado, data, sizeof(feriados->data_feriado) - 1);
-            strncpy(feriados->tipo_feriado, tipo, sizeof(feriados->tipo_feriado) - 1);
-            proximo_encontrado = 1;
+        if (invalida) {
+            if (ano == ano_atual) {
+                ret = -1;
+                break;
+            }
+            // Sem o ano seguinte, apenas não há virada de ano
+            cache_feriados_marcar_vazio(cache, ano);
         }
+    
+        resposta_http_resetar(&response);
     }
     
-    json_decref(root);
+    resposta_http_liberar(&response);
     
-    if (!proximo_encontrado) {
-        snprintf(feriados->proximo_feriado, sizeof(feriados->proximo_feriado), 
-                 "Nenhum feriado restante em %d", ano_atual);
-        snprintf(feriados->data_feriado, sizeof(feriados->data_feriado), "N/A");
-        snprintf(feriados->tipo_feriado, sizeof(feriados->tipo_feriado), "N/A");
+    if (ret == 0) {
+        cache_feriados_preencher(cache, &timeinfo, feriados);
+    
+        avisar("[SUCESSO] %d feriados nacionais encontrados em %d\n", 
+               feriados->quantidade_feriados, ano_atual);
+        if (strcmp(feriados->data_feriado, "N/A") != 0) {
+            avisar("Próximo feriado: %s (%s)\n", 
+                   feriados->proximo_feriado, feriados->data_feriado);
+        }
     }
     
-    printf("[SUCESSO] %d feriados nacionais encontrados em %d\n", 
-           feriados->quantidade_feriados, ano_atual);
-    if (proximo_encontrado) {
-        printf("Próximo feriado: %s (%s)\n", 
-               feriados->proximo_feriado, feriados->data_feriado);
+    if (cache == &local) {
+        cache_feriados_finalizar(&local);
     }
     
-    return 0;
+    return ret;
 }
 
 /* ========================================================================
@@ -1,8 +1,12 @@
 #ifndef INTEGRADOR_APIS_H
 #define INTEGRADOR_APIS_H
 
+#include <stdint.h>
+#include <time.h>
 #include <curl/curl.h>
 #include <jansson.h>
+#include "cliente_http.h"
+#include "extrator_json.h"
 
 /* Estrutura para armazenar dados do ViaCEP */
 typedef struct {
@@ -31,16 +35,60 @@ typedef struct {
     char tipo_feriado[64];
 } DadosFeriados;
 
-/* Estrutura para resposta HTTP */
-typedef struct {
-    char *data;
-    size_t size;
-} HTTPResponse;
+/* Retorno de parsear_endereco/concluir_endereco para CEP inexistente */
+#define CEP_NAO_ENCONTRADO -2
+
+/* Menor CEP numérico existente (01000-000, São Paulo/SP) */
+#define CEP_MINIMO 1000000u
+
+/* Validade de um dado guardado em cache (ver estado_dado) */
+typedef enum {
+    DADO_FRESCO,
+    DADO_VELHO,                 /* servido, mas já deve ser renovado */
+    DADO_VENCIDO                /* não deve mais ser servido */
+} EstadoDado;
+
+#define JANELA_REVALIDACAO_PADRAO 86400     /* segundos */
 
 /* Funções principais */
-int buscar_endereco(const char *cep, DadosEndereco *endereco);
-int buscar_dados_municipio(const char *codigo_ibge, DadosIBGE *dados);
-int buscar_feriados(const char *uf, DadosFeriados *feriados);
+int buscar_endereco(ClienteHTTP *cliente, const char *cep, DadosEndereco *endereco);
+int buscar_dados_municipio(ClienteHTTP *cliente, const char *codigo_ibge, DadosIBGE *dados);
+int buscar_feriados(ClienteHTTP *cliente, const char *uf, DadosFeriados *feriados);
 void exibir_relatorio_completo(const DadosEndereco *endereco, const DadosIBGE *dados, const DadosFeriados *feriados);
 
+/* Recebe a população de cada localidade de uma resposta com vários códigos */
+typedef void (*RetornoPopulacao)(const char *codigo_ibge, int populacao, void *contexto);
+
+/* Estado da extração de uma resposta do indicador de população */
+typedef struct {
+    RetornoPopulacao retorno;
+    void *contexto;
+    char localidade[16];
+    int populacao;              /* valor do último ano lido, -1 se nenhum */
+    int encontradas;
+} ColetorPopulacao;
+
+/* Funções auxiliares (compartilhadas com o modo lote) */
+int cep_valido(const char *cep, uint32_t *numero);
+EstadoDado estado_dado(time_t atualizado, int ttl, int janela, time_t agora);
+void configurar_url_base(Upstream upstream, const char *url);
+void configurar_silencioso(int ativo);
+void montar_url_endereco(char *url, size_t tamanho, const char *cep);
+void montar_url_municipio(char *url, size_t tamanho, const char *codigo_ibge);
+void montar_url_municipios(char *url, size_t tamanho);
+void montar_url_populacao(char *url, size_t tamanho, const char *codigo_ibge);
+void montar_url_feriados(char *url, size_t tamanho, int ano);
+int parsear_endereco(const char *json, DadosEndereco *endereco);
+int parsear_municipio(const char *json, DadosIBGE *dados);
+int parsear_populacao(const char *json, DadosIBGE *dados);
+void extrair_municipio(json_t *root, DadosIBGE *dados);
+int parsear_populacoes(const char *json, RetornoPopulacao retorno, void *contexto);
+void extrator_endereco_iniciar(ExtratorJSON *ex, DadosEndereco *endereco);
+void extrator_municipio_iniciar(ExtratorJSON *ex, DadosIBGE *dados);
+void extrator_populacoes_iniciar(ExtratorJSON *ex, ColetorPopulacao *coletor,
+                                 RetornoPopulacao retorno, void *contexto);
+int concluir_extracao(ExtratorJSON *ex);
+int concluir_endereco(ExtratorJSON *ex, DadosEndereco *endereco);
+void finalizar_dados_municipio(DadosIBGE *dados);
+
 #endif
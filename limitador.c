@@ -0,0 +1,154 @@
+#include <string.h>
+#include "limitador.h"
+
+/* ========================================================================
+   LIMITE DE ENVIO POR HOST
+   ========================================================================
+   As APIs públicas respondem 429 quando recebem requisições demais. Em
+   vez de descobrir isso a cada lote, cada host tem um balde de fichas
+   (uma ficha por requisição, repostas a 'taxa' por segundo) e um teto de
+   requisições simultâneas; quem não cabe espera na fila do motor.
+   
+   A taxa segue o servidor (aumento aditivo, redução multiplicativa): uma
+   recusa (429 ou Retry-After) corta a taxa pela metade e, com
+   Retry-After, suspende os envios até o prazo pedido; cada resposta bem
+   sucedida devolve um pouco da taxa, até a configurada. Um host sem
+   limite configurado passa a ser limitado na primeira recusa, a partir
+   da metade da taxa observada até ali.
+   ======================================================================== */
+
+void limitador_configurar(Limitador *l, double taxa, int max_simultaneas) {
+    memset(l, 0, sizeof(*l));
+    l->taxa_maxima = taxa > 0 ? taxa : 0;
+    l->taxa = l->taxa_maxima;
+    l->fichas = l->taxa;
+    l->max_simultaneas = max_simultaneas > 0 ? max_simultaneas : 0;
+}
+
+static void repor_fichas(Limitador *l, double agora) {
+    double rajada = l->taxa > LIMITADOR_TAXA_MINIMA ? l->taxa : LIMITADOR_TAXA_MINIMA;
+    
+    if (l->atualizado > 0) {
+        l->fichas += (agora - l->atualizado) * l->taxa / 1000.0;
+        if (l->fichas > rajada) {
+            l->fichas = rajada;
+        }
+    }
+    l->atualizado = agora;
+}
+
+/* ========================================================================
+   FUNÇÃO: limitador_espera_ms
+   ========================================================================
+   Quanto falta (ms) para o host aceitar mais uma requisição: 0 se ela
+   pode sair agora e -1 se só depois que outra terminar (teto de
+   simultâneas). Não consome a ficha (ver limitador_consumir).
+   ======================================================================== */
+double limitador_espera_ms(Limitador *l, double agora) {
+    if (l->max_simultaneas > 0 && l->simultaneas >= l->max_simultaneas) {
+        return -1;
+    }
+    if (agora < l->pausa_ate) {
+        return l->pausa_ate - agora;
+    }
+    if (l->taxa <= 0) {
+        return 0;
+    }
+    
+    repor_fichas(l, agora);
+    return l->fichas >= 1 ? 0 : (1 - l->fichas) * 1000.0 / l->taxa;
+}
+
+/* ========================================================================
+   FUNÇÃO: limitador_consumir
+   ========================================================================
+   Registra uma requisição enviada. Deve seguir um limitador_espera_ms
+   que retornou 0; limitador_liberar é chamada quando ela terminar.
+   ======================================================================== */
+void limitador_consumir(Limitador *l, double agora) {
+    if (l->taxa > 0) {
+        l->fichas -= 1;
+    }
+    l->simultaneas++;
+    l->enviadas++;
+    
+    if (agora - l->inicio_janela >= 1000) {
+        if (l->inicio_janela > 0) {
+            l->taxa_observada = l->enviadas_janela * 1000.0 / (agora - l->inicio_janela);
+        }
+        l->inicio_janela = agora;
+        l->enviadas_janela = 0;
+    }
+    l->enviadas_janela++;
+}
+
+void limitador_liberar(Limitador *l) {
+    if (l->simultaneas > 0) {
+        l->simultaneas--;
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: limitador_sucesso
+   ========================================================================
+   Aumento aditivo: cerca de 1 req/s a mais a cada segundo de respostas
+   aceitas, sem passar da taxa configurada.
+   ======================================================================== */
+void limitador_sucesso(Limitador *l) {
+    if (l->taxa <= 0) {
+        return;
+    }
+    
+    l->taxa += 1.0 / l->taxa;
+    if (l->taxa_maxima > 0 && l->taxa > l->taxa_maxima) {
+        l->taxa = l->taxa_maxima;
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: limitador_recusado
+   ========================================================================
+   Redução multiplicativa após um 429 (ou resposta com Retry-After). As
+   recusas de uma mesma rajada chegam juntas, então a taxa só é reduzida
+   uma vez a cada LIMITADOR_INTERVALO_REDUCAO_MS.
+   ======================================================================== */
+void limitador_recusado(Limitador *l, double agora, double retry_after_ms) {
+    l->recusas++;
+    
+    if (retry_after_ms > 0 && agora + retry_after_ms > l->pausa_ate) {
+        l->pausa_ate = agora + retry_after_ms;
+    }
+    
+    if (l->ultima_reducao > 0 && agora - l->ultima_reducao < LIMITADOR_INTERVALO_REDUCAO_MS) {
+        return;
+    }
+    l->ultima_reducao = agora;
+    
+    if (l->taxa <= 0) {
+        double observada = l->taxa_observada;
+        if (observada <= 0 && agora > l->inicio_janela && l->inicio_janela > 0) {
+            observada = l->enviadas_janela * 1000.0 / (agora - l->inicio_janela);
+        }
+        l->taxa = observada;
+    }
+    l->taxa /= 2;
+    if (l->taxa < LIMITADOR_TAXA_MINIMA) {
+        l->taxa = LIMITADOR_TAXA_MINIMA;
+    }
+    if (l->fichas > 0) {
+        l->fichas = 0;
+    }
+    l->atualizado = agora;
+}
+
+void limitador_imprimir(FILE *saida, const char *rotulo, const Limitador *l) {
+    fprintf(saida, "%-10s %ld requisições, %ld esperaram, %ld recusas", rotulo,
+            l->enviadas, l->enfileiradas, l->recusas);
+    if (l->taxa > 0) {
+        fprintf(saida, ", taxa final %.1f req/s", l->taxa);
+    }
+    if (l->taxa_maxima > 0 || l->max_simultaneas > 0) {
+        fprintf(saida, " (limite: %.1f req/s, %d simultâneas)", l->taxa_maxima, l->max_simultaneas);
+    }
+    fprintf(saida, "\n");
+}
@@ -0,0 +1,42 @@
+#ifndef LIMITADOR_H
+#define LIMITADOR_H
+
+#include <stdio.h>
+
+/* Limite de envio para um host: balde de fichas (taxa por segundo, com
+   rajada de até um segundo de fichas) e teto de requisições simultâneas.
+   A taxa se adapta às recusas do servidor (ver limitador.c). Os
+   instantes são em ms do relógio monotônico. */
+typedef struct {
+    double taxa_maxima;         /* configurada, em req/s (0 = sem limite) */
+    int max_simultaneas;        /* 0 = sem limite */
+    
+    double taxa;                /* em vigor (0 = sem limite) */
+    double fichas;
+    double atualizado;          /* última reposição de fichas */
+    int simultaneas;
+    double pausa_ate;           /* Retry-After: nada sai antes disto */
+    double ultima_reducao;
+    
+    /* Taxa de envio observada, para começar a limitar quem não tinha limite */
+    double inicio_janela;
+    long enviadas_janela;
+    double taxa_observada;
+    
+    long enviadas;
+    long recusas;               /* respostas 429 ou com Retry-After */
+    long enfileiradas;          /* requisições que esperaram pelo limite */
+} Limitador;
+
+#define LIMITADOR_TAXA_MINIMA 1.0
+#define LIMITADOR_INTERVALO_REDUCAO_MS 1000
+
+void limitador_configurar(Limitador *l, double taxa, int max_simultaneas);
+double limitador_espera_ms(Limitador *l, double agora);
+void limitador_consumir(Limitador *l, double agora);
+void limitador_liberar(Limitador *l);
+void limitador_sucesso(Limitador *l);
+void limitador_recusado(Limitador *l, double agora, double retry_after_ms);
+void limitador_imprimir(FILE *saida, const char *rotulo, const Limitador *l);
+
+#endif
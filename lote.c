@@ -0,0 +1,718 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include "integrador__apis.h"
+#include "motor.h"
+#include "lote.h"
+#include "canal.h"
+#include "resultados.h"
+#include "saida.h"
+
+/* Estado compartilhado do lote */
+typedef struct {
+    const ConfigLote *config;
+    EstatisticasLote *estatisticas;
+    int ocupadas;
+    Resultados *resultados;     /* NULL = escreve cada resultado ao concluir */
+    Saida saida;
+} ContextoLote;
+
+/* Um slot do limite de concorrência */
+typedef struct {
+    Consulta consulta;
+    int ocupado;
+    ContextoLote *ctx;
+} SlotLote;
+
+static double agora_segundos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ========================================================================
+   FUNÇÃO: ler_proximo_cep
+   ========================================================================
+   Lê a próxima linha não vazia da entrada, sem espaços nas pontas.
+   Retorna 1 se leu um CEP e 0 no fim da entrada.
+   ======================================================================== */
+static int ler_proximo_cep(FILE *entrada, char *cep, size_t tamanho, long *linha) {
+    char buffer[128];
+    
+    while (fgets(buffer, sizeof(buffer), entrada)) {
+        size_t len = strlen(buffer);
+    
+        /* Descarta o restante de linhas longas demais */
+        if (len > 0 && buffer[len - 1] != '\n' && !feof(entrada)) {
+            int c;
+            while ((c = fgetc(entrada)) != EOF && c != '\n');
+        }
+        (*linha)++;
+    
+        char *inicio = buffer;
+        while (*inicio && isspace((unsigned char)*inicio)) inicio++;
+        char *fim = inicio + strlen(inicio);
+        while (fim > inicio && isspace((unsigned char)fim[-1])) fim--;
+        *fim = '\0';
+    
+        if (*inicio == '\0') {
+            continue;
+        }
+    
+        snprintf(cep, tamanho, "%s", inicio);
+        return 1;
+    }
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: registrar_resultado
+   ========================================================================
+   Conta uma consulta concluída e a escreve (ou a guarda, com 'ordenar').
+   ======================================================================== */
+static void registrar_resultado(ContextoLote *ctx, const Consulta *consulta) {
+    if (consulta->erro) {
+        ctx->estatisticas->falhas++;
+    } else {
+        ctx->estatisticas->sucesso++;
+    }
+    
+    /* Guardado para sair na ordem da entrada; sem memória, sai agora */
+    if (!ctx->resultados || resultados_adicionar(ctx->resultados, consulta) != 0) {
+        saida_consulta(&ctx->saida, consulta);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: consulta_concluida
+   ========================================================================
+   Chamada pelo motor quando todas as etapas de um CEP terminam.
+   Libera o slot para o próximo CEP da entrada.
+   ======================================================================== */
+static void consulta_concluida(Consulta *consulta, void *contexto) {
+    SlotLote *slot = (SlotLote *)contexto;
+    ContextoLote *ctx = slot->ctx;
+    
+    registrar_resultado(ctx, consulta);
+    slot->ocupado = 0;
+    ctx->ocupadas--;
+}
+
+/* ========================================================================
+   FUNÇÃO: escrever_ordenados
+   ========================================================================
+   Escreve os resultados guardados na ordem das linhas de entrada. Como
+   as linhas são números crescentes, basta uma tabela de posição por
+   linha, sem ordenação.
+   ======================================================================== */
+static int escrever_ordenados(const Resultados *resultados, Saida *saida, long ultima_linha) {
+    uint32_t *posicoes = malloc(((size_t)ultima_linha + 1) * sizeof(uint32_t));
+    Consulta consulta;
+    
+    if (!posicoes) {
+        fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+        return -1;
+    }
+    
+    memset(posicoes, 0xff, ((size_t)ultima_linha + 1) * sizeof(uint32_t));
+    for (long i = 0; i < resultados->quantidade; i++) {
+        posicoes[resultados->linha[i]] = (uint32_t)i;
+    }
+    
+    for (long linha = 1; linha <= ultima_linha; linha++) {
+        if (posicoes[linha] == UINT32_MAX) {
+            continue;
+        }
+        resultados_ler(resultados, posicoes[linha], &consulta);
+        saida_consulta(saida, &consulta);
+    }
+    
+    free(posicoes);
+    return 0;
+}
+
+/* ========================================================================
+   LOTE PARALELO
+   ========================================================================
+   Com config->threads > 1, o lote vira um pipeline de três estágios
+   ligados por canais limitados sem trava (ver canal.c):
+   
+       leitura ──canal──> N threads de E/S ──canal──> saída
+   
+   A thread principal lê os CEPs e os distribui pelo número do CEP, de
+   modo que CEPs repetidos caem no mesmo motor e continuam coalescendo.
+   Cada thread de E/S conduz o seu próprio motor (e o seu curl_multi); a
+   extração dos campos acontece enquanto as respostas chegam, então o
+   parse também se divide entre as N threads. A thread de saída conta,
+   formata e escreve os resultados, tirando isso do caminho da rede.
+   
+   Canal cheio segura quem produz: a leitura espera por espaço e uma
+   thread de E/S com a saída atrasada guarda a consulta no slot (que
+   segue ocupado) e, fora da trava do cliente, dorme até a saída abrir
+   espaço.
+   Para não acordar a outra ponta a cada item, a leitura só é chamada
+   quando o canal de entrada cai para a metade, e a saída quando o canal
+   de concluídas chega à metade ou quando a thread de E/S vai esperar.
+   Os caches e os limites por host do cliente são compartilhados sob a
+   trava dele, assim como o download da tabela de feriados: um motor a
+   baixa e os outros esperam o cache. DNS e sessões TLS, pelo share do
+   curl; as conexões ficam com o curl_multi de cada motor.
+   ======================================================================== */
+
+#define LOTE_CANAL_ENTRADA 1024     /* CEPs por thread de E/S */
+#define LOTE_CANAL_SAIDA 256        /* consultas concluídas por thread de E/S */
+#define LOTE_ESPERA_MS 1000
+#define LOTE_ESPERA_FILA_MS 10      /* com fila no limite do host (liberado por outra thread) */
+
+/* Um CEP lido da entrada, a caminho de uma thread de E/S */
+typedef struct {
+    char cep[16];
+    long linha;
+} EntradaLote;
+
+typedef struct ContextoParalelo ContextoParalelo;
+typedef struct ThreadES ThreadES;
+
+typedef struct SlotParalelo {
+    Consulta consulta;
+    int ocupado;
+    ThreadES *dona;
+    struct SlotParalelo *proximo_pendente;
+} SlotParalelo;
+
+/* Uma thread de E/S: seu motor, seus slots e seus dois canais */
+struct ThreadES {
+    ContextoParalelo *ctx;
+    pthread_t thread;
+    int iniciada;
+    Motor motor;
+    MetricasUpstream metricas[TOTAL_UPSTREAMS];
+    Canal entrada;          /* EntradaLote, da leitura */
+    Canal concluidas;       /* Consulta, para a saída */
+    SlotParalelo *slots;
+    int concorrencia;
+    int ocupadas;
+    SlotParalelo *pendentes;        /* concluídas que não couberam no canal, em ordem */
+    SlotParalelo *fim_pendentes;
+    atomic_int esperando;   /* parada em curl_multi_poll (ver acordar_thread_es) */
+    Campainha espaco;       /* espera por espaço no canal de concluídas */
+};
+
+struct ContextoParalelo {
+    ContextoLote lote;      /* usado só pela thread de saída */
+    ThreadES *threads;
+    int total_threads;
+    atomic_int fim_entrada;
+    atomic_int terminadas;  /* threads de E/S que já saíram */
+    Campainha leitura;      /* espera por espaço em um canal de entrada */
+    Campainha saida;        /* espera por consultas concluídas */
+};
+
+/* ========================================================================
+   FUNÇÃO: acordar_thread_es
+   ========================================================================
+   Interrompe o curl_multi_poll de uma thread de E/S que está esperando
+   por CEPs. Emparelha com o anúncio em executar_thread_es: ou ela vê o
+   canal já alterado, ou esta thread a vê esperando.
+   ======================================================================== */
+static void acordar_thread_es(ThreadES *es) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&es->esperando, memory_order_relaxed)) {
+        curl_multi_wakeup(es->motor.multi);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: consulta_concluida_es
+   ========================================================================
+   Passa a consulta concluída para a thread de saída e libera o slot.
+   Chamada pelo motor com a trava do cliente tomada, então nunca espera:
+   com o canal cheio (ou já com pendentes, para manter a ordem), o slot
+   segue ocupado na lista de pendentes, que executar_thread_es despeja
+   fora da trava.
+   ======================================================================== */
+static void consulta_concluida_es(Consulta *consulta, void *contexto) {
+    SlotParalelo *slot = (SlotParalelo *)contexto;
+    ThreadES *es = slot->dona;
+    
+    if (es->pendentes || canal_enviar(&es->concluidas, consulta) != 0) {
+        slot->proximo_pendente = NULL;
+        if (es->fim_pendentes) {
+            es->fim_pendentes->proximo_pendente = slot;
+        } else {
+            es->pendentes = slot;
+        }
+        es->fim_pendentes = slot;
+        return;
+    }
+    if (canal_quantidade(&es->concluidas) >= LOTE_CANAL_SAIDA / 2) {
+        campainha_tocar(&es->ctx->saida);
+    }
+    
+    slot->ocupado = 0;
+    es->ocupadas--;
+}
+
+/* ========================================================================
+   FUNÇÃO: despejar_pendentes
+   ========================================================================
+   Passa para o canal de concluídas o que couber da lista de pendentes,
+   liberando os slots. Retorna 1 se ainda restarem pendentes.
+   ======================================================================== */
+static int despejar_pendentes(ThreadES *es) {
+    while (es->pendentes) {
+        SlotParalelo *slot = es->pendentes;
+        if (canal_enviar(&es->concluidas, &slot->consulta) != 0) {
+            campainha_tocar(&es->ctx->saida);
+            return 1;
+        }
+        es->pendentes = slot->proximo_pendente;
+        slot->ocupado = 0;
+        es->ocupadas--;
+    }
+    es->fim_pendentes = NULL;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: executar_thread_es
+   ========================================================================
+   Laço de uma thread de E/S: preenche os slots livres com os CEPs do
+   canal de entrada e conduz o motor até a entrada acabar e as consultas
+   em andamento terminarem.
+   ======================================================================== */
+static void *executar_thread_es(void *arg) {
+    ThreadES *es = (ThreadES *)arg;
+    ContextoParalelo *ctx = es->ctx;
+    EntradaLote entrada;
+    
+    for (;;) {
+        int recebidos = 0;
+    
+        /* Saída atrasada: sem rodar o motor, que só concluiria mais
+           consultas sem lugar, dorme até ela abrir espaço no canal */
+        if (despejar_pendentes(es)) {
+            campainha_preparar(&es->espaco);
+            if (canal_quantidade(&es->concluidas) < es->concluidas.capacidade) {
+                campainha_cancelar(&es->espaco);
+            } else {
+                campainha_esperar(&es->espaco, LOTE_ESPERA_MS);
+            }
+            continue;
+        }
+    
+        for (int i = 0; i < es->concorrencia && es->ocupadas < es->concorrencia; i++) {
+            SlotParalelo *slot = &es->slots[i];
+            if (slot->ocupado) {
+                continue;
+            }
+            if (canal_receber(&es->entrada, &entrada) != 0) {
+                break;
+            }
+            memcpy(slot->consulta.cep, entrada.cep, sizeof(slot->consulta.cep));
+            slot->consulta.linha = entrada.linha;
+            slot->consulta.prioridade = PRIORIDADE_LOTE;
+            slot->ocupado = 1;
+            es->ocupadas++;
+            recebidos++;
+            motor_submeter(&es->motor, &slot->consulta, consulta_concluida_es, slot);
+        }
+        if (recebidos > 0 && canal_quantidade(&es->entrada) <= LOTE_CANAL_ENTRADA / 2) {
+            campainha_tocar(&ctx->leitura);
+        }
+    
+        int fim = atomic_load(&ctx->fim_entrada) && canal_vazio(&es->entrada);
+        if (fim && es->ocupadas == 0) {
+            break;
+        }
+    
+        if (!canal_vazio(&es->concluidas)) {
+            campainha_tocar(&ctx->saida);
+        }
+    
+        /* Com slot livre, a espera também termina quando chega CEP */
+        int espera = es->motor.enfileiradas > 0 ? LOTE_ESPERA_FILA_MS : LOTE_ESPERA_MS;
+        if (es->ocupadas < es->concorrencia && !fim) {
+            atomic_store(&es->esperando, 1);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (!canal_vazio(&es->entrada) || atomic_load(&ctx->fim_entrada)) {
+                espera = 0;
+            }
+        }
+    
+        if (es->ocupadas > 0) {
+            motor_executar(&es->motor, espera);
+        } else {
+            /* Nada em andamento: motor_executar não esperaria */
+            motor_executar(&es->motor, 0);
+            if (espera > 0) {
+                curl_multi_poll(es->motor.multi, NULL, 0, espera, NULL);
+            }
+        }
+        atomic_store(&es->esperando, 0);
+    }
+    
+    atomic_fetch_add(&ctx->terminadas, 1);
+    campainha_tocar(&ctx->saida);
+    return NULL;
+}
+
+/* ========================================================================
+   FUNÇÃO: executar_saida
+   ========================================================================
+   Thread de saída: recolhe as consultas concluídas de todas as threads
+   de E/S e as registra. Termina quando todas as threads de E/S saíram e
+   os canais esvaziaram.
+   ======================================================================== */
+static void *executar_saida(void *arg) {
+    ContextoParalelo *ctx = (ContextoParalelo *)arg;
+    Consulta consulta;
+    
+    for (;;) {
+        /* Lido antes de esvaziar: o que veio antes da saída de uma thread
+           de E/S é recolhido nesta mesma passada */
+        int terminadas = atomic_load(&ctx->terminadas);
+        int recebidas = 0;
+    
+        for (int i = 0; i < ctx->total_threads; i++) {
+            int antes = recebidas;
+            while (canal_receber(&ctx->threads[i].concluidas, &consulta) == 0) {
+                registrar_resultado(&ctx->lote, &consulta);
+                recebidas++;
+            }
+            if (recebidas > antes) {
+                campainha_tocar(&ctx->threads[i].espaco);
+            }
+        }
+        if (recebidas > 0) {
+            continue;
+        }
+        if (terminadas == ctx->total_threads) {
+            break;
+        }
+    
+        campainha_preparar(&ctx->saida);
+        int pronto = atomic_load(&ctx->terminadas) != terminadas;
+        for (int i = 0; i < ctx->total_threads && !pronto; i++) {
+            pronto = !canal_vazio(&ctx->threads[i].concluidas);
+        }
+        if (pronto) {
+            campainha_cancelar(&ctx->saida);
+        } else {
+            campainha_esperar(&ctx->saida, LOTE_ESPERA_MS);
+        }
+    }
+    
+    return NULL;
+}
+
+/* ========================================================================
+   FUNÇÃO: escolher_thread_es
+   ========================================================================
+   Thread de E/S de um CEP: pelo número do CEP (ou por um hash do texto,
+   se ele for inválido), para que repetições dele se encontrem no mesmo
+   motor.
+   ======================================================================== */
+static int escolher_thread_es(const char *cep, int total_threads) {
+    uint32_t numero;
+    
+    if (cep_valido(cep, &numero) != 0) {
+        numero = 2166136261u;
+        for (const char *c = cep; *c; c++) {
+            numero = (numero ^ (unsigned char)*c) * 16777619u;
+        }
+    }
+    /* Hash multiplicativo; os bits altos decidem (os baixos repetiriam a
+       paridade do CEP) */
+    return (int)(((uint64_t)(numero * 2654435761u) * (uint32_t)total_threads) >> 32);
+}
+
+static void finalizar_threads_es(ContextoParalelo *ctx) {
+    for (int i = 0; i < ctx->total_threads; i++) {
+        ThreadES *es = &ctx->threads[i];
+        motor_finalizar(&es->motor);
+        canal_finalizar(&es->entrada);
+        canal_finalizar(&es->concluidas);
+        campainha_finalizar(&es->espaco);
+        free(es->slots);
+    }
+    free(ctx->threads);
+}
+
+/* ========================================================================
+   FUNÇÃO: iniciar_threads_es
+   ========================================================================
+   Prepara (sem iniciar) as threads de E/S: cada uma com o seu motor,
+   métricas próprias e a sua parte da concorrência. Só a primeira
+   revalida os caches.
+   ======================================================================== */
+static int iniciar_threads_es(ContextoParalelo *ctx, const ConfigLote *config, int concorrencia) {
+    int por_thread = (concorrencia + ctx->total_threads - 1) / ctx->total_threads;
+    
+    ctx->threads = calloc(ctx->total_threads, sizeof(ThreadES));
+    if (!ctx->threads) {
+        fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+        return -1;
+    }
+    
+    for (int i = 0; i < ctx->total_threads; i++) {
+        ThreadES *es = &ctx->threads[i];
+    
+        es->ctx = ctx;
+        es->concorrencia = por_thread;
+        atomic_init(&es->esperando, 0);
+        campainha_iniciar(&es->espaco);
+        es->slots = calloc(por_thread, sizeof(SlotParalelo));
+        if (!es->slots ||
+            canal_iniciar(&es->entrada, LOTE_CANAL_ENTRADA, sizeof(EntradaLote)) != 0 ||
+            canal_iniciar(&es->concluidas, LOTE_CANAL_SAIDA, sizeof(Consulta)) != 0 ||
+            motor_iniciar(&es->motor, config->cliente) != 0) {
+            ctx->total_threads = i + 1;
+            finalizar_threads_es(ctx);
+            return -1;
+        }
+        for (int j = 0; j < por_thread; j++) {
+            es->slots[j].dona = es;
+        }
+        es->motor.metricas = es->metricas;
+        es->motor.revalidar = i == 0;
+        es->motor.populacao_por_lote = config->populacao_por_lote;
+        es->motor.janela_populacao_ms = MOTOR_JANELA_POPULACAO_MS;
+    }
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: executar_lote_paralelo
+   ========================================================================
+   Versão de executar_lote com config->threads threads de E/S e uma de
+   saída (ver LOTE PARALELO acima). A thread que chama faz a leitura.
+   ======================================================================== */
+static int executar_lote_paralelo(const ConfigLote *config, EstatisticasLote *estatisticas,
+                                  int concorrencia) {
+    ContextoParalelo ctx;
+    Resultados resultados;
+    pthread_t thread_saida;
+    EntradaLote item;
+    long linha = 0;
+    int ret = 0;
+    
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.lote.config = config;
+    ctx.lote.estatisticas = estatisticas;
+    ctx.total_threads = config->threads;
+    atomic_init(&ctx.fim_entrada, 0);
+    atomic_init(&ctx.terminadas, 0);
+    resultados_iniciar(&resultados);
+    if (config->ordenar) {
+        ctx.lote.resultados = &resultados;
+    }
+    
+    fflush(config->saida);
+    if (saida_iniciar(&ctx.lote.saida, fileno(config->saida), config->formato) != 0) {
+        return -1;
+    }
+    if (iniciar_threads_es(&ctx, config, concorrencia) != 0) {
+        saida_finalizar(&ctx.lote.saida);
+        return -1;
+    }
+    campainha_iniciar(&ctx.leitura);
+    campainha_iniciar(&ctx.saida);
+    config->cliente->compartilhado = 1;
+    
+    double inicio = agora_segundos();
+    
+    int saida_iniciada = pthread_create(&thread_saida, NULL, executar_saida, &ctx) == 0;
+    if (!saida_iniciada) {
+        fprintf(stderr, "[ERRO] Falha ao criar a thread de saída\n");
+        ret = -1;
+    }
+    for (int i = 0; i < ctx.total_threads && ret == 0; i++) {
+        if (pthread_create(&ctx.threads[i].thread, NULL, executar_thread_es, &ctx.threads[i]) != 0) {
+            fprintf(stderr, "[ERRO] Falha ao criar a thread de E/S %d\n", i);
+            ret = -1;
+            break;
+        }
+        ctx.threads[i].iniciada = 1;
+    }
+    
+    /* Leitura: a thread de E/S que não tem espaço segura a entrada */
+    while (ret == 0 && ler_proximo_cep(config->entrada, item.cep, sizeof(item.cep), &linha)) {
+        ThreadES *es = &ctx.threads[escolher_thread_es(item.cep, ctx.total_threads)];
+    
+        item.linha = linha;
+        estatisticas->total++;
+        while (canal_enviar(&es->entrada, &item) != 0) {
+            acordar_thread_es(es);
+            campainha_preparar(&ctx.leitura);
+            if (canal_enviar(&es->entrada, &item) == 0) {
+                campainha_cancelar(&ctx.leitura);
+                break;
+            }
+            campainha_esperar(&ctx.leitura, LOTE_ESPERA_MS);
+        }
+        acordar_thread_es(es);
+    }
+    
+    atomic_store(&ctx.fim_entrada, 1);
+    for (int i = 0; i < ctx.total_threads; i++) {
+        if (ctx.threads[i].iniciada) {
+            curl_multi_wakeup(ctx.threads[i].motor.multi);
+            pthread_join(ctx.threads[i].thread, NULL);
+        } else {
+            atomic_fetch_add(&ctx.terminadas, 1);
+        }
+    }
+    if (saida_iniciada) {
+        campainha_tocar(&ctx.saida);
+        pthread_join(thread_saida, NULL);
+    }
+    
+    config->cliente->compartilhado = 0;
+    estatisticas->segundos = agora_segundos() - inicio;
+    
+    for (int i = 0; i < ctx.total_threads; i++) {
+        ThreadES *es = &ctx.threads[i];
+        estatisticas->requisicoes_populacao += es->motor.requisicoes_populacao;
+        motor_juntar_contadores(&estatisticas->contadores, &es->motor.contadores);
+        motor_juntar_tempos(&estatisticas->tempos, &es->motor.tempos);
+        for (int u = 0; u < TOTAL_UPSTREAMS; u++) {
+            metricas_juntar(&config->cliente->metricas[u], &es->metricas[u]);
+        }
+    }
+    estatisticas->memoria_resultados = resultados_memoria(&resultados);
+    
+    if (ctx.lote.resultados && escrever_ordenados(&resultados, &ctx.lote.saida, linha) != 0) {
+        ret = -1;
+    }
+    if (saida_finalizar(&ctx.lote.saida) != 0) {
+        ret = -1;
+    }
+    estatisticas->bytes_saida = ctx.lote.saida.bytes;
+    estatisticas->escritas_saida = ctx.lote.saida.escritas;
+    
+    resultados_finalizar(&resultados);
+    campainha_finalizar(&ctx.leitura);
+    campainha_finalizar(&ctx.saida);
+    finalizar_threads_es(&ctx);
+    
+    return ret;
+}
+
+/* ========================================================================
+   FUNÇÃO: executar_lote
+   ========================================================================
+   Lê CEPs da entrada e submete cada um ao motor de consultas, que conduz
+   as requisições de todos em um único laço curl_multi. Até 'concorrencia'
+   CEPs ficam em andamento ao mesmo tempo, de modo que a espera de rede de
+   um se sobrepõe à dos outros.
+   
+   As linhas de saída saem na ordem de conclusão, marcadas com o número
+   da linha de entrada; com 'ordenar', os resultados são guardados em
+   formato compacto e escritos ao final na ordem da entrada. As consultas
+   de população de CEPs em andamento são agrupadas em requisições com
+   vários municípios. Com config->threads > 1, o trabalho se divide entre
+   várias threads (ver executar_lote_paralelo).
+   ======================================================================== */
+int executar_lote(const ConfigLote *config, EstatisticasLote *estatisticas) {
+    ContextoLote ctx;
+    Resultados resultados;
+    Motor motor;
+    SlotLote *slots;
+    int concorrencia = config->concorrencia > 0 ? config->concorrencia : LOTE_CONCORRENCIA_PADRAO;
+    int fim_entrada = 0;
+    long linha = 0;
+    
+    memset(estatisticas, 0, sizeof(*estatisticas));
+    if (config->threads > 1) {
+        return executar_lote_paralelo(config, estatisticas, concorrencia);
+    }
+    ctx.config = config;
+    ctx.estatisticas = estatisticas;
+    ctx.ocupadas = 0;
+    ctx.resultados = NULL;
+    resultados_iniciar(&resultados);
+    if (config->ordenar) {
+        ctx.resultados = &resultados;
+    }
+    
+    /* O que já estiver no buffer do FILE sai antes dos registros */
+    fflush(config->saida);
+    if (saida_iniciar(&ctx.saida, fileno(config->saida), config->formato) != 0) {
+        return -1;
+    }
+    if (motor_iniciar(&motor, config->cliente) != 0) {
+        saida_finalizar(&ctx.saida);
+        return -1;
+    }
+    motor.populacao_por_lote = config->populacao_por_lote;
+    motor.janela_populacao_ms = MOTOR_JANELA_POPULACAO_MS;
+    
+    slots = calloc(concorrencia, sizeof(SlotLote));
+    if (!slots) {
+        fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+        motor_finalizar(&motor);
+        saida_finalizar(&ctx.saida);
+        return -1;
+    }
+    
+    for (int i = 0; i < concorrencia; i++) {
+        slots[i].ctx = &ctx;
+    }
+    
+    double inicio = agora_segundos();
+    
+    for (;;) {
+        /* Preenche os slots livres com os próximos CEPs da entrada */
+        for (int i = 0; i < concorrencia && !fim_entrada; i++) {
+            SlotLote *slot = &slots[i];
+            if (slot->ocupado) {
+                continue;
+            }
+            if (!ler_proximo_cep(config->entrada, slot->consulta.cep, sizeof(slot->consulta.cep), &linha)) {
+                fim_entrada = 1;
+                break;
+            }
+            slot->consulta.linha = linha;
+            slot->consulta.prioridade = PRIORIDADE_LOTE;
+            slot->ocupado = 1;
+            ctx.ocupadas++;
+            estatisticas->total++;
+            motor_submeter(&motor, &slot->consulta, consulta_concluida, slot);
+        }
+    
+        if (ctx.ocupadas == 0 && fim_entrada) {
+            break;
+        }
+    
+        /* Só espera por atividade se não houver slot livre para preencher */
+        motor_executar(&motor, (ctx.ocupadas < concorrencia && !fim_entrada) ? 0 : 1000);
+    }
+    
+    estatisticas->segundos = agora_segundos() - inicio;
+    estatisticas->requisicoes_populacao = motor.requisicoes_populacao;
+    estatisticas->contadores = motor.contadores;
+    estatisticas->tempos = motor.tempos;
+    estatisticas->memoria_resultados = resultados_memoria(&resultados);
+    
+    int ret = 0;
+    if (ctx.resultados && escrever_ordenados(&resultados, &ctx.saida, linha) != 0) {
+        ret = -1;
+    }
+    if (saida_finalizar(&ctx.saida) != 0) {
+        ret = -1;
+    }
+    estatisticas->bytes_saida = ctx.saida.bytes;
+    estatisticas->escritas_saida = ctx.saida.escritas;
+    
+    resultados_finalizar(&resultados);
+    free(slots);
+    motor_finalizar(&motor);
+    
+    return ret;
+}
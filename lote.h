@@ -0,0 +1,40 @@
+#ifndef LOTE_H
+#define LOTE_H
+
+#include <stdio.h>
+#include "cliente_http.h"
+#include "motor.h"
+#include "saida.h"
+
+/* Configuração do modo lote */
+typedef struct {
+    ClienteHTTP *cliente;   /* share de DNS/TLS/conexões usado pelos handles do lote */
+    FILE *entrada;      /* um CEP por linha */
+    FILE *saida;        /* um registro por CEP, marcado com a linha de entrada */
+    FormatoSaida formato;
+    int concorrencia;   /* máximo de consultas em andamento ao mesmo tempo */
+    int populacao_por_lote; /* códigos IBGE por requisição de população (0 = um por CEP) */
+    int ordenar;        /* guarda os resultados e os escreve na ordem da entrada */
+    int threads;        /* threads de E/S, cada uma com seu motor (<= 1 = uma só) */
+} ConfigLote;
+
+/* Estatísticas de uma execução em lote */
+typedef struct {
+    long total;
+    long sucesso;
+    long falhas;
+    double segundos;
+    long requisicoes_populacao;
+    size_t memoria_resultados;  /* resultados guardados com 'ordenar' (ver resultados.c) */
+    long long bytes_saida;
+    long escritas_saida;        /* chamadas a write() na saída */
+    ContadoresMotor contadores;
+    TemposMotor tempos;
+} EstatisticasLote;
+
+#define LOTE_CONCORRENCIA_PADRAO 16
+#define LOTE_MAX_THREADS 64
+
+int executar_lote(const ConfigLote *config, EstatisticasLote *estatisticas);
+
+#endif
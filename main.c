@@ -1,53 +1,744 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
 #include "integrador__apis.h"
+#include "motor.h"
+#include "cache_cep.h"
+#include "cache_feriados.h"
+#include "cache_negativo.h"
+#include "indice_ibge.h"
+#include "lote.h"
+#include "resultados.h"
+#include "saida.h"
+#include "servico.h"
+#include "snapshot.h"
 
-int main(int argc, char *argv[]) {
-    DadosEndereco endereco = {0};
-    DadosIBGE dados_ibge = {0};
-    DadosFeriados feriados = {0};
-    const char *cep;
+/* Opções sem forma curta */
+enum {
+    OPCAO_URL_VIACEP = 256,
+    OPCAO_URL_IBGE,
+    OPCAO_URL_BRASILAPI,
+    OPCAO_SNAPSHOT,
+    OPCAO_SNAPSHOT_INTERVALO,
+    OPCAO_TTL_IBGE,
+    OPCAO_TTL_FERIADOS,
+    OPCAO_JANELA_REVALIDACAO,
+    OPCAO_HTTP,
+    OPCAO_CACERT
+};
+
+static void exibir_uso(const char *programa) {
+    fprintf(stderr, "\nUso: %s <CEP>\n", programa);
+    fprintf(stderr, "     %s [--sequencial] <CEP>\n", programa);
+    fprintf(stderr, "     %s --lote <arquivo|-> [--concorrencia N]\n", programa);
+    fprintf(stderr, "     %s --servico PORTA\n", programa);
+    fprintf(stderr, "Exemplo: %s 01310100\n\n", programa);
+    fprintf(stderr, "Opções:\n");
+    fprintf(stderr, "  -l, --lote ARQUIVO       Lê um CEP por linha do arquivo ('-' para stdin)\n");
+    fprintf(stderr, "  -c, --concorrencia N     Máximo de CEPs em andamento no modo lote (padrão: %d)\n",
+            LOTE_CONCORRENCIA_PADRAO);
+    fprintf(stderr, "  -j, --threads N          Threads de E/S no modo lote, cada uma com seu curl_multi;\n"
+                    "                           a concorrência se divide entre elas (padrão: 1)\n");
+    fprintf(stderr, "  -b, --populacao-por-lote N Municípios por requisição de população no modo lote\n"
+                    "                           (padrão: %d; 0 = uma requisição por CEP)\n",
+            MOTOR_POPULACAO_POR_LOTE);
+    fprintf(stderr, "  -f, --formato FORMATO    Registro por CEP: tsv (padrão do lote), ndjson, csv ou binario;\n"
+                    "                           no CEP único, substitui o relatório\n");
+    fprintf(stderr, "  -q, --silencioso         Omite os avisos [API n] e URL de cada etapa\n");
+    fprintf(stderr, "  -O, --ordenar            No modo lote, escreve os resultados na ordem da entrada\n"
+                    "                           (guardados em memória em formato compacto)\n");
+    fprintf(stderr, "  -s, --sequencial         Faz as requisições uma após a outra, sem paralelismo\n");
+    fprintf(stderr, "  -C, --cache-cep ARQUIVO  Cache persistente de endereços (arquivo mapeado)\n");
+    fprintf(stderr, "  -F, --cache-feriados DIR Persiste as tabelas anuais de feriados em DIR\n");
+    fprintf(stderr, "  -N, --ttl-negativo S     Lembra por S segundos os CEPs inexistentes (padrão: %d;\n"
+                    "                           0 = sempre consulta o ViaCEP)\n", CACHE_NEGATIVO_TTL_PADRAO);
+    fprintf(stderr, "      --ttl-ibge S         Validade do índice do IBGE (padrão: %d; 0 = não vence)\n",
+            INDICE_IBGE_TTL_PADRAO);
+    fprintf(stderr, "      --ttl-feriados S     Validade de cada tabela de feriados (padrão: %d; 0 = não vence)\n",
+            CACHE_FERIADOS_TTL_PADRAO);
+    fprintf(stderr, "      --janela-revalidacao S Depois do TTL, por quantos segundos o dado velho ainda é\n"
+                    "                           servido enquanto é renovado em segundo plano (padrão: %d)\n",
+            JANELA_REVALIDACAO_PADRAO);
+    fprintf(stderr, "  -P, --preload-ibge       Carrega todos os municípios do IBGE antes de começar\n");
+    fprintf(stderr, "  -I, --ibge-snapshot ARQ  Lê o índice do IBGE de ARQ (ou o cria, se não existir)\n");
+    fprintf(stderr, "      --snapshot ARQ       Carrega os caches em memória (IBGE, feriados, CEPs inexistentes)\n"
+                    "                           de ARQ ao iniciar e os grava nele ao terminar\n");
+    fprintf(stderr, "      --snapshot-intervalo S No modo serviço, grava o snapshot a cada S segundos e a cada\n"
+                    "                           SIGUSR1 (padrão: %d; 0 = só ao terminar e com SIGUSR1)\n",
+            SNAPSHOT_INTERVALO_PADRAO);
+    fprintf(stderr, "  -S, --servico PORTA      Atende GET /cep/{cep} em JSON até receber SIGINT/SIGTERM\n");
+    fprintf(stderr, "  -M, --metricas ARQUIVO   Grava ao final a latência por fase de cada API em JSON\n"
+                    "                           (Prometheus se terminar em .prom; '-' = saída de erro)\n");
+    fprintf(stderr, "  -T, --prazo MS           Orçamento de tempo de cada consulta, dividido entre as etapas\n"
+                    "                           (padrão: %d; 0 = sem prazo)\n", HTTP_PRAZO_PADRAO_MS);
+    fprintf(stderr, "  -D, --duplicar           Duplica a requisição que passa do p95 observado para o host\n"
+                    "                           e usa a primeira resposta\n");
+    fprintf(stderr, "  -L, --limite HOST=TAXA[:N] Limita o host (viacep, ibge, brasilapi) a TAXA req/s e N\n"
+                    "                           requisições simultâneas; repetível (padrão: sem limite,\n"
+                    "                           reduzido automaticamente a cada 429)\n");
+    fprintf(stderr, "      --http VERSAO        2 (padrão: HTTP/2 negociado nos hosts https, várias requisições\n"
+                    "                           por conexão; HTTP/1.1 se o host não o oferecer) ou 1.1\n");
+    fprintf(stderr, "      --cacert ARQ         Autoridades certificadoras (PEM) no lugar das do sistema\n");
+    fprintf(stderr, "      --url-viacep URL     Endereço base do ViaCEP (ex.: http://127.0.0.1:18081)\n");
+    fprintf(stderr, "      --url-ibge URL       Endereço base do IBGE\n");
+    fprintf(stderr, "      --url-brasilapi URL  Endereço base da Brasil API\n\n");
+    fprintf(stderr, "Exemplos de CEPs para testar:\n");
+    fprintf(stderr, "  01310100 - São Paulo/SP (Av. Paulista)\n");
+    fprintf(stderr, "  20040020 - Rio de Janeiro/RJ (Centro)\n");
+    fprintf(stderr, "  30130100 - Belo Horizonte/MG (Centro)\n");
+    fprintf(stderr, "  40020000 - Salvador/BA (Centro)\n");
+    fprintf(stderr, "  88015100 - Florianópolis/SC (Centro)\n\n");
+}
+
+/* ========================================================================
+   FUNÇÃO: executar_modo_lote
+   ========================================================================
+   Processa um arquivo de CEPs e reporta a vazão ao final (em stderr,
+   para não misturar com a saída TSV).
+   ======================================================================== */
+static int executar_modo_lote(ClienteHTTP *cliente, const char *arquivo, int concorrencia,
+                             int threads, int populacao_por_lote, int ordenar, FormatoSaida formato) {
+    ConfigLote config = {0};
+    EstatisticasLote estatisticas;
+    FILE *entrada = stdin;
+    
+    if (strcmp(arquivo, "-") != 0) {
+        entrada = fopen(arquivo, "r");
+        if (!entrada) {
+            perror("[ERRO] Não foi possível abrir o arquivo de CEPs");
+            return 1;
+        }
+    }
+    
+    config.cliente = cliente;
+    config.entrada = entrada;
+    config.saida = stdout;
+    config.concorrencia = concorrencia;
+    config.threads = threads;
+    config.populacao_por_lote = populacao_por_lote;
+    config.ordenar = ordenar;
+    config.formato = formato;
+    
+    int ret = executar_lote(&config, &estatisticas);
+    
+    if (entrada != stdin) {
+        fclose(entrada);
+    }
+    
+    if (ret != 0) {
+        return 1;
+    }
+    
+    fprintf(stderr, "\n[LOTE] %ld CEPs (%ld com sucesso, %ld com falha) em %.2f s\n",
+            estatisticas.total, estatisticas.sucesso, estatisticas.falhas, estatisticas.segundos);
+    fprintf(stderr, "[LOTE] Vazão: %.1f CEPs/s\n",
+            estatisticas.segundos > 0 ? estatisticas.total / estatisticas.segundos : 0.0);
+    if (threads > 1) {
+        fprintf(stderr, "[LOTE] Threads: %d de E/S, 1 de saída\n", threads);
+    }
+    if (estatisticas.total > 0) {
+        fprintf(stderr, "[LOTE] Alocações por CEP: %.3f em buffers de resposta, %.1f no jansson\n",
+                (double)contador_alocacoes.respostas / estatisticas.total,
+                (double)contador_alocacoes.json / estatisticas.total);
+    }
+    if (ordenar && estatisticas.total > 0) {
+        double por_cep = (double)estatisticas.memoria_resultados / estatisticas.total;
+        fprintf(stderr, "[LOTE] Resultados em memória: %.1f MB, %.0f bytes por CEP "
+                "(%.0f MB por milhão de CEPs; %.0f MB nas structs da consulta)\n",
+                estatisticas.memoria_resultados / 1e6, por_cep, por_cep,
+                resultados_memoria_structs(1000000) / 1e6);
+    }
+    fprintf(stderr, "[LOTE] Saída: %lld bytes em %ld chamadas a write\n",
+            estatisticas.bytes_saida, estatisticas.escritas_saida);
+    fprintf(stderr, "[LOTE] Latência por etapa:\n");
+    motor_imprimir_tempos(stderr, "[LOTE]   ", &estatisticas.tempos);
+    fprintf(stderr, "[LOTE] Requisições de população ao IBGE: %ld\n",
+            estatisticas.requisicoes_populacao);
+    motor_imprimir_contadores(stderr, "[LOTE] ", &estatisticas.contadores);
+    cliente_http_imprimir_limites(cliente, stderr, "[LOTE] Limite ");
+    fprintf(stderr, "[LOTE] Conexões (--http %s):\n", cliente_http_nome_versao(cliente));
+    cliente_http_imprimir_conexoes(cliente, stderr, "[LOTE]   ");
+    fprintf(stderr, "[LOTE] Tabelas de feriados baixadas: %ld\n", cliente->cache_feriados->downloads);
+    if (cliente->indice_ibge) {
+        fprintf(stderr, "[LOTE] Índice do IBGE: %ld acertos, %ld faltas\n",
+                cliente->indice_ibge->acertos, cliente->indice_ibge->faltas);
+    }
+    if (cliente->cache_cep) {
+        fprintf(stderr, "[LOTE] Cache de CEPs: %ld acertos, %ld faltas\n",
+                cliente->cache_cep->acertos, cliente->cache_cep->faltas);
+    }
+    
+    return estatisticas.falhas > 0 && estatisticas.sucesso == 0 ? 1 : 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: executar_modo_servico
+   ========================================================================
+   Atende consultas por HTTP até ser interrompido e reporta o que foi
+   atendido ao final.
+   ======================================================================== */
+static int executar_modo_servico(ClienteHTTP *cliente, int porta, const char *snapshot,
+                                 int intervalo_snapshot) {
+    ConfigServico config = {0};
+    EstatisticasServico estatisticas;
+    
+    config.cliente = cliente;
+    config.porta = porta;
+    config.max_conexoes = SERVICO_MAX_CONEXOES_PADRAO;
+    config.snapshot = snapshot;
+    config.intervalo_snapshot = intervalo_snapshot;
+    
+    if (executar_servico(&config, &estatisticas) != 0) {
+        return 1;
+    }
+    
+    fprintf(stderr, "[SERVIÇO] %ld conexões, %ld requisições\n",
+            estatisticas.conexoes, estatisticas.requisicoes);
+    fprintf(stderr, "[SERVIÇO] Consultas: %ld com sucesso, %ld não encontradas, %ld com falha\n",
+            estatisticas.sucesso, estatisticas.nao_encontrados, estatisticas.falhas);
+    fprintf(stderr, "[SERVIÇO] Latência por etapa:\n");
+    motor_imprimir_tempos(stderr, "[SERVIÇO]   ", &estatisticas.tempos);
+    motor_imprimir_contadores(stderr, "[SERVIÇO] ", &estatisticas.contadores);
+    cliente_http_imprimir_limites(cliente, stderr, "[SERVIÇO] Limite ");
+    fprintf(stderr, "[SERVIÇO] Conexões (--http %s):\n", cliente_http_nome_versao(cliente));
+    cliente_http_imprimir_conexoes(cliente, stderr, "[SERVIÇO]   ");
+    fprintf(stderr, "[SERVIÇO] Tabelas de feriados baixadas: %ld\n", cliente->cache_feriados->downloads);
+    if (cliente->cache_cep) {
+        fprintf(stderr, "[SERVIÇO] Cache de CEPs: %ld acertos, %ld faltas\n",
+                cliente->cache_cep->acertos, cliente->cache_cep->faltas);
+    }
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: gravar_metricas
+   ========================================================================
+   Grava as métricas de fases por API acumuladas na execução.
+   ======================================================================== */
+static void gravar_metricas(const ClienteHTTP *cliente, const char *arquivo) {
+    size_t tamanho = strlen(arquivo);
+    FormatoMetricas formato = tamanho > 5 && strcmp(arquivo + tamanho - 5, ".prom") == 0 ?
+                              METRICAS_PROMETHEUS : METRICAS_JSON;
+    FILE *saida = stderr;
+    
+    if (strcmp(arquivo, "-") != 0) {
+        saida = fopen(arquivo, "w");
+        if (!saida) {
+            perror("[ERRO] Não foi possível gravar as métricas");
+            return;
+        }
+    }
+    
+    cliente_http_exportar_metricas(cliente, saida, formato);
+    
+    if (saida != stderr) {
+        fclose(saida);
+        fprintf(stderr, "[METRICAS] Gravadas em %s\n", arquivo);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: preparar_indice_ibge
+   ========================================================================
+   Carrega o índice de municípios do snapshot, se houver e não estiver
+   vencido, ou o constrói pela rede (gravando o snapshot para as próximas
+   execuções).
+   ======================================================================== */
+static int preparar_indice_ibge(ClienteHTTP *cliente, IndiceIBGE *indice, const char *snapshot) {
+    struct timespec inicio, fim;
+    const char *origem = "snapshot";
     
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    
+    int carregado = snapshot && indice_ibge_carregar(indice, snapshot) == 0;
+    if (carregado && indice_ibge_estado(indice, time(NULL)) == DADO_VENCIDO) {
+        fprintf(stderr, "[IBGE] Snapshot %s vencido, reconstruindo o índice\n", snapshot);
+        carregado = 0;
+    }
+    
+    if (!carregado) {
+        indice_ibge_finalizar(indice);
+        origem = "rede";
+        if (indice_ibge_preparar(indice, cliente) != 0) {
+            fprintf(stderr, "[ERRO] Não foi possível carregar o índice do IBGE\n");
+            return -1;
+        }
+        if (snapshot && indice_ibge_salvar(indice, snapshot) == 0) {
+            fprintf(stderr, "[IBGE] Snapshot gravado em %s\n", snapshot);
+        }
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+    fprintf(stderr, "[IBGE] %d municípios indexados (%s) em %.0f ms, %.1f KB em memória\n",
+            indice->quantidade, origem,
+            (fim.tv_sec - inicio.tv_sec) * 1e3 + (fim.tv_nsec - inicio.tv_nsec) / 1e6,
+            indice_ibge_memoria(indice) / 1024.0);
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: exibir_cabecalho
+   ======================================================================== */
+static void exibir_cabecalho(void) {
     printf("═══════════════════════════════════════════════════════════════\n");
     printf("  SISTEMA DE INTEGRAÇÃO DE 3 APIs REST PÚBLICAS              \n");
     printf("  ViaCEP + IBGE + Brasil API                                  \n");
     printf("═══════════════════════════════════════════════════════════════\n");
+}
+
+/* ========================================================================
+   FUNÇÃO: escrever_registro
+   ========================================================================
+   Escreve o resultado de um CEP único como um registro no formato
+   pedido, no lugar do relatório.
+   ======================================================================== */
+static int escrever_registro(const Consulta *consulta, FormatoSaida formato) {
+    Saida saida;
     
-    /* Valida argumentos */
-    if (argc < 2) {
-        fprintf(stderr, "\nUso: %s <CEP>\n", argv[0]);
-        fprintf(stderr, "Exemplo: %s 01310100\n\n", argv[0]);
-        fprintf(stderr, "Exemplos de CEPs para testar:\n");
-        fprintf(stderr, "  01310100 - São Paulo/SP (Av. Paulista)\n");
-        fprintf(stderr, "  20040020 - Rio de Janeiro/RJ (Centro)\n");
-        fprintf(stderr, "  30130100 - Belo Horizonte/MG (Centro)\n");
-        fprintf(stderr, "  40020000 - Salvador/BA (Centro)\n");
-        fprintf(stderr, "  88015100 - Florianópolis/SC (Centro)\n\n");
-        return 1;
+    fflush(stdout);
+    if (saida_iniciar(&saida, STDOUT_FILENO, formato) != 0) {
+        return -1;
     }
+    saida_consulta(&saida, consulta);
+    return saida_finalizar(&saida);
+}
+
+/* ========================================================================
+   FUNÇÃO: executar_modo_sequencial
+   ========================================================================
+   Consulta as três APIs para um único CEP, uma requisição após a outra.
+   'formato' é NULL para o relatório.
+   ======================================================================== */
+static int executar_modo_sequencial(ClienteHTTP *cliente, const char *cep, const FormatoSaida *formato) {
+    DadosEndereco endereco = {0};
+    DadosIBGE dados_ibge = {0};
+    DadosFeriados feriados = {0};
     
-    cep = argv[1];
+    cliente_http_iniciar_prazo(cliente);
     
     /* ETAPA 1: Buscar endereço via ViaCEP (inclui código IBGE) */
-    if (buscar_endereco(cep, &endereco) != 0) {
+    if (buscar_endereco(cliente, cep, &endereco) != 0) {
         fprintf(stderr, "\n[ERRO] Não foi possível obter dados do endereço\n");
         return 1;
     }
     
     /* ETAPA 2: Buscar dados demográficos via IBGE usando código IBGE obtido */
-    if (buscar_dados_municipio(endereco.codigo_ibge, &dados_ibge) != 0) {
+    if (buscar_dados_municipio(cliente, endereco.codigo_ibge, &dados_ibge) != 0) {
         fprintf(stderr, "\n[ERRO] Não foi possível obter dados do IBGE\n");
         return 1;
     }
     
     /* ETAPA 3: Buscar feriados nacionais via Brasil API usando UF obtido */
-    if (buscar_feriados(endereco.uf, &feriados) != 0) {
+    if (buscar_feriados(cliente, endereco.uf, &feriados) != 0) {
         fprintf(stderr, "\n[ERRO] Não foi possível obter dados de feriados\n");
         return 1;
     }
     
     /* ETAPA 4: Combinar e exibir dados integrados das 3 APIs */
+    if (formato) {
+        Consulta consulta = {0};
+        consulta.linha = 1;
+        snprintf(consulta.cep, sizeof(consulta.cep), "%s", cep);
+        consulta.endereco = endereco;
+        consulta.ibge = dados_ibge;
+        consulta.feriados = feriados;
+        return escrever_registro(&consulta, *formato) == 0 ? 0 : 1;
+    }
     exibir_relatorio_completo(&endereco, &dados_ibge, &feriados);
     
     return 0;
 }
+
+/* ========================================================================
+   FUNÇÃO: executar_modo_paralelo
+   ========================================================================
+   Consulta as três APIs para um único CEP pelo motor de consultas: após
+   o ViaCEP, município, população e feriados são buscados em paralelo e
+   juntados antes do relatório. Com 'formato', escreve um registro
+   (inclusive de erro) no lugar do relatório e dos avisos.
+   ======================================================================== */
+static int executar_modo_paralelo(ClienteHTTP *cliente, const char *cep, const FormatoSaida *formato,
+                                  int verboso) {
+    Motor motor;
+    Consulta consulta = {0};
+    
+    if (motor_iniciar(&motor, cliente) != 0) {
+        return 1;
+    }
+    motor.verboso = verboso && !formato;
+    
+    consulta.linha = 1;
+    snprintf(consulta.cep, sizeof(consulta.cep), "%s", cep);
+    motor_submeter(&motor, &consulta, NULL, NULL);
+    
+    while (motor_executar(&motor, 1000) > 0);
+    
+    motor_finalizar(&motor);
+    
+    if (formato) {
+        int ret = escrever_registro(&consulta, *formato);
+        return ret == 0 && !consulta.erro ? 0 : 1;
+    }
+    
+    if (consulta.erro) {
+        switch (consulta.etapa_erro) {
+            case ETAPA_VIACEP:
+                fprintf(stderr, "\n[ERRO] Não foi possível obter dados do endereço\n");
+                break;
+            case ETAPA_FERIADOS:
+                fprintf(stderr, "\n[ERRO] Não foi possível obter dados de feriados\n");
+                break;
+            default:
+                fprintf(stderr, "\n[ERRO] Não foi possível obter dados do IBGE\n");
+                break;
+        }
+        return 1;
+    }
+    
+    exibir_relatorio_completo(&consulta.endereco, &consulta.ibge, &consulta.feriados);
+    
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    ClienteHTTP cliente;
+    int ret;
+    const char *arquivo_lote = NULL;
+    int concorrencia = LOTE_CONCORRENCIA_PADRAO;
+    int threads = 1;
+    int populacao_por_lote = MOTOR_POPULACAO_POR_LOTE;
+    int sequencial = 0;
+    int ordenar = 0;
+    FormatoSaida formato = SAIDA_TSV;
+    int formato_definido = 0;   /* senão, relatório no CEP único */
+    int silencioso = 0;
+    const char *arquivo_cache_cep = NULL;
+    CacheCEP cache_cep;
+    const char *diretorio_feriados = NULL;
+    CacheFeriados cache_feriados;
+    int ttl_negativo = CACHE_NEGATIVO_TTL_PADRAO;
+    CacheNegativo cache_negativo;
+    int preload_ibge = 0;
+    const char *snapshot_ibge = NULL;
+    IndiceIBGE indice_ibge;
+    const char *arquivo_snapshot = NULL;
+    int intervalo_snapshot = SNAPSHOT_INTERVALO_PADRAO;
+    ResumoSnapshot resumo_snapshot;
+    int ttl_ibge = INDICE_IBGE_TTL_PADRAO;
+    int ttl_feriados = CACHE_FERIADOS_TTL_PADRAO;
+    int janela_revalidacao = JANELA_REVALIDACAO_PADRAO;
+    int porta_servico = 0;
+    const char *arquivo_metricas = NULL;
+    int prazo_ms = HTTP_PRAZO_PADRAO_MS;
+    int duplicar = 0;
+    const char *limites[TOTAL_UPSTREAMS];
+    int total_limites = 0;
+    const char *versao_http = NULL;
+    const char *certificados = NULL;
+    int opt;
+    
+    static const struct option opcoes[] = {
+        {"lote",         required_argument, NULL, 'l'},
+        {"concorrencia", required_argument, NULL, 'c'},
+        {"threads",      required_argument, NULL, 'j'},
+        {"populacao-por-lote", required_argument, NULL, 'b'},
+        {"sequencial",   no_argument,       NULL, 's'},
+        {"ordenar",      no_argument,       NULL, 'O'},
+        {"formato",      required_argument, NULL, 'f'},
+        {"silencioso",   no_argument,       NULL, 'q'},
+        {"cache-cep",    required_argument, NULL, 'C'},
+        {"cache-feriados", required_argument, NULL, 'F'},
+        {"ttl-negativo", required_argument, NULL, 'N'},
+        {"preload-ibge", no_argument,       NULL, 'P'},
+        {"ibge-snapshot", required_argument, NULL, 'I'},
+        {"servico",      required_argument, NULL, 'S'},
+        {"metricas",     required_argument, NULL, 'M'},
+        {"prazo",        required_argument, NULL, 'T'},
+        {"duplicar",     no_argument,       NULL, 'D'},
+        {"limite",       required_argument, NULL, 'L'},
+        {"url-viacep",   required_argument, NULL, OPCAO_URL_VIACEP},
+        {"url-ibge",     required_argument, NULL, OPCAO_URL_IBGE},
+        {"url-brasilapi", required_argument, NULL, OPCAO_URL_BRASILAPI},
+        {"snapshot",     required_argument, NULL, OPCAO_SNAPSHOT},
+        {"snapshot-intervalo", required_argument, NULL, OPCAO_SNAPSHOT_INTERVALO},
+        {"ttl-ibge",     required_argument, NULL, OPCAO_TTL_IBGE},
+        {"ttl-feriados", required_argument, NULL, OPCAO_TTL_FERIADOS},
+        {"janela-revalidacao", required_argument, NULL, OPCAO_JANELA_REVALIDACAO},
+        {"http",         required_argument, NULL, OPCAO_HTTP},
+        {"cacert",       required_argument, NULL, OPCAO_CACERT},
+        {"help",         no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    while ((opt = getopt_long(argc, argv, "l:c:j:b:sOf:qC:F:N:PI:S:M:T:DL:h", opcoes, NULL)) != -1) {
+        switch (opt) {
+            case 'l':
+                arquivo_lote = optarg;
+                break;
+            case 'c':
+                concorrencia = atoi(optarg);
+                if (concorrencia <= 0) {
+                    fprintf(stderr, "[ERRO] Concorrência inválida: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                if (threads <= 0 || threads > LOTE_MAX_THREADS) {
+                    fprintf(stderr, "[ERRO] Número de threads inválido: %s (máximo %d)\n",
+                            optarg, LOTE_MAX_THREADS);
+                    return 1;
+                }
+                break;
+            case 'b':
+                populacao_por_lote = atoi(optarg);
+                if (populacao_por_lote < 0 || populacao_por_lote > MOTOR_POPULACAO_POR_LOTE) {
+                    fprintf(stderr, "[ERRO] Municípios por requisição inválido: %s (máximo %d)\n",
+                            optarg, MOTOR_POPULACAO_POR_LOTE);
+                    return 1;
+                }
+                break;
+            case 's':
+                sequencial = 1;
+                break;
+            case 'O':
+                ordenar = 1;
+                break;
+            case 'f':
+                if (saida_formato(optarg, &formato) != 0) {
+                    fprintf(stderr, "[ERRO] Formato inválido: %s (tsv, ndjson, csv ou binario)\n", optarg);
+                    return 1;
+                }
+                formato_definido = 1;
+                break;
+            case 'q':
+                silencioso = 1;
+                break;
+            case 'C':
+                arquivo_cache_cep = optarg;
+                break;
+            case 'F':
+                diretorio_feriados = optarg;
+                break;
+            case 'N':
+                ttl_negativo = atoi(optarg);
+                if (ttl_negativo < 0) {
+                    fprintf(stderr, "[ERRO] TTL inválido: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'P':
+                preload_ibge = 1;
+                break;
+            case 'I':
+                preload_ibge = 1;
+                snapshot_ibge = optarg;
+                break;
+            case 'S':
+                porta_servico = atoi(optarg);
+                if (porta_servico <= 0 || porta_servico > 65535) {
+                    fprintf(stderr, "[ERRO] Porta inválida: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'M':
+                arquivo_metricas = optarg;
+                break;
+            case 'T':
+                prazo_ms = atoi(optarg);
+                if (prazo_ms < 0) {
+                    fprintf(stderr, "[ERRO] Prazo inválido: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'D':
+                duplicar = 1;
+                break;
+            case 'L':
+                if (total_limites == TOTAL_UPSTREAMS) {
+                    fprintf(stderr, "[ERRO] Limites demais (um por host)\n");
+                    return 1;
+                }
+                limites[total_limites++] = optarg;
+                break;
+            case OPCAO_URL_VIACEP:
+                configurar_url_base(UPSTREAM_VIACEP, optarg);
+                break;
+            case OPCAO_URL_IBGE:
+                configurar_url_base(UPSTREAM_IBGE, optarg);
+                break;
+            case OPCAO_URL_BRASILAPI:
+                configurar_url_base(UPSTREAM_BRASILAPI, optarg);
+                break;
+            case OPCAO_SNAPSHOT:
+                arquivo_snapshot = optarg;
+                break;
+            case OPCAO_SNAPSHOT_INTERVALO:
+                intervalo_snapshot = atoi(optarg);
+                if (intervalo_snapshot < 0) {
+                    fprintf(stderr, "[ERRO] Intervalo inválido: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPCAO_TTL_IBGE:
+                ttl_ibge = atoi(optarg);
+                if (ttl_ibge < 0) {
+                    fprintf(stderr, "[ERRO] TTL inválido: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPCAO_TTL_FERIADOS:
+                ttl_feriados = atoi(optarg);
+                if (ttl_feriados < 0) {
+                    fprintf(stderr, "[ERRO] TTL inválido: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPCAO_JANELA_REVALIDACAO:
+                janela_revalidacao = atoi(optarg);
+                if (janela_revalidacao < 0) {
+                    fprintf(stderr, "[ERRO] Janela inválida: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPCAO_HTTP:
+                versao_http = optarg;
+                break;
+            case OPCAO_CACERT:
+                certificados = optarg;
+                break;
+            default:
+                exibir_uso(argv[0]);
+                return 1;
+        }
+    }
+    
+    /* Um registro legível por máquina não se mistura com os avisos */
+    configurar_silencioso(silencioso || formato_definido);
+    
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    cliente_http_contar_alocacoes();
+    
+    if (cliente_http_iniciar(&cliente) != 0) {
+        curl_global_cleanup();
+        return 1;
+    }
+    cliente.prazo_ms = prazo_ms;
+    cliente.duplicar = duplicar;
+    for (int i = 0; i < total_limites; i++) {
+        if (cliente_http_configurar_limite(&cliente, limites[i]) != 0) {
+            fprintf(stderr, "[ERRO] Limite inválido: %s (use HOST=TAXA[:SIMULTANEAS])\n", limites[i]);
+            cliente_http_finalizar(&cliente);
+            curl_global_cleanup();
+            return 1;
+        }
+    }
+    if (versao_http && cliente_http_configurar_versao(&cliente, versao_http) != 0) {
+        fprintf(stderr, "[ERRO] Versão do HTTP inválida: %s (2 ou 1.1)\n", versao_http);
+        cliente_http_finalizar(&cliente);
+        curl_global_cleanup();
+        return 1;
+    }
+    if (certificados) {
+        cliente_http_configurar_certificados(&cliente, certificados);
+    }
+    
+    /* Tabelas de feriados: baixadas uma vez por ano e reaproveitadas */
+    cache_feriados_iniciar(&cache_feriados, diretorio_feriados);
+    cache_feriados.ttl = ttl_feriados;
+    cache_feriados.janela = janela_revalidacao;
+    cliente.cache_feriados = &cache_feriados;
+    
+    /* CEPs inexistentes: respondidos sem ir à rede enquanto valer o TTL */
+    cache_negativo_iniciar(&cache_negativo, ttl_negativo);
+    if (ttl_negativo > 0) {
+        cliente.cache_negativo = &cache_negativo;
+    }
+    
+    if (arquivo_cache_cep) {
+        if (cache_cep_abrir(&cache_cep, arquivo_cache_cep) != 0) {
+            cliente_http_finalizar(&cliente);
+            curl_global_cleanup();
+            return 1;
+        }
+        cliente.cache_cep = &cache_cep;
+    }
+    
+    /* Caches aquecidos por uma execução anterior: prontos sem ir à rede */
+    indice_ibge_iniciar(&indice_ibge);
+    indice_ibge.ttl = ttl_ibge;
+    indice_ibge.janela = janela_revalidacao;
+    if (arquivo_snapshot &&
+        snapshot_carregar(&cliente, &indice_ibge, arquivo_snapshot, &resumo_snapshot) == 0) {
+        snapshot_imprimir(stderr, "Carregado de", arquivo_snapshot, &resumo_snapshot);
+    }
+    
+    /* Um índice além da janela de revalidação não é servido (com
+       --preload-ibge, é refeito pela rede logo abaixo) */
+    if (cliente.indice_ibge && indice_ibge_estado(&indice_ibge, time(NULL)) == DADO_VENCIDO) {
+        fprintf(stderr, "[IBGE] Índice do snapshot vencido, descartado\n");
+        indice_ibge_finalizar(&indice_ibge);
+        cliente.indice_ibge = NULL;
+    }
+    
+    if (preload_ibge && !cliente.indice_ibge) {
+        if (preparar_indice_ibge(&cliente, &indice_ibge, snapshot_ibge) != 0) {
+            indice_ibge_finalizar(&indice_ibge);
+            if (cliente.cache_cep) {
+                cache_cep_fechar(cliente.cache_cep);
+            }
+            cache_feriados_finalizar(&cache_feriados);
+            cliente_http_finalizar(&cliente);
+            curl_global_cleanup();
+            return 1;
+        }
+        cliente.indice_ibge = &indice_ibge;
+    }
+    
+    if (porta_servico) {
+        ret = executar_modo_servico(&cliente, porta_servico, arquivo_snapshot, intervalo_snapshot);
+    } else if (arquivo_lote) {
+        ret = executar_modo_lote(&cliente, arquivo_lote, concorrencia, threads, populacao_por_lote,
+                                 ordenar, formato);
+    } else {
+        if (!formato_definido) {
+            exibir_cabecalho();
+        }
+    
+        /* Valida argumentos */
+        if (optind >= argc) {
+            exibir_uso(argv[0]);
+            ret = 1;
+        } else if (sequencial) {
+            ret = executar_modo_sequencial(&cliente, argv[optind], formato_definido ? &formato : NULL);
+        } else {
+            ret = executar_modo_paralelo(&cliente, argv[optind], formato_definido ? &formato : NULL,
+                                         !silencioso);
+        }
+    }
+    
+    if (arquivo_metricas) {
+        gravar_metricas(&cliente, arquivo_metricas);
+    }
+    
+    if (arquivo_snapshot &&
+        snapshot_salvar(&cliente, arquivo_snapshot, &resumo_snapshot) == 0) {
+        snapshot_imprimir(stderr, "Gravado em", arquivo_snapshot, &resumo_snapshot);
+    }
+    
+    if (cliente.cache_cep) {
+        cache_cep_fechar(cliente.cache_cep);
+    }
+    indice_ibge_finalizar(&indice_ibge);
+    cache_feriados_finalizar(&cache_feriados);
+    cache_negativo_finalizar(&cache_negativo);
+    cliente_http_finalizar(&cliente);
+    curl_global_cleanup();
+    
+    return ret;
+}
@@ -0,0 +1,231 @@
+#include <time.h>
+#include "metricas.h"
+
+static const char *NOMES_FASES[TOTAL_FASES] = {
+    "dns", "conexao", "tls", "espera", "transferencia", "total", "parse"
+};
+
+/* ========================================================================
+   FUNÇÕES: faixa_histograma / valor_faixa
+   ========================================================================
+   Converte um valor na sua faixa e uma faixa no valor que a representa
+   (o meio da faixa). Abaixo de 16 us cada valor tem a sua faixa; acima,
+   a faixa é dada pela potência de 2 e pelos 3 bits seguintes.
+   ======================================================================== */
+static int faixa_histograma(long valor) {
+    if (valor < 16) {
+        return valor < 0 ? 0 : (int)valor;
+    }
+    
+    int expoente = 63 - __builtin_clzl((unsigned long)valor);
+    int faixa = 16 + (expoente - 4) * 8 + (int)((valor >> (expoente - 3)) & 7);
+    
+    return faixa < HISTOGRAMA_FAIXAS ? faixa : HISTOGRAMA_FAIXAS - 1;
+}
+
+static long valor_faixa(int faixa) {
+    if (faixa < 16) {
+        return faixa;
+    }
+    
+    int expoente = (faixa - 16) / 8 + 4;
+    long inicio = (long)(8 + (faixa - 16) % 8) << (expoente - 3);
+    
+    return inicio + (1L << (expoente - 3)) / 2;
+}
+
+void histograma_registrar(Histograma *h, long microssegundos) {
+    h->contagem[faixa_histograma(microssegundos)]++;
+    h->total++;
+    h->soma_us += microssegundos;
+    if (microssegundos > h->maximo_us) {
+        h->maximo_us = microssegundos;
+    }
+}
+
+void histograma_juntar(Histograma *destino, const Histograma *origem) {
+    for (int i = 0; i < HISTOGRAMA_FAIXAS; i++) {
+        destino->contagem[i] += origem->contagem[i];
+    }
+    destino->total += origem->total;
+    destino->soma_us += origem->soma_us;
+    if (origem->maximo_us > destino->maximo_us) {
+        destino->maximo_us = origem->maximo_us;
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: histograma_percentil
+   ========================================================================
+   Retorna o valor (em us) abaixo do qual estão 'percentil'% das amostras.
+   ======================================================================== */
+long histograma_percentil(const Histograma *h, double percentil) {
+    long alvo = (long)(percentil / 100.0 * h->total + 0.999999);
+    long acumulado = 0;
+    
+    if (h->total == 0) {
+        return 0;
+    }
+    if (alvo < 1) {
+        alvo = 1;
+    }
+    
+    for (int i = 0; i < HISTOGRAMA_FAIXAS; i++) {
+        acumulado += h->contagem[i];
+        if (acumulado >= alvo) {
+            long valor = valor_faixa(i);
+            return valor < h->maximo_us ? valor : h->maximo_us;
+        }
+    }
+    
+    return h->maximo_us;
+}
+
+void histograma_imprimir(FILE *saida, const char *rotulo, const Histograma *h) {
+    fprintf(saida, "%-10s n=%-7ld p50=%8.2f  p95=%8.2f  p99=%8.2f  max=%8.2f ms\n",
+            rotulo, h->total,
+            histograma_percentil(h, 50) / 1e3,
+            histograma_percentil(h, 95) / 1e3,
+            histograma_percentil(h, 99) / 1e3,
+            h->maximo_us / 1e3);
+}
+
+long metricas_agora_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/* ========================================================================
+   FUNÇÃO: metricas_registrar_curl
+   ========================================================================
+   Lê os tempos de uma transferência concluída e registra a duração de
+   cada fase. O curl informa tempos acumulados desde o início; cada fase
+   é a diferença para a anterior. Com a conexão reaproveitada, DNS,
+   conexão e TLS ficam em zero. Só faz leituras do handle: nenhuma
+   chamada de sistema nem alocação. Retorna o tempo total (us).
+   ======================================================================== */
+long metricas_registrar_curl(MetricasUpstream *m, CURL *curl, CURLcode resultado) {
+    curl_off_t dns = 0, conexao = 0, tls = 0, primeiro_byte = 0, total = 0;
+    long conexoes = 0, versao = 0;
+    
+    m->requisicoes++;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &conexoes);
+    m->conexoes += conexoes;
+    if (resultado != CURLE_OK) {
+        m->falhas++;
+        return 0;
+    }
+    
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &conexao);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &primeiro_byte);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &versao);
+    if (versao == CURL_HTTP_VERSION_2_0) {
+        m->respostas_http2++;
+    }
+    
+    /* Sem TLS (http://), APPCONNECT fica em zero */
+    curl_off_t pronto = tls > conexao ? tls : conexao;
+    
+    histograma_registrar(&m->fases[FASE_DNS], (long)dns);
+    histograma_registrar(&m->fases[FASE_CONEXAO], (long)(conexao > dns ? conexao - dns : 0));
+    histograma_registrar(&m->fases[FASE_TLS], (long)(tls > conexao ? tls - conexao : 0));
+    histograma_registrar(&m->fases[FASE_ESPERA], (long)(primeiro_byte > pronto ? primeiro_byte - pronto : 0));
+    histograma_registrar(&m->fases[FASE_TRANSFERENCIA], (long)(total > primeiro_byte ? total - primeiro_byte : 0));
+    histograma_registrar(&m->fases[FASE_TOTAL], (long)total);
+    
+    return (long)total;
+}
+
+void metricas_registrar_parse(MetricasUpstream *m, long nanossegundos) {
+    histograma_registrar(&m->fases[FASE_PARSE], (nanossegundos + 500) / 1000);
+}
+
+/* ========================================================================
+   FUNÇÃO: metricas_juntar
+   ========================================================================
+   Soma as métricas de um host registradas à parte (ex.: por uma thread
+   do lote paralelo) às do cliente.
+   ======================================================================== */
+void metricas_juntar(MetricasUpstream *destino, const MetricasUpstream *origem) {
+    for (int i = 0; i < TOTAL_FASES; i++) {
+        histograma_juntar(&destino->fases[i], &origem->fases[i]);
+    }
+    destino->requisicoes += origem->requisicoes;
+    destino->falhas += origem->falhas;
+    destino->conexoes += origem->conexoes;
+    destino->respostas_http2 += origem->respostas_http2;
+}
+
+/* ========================================================================
+   FUNÇÃO: metricas_exportar
+   ========================================================================
+   Grava os histogramas de todos os hosts em JSON ou no formato texto do
+   Prometheus (um summary com p50/p95/p99, soma e contagem por fase).
+   ======================================================================== */
+void metricas_exportar(FILE *saida, FormatoMetricas formato, const MetricasUpstream *upstreams,
+                       const char *const *nomes, int total) {
+    static const double QUANTIS[] = {50, 95, 99};
+    
+    if (formato == METRICAS_PROMETHEUS) {
+        fprintf(saida, "# HELP integrador_http_requisicoes_total Requisições HTTP concluídas por API\n");
+        fprintf(saida, "# TYPE integrador_http_requisicoes_total counter\n");
+        for (int u = 0; u < total; u++) {
+            fprintf(saida, "integrador_http_requisicoes_total{api=\"%s\"} %ld\n", nomes[u], upstreams[u].requisicoes);
+        }
+        fprintf(saida, "# HELP integrador_http_falhas_total Requisições HTTP que falharam por API\n");
+        fprintf(saida, "# TYPE integrador_http_falhas_total counter\n");
+        for (int u = 0; u < total; u++) {
+            fprintf(saida, "integrador_http_falhas_total{api=\"%s\"} %ld\n", nomes[u], upstreams[u].falhas);
+        }
+        fprintf(saida, "# HELP integrador_http_conexoes_total Conexões abertas por API\n");
+        fprintf(saida, "# TYPE integrador_http_conexoes_total counter\n");
+        for (int u = 0; u < total; u++) {
+            fprintf(saida, "integrador_http_conexoes_total{api=\"%s\"} %ld\n", nomes[u], upstreams[u].conexoes);
+        }
+        fprintf(saida, "# HELP integrador_http2_respostas_total Respostas recebidas por HTTP/2 por API\n");
+        fprintf(saida, "# TYPE integrador_http2_respostas_total counter\n");
+        for (int u = 0; u < total; u++) {
+            fprintf(saida, "integrador_http2_respostas_total{api=\"%s\"} %ld\n", nomes[u],
+                    upstreams[u].respostas_http2);
+        }
+        fprintf(saida, "# HELP integrador_http_fase_segundos Duração de cada fase das requisições HTTP\n");
+        fprintf(saida, "# TYPE integrador_http_fase_segundos summary\n");
+        for (int u = 0; u < total; u++) {
+            for (int f = 0; f < TOTAL_FASES; f++) {
+                const Histograma *h = &upstreams[u].fases[f];
+                for (size_t q = 0; q < sizeof(QUANTIS) / sizeof(QUANTIS[0]); q++) {
+                    fprintf(saida, "integrador_http_fase_segundos{api=\"%s\",fase=\"%s\",quantile=\"%g\"} %.6f\n",
+                            nomes[u], NOMES_FASES[f], QUANTIS[q] / 100, histograma_percentil(h, QUANTIS[q]) / 1e6);
+                }
+                fprintf(saida, "integrador_http_fase_segundos_sum{api=\"%s\",fase=\"%s\"} %.6f\n",
+                        nomes[u], NOMES_FASES[f], h->soma_us / 1e6);
+                fprintf(saida, "integrador_http_fase_segundos_count{api=\"%s\",fase=\"%s\"} %ld\n",
+                        nomes[u], NOMES_FASES[f], h->total);
+            }
+        }
+        return;
+    }
+    
+    fprintf(saida, "{\"upstreams\":{");
+    for (int u = 0; u < total; u++) {
+        fprintf(saida, "%s\"%s\":{\"requisicoes\":%ld,\"falhas\":%ld,\"conexoes\":%ld,"
+                       "\"respostas_http2\":%ld,\"fases_ms\":{",
+                u ? "," : "", nomes[u], upstreams[u].requisicoes, upstreams[u].falhas,
+                upstreams[u].conexoes, upstreams[u].respostas_http2);
+        for (int f = 0; f < TOTAL_FASES; f++) {
+            const Histograma *h = &upstreams[u].fases[f];
+            fprintf(saida, "%s\"%s\":{\"n\":%ld,\"media\":%.3f,\"p50\":%.3f,\"p95\":%.3f,"
+                           "\"p99\":%.3f,\"max\":%.3f}",
+                    f ? "," : "", NOMES_FASES[f], h->total,
+                    h->total ? h->soma_us / 1e3 / h->total : 0.0,
+                    histograma_percentil(h, 50) / 1e3, histograma_percentil(h, 95) / 1e3,
+                    histograma_percentil(h, 99) / 1e3, h->maximo_us / 1e3);
+        }
+        fprintf(saida, "}}");
+    }
+    fprintf(saida, "}}\n");
+}
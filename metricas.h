@@ -0,0 +1,60 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <stdio.h>
+#include <curl/curl.h>
+
+/* Faixas do histograma: valores exatos até 15 us e, acima disso, 8
+   faixas por potência de 2 (erro relativo de no máximo 6,25%) */
+#define HISTOGRAMA_FAIXAS 256
+
+/* Histograma de latências em microssegundos. Registrar é só um
+   incremento, sem alocação; percentis são lidos ao final. */
+typedef struct {
+    long contagem[HISTOGRAMA_FAIXAS];
+    long total;
+    long long soma_us;
+    long maximo_us;
+} Histograma;
+
+/* Fases de uma requisição HTTP, derivadas dos tempos acumulados do curl
+   (CURLINFO_NAMELOOKUP/CONNECT/APPCONNECT/STARTTRANSFER/TOTAL_TIME),
+   mais o tempo gasto extraindo os campos da resposta */
+typedef enum {
+    FASE_DNS,
+    FASE_CONEXAO,
+    FASE_TLS,
+    FASE_ESPERA,                /* requisição enviada até o primeiro byte */
+    FASE_TRANSFERENCIA,         /* primeiro ao último byte */
+    FASE_TOTAL,
+    FASE_PARSE,
+    TOTAL_FASES
+} FaseHTTP;
+
+/* Histogramas de um host */
+typedef struct {
+    Histograma fases[TOTAL_FASES];
+    long requisicoes;
+    long falhas;
+    long conexoes;              /* conexões novas (CURLINFO_NUM_CONNECTS) */
+    long respostas_http2;       /* respostas que vieram por HTTP/2 */
+} MetricasUpstream;
+
+typedef enum {
+    METRICAS_JSON,
+    METRICAS_PROMETHEUS
+} FormatoMetricas;
+
+void histograma_registrar(Histograma *h, long microssegundos);
+void histograma_juntar(Histograma *destino, const Histograma *origem);
+long histograma_percentil(const Histograma *h, double percentil);
+void histograma_imprimir(FILE *saida, const char *rotulo, const Histograma *h);
+
+long metricas_agora_ns(void);
+long metricas_registrar_curl(MetricasUpstream *m, CURL *curl, CURLcode resultado);
+void metricas_registrar_parse(MetricasUpstream *m, long nanossegundos);
+void metricas_juntar(MetricasUpstream *destino, const MetricasUpstream *origem);
+void metricas_exportar(FILE *saida, FormatoMetricas formato, const MetricasUpstream *upstreams,
+                       const char *const *nomes, int total);
+
+#endif
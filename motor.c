@@ -0,0 +1,1754 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "motor.h"
+#include "cache_cep.h"
+#include "cache_negativo.h"
+#include "cache_feriados.h"
+#include "indice_ibge.h"
+
+/* ========================================================================
+   MOTOR DE CONSULTAS
+   ========================================================================
+   Só a etapa do IBGE depende do ViaCEP (precisa do código IBGE). As
+   requisições de município, população e feriados não dependem umas das
+   outras, então assim que o ViaCEP responde as três são disparadas em
+   paralelo e a consulta só é concluída quando todas terminam:
+   
+       ViaCEP ──┬── IBGE município ───┐
+                ├── IBGE população ───┼── consulta concluída
+                └── Brasil API ───────┘
+   
+   A latência de um CEP cai de quatro idas e voltas somadas para cerca
+   de duas. Todas as consultas submetidas compartilham o mesmo curl_multi.
+   
+   Se o cliente tiver cache de CEPs, um acerto pula o ViaCEP e a consulta
+   já começa pelas três requisições paralelas. Se tiver o índice de
+   municípios pré-carregado, município e população saem dele sem rede.
+   
+   Feriados não dependem do CEP: a tabela do ano é baixada uma única vez
+   para o cache de feriados e as consultas que chegam enquanto o download
+   está em andamento esperam por ele, em vez de baixar de novo.
+   
+   Com populacao_por_lote > 0, a população também não sai uma requisição
+   por CEP: o endpoint de indicadores aceita vários códigos separados por
+   '|', então as consultas se juntam em um grupo que é enviado quando
+   atinge populacao_por_lote códigos distintos, quando a janela de
+   janela_populacao_ms se esgota ou quando não há mais nada em andamento.
+   
+   Com prazo_ms no cliente, cada consulta tem um orçamento total: o ViaCEP
+   pode usar até MOTOR_FRACAO_VIACEP dele e as etapas dependentes, que
+   correm em paralelo, o que sobrar; cada requisição leva CURLOPT_TIMEOUT_MS
+   igual ao que resta da sua etapa. Falhas transitórias são repetidas uma
+   vez se ainda houver orçamento. Com 'duplicar', uma requisição que passa
+   do p95 observado para o host ganha uma cópia e vale a primeira resposta
+   útil; a cópia acumula a resposta em buffer e só é extraída se vencer.
+   
+   Nenhuma requisição vai direto ao curl_multi: quando o host não aceita
+   mais uma (taxa, simultâneas ou Retry-After, ver limitador.c), ela
+   espera em uma fila por host e prioridade; as interativas saem antes
+   das de lote. A fila anda quando uma requisição do host termina ou
+   quando motor_verificar_prazos é chamada.
+   
+   O índice do IBGE e as tabelas de feriados têm validade (TTL). Passado
+   o TTL, o dado velho continua sendo servido por uma janela enquanto o
+   motor o renova em segundo plano, com requisições comuns na prioridade
+   mais baixa (no máximo MOTOR_REVALIDACOES_SIMULTANEAS por vez); só
+   depois da janela a consulta volta a esperar pela rede. A latência das
+   consultas não sobe quando os dados envelhecem.
+   
+   Vários motores, cada um em sua thread, podem dividir um cliente
+   compartilhado (lote paralelo). A rede e a extração das respostas, que
+   acontecem dentro de curl_multi_perform, correm sem trava; o que mexe
+   nos caches e nos limites do cliente (submeter consultas, processar as
+   transferências concluídas, despachar as filas) é feito com a trava do
+   cliente. As métricas por host ficam em motor->metricas, que cada
+   thread tem para si, e só uma thread faz as revalidações.
+   ======================================================================== */
+
+static const char *NOMES_ETAPAS[TOTAL_ETAPAS] = { "viacep", "ibge", "populacao", "feriados" };
+
+/* Uma requisição em andamento de uma consulta */
+struct Transferencia {
+    Motor *motor;
+    CURL *curl;
+    HTTPResponse resposta;
+    Consulta *consulta;         /* NULL nos downloads compartilhados */
+    Consulta *espera;           /* consultas de um grupo de população */
+    IndiceIBGE *indice;         /* revalidação das populações do índice */
+    int revalidacao;            /* renovação em segundo plano (sem consulta) */
+    ExtratorJSON extrator;      /* lê a resposta enquanto ela chega */
+    ColetorPopulacao coletor;
+    EtapaConsulta etapa;
+    int ano;
+    CURLcode resultado;
+    long parse_ns;              /* tempo gasto no extrator */
+    char url[512];
+    Consulta *seguidores;       /* consultas esperando pela mesma URL */
+    Transferencia *proximo_voo; /* próxima no mesmo balde de motor->voos */
+    double prazo;               /* fim do orçamento (ms), 0 = sem prazo */
+    double prazo_duplicar;      /* quando duplicar se não tiver respondido (0 = nunca) */
+    int tentativas;
+    int duplicata;              /* cópia de outra: acumula a resposta em buffer */
+    int aguardando;             /* falhou, mas a duplicata ainda pode responder */
+    Transferencia *gemea;       /* original <-> duplicata */
+    PrioridadeConsulta prioridade;
+    int na_fila;                /* esperando pelo limite do host */
+    Transferencia *proxima_fila;
+    Transferencia *proxima_livre;
+    Transferencia *proxima_alocada;
+};
+
+/* Host consultado em cada etapa */
+static const Upstream UPSTREAM_ETAPAS[TOTAL_ETAPAS] = {
+    UPSTREAM_VIACEP, UPSTREAM_IBGE, UPSTREAM_IBGE, UPSTREAM_BRASILAPI
+};
+
+const char *nome_etapa(EtapaConsulta etapa) {
+    return NOMES_ETAPAS[etapa];
+}
+
+/* ========================================================================
+   FUNÇÃO: motor_imprimir_tempos
+   ========================================================================
+   Percentis de latência por etapa e por consulta, uma linha cada.
+   ======================================================================== */
+void motor_imprimir_tempos(FILE *saida, const char *prefixo, const TemposMotor *tempos) {
+    for (int i = 0; i < TOTAL_ETAPAS; i++) {
+        if (tempos->etapas[i].total == 0) {
+            continue;
+        }
+        fprintf(saida, "%s", prefixo);
+        histograma_imprimir(saida, NOMES_ETAPAS[i], &tempos->etapas[i]);
+    }
+    fprintf(saida, "%s", prefixo);
+    histograma_imprimir(saida, "consulta", &tempos->consultas);
+}
+
+/* ========================================================================
+   FUNÇÃO: motor_imprimir_contadores
+   ========================================================================
+   Etapas atendidas pela requisição de outra consulta (no total e por
+   etapa), requisições duplicadas e repetidas e prazos esgotados.
+   ======================================================================== */
+void motor_imprimir_contadores(FILE *saida, const char *prefixo, const ContadoresMotor *contadores) {
+    long total = 0;
+    
+    for (int i = 0; i < TOTAL_ETAPAS; i++) {
+        total += contadores->coalescidas[i];
+    }
+    fprintf(saida, "%sRequisições coalescidas: %ld (", prefixo, total);
+    for (int i = 0; i < TOTAL_ETAPAS; i++) {
+        fprintf(saida, "%s%s %ld", i ? ", " : "", NOMES_ETAPAS[i], contadores->coalescidas[i]);
+    }
+    fprintf(saida, ")\n");
+    fprintf(saida, "%sRequisições duplicadas: %ld (%ld responderam primeiro), repetidas: %ld, "
+            "prazos esgotados: %ld\n", prefixo, contadores->duplicadas,
+            contadores->duplicadas_vencedoras, contadores->repetidas, contadores->prazos_esgotados);
+    fprintf(saida, "%sCEPs recusados sem requisição: %ld inválidos, %ld inexistentes em cache\n",
+            prefixo, contadores->ceps_invalidos, contadores->inexistentes_em_cache);
+    fprintf(saida, "%sRevalidações em segundo plano: %ld concluídas, %ld com falha\n",
+            prefixo, contadores->revalidacoes, contadores->revalidacoes_falhas);
+}
+
+/* ========================================================================
+   FUNÇÃO: motor_juntar_tempos
+   ========================================================================
+   Soma os tempos e contadores de outro motor (ex.: de cada thread do
+   lote paralelo) para um resumo único.
+   ======================================================================== */
+void motor_juntar_tempos(TemposMotor *destino, const TemposMotor *origem) {
+    for (int i = 0; i < TOTAL_ETAPAS; i++) {
+        histograma_juntar(&destino->etapas[i], &origem->etapas[i]);
+    }
+    histograma_juntar(&destino->consultas, &origem->consultas);
+}
+
+void motor_juntar_contadores(ContadoresMotor *destino, const ContadoresMotor *origem) {
+    for (int i = 0; i < TOTAL_ETAPAS; i++) {
+        destino->coalescidas[i] += origem->coalescidas[i];
+    }
+    destino->duplicadas += origem->duplicadas;
+    destino->duplicadas_vencedoras += origem->duplicadas_vencedoras;
+    destino->repetidas += origem->repetidas;
+    destino->prazos_esgotados += origem->prazos_esgotados;
+    destino->ceps_invalidos += origem->ceps_invalidos;
+    destino->inexistentes_em_cache += origem->inexistentes_em_cache;
+    destino->revalidacoes += origem->revalidacoes;
+    destino->revalidacoes_falhas += origem->revalidacoes_falhas;
+}
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* ========================================================================
+   FUNÇÃO: atualizar_hoje
+   ========================================================================
+   Recalcula a data de referência dos feriados quando o dia muda, para
+   que um processo de longa duração (modo serviço) não fique preso ao dia
+   em que começou.
+   ======================================================================== */
+static void atualizar_hoje(Motor *motor) {
+    time_t agora = time(NULL);
+    struct tm meia_noite;
+    
+    if (agora < motor->proximo_dia) {
+        return;
+    }
+    
+    localtime_r(&agora, &motor->hoje);
+    motor->ano = motor->hoje.tm_year + 1900;
+    
+    meia_noite = motor->hoje;
+    meia_noite.tm_mday++;
+    meia_noite.tm_hour = 0;
+    meia_noite.tm_min = 0;
+    meia_noite.tm_sec = 0;
+    meia_noite.tm_isdst = -1;
+    motor->proximo_dia = mktime(&meia_noite);
+}
+
+/* ========================================================================
+   FUNÇÃO: motor_iniciar
+   ======================================================================== */
+int motor_iniciar(Motor *motor, ClienteHTTP *cliente) {
+    memset(motor, 0, sizeof(*motor));
+    motor->cliente = cliente;
+    motor->metricas = cliente->metricas;
+    motor->revalidar = 1;
+    
+    /* Sem cache compartilhado, o motor mantém o seu próprio */
+    if (cliente->cache_feriados) {
+        motor->feriados = cliente->cache_feriados;
+    } else {
+        cache_feriados_iniciar(&motor->feriados_proprio, NULL);
+        motor->feriados = &motor->feriados_proprio;
+    }
+    
+    atualizar_hoje(motor);
+    
+    motor->multi = curl_multi_init();
+    if (!motor->multi) {
+        fprintf(stderr, "[ERRO] Falha ao inicializar CURL multi\n");
+        return -1;
+    }
+    
+    /* Transferências para o mesmo host dividem a conexão em HTTP/2; cada
+       conexão leva até MOTOR_FLUXOS_POR_CONEXAO streams (ou o que o
+       servidor aceitar, se for menos). Sem o limite de conexões por
+       host, o curl abriria uma conexão nova para cada transferência que
+       encontrasse as existentes cheias ou ainda em negociação; com ele,
+       elas esperam um stream livre. O limite conta só as conexões deste
+       curl_multi, já que os handles do motor não dividem o cache de
+       conexões (share_motor): uma transferência à espera é acordada
+       quando outra deste mesmo multi termina. */
+    curl_multi_setopt(motor->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(motor->multi, CURLMOPT_MAX_CONCURRENT_STREAMS, (long)MOTOR_FLUXOS_POR_CONEXAO);
+    if (cliente->versao_http != CURL_HTTP_VERSION_1_1) {
+        curl_multi_setopt(motor->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)MOTOR_CONEXOES_POR_HOST);
+        motor->conexoes_limitadas = 1;
+    }
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: motor_finalizar
+   ======================================================================== */
+void motor_finalizar(Motor *motor) {
+    Transferencia *t = motor->alocadas;
+    
+    while (t) {
+        Transferencia *proxima = t->proxima_alocada;
+        curl_multi_remove_handle(motor->multi, t->curl);
+        curl_easy_cleanup(t->curl);
+        resposta_http_liberar(&t->resposta);
+        free(t);
+        t = proxima;
+    }
+    
+    if (motor->multi) {
+        curl_multi_cleanup(motor->multi);
+    }
+    cache_feriados_finalizar(&motor->feriados_proprio);
+    memset(motor, 0, sizeof(*motor));
+}
+
+/* ========================================================================
+   FUNÇÃO: receber_dados
+   ========================================================================
+   Write callback das transferências. As respostas das etapas de uma
+   consulta vão direto para o extrator, que preenche a consulta enquanto
+   os bytes chegam; só a tabela de feriados (gravada em disco como veio)
+   e as duplicatas (que não podem escrever na consulta junto com a
+   original) são acumuladas em buffer.
+   ======================================================================== */
+static size_t receber_dados(void *dados, size_t size, size_t nmemb, void *userp) {
+    Transferencia *t = (Transferencia *)userp;
+    
+    if (t->etapa == ETAPA_FERIADOS || t->duplicata) {
+        return write_callback(dados, size, nmemb, &t->resposta);
+    }
+    
+    long inicio = metricas_agora_ns();
+    extrator_json_alimentar(&t->extrator, (const char *)dados, size * nmemb);
+    t->parse_ns += metricas_agora_ns() - inicio;
+    return size * nmemb;
+}
+
+static size_t receber_cabecalho(char *buffer, size_t size, size_t nitems, void *userp) {
+    Transferencia *t = (Transferencia *)userp;
+    
+    if (t->etapa == ETAPA_FERIADOS || t->duplicata) {
+        return header_callback(buffer, size, nitems, &t->resposta);
+    }
+    return size * nitems;
+}
+
+static void definir_populacao(const char *codigo_ibge, int populacao, void *contexto) {
+    (void)codigo_ibge;
+    ((DadosIBGE *)contexto)->populacao = populacao;
+}
+
+static void aplicar_populacao(const char *codigo_ibge, int populacao, void *contexto) {
+    Transferencia *t = (Transferencia *)contexto;
+    
+    /* Chamada durante curl_multi_perform, fora da trava do cliente */
+    if (t->indice) {
+        cliente_http_travar(t->motor->cliente);
+        indice_ibge_definir_populacao(t->indice, codigo_ibge, populacao);
+        cliente_http_destravar(t->motor->cliente);
+        return;
+    }
+    for (Consulta *c = t->espera; c; c = c->proxima_populacao) {
+        if (strcmp(c->endereco.codigo_ibge, codigo_ibge) == 0) {
+            c->ibge.populacao = populacao;
+        }
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: obter_transferencia
+   ========================================================================
+   Reaproveita uma transferência livre (com seu handle, já ligado ao share
+   do cliente, e seu buffer de resposta, já alocado) ou cria uma nova.
+   As transferências livres formam o pool de buffers do motor: em regime,
+   uma consulta não aloca memória para receber respostas.
+   ======================================================================== */
+static Transferencia *obter_transferencia(Motor *motor) {
+    Transferencia *t = motor->livres;
+    
+    if (t) {
+        motor->livres = t->proxima_livre;
+        return t;
+    }
+    
+    t = calloc(1, sizeof(Transferencia));
+    if (!t) {
+        fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+        return NULL;
+    }
+    
+    t->curl = cliente_http_novo_handle(motor->cliente);
+    if (!t->curl) {
+        free(t);
+        return NULL;
+    }
+    t->motor = motor;
+    curl_easy_setopt(t->curl, CURLOPT_SHARE, motor->cliente->share_motor);
+    curl_easy_setopt(t->curl, CURLOPT_WRITEFUNCTION, receber_dados);
+    curl_easy_setopt(t->curl, CURLOPT_WRITEDATA, (void *)t);
+    curl_easy_setopt(t->curl, CURLOPT_HEADERFUNCTION, receber_cabecalho);
+    curl_easy_setopt(t->curl, CURLOPT_HEADERDATA, (void *)t);
+    curl_easy_setopt(t->curl, CURLOPT_PRIVATE, (void *)t);
+    
+    t->proxima_alocada = motor->alocadas;
+    motor->alocadas = t;
+    
+    return t;
+}
+
+/* ========================================================================
+   FUNÇÃO: devolver_transferencia
+   ========================================================================
+   Devolve ao pool uma transferência que já saiu do curl_multi.
+   ======================================================================== */
+static void devolver_transferencia(Motor *motor, Transferencia *t) {
+    t->parse_ns = 0;
+    resposta_http_resetar(&t->resposta);
+    t->consulta = NULL;
+    t->espera = NULL;
+    t->indice = NULL;
+    t->revalidacao = 0;
+    t->seguidores = NULL;
+    t->gemea = NULL;
+    t->duplicata = 0;
+    t->aguardando = 0;
+    t->prazo_duplicar = 0;
+    t->na_fila = 0;
+    t->proxima_fila = NULL;
+    t->proxima_livre = motor->livres;
+    motor->livres = t;
+}
+
+/* ========================================================================
+   FUNÇÃO: observar_versao
+   ========================================================================
+   O limite de conexões por host de motor_iniciar só serve se elas
+   multiplexam. Um host que responde em HTTP/1.1 (não oferece HTTP/2)
+   levaria uma requisição por vez em cada uma das poucas conexões,
+   então na primeira resposta assim o limite sai e o motor segue como
+   no --http 1.1. O limite é do curl_multi inteiro: os outros hosts
+   também deixam de tê-lo.
+   ======================================================================== */
+static void observar_versao(Motor *motor, Transferencia *t) {
+    long versao = 0;
+    
+    if (!motor->conexoes_limitadas || t->resultado != CURLE_OK) {
+        return;
+    }
+    curl_easy_getinfo(t->curl, CURLINFO_HTTP_VERSION, &versao);
+    if (versao == CURL_HTTP_VERSION_1_0 || versao == CURL_HTTP_VERSION_1_1) {
+        curl_multi_setopt(motor->multi, CURLMOPT_MAX_HOST_CONNECTIONS, 0L);
+        motor->conexoes_limitadas = 0;
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: liberar_transferencia
+   ========================================================================
+   Devolve ao pool uma transferência concluída, registrando antes os
+   tempos dela (fases do curl e extração) nas métricas do host.
+   ======================================================================== */
+static void liberar_transferencia(Motor *motor, Transferencia *t) {
+    MetricasUpstream *metricas = &motor->metricas[UPSTREAM_ETAPAS[t->etapa]];
+    
+    long total_us = metricas_registrar_curl(metricas, t->curl, t->resultado);
+    observar_versao(motor, t);
+    if (t->resultado == CURLE_OK) {
+        histograma_registrar(&motor->tempos.etapas[t->etapa], total_us);
+        metricas_registrar_parse(metricas, t->parse_ns);
+    }
+    devolver_transferencia(motor, t);
+}
+
+/* ========================================================================
+   FUNÇÃO: marcar_erro
+   ========================================================================
+   Registra a primeira falha da consulta; as demais são ignoradas.
+   ======================================================================== */
+static void marcar_erro(Consulta *consulta, EtapaConsulta etapa, const char *motivo) {
+    if (!consulta->erro) {
+        consulta->erro = CONSULTA_FALHOU;
+        consulta->etapa_erro = etapa;
+        consulta->motivo = motivo;
+    }
+}
+
+static void anunciar_etapa(EtapaConsulta etapa, const char *url) {
+    switch (etapa) {
+        case ETAPA_VIACEP:
+            printf("\n[API 1] Consultando ViaCEP...\n");
+            break;
+        case ETAPA_MUNICIPIO:
+            printf("\n[API 2] Consultando IBGE...\n");
+            break;
+        case ETAPA_POPULACAO:
+            printf("\n[API 2] Consultando IBGE (população)...\n");
+            break;
+        case ETAPA_FERIADOS:
+            printf("\n[API 3] Consultando Brasil API (Feriados)...\n");
+            break;
+        default:
+            break;
+    }
+    printf("URL: %s\n", url);
+}
+
+/* ========================================================================
+   FUNÇÃO: iniciar_extracao
+   ========================================================================
+   Aponta o extrator da transferência para os campos da consulta (ou do
+   grupo de população). Refeita a cada tentativa: os campos já escritos
+   por uma resposta incompleta são sobrescritos pela seguinte.
+   ======================================================================== */
+static void iniciar_extracao(Transferencia *t) {
+    Consulta *consulta = t->consulta;
+    
+    switch (t->etapa) {
+        case ETAPA_VIACEP:
+            memset(&consulta->endereco, 0, sizeof(consulta->endereco));
+            extrator_endereco_iniciar(&t->extrator, &consulta->endereco);
+            break;
+        case ETAPA_MUNICIPIO:
+            /* Só os campos desta etapa: a população corre em paralelo */
+            consulta->ibge.nome_completo[0] = '\0';
+            consulta->ibge.regiao[0] = '\0';
+            extrator_municipio_iniciar(&t->extrator, &consulta->ibge);
+            break;
+        case ETAPA_POPULACAO:
+            /* Sem consulta, é um grupo: a resposta se divide entre t->espera
+               (ou vai para o índice, na revalidação) */
+            if (consulta) {
+                consulta->ibge.populacao = 0;
+                extrator_populacoes_iniciar(&t->extrator, &t->coletor, definir_populacao, &consulta->ibge);
+            } else {
+                extrator_populacoes_iniciar(&t->extrator, &t->coletor, aplicar_populacao, t);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: atraso_duplicacao
+   ========================================================================
+   Quanto esperar (ms) antes de duplicar uma requisição ao host: o p95 da
+   duração total das respostas dele. Retorna -1 enquanto não houver
+   MOTOR_AMOSTRAS_DUPLICAR respostas para estimá-lo.
+   ======================================================================== */
+static double atraso_duplicacao(Motor *motor, Upstream upstream) {
+    const Histograma *h = &motor->metricas[upstream].fases[FASE_TOTAL];
+    
+    if (h->total < MOTOR_AMOSTRAS_DUPLICAR) {
+        return -1;
+    }
+    if (motor->amostras_duplicar[upstream] == 0 ||
+        h->total - motor->amostras_duplicar[upstream] >= MOTOR_AMOSTRAS_DUPLICAR) {
+        motor->atraso_duplicar_us[upstream] = histograma_percentil(h, 95);
+        motor->amostras_duplicar[upstream] = h->total;
+    }
+    return motor->atraso_duplicar_us[upstream] / 1e3;
+}
+
+/* ========================================================================
+   FUNÇÃO: iniciar_envio
+   ========================================================================
+   Entrega a transferência ao curl_multi com o tempo que resta do seu
+   orçamento e, se for o caso, agenda a duplicação. O limite do host já
+   deve ter aceitado a requisição.
+   ======================================================================== */
+static void iniciar_envio(Motor *motor, Transferencia *t, double agora) {
+    long limite = 0;
+    
+    limitador_consumir(&motor->cliente->limites[UPSTREAM_ETAPAS[t->etapa]], agora);
+    motor->enviadas++;
+    
+    if (t->prazo > 0) {
+        limite = t->prazo - agora > 1 ? (long)(t->prazo - agora) : 1;
+    }
+    curl_easy_setopt(t->curl, CURLOPT_TIMEOUT_MS, limite);
+    
+    t->prazo_duplicar = 0;
+    if (motor->cliente->duplicar && t->consulta && !t->duplicata) {
+        double atraso = atraso_duplicacao(motor, UPSTREAM_ETAPAS[t->etapa]);
+        if (atraso >= 0 && (t->prazo == 0 || agora + atraso < t->prazo)) {
+            t->prazo_duplicar = agora + atraso;
+        }
+    }
+    
+    curl_multi_add_handle(motor->multi, t->curl);
+    motor->ativas++;
+}
+
+/* ========================================================================
+   FUNÇÃO: enviar_transferencia
+   ========================================================================
+   Envia a transferência se o host a aceita agora e ninguém espera antes
+   dela; senão, põe no fim da fila do host na sua prioridade.
+   ======================================================================== */
+static void enviar_transferencia(Motor *motor, Transferencia *t) {
+    Upstream upstream = UPSTREAM_ETAPAS[t->etapa];
+    Limitador *limite = &motor->cliente->limites[upstream];
+    double agora = agora_ms();
+    int fila_vazia = 1;
+    
+    for (int p = 0; p < TOTAL_PRIORIDADES; p++) {
+        if (motor->filas[upstream][p]) {
+            fila_vazia = 0;
+        }
+    }
+    if (fila_vazia && limitador_espera_ms(limite, agora) == 0) {
+        iniciar_envio(motor, t, agora);
+        return;
+    }
+    
+    t->na_fila = 1;
+    t->proxima_fila = NULL;
+    if (motor->fins_filas[upstream][t->prioridade]) {
+        motor->fins_filas[upstream][t->prioridade]->proxima_fila = t;
+    } else {
+        motor->filas[upstream][t->prioridade] = t;
+    }
+    motor->fins_filas[upstream][t->prioridade] = t;
+    motor->enfileiradas++;
+    limite->enfileiradas++;
+}
+
+/* Tira da fila do host a transferência 't', que pode estar em qualquer posição */
+static void retirar_da_fila(Motor *motor, Transferencia *t) {
+    Upstream upstream = UPSTREAM_ETAPAS[t->etapa];
+    Transferencia **p = &motor->filas[upstream][t->prioridade];
+    Transferencia *anterior = NULL;
+    
+    while (*p && *p != t) {
+        anterior = *p;
+        p = &(*p)->proxima_fila;
+    }
+    if (*p) {
+        *p = t->proxima_fila;
+        if (motor->fins_filas[upstream][t->prioridade] == t) {
+            motor->fins_filas[upstream][t->prioridade] = anterior;
+        }
+        motor->enfileiradas--;
+    }
+    t->proxima_fila = NULL;
+    t->na_fila = 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: cancelar_transferencia
+   ========================================================================
+   Desiste de uma transferência ainda não concluída (a outra do par
+   original/duplicata respondeu), esteja ela na fila ou no curl_multi.
+   ======================================================================== */
+static void cancelar_transferencia(Motor *motor, Transferencia *t) {
+    if (t->na_fila) {
+        retirar_da_fila(motor, t);
+    } else {
+        curl_multi_remove_handle(motor->multi, t->curl);
+        motor->ativas--;
+        limitador_liberar(&motor->cliente->limites[UPSTREAM_ETAPAS[t->etapa]]);
+    }
+    devolver_transferencia(motor, t);
+}
+
+/* ========================================================================
+   FUNÇÃO: iniciar_transferencia
+   ========================================================================
+   Entrega ao curl_multi uma requisição para 'url', que deve terminar até
+   'prazo' (ms, 0 = sem prazo). A prioridade é a da consulta ou, nas
+   requisições compartilhadas, 'prioridade'.
+   ======================================================================== */
+static Transferencia *iniciar_transferencia(Motor *motor, Consulta *consulta, EtapaConsulta etapa,
+                                            const char *url, double prazo, PrioridadeConsulta prioridade) {
+    Transferencia *t = obter_transferencia(motor);
+    if (!t) {
+        return NULL;
+    }
+    
+    if (motor->verboso) {
+        anunciar_etapa(etapa, url);
+    }
+    
+    t->consulta = consulta;
+    t->etapa = etapa;
+    t->prioridade = consulta ? consulta->prioridade : prioridade;
+    t->prazo = prazo;
+    t->tentativas = 1;
+    snprintf(t->url, sizeof(t->url), "%s", url);
+    iniciar_extracao(t);
+    
+    curl_easy_setopt(t->curl, CURLOPT_URL, url);
+    enviar_transferencia(motor, t);
+    
+    return t;
+}
+
+/* ========================================================================
+   FUNÇÃO: prazo_compartilhado
+   ========================================================================
+   Prazo das requisições que não pertencem a uma consulta (tabela de
+   feriados, grupos de população): um orçamento inteiro a partir de agora.
+   ======================================================================== */
+static double prazo_compartilhado(Motor *motor) {
+    return motor->cliente->prazo_ms > 0 ? agora_ms() + motor->cliente->prazo_ms : 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: prazo_etapa
+   ========================================================================
+   Fatia do orçamento da consulta que a etapa pode usar (ver o início do
+   arquivo). Retorna o instante limite em ms, ou 0 sem prazo.
+   ======================================================================== */
+static double prazo_etapa(Motor *motor, Consulta *consulta, EtapaConsulta etapa) {
+    int prazo_ms = motor->cliente->prazo_ms;
+    
+    if (prazo_ms <= 0) {
+        return 0;
+    }
+    if (etapa == ETAPA_VIACEP) {
+        return consulta->inicio + prazo_ms * MOTOR_FRACAO_VIACEP;
+    }
+    return consulta->inicio + prazo_ms;
+}
+
+/* ========================================================================
+   FUNÇÕES: buscar_voo / registrar_voo / remover_voo
+   ========================================================================
+   Requisições em andamento indexadas pela URL completa (singleflight):
+   uma consulta que precisa de uma URL já pedida espera pela resposta em
+   vez de repetir a requisição. Tabela de espalhamento com listas
+   encadeadas pelos próprios registros de transferência.
+   ======================================================================== */
+static unsigned int espalhar_url(const char *url) {
+    unsigned int h = 2166136261u;
+    
+    for (const unsigned char *p = (const unsigned char *)url; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h & (MOTOR_BALDES_VOOS - 1);
+}
+
+static Transferencia *buscar_voo(Motor *motor, const char *url) {
+    for (Transferencia *t = motor->voos[espalhar_url(url)]; t; t = t->proximo_voo) {
+        if (strcmp(t->url, url) == 0) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static void registrar_voo(Motor *motor, Transferencia *t) {
+    unsigned int balde = espalhar_url(t->url);
+    
+    t->proximo_voo = motor->voos[balde];
+    motor->voos[balde] = t;
+}
+
+static void remover_voo(Motor *motor, Transferencia *t) {
+    Transferencia **p = &motor->voos[espalhar_url(t->url)];
+    
+    while (*p && *p != t) {
+        p = &(*p)->proximo_voo;
+    }
+    if (*p) {
+        *p = t->proximo_voo;
+    }
+    t->proximo_voo = NULL;
+}
+
+/* ========================================================================
+   FUNÇÃO: disparar_etapa
+   ========================================================================
+   Monta a URL da etapa da consulta e inicia a requisição, ou junta a
+   consulta a uma requisição idêntica já em andamento.
+   ======================================================================== */
+static void disparar_etapa(Motor *motor, Consulta *consulta, EtapaConsulta etapa) {
+    char url[512];
+    
+    switch (etapa) {
+        case ETAPA_VIACEP:
+            montar_url_endereco(url, sizeof(url), consulta->cep);
+            break;
+        case ETAPA_MUNICIPIO:
+            montar_url_municipio(url, sizeof(url), consulta->endereco.codigo_ibge);
+            break;
+        case ETAPA_POPULACAO:
+            montar_url_populacao(url, sizeof(url), consulta->endereco.codigo_ibge);
+            break;
+        default:
+            return;
+    }
+    
+    double prazo = prazo_etapa(motor, consulta, etapa);
+    if (prazo > 0 && agora_ms() >= prazo) {
+        marcar_erro(consulta, etapa, "prazo esgotado");
+        motor->contadores.prazos_esgotados++;
+        return;
+    }
+    
+    consulta->pendentes++;
+    
+    Transferencia *voo = buscar_voo(motor, url);
+    if (voo) {
+        consulta->proxima_voo[etapa] = voo->seguidores;
+        voo->seguidores = consulta;
+        motor->contadores.coalescidas[etapa]++;
+        return;
+    }
+    
+    Transferencia *t = iniciar_transferencia(motor, consulta, etapa, url, prazo, consulta->prioridade);
+    if (!t) {
+        marcar_erro(consulta, etapa, "falha ao alocar transferência");
+        consulta->pendentes--;
+        return;
+    }
+    registrar_voo(motor, t);
+    if (etapa == ETAPA_POPULACAO) {
+        motor->requisicoes_populacao++;
+    }
+}
+
+static void concluir_consulta_se_pronta(Motor *motor, Consulta *consulta);
+static void resolver_feriados(Motor *motor, Consulta *consulta);
+
+/* ========================================================================
+   FUNÇÃO: liberar_espera_feriados
+   ========================================================================
+   Acorda as consultas que esperavam pela tabela de feriados. Com a
+   tabela carregada, cada uma resolve seu próximo feriado (o que pode
+   exigir a tabela do ano seguinte); em caso de falha, todas recebem o erro.
+   ======================================================================== */
+static void liberar_espera_feriados(Motor *motor, const char *erro) {
+    Consulta *espera = motor->espera_feriados;
+    
+    motor->espera_feriados = NULL;
+    motor->ano_feriados_em_andamento = 0;
+    motor->ano_feriados_alheio = 0;
+    
+    while (espera) {
+        Consulta *consulta = espera;
+        espera = consulta->proxima_espera;
+        consulta->proxima_espera = NULL;
+        consulta->pendentes--;
+    
+        if (erro) {
+            marcar_erro(consulta, ETAPA_FERIADOS, erro);
+        } else {
+            resolver_feriados(motor, consulta);
+        }
+        concluir_consulta_se_pronta(motor, consulta);
+    }
+}
+
+/* Com o cache de feriados do cliente, o download em andamento também é
+   dele: com -j N, só um motor baixa a tabela e os outros esperam */
+static int feriados_compartilhados(Motor *motor) {
+    return motor->feriados == motor->cliente->cache_feriados;
+}
+
+/* Desfaz a marca do cliente deixada por este motor ao iniciar o download */
+static void soltar_feriados(Motor *motor, int ano, const char *erro) {
+    if (feriados_compartilhados(motor) && motor->cliente->ano_feriados_em_andamento == ano) {
+        motor->cliente->ano_feriados_em_andamento = 0;
+        motor->cliente->erro_feriados = erro;
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: verificar_feriados_alheios
+   ========================================================================
+   Acorda as consultas que esperavam o download de outro motor, quando ele
+   termina. Não há como o outro motor avisar (cada um tem o seu
+   curl_multi), então motor_executar confere a cada passada e, enquanto
+   espera, não dorme mais que MOTOR_ESPERA_FERIADOS_MS.
+   ======================================================================== */
+static void verificar_feriados_alheios(Motor *motor) {
+    if (motor->ano_feriados_alheio == 0 ||
+        motor->cliente->ano_feriados_em_andamento == motor->ano_feriados_alheio) {
+        return;
+    }
+    liberar_espera_feriados(motor, motor->cliente->erro_feriados);
+}
+
+/* ========================================================================
+   FUNÇÃO: resolver_feriados
+   ========================================================================
+   Preenche os feriados da consulta direto do cache ou, se falta a tabela
+   de algum ano, coloca a consulta em espera pelo download (iniciando-o
+   se ninguém o iniciou ainda, neste motor ou em outro).
+   ======================================================================== */
+static void resolver_feriados(Motor *motor, Consulta *consulta) {
+    int ano = cache_feriados_ano_pendente(motor->feriados, &motor->hoje);
+    
+    if (ano == 0) {
+        cache_feriados_preencher(motor->feriados, &motor->hoje, &consulta->feriados);
+        if (motor->verboso) {
+            printf("[SUCESSO] %d feriados nacionais encontrados em %d\n",
+                   consulta->feriados.quantidade_feriados, motor->ano);
+        }
+        return;
+    }
+    
+    consulta->pendentes++;
+    consulta->proxima_espera = motor->espera_feriados;
+    motor->espera_feriados = consulta;
+    
+    if (motor->ano_feriados_em_andamento != 0 || motor->ano_feriados_alheio != 0) {
+        motor->contadores.coalescidas[ETAPA_FERIADOS]++;
+    } else if (feriados_compartilhados(motor) && motor->cliente->ano_feriados_em_andamento == ano) {
+        motor->ano_feriados_alheio = ano;
+        motor->contadores.coalescidas[ETAPA_FERIADOS]++;
+    } else {
+        char url[512];
+        Transferencia *t;
+    
+        montar_url_feriados(url, sizeof(url), ano);
+        motor->ano_feriados_em_andamento = ano;
+        if (feriados_compartilhados(motor) && motor->cliente->ano_feriados_em_andamento == 0) {
+            motor->cliente->ano_feriados_em_andamento = ano;
+        }
+        t = iniciar_transferencia(motor, NULL, ETAPA_FERIADOS, url, prazo_compartilhado(motor),
+                                  PRIORIDADE_INTERATIVA);
+        if (!t) {
+            soltar_feriados(motor, ano, "falha ao alocar transferência");
+            liberar_espera_feriados(motor, "falha ao alocar transferência");
+            return;
+        }
+        t->ano = ano;
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: concluir_download_feriados
+   ========================================================================
+   Carrega a tabela baixada no cache. A falha no ano seguinte não é erro:
+   apenas não há virada de ano no próximo feriado.
+   ======================================================================== */
+static void concluir_download_feriados(Motor *motor, Transferencia *t, CURLcode resultado) {
+    const char *erro = NULL;
+    int ano = t->ano;
+    
+    if (resultado != CURLE_OK) {
+        erro = curl_easy_strerror(resultado);
+    } else {
+        long inicio = metricas_agora_ns();
+        if (cache_feriados_carregar_json(motor->feriados, ano,
+                                         t->resposta.data ? t->resposta.data : "") != 0) {
+            erro = "resposta inválida";
+        }
+        t->parse_ns += metricas_agora_ns() - inicio;
+    }
+    
+    /* Na revalidação ninguém espera: em caso de falha, a tabela velha fica */
+    if (t->revalidacao) {
+        motor->ano_feriados_revalidando = 0;
+        motor->em_segundo_plano--;
+        if (erro) {
+            motor->contadores.revalidacoes_falhas++;
+            motor->revalidar_feriados_apos = agora_ms() + MOTOR_ESPERA_REVALIDACAO_MS;
+        } else {
+            motor->contadores.revalidacoes++;
+        }
+        liberar_transferencia(motor, t);
+        return;
+    }
+    
+    if (erro && ano != motor->ano) {
+        cache_feriados_marcar_vazio(motor->feriados, ano);
+        erro = NULL;
+    }
+    
+    liberar_transferencia(motor, t);
+    soltar_feriados(motor, ano, erro);
+    liberar_espera_feriados(motor, erro);
+}
+
+/* ========================================================================
+   FUNÇÃO: enviar_grupo_populacao
+   ========================================================================
+   Envia em uma única requisição os códigos distintos das consultas que
+   aguardam população. Se a requisição não puder ser criada, as consultas
+   seguem sem população, como quando a requisição falha.
+   ======================================================================== */
+static void enviar_grupo_populacao(Motor *motor) {
+    Consulta *espera = motor->espera_populacao;
+    char codigos[MOTOR_POPULACAO_POR_LOTE * 8 + 16];
+    char url[sizeof(codigos) + 256];
+    size_t usado = 0;
+    Transferencia *t;
+    
+    if (!espera) {
+        return;
+    }
+    motor->espera_populacao = NULL;
+    motor->codigos_populacao = 0;
+    
+    codigos[0] = '\0';
+    for (Consulta *c = espera; c; c = c->proxima_populacao) {
+        const char *codigo = c->endereco.codigo_ibge;
+        int repetido = 0;
+        for (Consulta *anterior = espera; anterior != c; anterior = anterior->proxima_populacao) {
+            if (strcmp(anterior->endereco.codigo_ibge, codigo) == 0) {
+                repetido = 1;
+                break;
+            }
+        }
+        if (!repetido && usado + strlen(codigo) + 2 < sizeof(codigos)) {
+            usado += snprintf(codigos + usado, sizeof(codigos) - usado, "%s%s",
+                              usado > 0 ? "|" : "", codigo);
+        }
+    }
+    
+    montar_url_populacao(url, sizeof(url), codigos);
+    motor->requisicoes_populacao++;
+    
+    t = iniciar_transferencia(motor, NULL, ETAPA_POPULACAO, url, prazo_compartilhado(motor), PRIORIDADE_LOTE);
+    if (!t) {
+        while (espera) {
+            Consulta *consulta = espera;
+            espera = consulta->proxima_populacao;
+            consulta->proxima_populacao = NULL;
+            consulta->pendentes--;
+            concluir_consulta_se_pronta(motor, consulta);
+        }
+        return;
+    }
+    t->espera = espera;
+}
+
+/* ========================================================================
+   FUNÇÃO: agrupar_populacao
+   ========================================================================
+   Coloca a consulta no grupo de população em formação; o grupo é enviado
+   assim que chega a populacao_por_lote códigos distintos.
+   ======================================================================== */
+static void agrupar_populacao(Motor *motor, Consulta *consulta) {
+    int novo = 1;
+    
+    for (Consulta *c = motor->espera_populacao; c; c = c->proxima_populacao) {
+        if (strcmp(c->endereco.codigo_ibge, consulta->endereco.codigo_ibge) == 0) {
+            novo = 0;
+            break;
+        }
+    }
+    
+    if (!motor->espera_populacao) {
+        motor->inicio_populacao = agora_ms();
+    }
+    
+    consulta->pendentes++;
+    consulta->proxima_populacao = motor->espera_populacao;
+    motor->espera_populacao = consulta;
+    motor->codigos_populacao += novo;
+    
+    if (motor->codigos_populacao >= motor->populacao_por_lote) {
+        enviar_grupo_populacao(motor);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: concluir_grupo_populacao
+   ========================================================================
+   Distribui a resposta do grupo entre as consultas que esperavam por ela.
+   Como na requisição individual, a falha é tolerada.
+   ======================================================================== */
+static void concluir_grupo_populacao(Motor *motor, Transferencia *t, CURLcode resultado) {
+    Consulta *espera = t->espera;
+    
+    /* As populações já foram distribuídas durante a transferência */
+    (void)resultado;
+    extrator_json_concluir(&t->extrator);
+    liberar_transferencia(motor, t);
+    
+    while (espera) {
+        Consulta *consulta = espera;
+        espera = consulta->proxima_populacao;
+        consulta->proxima_populacao = NULL;
+        consulta->pendentes--;
+        concluir_consulta_se_pronta(motor, consulta);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: enviar_revalidacao_ibge
+   ========================================================================
+   Pede de novo as populações do índice em grupos de
+   MOTOR_POPULACAO_POR_LOTE códigos, no máximo
+   MOTOR_REVALIDACOES_SIMULTANEAS grupos por vez; as respostas atualizam
+   o índice no lugar. Quando o último grupo termina, o índice passa a
+   contar como obtido agora ou, se algum grupo falhou, a renovação é
+   tentada de novo depois de MOTOR_ESPERA_REVALIDACAO_MS.
+   ======================================================================== */
+static void enviar_revalidacao_ibge(Motor *motor) {
+    IndiceIBGE *indice = motor->cliente->indice_ibge;
+    
+    while (motor->grupos_ibge < MOTOR_REVALIDACOES_SIMULTANEAS && motor->proximo_municipio < indice->quantidade) {
+        char codigos[MOTOR_POPULACAO_POR_LOTE * 8 + 16];
+        char url[sizeof(codigos) + 256];
+        size_t usado = 0;
+        int fim = motor->proximo_municipio + MOTOR_POPULACAO_POR_LOTE;
+        Transferencia *t;
+    
+        if (fim > indice->quantidade) fim = indice->quantidade;
+        for (int i = motor->proximo_municipio; i < fim; i++) {
+            usado += snprintf(codigos + usado, sizeof(codigos) - usado, "%s%u",
+                              usado > 0 ? "|" : "", indice->municipios[i].codigo);
+        }
+        motor->proximo_municipio = fim;
+    
+        montar_url_populacao(url, sizeof(url), codigos);
+        t = iniciar_transferencia(motor, NULL, ETAPA_POPULACAO, url, prazo_compartilhado(motor),
+                                  PRIORIDADE_REVALIDACAO);
+        if (!t) {
+            motor->falhas_ibge++;
+            continue;
+        }
+        t->indice = indice;
+        t->revalidacao = 1;
+        motor->grupos_ibge++;
+        motor->em_segundo_plano++;
+    }
+    
+    if (motor->grupos_ibge > 0 || motor->proximo_municipio < indice->quantidade) {
+        return;
+    }
+    
+    motor->revalidando_ibge = 0;
+    if (motor->falhas_ibge == 0) {
+        indice->atualizado = time(NULL);
+        motor->indice_vencido = 0;
+        motor->contadores.revalidacoes++;
+    } else {
+        motor->contadores.revalidacoes_falhas++;
+        motor->revalidar_ibge_apos = agora_ms() + MOTOR_ESPERA_REVALIDACAO_MS;
+    }
+}
+
+static void concluir_revalidacao_ibge(Motor *motor, Transferencia *t, CURLcode resultado) {
+    extrator_json_concluir(&t->extrator);
+    if (resultado != CURLE_OK) {
+        motor->falhas_ibge++;
+    }
+    liberar_transferencia(motor, t);
+    motor->grupos_ibge--;
+    motor->em_segundo_plano--;
+    enviar_revalidacao_ibge(motor);
+}
+
+/* ========================================================================
+   FUNÇÃO: revalidar_caches
+   ========================================================================
+   Chamada a cada consulta submetida: começa a renovar em segundo plano o
+   índice do IBGE ou a tabela de feriados que passou do TTL, se ainda não
+   estiver sendo renovado e se a última tentativa não falhou há pouco. As
+   consultas continuam usando o dado velho até a janela acabar.
+   ======================================================================== */
+static void revalidar_caches(Motor *motor) {
+    IndiceIBGE *indice = motor->cliente->indice_ibge;
+    
+    if (indice && !motor->revalidando_ibge) {
+        EstadoDado estado = indice_ibge_estado(indice, time(NULL));
+        motor->indice_vencido = estado == DADO_VENCIDO;
+        if (motor->revalidar && estado != DADO_FRESCO && agora_ms() >= motor->revalidar_ibge_apos) {
+            motor->revalidando_ibge = 1;
+            motor->proximo_municipio = 0;
+            motor->falhas_ibge = 0;
+            enviar_revalidacao_ibge(motor);
+        }
+    }
+    
+    if (motor->revalidar && !motor->ano_feriados_revalidando &&
+        agora_ms() >= motor->revalidar_feriados_apos) {
+        int ano = cache_feriados_ano_velho(motor->feriados, &motor->hoje);
+        if (ano != 0) {
+            char url[512];
+            Transferencia *t;
+    
+            montar_url_feriados(url, sizeof(url), ano);
+            t = iniciar_transferencia(motor, NULL, ETAPA_FERIADOS, url, prazo_compartilhado(motor),
+                                      PRIORIDADE_REVALIDACAO);
+            if (t) {
+                t->ano = ano;
+                t->revalidacao = 1;
+                motor->ano_feriados_revalidando = ano;
+                motor->em_segundo_plano++;
+            }
+        }
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: disparar_dependentes
+   ========================================================================
+   Com o endereço (e o código IBGE) em mãos, dispara em paralelo as três
+   requisições que dependiam dele.
+   ======================================================================== */
+static void disparar_dependentes(Motor *motor, Consulta *consulta) {
+    IndiceIBGE *indice = motor->cliente->indice_ibge;
+    
+    if (indice && !motor->indice_vencido &&
+        indice_ibge_buscar(indice, consulta->endereco.codigo_ibge, &consulta->ibge)) {
+        if (motor->verboso) {
+            printf("\n[INDICE] Município encontrado no índice do IBGE: %s\n",
+                   consulta->ibge.nome_completo);
+        }
+    } else {
+        disparar_etapa(motor, consulta, ETAPA_MUNICIPIO);
+        if (motor->populacao_por_lote > 0) {
+            agrupar_populacao(motor, consulta);
+        } else {
+            disparar_etapa(motor, consulta, ETAPA_POPULACAO);
+        }
+    }
+    resolver_feriados(motor, consulta);
+}
+
+/* ========================================================================
+   FUNÇÃO: concluir_consulta_se_pronta
+   ========================================================================
+   Junta as etapas paralelas: quando não há mais requisições pendentes,
+   calcula os dados derivados e avisa quem submeteu a consulta.
+   ======================================================================== */
+static void concluir_consulta_se_pronta(Motor *motor, Consulta *consulta) {
+    if (consulta->pendentes > 0) {
+        return;
+    }
+    
+    histograma_registrar(&motor->tempos.consultas, (long)((agora_ms() - consulta->inicio) * 1e3));
+    
+    if (!consulta->erro) {
+        finalizar_dados_municipio(&consulta->ibge);
+    }
+    
+    if (consulta->concluida) {
+        consulta->concluida(consulta, consulta->contexto);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: aplicar_etapa
+   ========================================================================
+   Aplica a uma consulta o resultado de uma etapa cujos campos já estão
+   na consulta. 'estado' é o retorno da extração (ver concluir_endereco).
+   Quando o ViaCEP responde, dispara em paralelo as três requisições que
+   dependem dele. A falha na população é tolerada, como em
+   buscar_dados_municipio.
+   ======================================================================== */
+static void aplicar_etapa(Motor *motor, Consulta *consulta, EtapaConsulta etapa,
+                          CURLcode resultado, int estado) {
+    consulta->pendentes--;
+    
+    if (resultado != CURLE_OK && etapa != ETAPA_POPULACAO) {
+        marcar_erro(consulta, etapa, resultado == CURLE_OPERATION_TIMEDOUT ?
+                    "prazo esgotado" : curl_easy_strerror(resultado));
+        concluir_consulta_se_pronta(motor, consulta);
+        return;
+    }
+    
+    switch (etapa) {
+        case ETAPA_VIACEP:
+            if (estado == CEP_NAO_ENCONTRADO) {
+                if (motor->verboso) {
+                    fprintf(stderr, "[ERRO] CEP não encontrado\n");
+                }
+                marcar_erro(consulta, etapa, "endereço não encontrado");
+                consulta->erro = CONSULTA_NAO_ENCONTRADA;
+                if (motor->cliente->cache_negativo) {
+                    uint32_t numero;
+                    if (cep_valido(consulta->cep, &numero) == 0) {
+                        cache_negativo_gravar(motor->cliente->cache_negativo, numero, time(NULL));
+                    }
+                }
+                break;
+            }
+            if (estado != 0) {
+                marcar_erro(consulta, etapa, "resposta inválida");
+                break;
+            }
+            if (motor->verboso) {
+                printf("[SUCESSO] Endereço encontrado: %s - %s/%s\n",
+                       consulta->endereco.logradouro, consulta->endereco.cidade,
+                       consulta->endereco.uf);
+                printf("Código IBGE: %s\n", consulta->endereco.codigo_ibge);
+            }
+            disparar_dependentes(motor, consulta);
+            break;
+        case ETAPA_MUNICIPIO:
+            if (estado != 0) {
+                marcar_erro(consulta, etapa, "resposta inválida");
+            } else if (motor->verboso) {
+                printf("[SUCESSO] Dados do município obtidos\n");
+            }
+            break;
+        default:
+            break;
+    }
+    
+    concluir_consulta_se_pronta(motor, consulta);
+}
+
+/* ========================================================================
+   FUNÇÃO: copiar_resultado
+   ========================================================================
+   Passa para uma consulta que esperava pela mesma URL os campos que o
+   extrator preencheu na consulta que fez a requisição. Só os campos da
+   etapa: as outras etapas da consulta podem estar em andamento.
+   ======================================================================== */
+static void copiar_resultado(Consulta *destino, const Consulta *origem, EtapaConsulta etapa) {
+    switch (etapa) {
+        case ETAPA_VIACEP:
+            destino->endereco = origem->endereco;
+            break;
+        case ETAPA_MUNICIPIO:
+            memcpy(destino->ibge.nome_completo, origem->ibge.nome_completo, sizeof(destino->ibge.nome_completo));
+            memcpy(destino->ibge.regiao, origem->ibge.regiao, sizeof(destino->ibge.regiao));
+            break;
+        case ETAPA_POPULACAO:
+            destino->ibge.populacao = origem->ibge.populacao;
+            break;
+        default:
+            break;
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: processar_transferencia
+   ========================================================================
+   Conclui a extração da resposta de uma etapa (os campos já foram
+   preenchidos enquanto ela chegava) e aplica o resultado à consulta e
+   às que esperavam pela mesma URL. Downloads da tabela de feriados e
+   grupos de população não pertencem a uma consulta e são tratados à
+   parte.
+   ======================================================================== */
+static void processar_transferencia(Motor *motor, Transferencia *t, CURLcode resultado) {
+    Consulta *consulta = t->consulta;
+    EtapaConsulta etapa = t->etapa;
+    Consulta *seguidores = t->seguidores;
+    int estado = 0;
+    
+    if (resultado == CURLE_OPERATION_TIMEDOUT) {
+        motor->contadores.prazos_esgotados++;
+    }
+    
+    if (!consulta) {
+        if (t->indice) {
+            concluir_revalidacao_ibge(motor, t, resultado);
+        } else if (etapa == ETAPA_POPULACAO) {
+            concluir_grupo_populacao(motor, t, resultado);
+        } else {
+            concluir_download_feriados(motor, t, resultado);
+        }
+        return;
+    }
+    
+    remover_voo(motor, t);
+    t->seguidores = NULL;
+    
+    if (resultado == CURLE_OK) {
+        switch (etapa) {
+            case ETAPA_VIACEP:
+                estado = concluir_endereco(&t->extrator, &consulta->endereco);
+                if (estado == 0 && motor->cliente->cache_cep) {
+                    cache_cep_gravar(motor->cliente->cache_cep, consulta->cep, &consulta->endereco);
+                }
+                break;
+            case ETAPA_MUNICIPIO:
+                estado = concluir_extracao(&t->extrator);
+                break;
+            case ETAPA_POPULACAO:
+                extrator_json_concluir(&t->extrator);
+                break;
+            default:
+                break;
+        }
+    }
+    
+    liberar_transferencia(motor, t);
+    
+    /* Copia antes de aplicar: ao concluir, a consulta pode ser reaproveitada */
+    for (Consulta *c = seguidores; c; c = c->proxima_voo[etapa]) {
+        copiar_resultado(c, consulta, etapa);
+    }
+    
+    aplicar_etapa(motor, consulta, etapa, resultado, estado);
+    
+    while (seguidores) {
+        Consulta *c = seguidores;
+        seguidores = c->proxima_voo[etapa];
+        c->proxima_voo[etapa] = NULL;
+        aplicar_etapa(motor, c, etapa, resultado, estado);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: motor_submeter
+   ========================================================================
+   Inicia uma consulta pela etapa do ViaCEP (ou direto pelas etapas
+   dependentes, se o endereço estiver no cache). CEPs inválidos ou já
+   respondidos como inexistentes terminam aqui, sem requisição.
+   'concluida' é chamada (se não for NULL) quando todas as etapas
+   terminarem, com sucesso ou não.
+   ======================================================================== */
+void motor_submeter(Motor *motor, Consulta *consulta, ConsultaConcluida concluida, void *contexto) {
+    uint32_t numero;
+    
+    cliente_http_travar(motor->cliente);
+    
+    memset(&consulta->endereco, 0, sizeof(consulta->endereco));
+    memset(&consulta->ibge, 0, sizeof(consulta->ibge));
+    memset(&consulta->feriados, 0, sizeof(consulta->feriados));
+    consulta->erro = 0;
+    consulta->motivo = NULL;
+    consulta->pendentes = 0;
+    consulta->concluida = concluida;
+    consulta->contexto = contexto;
+    consulta->inicio = agora_ms();
+    
+    atualizar_hoje(motor);
+    revalidar_caches(motor);
+    
+    int valido = cep_valido(consulta->cep, &numero) == 0;
+    if (valido) {
+        /* Só os dígitos: "01310-100" e "01310100" usam a mesma URL e as
+           mesmas chaves de cache e de requisição em voo */
+        snprintf(consulta->cep, sizeof(consulta->cep), "%08u", (unsigned)numero);
+    }
+    
+    if (!valido) {
+        if (motor->verboso) {
+            fprintf(stderr, "[ERRO] CEP inválido: %s\n", consulta->cep);
+        }
+        marcar_erro(consulta, ETAPA_VIACEP, "CEP inválido");
+        consulta->erro = CONSULTA_CEP_INVALIDO;
+        motor->contadores.ceps_invalidos++;
+    } else if (motor->cliente->cache_negativo &&
+               cache_negativo_contem(motor->cliente->cache_negativo, numero, time(NULL))) {
+        if (motor->verboso) {
+            fprintf(stderr, "[ERRO] CEP não encontrado (cache)\n");
+        }
+        marcar_erro(consulta, ETAPA_VIACEP, "endereço não encontrado");
+        consulta->erro = CONSULTA_NAO_ENCONTRADA;
+        motor->contadores.inexistentes_em_cache++;
+    } else if (motor->cliente->cache_cep &&
+               cache_cep_buscar(motor->cliente->cache_cep, consulta->cep, &consulta->endereco)) {
+        if (motor->verboso) {
+            printf("\n[CACHE] Endereço encontrado no cache local: %s - %s/%s\n",
+                   consulta->endereco.logradouro, consulta->endereco.cidade,
+                   consulta->endereco.uf);
+        }
+        disparar_dependentes(motor, consulta);
+    } else {
+        disparar_etapa(motor, consulta, ETAPA_VIACEP);
+    }
+    concluir_consulta_se_pronta(motor, consulta);
+    
+    cliente_http_destravar(motor->cliente);
+}
+
+/* ========================================================================
+   FUNÇÃO: repetir_transferencia
+   ========================================================================
+   Envia de novo uma transferência que teve falha transitória, se ainda
+   houver tentativas e orçamento. Retorna 1 se ela voltou ao curl_multi.
+   ======================================================================== */
+static int repetir_transferencia(Motor *motor, Transferencia *t) {
+    if (t->tentativas >= HTTP_TENTATIVAS || !cliente_http_falha_transitoria(t->curl, t->resultado)) {
+        return 0;
+    }
+    if (t->prazo > 0 && t->prazo - agora_ms() < HTTP_MIN_REPETIR_MS) {
+        return 0;
+    }
+    
+    metricas_registrar_curl(&motor->metricas[UPSTREAM_ETAPAS[t->etapa]], t->curl, t->resultado);
+    t->parse_ns = 0;
+    resposta_http_resetar(&t->resposta);
+    iniciar_extracao(t);
+    
+    t->tentativas++;
+    motor->contadores.repetidas++;
+    enviar_transferencia(motor, t);
+    return 1;
+}
+
+/* ========================================================================
+   FUNÇÃO: concluir_original
+   ========================================================================
+   Trata o fim de uma transferência que não é duplicata. Se a duplicata
+   dela ainda está em andamento, uma resposta útil a cancela e uma falha
+   espera por ela.
+   ======================================================================== */
+static void concluir_original(Motor *motor, Transferencia *t) {
+    Transferencia *d = t->gemea;
+    
+    if (d) {
+        if (t->resultado != CURLE_OK) {
+            t->aguardando = 1;
+            return;
+        }
+        t->gemea = NULL;
+        cancelar_transferencia(motor, d);
+    }
+    t->prazo_duplicar = 0;
+    
+    if (repetir_transferencia(motor, t)) {
+        return;
+    }
+    processar_transferencia(motor, t, t->resultado);
+}
+
+/* ========================================================================
+   FUNÇÃO: concluir_duplicata
+   ========================================================================
+   Uma duplicata que responde primeiro assume o lugar da original (URL em
+   andamento, consultas à espera) e a resposta acumulada passa pelo
+   extrator como se tivesse chegado pela original. Se falha, a original
+   segue sozinha, ou é concluída se já tinha falhado.
+   ======================================================================== */
+static void concluir_duplicata(Motor *motor, Transferencia *d) {
+    Transferencia *t = d->gemea;
+    
+    t->gemea = NULL;
+    d->gemea = NULL;
+    
+    if (d->resultado != CURLE_OK) {
+        liberar_transferencia(motor, d);
+        if (t->aguardando) {
+            t->aguardando = 0;
+            concluir_original(motor, t);
+        }
+        return;
+    }
+    
+    remover_voo(motor, t);
+    registrar_voo(motor, d);
+    d->seguidores = t->seguidores;
+    d->consulta = t->consulta;
+    d->duplicata = 0;
+    if (t->aguardando) {
+        liberar_transferencia(motor, t);
+    } else {
+        cancelar_transferencia(motor, t);
+    }
+    motor->contadores.duplicadas_vencedoras++;
+    
+    long inicio = metricas_agora_ns();
+    iniciar_extracao(d);
+    extrator_json_alimentar(&d->extrator, d->resposta.data ? d->resposta.data : "", d->resposta.size);
+    d->parse_ns += metricas_agora_ns() - inicio;
+    
+    processar_transferencia(motor, d, d->resultado);
+}
+
+/* ========================================================================
+   FUNÇÃO: duplicar_transferencia
+   ========================================================================
+   Envia uma cópia de uma requisição que passou do p95 do host. A cópia
+   não é repetida nem duplicada de novo. Retorna 1 se ela foi enviada.
+   ======================================================================== */
+static int duplicar_transferencia(Motor *motor, Transferencia *t) {
+    Transferencia *d = obter_transferencia(motor);
+    if (!d) {
+        return 0;
+    }
+    
+    d->consulta = t->consulta;
+    d->etapa = t->etapa;
+    d->prioridade = t->prioridade;
+    d->prazo = t->prazo;
+    d->tentativas = HTTP_TENTATIVAS;
+    d->duplicata = 1;
+    snprintf(d->url, sizeof(d->url), "%s", t->url);
+    d->gemea = t;
+    t->gemea = d;
+    motor->contadores.duplicadas++;
+    
+    curl_easy_setopt(d->curl, CURLOPT_URL, d->url);
+    enviar_transferencia(motor, d);
+    return 1;
+}
+
+/* ========================================================================
+   FUNÇÃO: despachar_fila
+   ========================================================================
+   Envia da fila do host o que o limite dele permite, as interativas
+   primeiro. Uma requisição cujo prazo venceu na fila termina com
+   CURLE_OPERATION_TIMEDOUT sem ir à rede. Retorna em quantos ms o host
+   aceita a próxima, ou -1 se a fila esvaziou ou se ela só anda quando
+   outra requisição do host terminar.
+   ======================================================================== */
+static double despachar_fila(Motor *motor, Upstream upstream) {
+    Limitador *limite = &motor->cliente->limites[upstream];
+    
+    for (;;) {
+        Transferencia *t = NULL;
+    
+        for (int p = 0; p < TOTAL_PRIORIDADES && !t; p++) {
+            t = motor->filas[upstream][p];
+        }
+        if (!t) {
+            return -1;
+        }
+    
+        double agora = agora_ms();
+        int vencida = t->prazo > 0 && agora >= t->prazo;
+        if (!vencida) {
+            double espera = limitador_espera_ms(limite, agora);
+            if (espera != 0) {
+                return espera;
+            }
+        }
+    
+        retirar_da_fila(motor, t);
+        if (!vencida) {
+            iniciar_envio(motor, t, agora);
+        } else if (t->duplicata) {
+            t->resultado = CURLE_OPERATION_TIMEDOUT;
+            concluir_duplicata(motor, t);
+        } else {
+            t->resultado = CURLE_OPERATION_TIMEDOUT;
+            concluir_original(motor, t);
+        }
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: motor_verificar_prazos
+   ========================================================================
+   Envia o que as filas dos hosts já permitem e duplica as requisições
+   que passaram do seu prazo de duplicação. Retorna em quantos ms vence o
+   próximo prazo (0 se acabou de enviar alguma requisição, -1 se não há
+   nenhum), para quem controla a espera do laço de eventos.
+   ======================================================================== */
+static int verificar_prazos(Motor *motor) {
+    long enviadas = motor->enviadas;
+    double proximo = -1;
+    
+    for (int i = 0; i < TOTAL_UPSTREAMS; i++) {
+        double espera = despachar_fila(motor, (Upstream)i);
+        if (espera > 0 && (proximo < 0 || espera < proximo)) {
+            proximo = espera;
+        }
+    }
+    
+    if (motor->cliente->duplicar) {
+        double agora = agora_ms();
+        for (Transferencia *t = motor->alocadas; t; t = t->proxima_alocada) {
+            if (t->prazo_duplicar <= 0) {
+                continue;
+            }
+            if (t->prazo_duplicar <= agora) {
+                t->prazo_duplicar = 0;
+                duplicar_transferencia(motor, t);
+            } else if (proximo < 0 || t->prazo_duplicar - agora < proximo) {
+                proximo = t->prazo_duplicar - agora;
+            }
+        }
+    }
+    
+    if (motor->enviadas != enviadas) {
+        return 0;
+    }
+    return proximo < 0 ? -1 : (int)proximo + 1;
+}
+
+int motor_verificar_prazos(Motor *motor) {
+    int prazo;
+    
+    cliente_http_travar(motor->cliente);
+    prazo = verificar_prazos(motor);
+    cliente_http_destravar(motor->cliente);
+    return prazo;
+}
+
+/* ========================================================================
+   FUNÇÃO: processar_concluidas
+   ========================================================================
+   Retira do curl_multi as transferências que terminaram e as processa.
+   Retorna quantas terminaram.
+   ======================================================================== */
+static int processar_concluidas(Motor *motor) {
+    int concluidas = 0;
+    CURLMsg *msg;
+    int restantes;
+    
+    while ((msg = curl_multi_info_read(motor->multi, &restantes))) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        Transferencia *t;
+        CURL *curl = msg->easy_handle;
+        curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **)&t);
+        t->resultado = cliente_http_resultado(curl, msg->data.result);
+        curl_multi_remove_handle(motor->multi, curl);
+        motor->ativas--;
+        concluidas++;
+    
+        Upstream upstream = UPSTREAM_ETAPAS[t->etapa];
+        limitador_liberar(&motor->cliente->limites[upstream]);
+        cliente_http_avaliar_resposta(motor->cliente, upstream, curl, t->resultado);
+        if (t->duplicata) {
+            concluir_duplicata(motor, t);
+        } else {
+            concluir_original(motor, t);
+        }
+        despachar_fila(motor, upstream);
+    }
+    
+    return concluidas;
+}
+
+/* ========================================================================
+   FUNÇÃO: motor_executar
+   ========================================================================
+   Executa uma rodada do laço: avança as transferências, processa as que
+   terminaram e, se nada terminou, espera até 'espera_ms' por atividade.
+   Envia o grupo de população pendente quando a janela se esgota ou
+   quando não há outra transferência cuja conclusão possa completá-lo,
+   e as duplicatas cujo prazo venceu.
+   Retorna o número de transferências (e grupos) de consultas ainda em
+   andamento; as revalidações em segundo plano não contam, para não
+   segurar quem só espera pelas consultas.
+   
+   A espera em curl_multi_poll pode ser interrompida por outra thread
+   com curl_multi_wakeup (ex.: chegou CEP para um motor do lote paralelo).
+   ======================================================================== */
+int motor_executar(Motor *motor, int espera_ms) {
+    int rodando;
+    int concluidas;
+    int prazo;
+    int esperar;
+    int andamento;
+    
+    /* Rede e extração das respostas, sem a trava do cliente */
+    curl_multi_perform(motor->multi, &rodando);
+    
+    cliente_http_travar(motor->cliente);
+    concluidas = processar_concluidas(motor);
+    verificar_feriados_alheios(motor);
+    if (motor->ano_feriados_alheio != 0 && espera_ms > MOTOR_ESPERA_FERIADOS_MS) {
+        espera_ms = MOTOR_ESPERA_FERIADOS_MS;
+    }
+    
+    prazo = verificar_prazos(motor);
+    if (prazo == 0) {
+        espera_ms = 0;
+    } else if (prazo > 0 && espera_ms > prazo) {
+        espera_ms = prazo;
+    }
+    
+    if (prazo != 0 && motor->espera_populacao) {
+        double restante = motor->janela_populacao_ms - (agora_ms() - motor->inicio_populacao);
+        if (restante <= 0 || motor->ativas + motor->enfileiradas - motor->em_segundo_plano == 0) {
+            enviar_grupo_populacao(motor);
+            espera_ms = 0;
+        } else if (espera_ms > restante) {
+            espera_ms = (int)restante + 1;
+        }
+    }
+    
+    andamento = motor->ativas + motor->enfileiradas - motor->em_segundo_plano + (motor->espera_populacao != NULL);
+    /* Quem chamou pode ter slots para preencher antes de esperar */
+    esperar = concluidas == 0 && (rodando > 0 || motor->enfileiradas > 0 || motor->ano_feriados_alheio != 0) &&
+              espera_ms > 0;
+    cliente_http_destravar(motor->cliente);
+    
+    if (esperar) {
+        curl_multi_poll(motor->multi, NULL, 0, espera_ms, NULL);
+    }
+    
+    return andamento;
+}
+
+/* ========================================================================
+   FUNÇÃO: motor_acao_socket
+   ========================================================================
+   Alternativa a motor_executar para quem já tem um laço de eventos (modo
+   serviço): o laço acompanha os sockets que o curl pede via
+   CURLMOPT_SOCKETFUNCTION/CURLMOPT_TIMERFUNCTION e repassa cada evento
+   (ou CURL_SOCKET_TIMEOUT) para cá. Não bloqueia. O agrupamento de
+   população não é usado neste modo.
+   ======================================================================== */
+void motor_acao_socket(Motor *motor, curl_socket_t socket, int eventos) {
+    int rodando;
+    
+    curl_multi_socket_action(motor->multi, socket, eventos, &rodando);
+    cliente_http_travar(motor->cliente);
+    processar_concluidas(motor);
+    cliente_http_destravar(motor->cliente);
+}
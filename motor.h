@@ -0,0 +1,161 @@
+#ifndef MOTOR_H
+#define MOTOR_H
+
+#include <time.h>
+#include "integrador__apis.h"
+#include "cache_feriados.h"
+#include "metricas.h"
+
+/* Requisições HTTP que compõem uma consulta de CEP */
+typedef enum {
+    ETAPA_VIACEP,
+    ETAPA_MUNICIPIO,
+    ETAPA_POPULACAO,
+    ETAPA_FERIADOS,
+    TOTAL_ETAPAS
+} EtapaConsulta;
+
+/* Ordem de saída das requisições que esperam pelo limite do host */
+typedef enum {
+    PRIORIDADE_INTERATIVA,      /* alguém esperando a resposta (serviço, CEP avulso) */
+    PRIORIDADE_LOTE,
+    PRIORIDADE_REVALIDACAO,     /* renovação em segundo plano de dados velhos */
+    TOTAL_PRIORIDADES
+} PrioridadeConsulta;
+
+/* Valores de Consulta.erro além de 0 */
+#define CONSULTA_FALHOU 1
+#define CONSULTA_NAO_ENCONTRADA 2
+#define CONSULTA_CEP_INVALIDO 3
+
+/* Tempos medidos pelo motor */
+typedef struct {
+    Histograma etapas[TOTAL_ETAPAS];    /* cada requisição (CURLINFO_TOTAL_TIME) */
+    Histograma consultas;               /* da submissão à conclusão de cada CEP */
+} TemposMotor;
+
+/* Contadores do que o motor fez além de uma requisição por etapa */
+typedef struct {
+    long coalescidas[TOTAL_ETAPAS];     /* etapas atendidas por requisição alheia */
+    long duplicadas;                    /* requisições duplicadas após o p95 do host */
+    long duplicadas_vencedoras;         /* duplicatas que responderam primeiro */
+    long repetidas;                     /* novas tentativas após falha transitória */
+    long prazos_esgotados;
+    long ceps_invalidos;                /* recusados pela validação local */
+    long inexistentes_em_cache;         /* respondidos pelo cache de CEPs inexistentes */
+    long revalidacoes;                  /* renovações concluídas de dados velhos */
+    long revalidacoes_falhas;
+} ContadoresMotor;
+
+typedef struct Consulta Consulta;
+typedef void (*ConsultaConcluida)(Consulta *consulta, void *contexto);
+
+/* Uma consulta de CEP e seu resultado integrado */
+struct Consulta {
+    char cep[16];
+    long linha;                 /* marcação livre para quem submeteu */
+    PrioridadeConsulta prioridade;
+    DadosEndereco endereco;
+    DadosIBGE ibge;
+    DadosFeriados feriados;
+    int erro;                   /* 0 em caso de sucesso (ver CONSULTA_*) */
+    EtapaConsulta etapa_erro;
+    const char *motivo;
+    
+    /* Uso interno do motor */
+    int pendentes;
+    double inicio;              /* quando foi submetida (ms); o prazo conta daqui */
+    Consulta *proxima_espera;
+    Consulta *proxima_populacao;
+    Consulta *proxima_voo[TOTAL_ETAPAS];    /* esperando a mesma URL (ver buscar_voo) */
+    ConsultaConcluida concluida;
+    void *contexto;
+};
+
+typedef struct Transferencia Transferencia;
+
+#define MOTOR_BALDES_VOOS 1024  /* potência de 2 */
+
+/* Motor de consultas: conduz as requisições de todas as consultas
+   submetidas em um único curl_multi, respeitando as dependências
+   entre etapas (ver motor.c). Cada motor é usado por uma thread só;
+   vários motores podem dividir um cliente compartilhado. */
+typedef struct {
+    ClienteHTTP *cliente;
+    MetricasUpstream *metricas; /* do cliente ou próprias (uma por thread do lote) */
+    CURLM *multi;
+    int conexoes_limitadas;     /* MOTOR_CONEXOES_POR_HOST em vigor (ver observar_versao) */
+    struct tm hoje;
+    int ano;
+    time_t proximo_dia;         /* quando 'hoje' precisa ser recalculado */
+    int verboso;                /* imprime os avisos [API n] e URL */
+    int ativas;                 /* transferências em andamento */
+    Transferencia *livres;      /* transferências prontas para reuso */
+    Transferencia *alocadas;    /* todas as transferências já criadas */
+    CacheFeriados *feriados;    /* do cliente ou feriados_proprio */
+    CacheFeriados feriados_proprio;
+    Consulta *espera_feriados;  /* consultas esperando a tabela do ano */
+    int ano_feriados_em_andamento;  /* download deste motor */
+    int ano_feriados_alheio;    /* à espera do download de outro motor */
+    
+    /* Agrupamento das consultas de população (0 = uma requisição por CEP) */
+    int populacao_por_lote;     /* máximo de códigos IBGE por requisição */
+    int janela_populacao_ms;    /* espera máxima para completar um grupo */
+    Consulta *espera_populacao; /* consultas do grupo ainda não enviado */
+    int codigos_populacao;      /* códigos distintos no grupo */
+    double inicio_populacao;    /* quando o grupo recebeu a primeira consulta */
+    long requisicoes_populacao;
+    
+    /* Renovação em segundo plano do que passou do TTL (ver revalidar_caches) */
+    int revalidar;              /* 0 = outro motor do mesmo cliente renova */
+    int em_segundo_plano;       /* transferências de revalidação em andamento */
+    int ano_feriados_revalidando;
+    double revalidar_feriados_apos;     /* ms; espera depois de uma falha */
+    int revalidando_ibge;
+    int proximo_municipio;      /* início do próximo grupo de populações a pedir */
+    int grupos_ibge;            /* grupos de populações em andamento */
+    int falhas_ibge;
+    double revalidar_ibge_apos;
+    int indice_vencido;         /* índice além da janela: não é mais servido */
+    
+    /* Requisições esperando pelo limite do host, por prioridade (FIFO) */
+    Transferencia *filas[TOTAL_UPSTREAMS][TOTAL_PRIORIDADES];
+    Transferencia *fins_filas[TOTAL_UPSTREAMS][TOTAL_PRIORIDADES];
+    int enfileiradas;
+    long enviadas;              /* requisições já entregues ao curl_multi */
+    
+    /* Requisições em andamento por URL (singleflight) */
+    Transferencia *voos[MOTOR_BALDES_VOOS];
+    
+    /* Atraso até duplicar uma requisição (p95 do host), recalculado a
+       cada MOTOR_AMOSTRAS_DUPLICAR respostas */
+    long atraso_duplicar_us[TOTAL_UPSTREAMS];
+    long amostras_duplicar[TOTAL_UPSTREAMS];
+    
+    ContadoresMotor contadores;
+    TemposMotor tempos;
+} Motor;
+
+#define MOTOR_POPULACAO_POR_LOTE 100
+#define MOTOR_JANELA_POPULACAO_MS 20
+#define MOTOR_FRACAO_VIACEP 0.5     /* do orçamento da consulta, antes das etapas dependentes */
+#define MOTOR_AMOSTRAS_DUPLICAR 20
+#define MOTOR_REVALIDACOES_SIMULTANEAS 2
+#define MOTOR_ESPERA_REVALIDACAO_MS 60000
+#define MOTOR_ESPERA_FERIADOS_MS 5      /* sono máximo à espera da tabela baixada por outro motor */
+#define MOTOR_FLUXOS_POR_CONEXAO 100    /* streams HTTP/2 simultâneos em uma conexão */
+#define MOTOR_CONEXOES_POR_HOST 4       /* enquanto os hosts responderem em HTTP/2 */
+
+int motor_iniciar(Motor *motor, ClienteHTTP *cliente);
+void motor_finalizar(Motor *motor);
+void motor_submeter(Motor *motor, Consulta *consulta, ConsultaConcluida concluida, void *contexto);
+int motor_executar(Motor *motor, int espera_ms);
+int motor_verificar_prazos(Motor *motor);
+void motor_acao_socket(Motor *motor, curl_socket_t socket, int eventos);
+const char *nome_etapa(EtapaConsulta etapa);
+void motor_imprimir_tempos(FILE *saida, const char *prefixo, const TemposMotor *tempos);
+void motor_imprimir_contadores(FILE *saida, const char *prefixo, const ContadoresMotor *contadores);
+void motor_juntar_tempos(TemposMotor *destino, const TemposMotor *origem);
+void motor_juntar_contadores(ContadoresMotor *destino, const ContadoresMotor *origem);
+
+#endif
@@ -0,0 +1,345 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cache_cep.h"
+#include "resultados.h"
+
+/* ========================================================================
+   RESULTADOS COMPACTOS
+   ========================================================================
+   Uma Consulta carrega o resultado em structs de campos char[] de
+   tamanho fixo (mais de 1 KB por CEP, quase tudo preenchimento). Para
+   guardar milhões de resultados (ex.: saída na ordem da entrada), cada
+   campo vira uma coluna: números para CEP e código IBGE, e deslocamentos
+   de 32 bits em uma arena para os textos. Cidade, bairro, UF, região e
+   feriado se repetem muito entre CEPs e são guardados uma vez só.
+   
+   resultados_ler remonta uma Consulta com os campos guardados para os
+   mesmos escritores de saída (área e densidade são recalculadas por
+   finalizar_dados_municipio, como no motor).
+   ======================================================================== */
+
+#define ARENA_CAPACIDADE_INICIAL 4096
+#define ARENA_BALDES_INICIAIS 1024
+#define RESULTADOS_CAPACIDADE_INICIAL 1024
+
+/* FNV-1a */
+static uint32_t espalhar_texto(const char *texto, size_t tamanho) {
+    uint32_t h = 2166136261u;
+    
+    for (size_t i = 0; i < tamanho; i++) {
+        h ^= (unsigned char)texto[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void arena_iniciar(ArenaTextos *arena) {
+    memset(arena, 0, sizeof(*arena));
+}
+
+static void arena_finalizar(ArenaTextos *arena) {
+    free(arena->dados);
+    free(arena->baldes);
+    memset(arena, 0, sizeof(*arena));
+}
+
+/* Balde do texto, ou o balde vazio onde ele entraria */
+static uint32_t *sondar_texto(const ArenaTextos *arena, uint32_t *baldes, uint32_t total,
+                              const char *texto, size_t tamanho) {
+    uint32_t i = espalhar_texto(texto, tamanho) & (total - 1);
+    
+    while (baldes[i] != 0) {
+        const char *guardado = arena->dados + baldes[i];
+        if (strncmp(guardado, texto, tamanho) == 0 && guardado[tamanho] == '\0') {
+            break;
+        }
+        i = (i + 1) & (total - 1);
+    }
+    return &baldes[i];
+}
+
+/* ========================================================================
+   FUNÇÃO: arena_crescer_baldes
+   ========================================================================
+   Dobra a tabela de baldes (ou a cria), reinserindo os textos.
+   Retorna 0 em caso de sucesso e -1 se faltar memória.
+   ======================================================================== */
+static int arena_crescer_baldes(ArenaTextos *arena) {
+    uint32_t total = arena->total_baldes ? arena->total_baldes * 2 : ARENA_BALDES_INICIAIS;
+    uint32_t *baldes = calloc(total, sizeof(uint32_t));
+    
+    if (!baldes) {
+        return -1;
+    }
+    
+    for (uint32_t i = 0; i < arena->total_baldes; i++) {
+        uint32_t deslocamento = arena->baldes[i];
+        if (deslocamento != 0) {
+            const char *texto = arena->dados + deslocamento;
+            *sondar_texto(arena, baldes, total, texto, strlen(texto)) = deslocamento;
+        }
+    }
+    
+    free(arena->baldes);
+    arena->baldes = baldes;
+    arena->total_baldes = total;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: arena_internar
+   ========================================================================
+   Retorna o deslocamento de 'texto' na arena, guardando-o se ainda não
+   estiver lá (0 para o texto vazio), ou UINT32_MAX se faltar memória.
+   ======================================================================== */
+static uint32_t arena_internar(ArenaTextos *arena, const char *texto) {
+    size_t tamanho = strlen(texto);
+    uint32_t *balde;
+    
+    if (tamanho == 0) {
+        return 0;
+    }
+    
+    if ((arena->quantidade + 1) * 2 > arena->total_baldes && arena_crescer_baldes(arena) != 0) {
+        return UINT32_MAX;
+    }
+    
+    balde = sondar_texto(arena, arena->baldes, arena->total_baldes, texto, tamanho);
+    if (*balde != 0) {
+        return *balde;
+    }
+    
+    /* O deslocamento 0 é o texto vazio, sempre no início dos dados */
+    if (arena->tamanho + tamanho + 1 > arena->capacidade) {
+        size_t capacidade = arena->capacidade ? arena->capacidade : ARENA_CAPACIDADE_INICIAL;
+        while (arena->tamanho + tamanho + 1 > capacidade) {
+            capacidade *= 2;
+        }
+        if (capacidade > UINT32_MAX) {
+            return UINT32_MAX;
+        }
+        char *dados = realloc(arena->dados, capacidade);
+        if (!dados) {
+            return UINT32_MAX;
+        }
+        if (!arena->dados) {
+            dados[0] = '\0';
+            arena->tamanho = 1;
+        }
+        arena->dados = dados;
+        arena->capacidade = capacidade;
+    }
+    
+    uint32_t deslocamento = (uint32_t)arena->tamanho;
+    memcpy(arena->dados + deslocamento, texto, tamanho + 1);
+    arena->tamanho += tamanho + 1;
+    arena->quantidade++;
+    *balde = deslocamento;
+    return deslocamento;
+}
+
+static const char *arena_texto(const ArenaTextos *arena, uint32_t deslocamento) {
+    return deslocamento ? arena->dados + deslocamento : "";
+}
+
+void resultados_iniciar(Resultados *r) {
+    memset(r, 0, sizeof(*r));
+    arena_iniciar(&r->textos);
+}
+
+void resultados_finalizar(Resultados *r) {
+    free(r->linha);
+    free(r->erro);
+    free(r->etapa_erro);
+    free(r->cep);
+    free(r->logradouro);
+    free(r->bairro);
+    free(r->cidade);
+    free(r->uf);
+    free(r->codigo_ibge);
+    free(r->municipio);
+    free(r->regiao);
+    free(r->populacao);
+    free(r->quantidade_feriados);
+    free(r->proximo_feriado);
+    free(r->data_feriado);
+    free(r->tipo_feriado);
+    arena_finalizar(&r->textos);
+    memset(r, 0, sizeof(*r));
+}
+
+static int crescer_coluna(void **coluna, size_t tamanho_item, long capacidade) {
+    void *nova = realloc(*coluna, tamanho_item * (size_t)capacidade);
+    
+    if (!nova) {
+        return -1;
+    }
+    *coluna = nova;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: crescer_resultados
+   ========================================================================
+   Dobra a capacidade de todas as colunas. Uma coluna que já cresceu
+   quando outra falhou só fica maior que o necessário.
+   ======================================================================== */
+static int crescer_resultados(Resultados *r) {
+    long capacidade = r->capacidade ? r->capacidade * 2 : RESULTADOS_CAPACIDADE_INICIAL;
+    
+    if (crescer_coluna((void **)&r->linha, sizeof(*r->linha), capacidade) != 0 ||
+        crescer_coluna((void **)&r->erro, sizeof(*r->erro), capacidade) != 0 ||
+        crescer_coluna((void **)&r->etapa_erro, sizeof(*r->etapa_erro), capacidade) != 0 ||
+        crescer_coluna((void **)&r->cep, sizeof(*r->cep), capacidade) != 0 ||
+        crescer_coluna((void **)&r->logradouro, sizeof(*r->logradouro), capacidade) != 0 ||
+        crescer_coluna((void **)&r->bairro, sizeof(*r->bairro), capacidade) != 0 ||
+        crescer_coluna((void **)&r->cidade, sizeof(*r->cidade), capacidade) != 0 ||
+        crescer_coluna((void **)&r->uf, sizeof(*r->uf), capacidade) != 0 ||
+        crescer_coluna((void **)&r->codigo_ibge, sizeof(*r->codigo_ibge), capacidade) != 0 ||
+        crescer_coluna((void **)&r->municipio, sizeof(*r->municipio), capacidade) != 0 ||
+        crescer_coluna((void **)&r->regiao, sizeof(*r->regiao), capacidade) != 0 ||
+        crescer_coluna((void **)&r->populacao, sizeof(*r->populacao), capacidade) != 0 ||
+        crescer_coluna((void **)&r->quantidade_feriados, sizeof(*r->quantidade_feriados), capacidade) != 0 ||
+        crescer_coluna((void **)&r->proximo_feriado, sizeof(*r->proximo_feriado), capacidade) != 0 ||
+        crescer_coluna((void **)&r->data_feriado, sizeof(*r->data_feriado), capacidade) != 0 ||
+        crescer_coluna((void **)&r->tipo_feriado, sizeof(*r->tipo_feriado), capacidade) != 0) {
+        return -1;
+    }
+    
+    r->capacidade = capacidade;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: resultados_adicionar
+   ========================================================================
+   Guarda o resultado de uma consulta concluída. Retorna 0 em caso de
+   sucesso e -1 se faltar memória.
+   ======================================================================== */
+int resultados_adicionar(Resultados *r, const Consulta *consulta) {
+    ArenaTextos *textos = &r->textos;
+    long i = r->quantidade;
+    uint32_t numero = 0;
+    
+    if (i == r->capacidade && crescer_resultados(r) != 0) {
+        return -1;
+    }
+    
+    r->linha[i] = (uint32_t)consulta->linha;
+    r->erro[i] = (uint8_t)consulta->erro;
+    r->etapa_erro[i] = (uint8_t)consulta->etapa_erro;
+    
+    if (consulta->erro) {
+        r->cep[i] = arena_internar(textos, consulta->cep);
+        r->logradouro[i] = arena_internar(textos, consulta->motivo ? consulta->motivo : "");
+        r->bairro[i] = r->cidade[i] = r->uf[i] = r->municipio[i] = r->regiao[i] = 0;
+        r->proximo_feriado[i] = r->data_feriado[i] = r->tipo_feriado[i] = 0;
+        r->codigo_ibge[i] = 0;
+        r->populacao[i] = 0;
+        r->quantidade_feriados[i] = 0;
+    } else {
+        if (cep_para_numero(consulta->endereco.cep, &numero) != 0) {
+            cep_valido(consulta->cep, &numero);
+        }
+        r->cep[i] = numero;
+        r->logradouro[i] = arena_internar(textos, consulta->endereco.logradouro);
+        r->bairro[i] = arena_internar(textos, consulta->endereco.bairro);
+        r->cidade[i] = arena_internar(textos, consulta->endereco.cidade);
+        r->uf[i] = arena_internar(textos, consulta->endereco.uf);
+        r->codigo_ibge[i] = (uint32_t)strtoul(consulta->endereco.codigo_ibge, NULL, 10);
+        r->municipio[i] = arena_internar(textos, consulta->ibge.nome_completo);
+        r->regiao[i] = arena_internar(textos, consulta->ibge.regiao);
+        r->populacao[i] = consulta->ibge.populacao;
+        r->quantidade_feriados[i] = (uint8_t)consulta->feriados.quantidade_feriados;
+        r->proximo_feriado[i] = arena_internar(textos, consulta->feriados.proximo_feriado);
+        r->data_feriado[i] = arena_internar(textos, consulta->feriados.data_feriado);
+        r->tipo_feriado[i] = arena_internar(textos, consulta->feriados.tipo_feriado);
+    }
+    
+    if (r->cep[i] == UINT32_MAX || r->logradouro[i] == UINT32_MAX || r->bairro[i] == UINT32_MAX ||
+        r->cidade[i] == UINT32_MAX || r->uf[i] == UINT32_MAX || r->municipio[i] == UINT32_MAX ||
+        r->regiao[i] == UINT32_MAX || r->proximo_feriado[i] == UINT32_MAX ||
+        r->data_feriado[i] == UINT32_MAX || r->tipo_feriado[i] == UINT32_MAX) {
+        return -1;
+    }
+    
+    r->quantidade++;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: resultados_ler
+   ========================================================================
+   Remonta em 'consulta' o resultado 'i' com os campos guardados. O
+   motivo de erro aponta para a arena e vale enquanto 'r' existir.
+   ======================================================================== */
+void resultados_ler(const Resultados *r, long i, Consulta *consulta) {
+    const ArenaTextos *textos = &r->textos;
+    
+    memset(&consulta->endereco, 0, sizeof(consulta->endereco));
+    memset(&consulta->ibge, 0, sizeof(consulta->ibge));
+    memset(&consulta->feriados, 0, sizeof(consulta->feriados));
+    consulta->linha = r->linha[i];
+    consulta->erro = r->erro[i];
+    consulta->etapa_erro = (EtapaConsulta)r->etapa_erro[i];
+    consulta->motivo = NULL;
+    
+    if (consulta->erro) {
+        snprintf(consulta->cep, sizeof(consulta->cep), "%s", arena_texto(textos, r->cep[i]));
+        consulta->motivo = arena_texto(textos, r->logradouro[i]);
+        return;
+    }
+    
+    snprintf(consulta->cep, sizeof(consulta->cep), "%08u", (unsigned)r->cep[i]);
+    snprintf(consulta->endereco.cep, sizeof(consulta->endereco.cep), "%05u-%03u",
+             (unsigned)(r->cep[i] / 1000), (unsigned)(r->cep[i] % 1000));
+    snprintf(consulta->endereco.logradouro, sizeof(consulta->endereco.logradouro), "%s",
+             arena_texto(textos, r->logradouro[i]));
+    snprintf(consulta->endereco.bairro, sizeof(consulta->endereco.bairro), "%s",
+             arena_texto(textos, r->bairro[i]));
+    snprintf(consulta->endereco.cidade, sizeof(consulta->endereco.cidade), "%s",
+             arena_texto(textos, r->cidade[i]));
+    snprintf(consulta->endereco.uf, sizeof(consulta->endereco.uf), "%s", arena_texto(textos, r->uf[i]));
+    if (r->codigo_ibge[i] != 0) {
+        snprintf(consulta->endereco.codigo_ibge, sizeof(consulta->endereco.codigo_ibge), "%u",
+                 (unsigned)r->codigo_ibge[i]);
+    }
+    snprintf(consulta->ibge.nome_completo, sizeof(consulta->ibge.nome_completo), "%s",
+             arena_texto(textos, r->municipio[i]));
+    snprintf(consulta->ibge.regiao, sizeof(consulta->ibge.regiao), "%s", arena_texto(textos, r->regiao[i]));
+    consulta->ibge.populacao = r->populacao[i];
+    finalizar_dados_municipio(&consulta->ibge);
+    consulta->feriados.quantidade_feriados = r->quantidade_feriados[i];
+    snprintf(consulta->feriados.proximo_feriado, sizeof(consulta->feriados.proximo_feriado), "%s",
+             arena_texto(textos, r->proximo_feriado[i]));
+    snprintf(consulta->feriados.data_feriado, sizeof(consulta->feriados.data_feriado), "%s",
+             arena_texto(textos, r->data_feriado[i]));
+    snprintf(consulta->feriados.tipo_feriado, sizeof(consulta->feriados.tipo_feriado), "%s",
+             arena_texto(textos, r->tipo_feriado[i]));
+}
+
+/* ========================================================================
+   FUNÇÃO: resultados_memoria
+   ========================================================================
+   Bytes alocados pelas colunas e pela arena (inclusive a folga das
+   capacidades), para comparar com resultados_memoria_structs.
+   ======================================================================== */
+size_t resultados_memoria(const Resultados *r) {
+    size_t por_resultado = sizeof(*r->linha) + sizeof(*r->erro) + sizeof(*r->etapa_erro) +
+                           sizeof(*r->cep) + sizeof(*r->logradouro) + sizeof(*r->bairro) +
+                           sizeof(*r->cidade) + sizeof(*r->uf) + sizeof(*r->codigo_ibge) +
+                           sizeof(*r->municipio) + sizeof(*r->regiao) + sizeof(*r->populacao) +
+                           sizeof(*r->quantidade_feriados) +
+                           sizeof(*r->proximo_feriado) + sizeof(*r->data_feriado) +
+                           sizeof(*r->tipo_feriado);
+    
+    return (size_t)r->capacidade * por_resultado + r->textos.capacidade +
+           (size_t)r->textos.total_baldes * sizeof(uint32_t);
+}
+
+/* Bytes para guardar 'quantidade' resultados nas structs da Consulta */
+size_t resultados_memoria_structs(long quantidade) {
+    return (size_t)quantidade * (sizeof(long) + sizeof(DadosEndereco) + sizeof(DadosIBGE) +
+                                 sizeof(DadosFeriados));
+}
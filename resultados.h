@@ -0,0 +1,54 @@
+#ifndef RESULTADOS_H
+#define RESULTADOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "motor.h"
+
+/* Textos guardados uma única vez: cada texto é um deslocamento em
+   'dados' (0 = texto vazio), e uma tabela hash de deslocamentos encontra
+   o texto igual já guardado */
+typedef struct {
+    char *dados;
+    size_t tamanho;
+    size_t capacidade;
+    uint32_t *baldes;           /* deslocamentos; 0 = balde vazio */
+    uint32_t total_baldes;      /* potência de 2 */
+    uint32_t quantidade;        /* textos distintos */
+} ArenaTextos;
+
+/* Resultados de um lote guardados em memória, uma coluna por campo.
+   Os textos repetidos (cidade, bairro, UF, região, feriado...) ficam na
+   arena; CEP e código IBGE são números. */
+typedef struct {
+    long quantidade;
+    long capacidade;
+    
+    uint32_t *linha;
+    uint8_t *erro;              /* Consulta.erro */
+    uint8_t *etapa_erro;
+    uint32_t *cep;              /* numérico; com erro, o texto de entrada na arena */
+    uint32_t *logradouro;       /* com erro, o motivo */
+    uint32_t *bairro;
+    uint32_t *cidade;
+    uint32_t *uf;
+    uint32_t *codigo_ibge;      /* numérico */
+    uint32_t *municipio;
+    uint32_t *regiao;
+    int32_t *populacao;
+    uint8_t *quantidade_feriados;
+    uint32_t *proximo_feriado;
+    uint32_t *data_feriado;
+    uint32_t *tipo_feriado;
+    
+    ArenaTextos textos;
+} Resultados;
+
+void resultados_iniciar(Resultados *r);
+void resultados_finalizar(Resultados *r);
+int resultados_adicionar(Resultados *r, const Consulta *consulta);
+void resultados_ler(const Resultados *r, long i, Consulta *consulta);
+size_t resultados_memoria(const Resultados *r);
+size_t resultados_memoria_structs(long quantidade);
+
+#endif
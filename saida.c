@@ -0,0 +1,359 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "saida.h"
+
+/* ========================================================================
+   SAÍDA EM LOTE
+   ========================================================================
+   Um registro por consulta, em um de quatro formatos:
+   
+   - TSV: linha, OK, cep, logradouro, bairro, cidade, uf, código IBGE,
+     região, população, próximo feriado, data do feriado; ou linha, ERRO,
+     cep, etapa, motivo.
+   - NDJSON: um objeto por linha, com os mesmos campos do modo serviço
+     mais "linha"; as falhas têm "erro": {"etapa", "motivo"}.
+   - CSV: cabeçalho e uma linha por consulta (RFC 4180, aspas só quando
+     preciso); etapa e motivo ficam vazios nas consultas com sucesso.
+   - Binário: o arquivo começa com SAIDA_MAGICO_BINARIO (8 bytes). Cada
+     registro é um u32 com o tamanho do restante do registro, seguido de
+     u32 linha, u8 erro (0 = sucesso, ver CONSULTA_*), u8 etapa do erro,
+     i32 população e 12 textos, cada um como u16 tamanho + bytes (sem
+     '\0'): cep, logradouro, bairro, cidade, uf, código IBGE, município,
+     região, próximo feriado, data, tipo do feriado e motivo do erro.
+     Inteiros em little-endian.
+   
+   Os registros são montados direto no buffer, que vai para o descritor
+   com um único write() quando falta folga para o próximo registro (ou
+   ao final), em vez de uma chamada de stdio por campo.
+   ======================================================================== */
+
+static const char *NOMES_FORMATOS[TOTAL_FORMATOS_SAIDA] = { "tsv", "ndjson", "csv", "binario" };
+
+#define SAIDA_CABECALHO_CSV "linha,status,cep,logradouro,bairro,cidade,uf,codigo_ibge,municipio," \
+                            "regiao,populacao,proximo_feriado,data_feriado,etapa_erro,motivo\n"
+
+/* ========================================================================
+   FUNÇÃO: saida_formato
+   ========================================================================
+   Converte o nome de um formato ("tsv", "ndjson", "csv" ou "binario").
+   Retorna 0 em caso de sucesso e -1 se o nome for desconhecido.
+   ======================================================================== */
+int saida_formato(const char *nome, FormatoSaida *formato) {
+    for (int i = 0; i < TOTAL_FORMATOS_SAIDA; i++) {
+        if (strcmp(nome, NOMES_FORMATOS[i]) == 0) {
+            *formato = (FormatoSaida)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* ========================================================================
+   FUNÇÃO: saida_texto_json
+   ========================================================================
+   Escreve uma string JSON (com aspas e escapes) em 'destino'. Retorna o
+   número de bytes escritos, sem passar de 'tamanho'.
+   ======================================================================== */
+size_t saida_texto_json(char *destino, size_t tamanho, const char *texto) {
+    size_t n = 0;
+    
+    if (tamanho < 3) {
+        return 0;
+    }
+    
+    destino[n++] = '"';
+    for (const unsigned char *p = (const unsigned char *)texto; *p && n + 8 < tamanho; p++) {
+        if (*p == '"' || *p == '\\') {
+            destino[n++] = '\\';
+            destino[n++] = (char)*p;
+        } else if (*p < 0x20) {
+            n += snprintf(destino + n, tamanho - n, "\\u%04x", *p);
+        } else {
+            destino[n++] = (char)*p;
+        }
+    }
+    destino[n++] = '"';
+    destino[n] = '\0';
+    
+    return n;
+}
+
+/* Campos JSON de uma consulta com sucesso, sem as chaves do objeto */
+static size_t campos_json(const Consulta *consulta, char *corpo, size_t tamanho) {
+    const DadosEndereco *e = &consulta->endereco;
+    const DadosIBGE *m = &consulta->ibge;
+    const DadosFeriados *f = &consulta->feriados;
+    size_t n = 0;
+    
+#define TEXTO(separador, chave, valor) \
+    n += snprintf(corpo + n, tamanho - n, separador "\"" chave "\":"); \
+    n += saida_texto_json(corpo + n, tamanho - n, valor)
+    
+    TEXTO("", "cep", e->cep);
+    TEXTO(",", "logradouro", e->logradouro);
+    TEXTO(",", "bairro", e->bairro);
+    TEXTO(",", "cidade", e->cidade);
+    TEXTO(",", "uf", e->uf);
+    TEXTO(",", "codigo_ibge", e->codigo_ibge);
+    n += snprintf(corpo + n, tamanho - n, ",\"municipio\":{");
+    TEXTO("", "nome", m->nome_completo);
+    TEXTO(",", "regiao", m->regiao);
+    n += snprintf(corpo + n, tamanho - n, ",\"populacao\":%d,\"area_km2\":%.2f,\"densidade\":%.2f}",
+                  m->populacao, m->area, m->densidade);
+    n += snprintf(corpo + n, tamanho - n, ",\"feriados\":{\"quantidade\":%d,\"proximo\":{",
+                  f->quantidade_feriados);
+    TEXTO("", "nome", f->proximo_feriado);
+    TEXTO(",", "data", f->data_feriado);
+    TEXTO(",", "tipo", f->tipo_feriado);
+    n += snprintf(corpo + n, tamanho - n, "}}");
+    
+#undef TEXTO
+    
+    return n < tamanho ? n : tamanho - 1;
+}
+
+/* ========================================================================
+   FUNÇÃO: saida_consulta_json
+   ========================================================================
+   Monta o JSON de uma consulta concluída com sucesso (modo serviço e
+   NDJSON).
+   ======================================================================== */
+size_t saida_consulta_json(const Consulta *consulta, char *corpo, size_t tamanho) {
+    size_t n = 0;
+    
+    corpo[n++] = '{';
+    n += campos_json(consulta, corpo + n, tamanho - n - 1);
+    corpo[n++] = '}';
+    corpo[n] = '\0';
+    return n;
+}
+
+/* Um campo CSV, entre aspas (com aspas dobradas) só se precisar */
+static size_t campo_csv(char *destino, size_t tamanho, const char *texto) {
+    size_t n = 0;
+    
+    if (!strpbrk(texto, ",\"\r\n")) {
+        n = strlen(texto);
+        if (n >= tamanho) {
+            n = tamanho - 1;
+        }
+        memcpy(destino, texto, n);
+        return n;
+    }
+    
+    destino[n++] = '"';
+    for (const char *p = texto; *p && n + 3 < tamanho; p++) {
+        if (*p == '"') {
+            destino[n++] = '"';
+        }
+        destino[n++] = *p;
+    }
+    destino[n++] = '"';
+    return n;
+}
+
+static size_t escrever_csv(const Consulta *consulta, char *destino, size_t tamanho) {
+    const DadosEndereco *e = &consulta->endereco;
+    const char *textos[] = {
+        consulta->erro ? consulta->cep : e->cep, e->logradouro, e->bairro, e->cidade, e->uf,
+        e->codigo_ibge, consulta->ibge.nome_completo, consulta->ibge.regiao
+    };
+    size_t n = 0;
+    
+    n += snprintf(destino, tamanho, "%ld,%s", consulta->linha, consulta->erro ? "ERRO" : "OK");
+    for (size_t i = 0; i < sizeof(textos) / sizeof(textos[0]); i++) {
+        destino[n++] = ',';
+        n += campo_csv(destino + n, tamanho - n, textos[i]);
+    }
+    n += snprintf(destino + n, tamanho - n, ",%d,", consulta->ibge.populacao);
+    n += campo_csv(destino + n, tamanho - n, consulta->feriados.proximo_feriado);
+    destino[n++] = ',';
+    n += campo_csv(destino + n, tamanho - n, consulta->feriados.data_feriado);
+    destino[n++] = ',';
+    if (consulta->erro) {
+        n += campo_csv(destino + n, tamanho - n, nome_etapa(consulta->etapa_erro));
+        destino[n++] = ',';
+        n += campo_csv(destino + n, tamanho - n, consulta->motivo ? consulta->motivo : "");
+    } else {
+        destino[n++] = ',';
+    }
+    destino[n++] = '\n';
+    return n;
+}
+
+static size_t escrever_u32(unsigned char *destino, uint32_t valor) {
+    destino[0] = (unsigned char)valor;
+    destino[1] = (unsigned char)(valor >> 8);
+    destino[2] = (unsigned char)(valor >> 16);
+    destino[3] = (unsigned char)(valor >> 24);
+    return 4;
+}
+
+static size_t escrever_texto_binario(unsigned char *destino, const char *texto) {
+    size_t tamanho = strlen(texto);
+    
+    if (tamanho > UINT16_MAX) {
+        tamanho = UINT16_MAX;
+    }
+    destino[0] = (unsigned char)tamanho;
+    destino[1] = (unsigned char)(tamanho >> 8);
+    memcpy(destino + 2, texto, tamanho);
+    return tamanho + 2;
+}
+
+/* Os campos de texto da Consulta são limitados (char[] de até 256 bytes),
+   então um registro sempre cabe em SAIDA_MAIOR_REGISTRO */
+static size_t escrever_binario(const Consulta *consulta, unsigned char *destino) {
+    const DadosEndereco *e = &consulta->endereco;
+    const DadosFeriados *f = &consulta->feriados;
+    const char *textos[] = {
+        consulta->erro ? consulta->cep : e->cep, e->logradouro, e->bairro, e->cidade, e->uf,
+        e->codigo_ibge, consulta->ibge.nome_completo, consulta->ibge.regiao,
+        f->proximo_feriado, f->data_feriado, f->tipo_feriado,
+        consulta->erro && consulta->motivo ? consulta->motivo : ""
+    };
+    size_t n = 4;
+    
+    n += escrever_u32(destino + n, (uint32_t)consulta->linha);
+    destino[n++] = (unsigned char)consulta->erro;
+    destino[n++] = (unsigned char)(consulta->erro ? consulta->etapa_erro : 0);
+    n += escrever_u32(destino + n, (uint32_t)consulta->ibge.populacao);
+    for (size_t i = 0; i < sizeof(textos) / sizeof(textos[0]); i++) {
+        n += escrever_texto_binario(destino + n, textos[i]);
+    }
+    
+    escrever_u32(destino, (uint32_t)(n - 4));
+    return n;
+}
+
+static void acrescentar(Saida *s, const char *dados, size_t tamanho) {
+    memcpy(s->buffer + s->tamanho, dados, tamanho);
+    s->tamanho += tamanho;
+}
+
+/* ========================================================================
+   FUNÇÃO: saida_iniciar
+   ========================================================================
+   Prepara a saída em 'fd' e acrescenta o cabeçalho do formato (CSV e
+   binário). Retorna 0 em caso de sucesso e -1 se faltar memória.
+   ======================================================================== */
+int saida_iniciar(Saida *s, int fd, FormatoSaida formato) {
+    memset(s, 0, sizeof(*s));
+    s->fd = fd;
+    s->formato = formato;
+    s->buffer = malloc(SAIDA_TAMANHO_BUFFER);
+    if (!s->buffer) {
+        fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+        return -1;
+    }
+    s->capacidade = SAIDA_TAMANHO_BUFFER;
+    
+    if (formato == SAIDA_CSV) {
+        acrescentar(s, SAIDA_CABECALHO_CSV, strlen(SAIDA_CABECALHO_CSV));
+    } else if (formato == SAIDA_BINARIO) {
+        acrescentar(s, SAIDA_MAGICO_BINARIO, strlen(SAIDA_MAGICO_BINARIO));
+    }
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: saida_consulta
+   ========================================================================
+   Acrescenta o registro de uma consulta concluída, descarregando antes
+   se o buffer não tiver folga para o maior registro possível.
+   ======================================================================== */
+void saida_consulta(Saida *s, const Consulta *consulta) {
+    char *destino;
+    size_t livre;
+    size_t n = 0;
+    
+    if (s->capacidade - s->tamanho < SAIDA_MAIOR_REGISTRO) {
+        saida_descarregar(s);
+    }
+    destino = s->buffer + s->tamanho;
+    livre = s->capacidade - s->tamanho;
+    
+    switch (s->formato) {
+        case SAIDA_TSV:
+            if (consulta->erro) {
+                n = snprintf(destino, livre, "%ld\tERRO\t%s\t%s\t%s\n", consulta->linha, consulta->cep,
+                             nome_etapa(consulta->etapa_erro), consulta->motivo);
+            } else {
+                const DadosEndereco *e = &consulta->endereco;
+                n = snprintf(destino, livre, "%ld\tOK\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%d\t%s\t%s\n",
+                             consulta->linha, e->cep, e->logradouro, e->bairro, e->cidade, e->uf,
+                             e->codigo_ibge, consulta->ibge.regiao, consulta->ibge.populacao,
+                             consulta->feriados.proximo_feriado, consulta->feriados.data_feriado);
+            }
+            break;
+        case SAIDA_NDJSON:
+            n = snprintf(destino, livre, "{\"linha\":%ld,", consulta->linha);
+            if (consulta->erro) {
+                n += snprintf(destino + n, livre - n, "\"cep\":");
+                n += saida_texto_json(destino + n, livre - n, consulta->cep);
+                n += snprintf(destino + n, livre - n, ",\"erro\":{\"etapa\":\"%s\",\"motivo\":",
+                              nome_etapa(consulta->etapa_erro));
+                n += saida_texto_json(destino + n, livre - n, consulta->motivo ? consulta->motivo : "");
+                n += snprintf(destino + n, livre - n, "}}\n");
+            } else {
+                n += campos_json(consulta, destino + n, livre - n);
+                n += snprintf(destino + n, livre - n, "}\n");
+            }
+            break;
+        case SAIDA_CSV:
+            n = escrever_csv(consulta, destino, livre);
+            break;
+        case SAIDA_BINARIO:
+            n = escrever_binario(consulta, (unsigned char *)destino);
+            break;
+        default:
+            break;
+    }
+    
+    s->tamanho += n < livre ? n : livre;
+    s->registros++;
+}
+
+/* ========================================================================
+   FUNÇÃO: saida_descarregar
+   ========================================================================
+   Envia o buffer ao descritor: um write() quando o descritor aceita
+   tudo de uma vez, mais alguns se a escrita for parcial (pipes).
+   Retorna 0 em caso de sucesso e -1 se a escrita falhar.
+   ======================================================================== */
+int saida_descarregar(Saida *s) {
+    size_t enviado = 0;
+    
+    while (enviado < s->tamanho && !s->erro) {
+        ssize_t n = write(s->fd, s->buffer + enviado, s->tamanho - enviado);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("[ERRO] Falha ao escrever a saída");
+            s->erro = 1;
+            break;
+        }
+        s->escritas++;
+        enviado += (size_t)n;
+    }
+    
+    s->bytes += enviado;
+    s->tamanho = 0;
+    return s->erro ? -1 : 0;
+}
+
+/* Descarrega o que restou e libera o buffer. Retorna -1 se alguma
+   escrita falhou */
+int saida_finalizar(Saida *s) {
+    int ret = saida_descarregar(s);
+    
+    free(s->buffer);
+    s->buffer = NULL;
+    s->capacidade = 0;
+    return ret;
+}
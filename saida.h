@@ -0,0 +1,43 @@
+#ifndef SAIDA_H
+#define SAIDA_H
+
+#include <stddef.h>
+#include "motor.h"
+
+/* Formatos de registro por consulta */
+typedef enum {
+    SAIDA_TSV,
+    SAIDA_NDJSON,
+    SAIDA_CSV,
+    SAIDA_BINARIO,
+    TOTAL_FORMATOS_SAIDA
+} FormatoSaida;
+
+/* Registros acumulados em um buffer grande e enviados com um write()
+   por descarga, em vez de um fprintf por campo */
+typedef struct {
+    int fd;
+    FormatoSaida formato;
+    char *buffer;
+    size_t tamanho;
+    size_t capacidade;
+    int erro;                   /* um write falhou: o resto é descartado */
+    long registros;
+    long escritas;              /* chamadas a write() */
+    long long bytes;
+} Saida;
+
+#define SAIDA_TAMANHO_BUFFER (1 << 20)
+#define SAIDA_MAIOR_REGISTRO 16384  /* folga mínima antes de cada registro */
+#define SAIDA_MAGICO_BINARIO "CEPREG01"
+
+int saida_formato(const char *nome, FormatoSaida *formato);
+int saida_iniciar(Saida *s, int fd, FormatoSaida formato);
+void saida_consulta(Saida *s, const Consulta *consulta);
+int saida_descarregar(Saida *s);
+int saida_finalizar(Saida *s);
+
+size_t saida_texto_json(char *destino, size_t tamanho, const char *texto);
+size_t saida_consulta_json(const Consulta *consulta, char *corpo, size_t tamanho);
+
+#endif
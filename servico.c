@@ -0,0 +1,873 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "integrador__apis.h"
+#include "motor.h"
+#include "saida.h"
+#include "servico.h"
+#include "snapshot.h"
+
+/* ========================================================================
+   MODO SERVIÇO
+   ========================================================================
+   Processo de longa duração que atende GET /cep/{cep} com o resultado
+   integrado em JSON. Um único laço epoll cuida de tudo: aceita conexões,
+   lê requisições, acompanha os sockets das transferências do motor
+   (CURLMOPT_SOCKETFUNCTION) e escreve as respostas. Nenhuma operação
+   bloqueia o laço; enquanto um CEP espera pelas APIs, as outras
+   conexões continuam sendo atendidas.
+   
+   Como o processo não termina a cada consulta, o curl_global_init, as
+   conexões já abertas com as APIs, as sessões TLS e os caches em memória
+   (CEPs, feriados, índice do IBGE) são aproveitados por todas as
+   requisições.
+   
+   GET /metricas (JSON) e GET /metrics (Prometheus) expõem os histogramas
+   de latência por fase de cada API.
+   ======================================================================== */
+
+#define SERVICO_TAMANHO_REQUISICAO 8192
+#define SERVICO_TAMANHO_CORPO 4096
+#define SERVICO_EVENTOS 256
+
+/* O que está por trás de cada registro no epoll */
+enum {
+    FONTE_ESCUTA,
+    FONTE_CONEXAO,
+    FONTE_CURL
+};
+
+typedef struct {
+    int tipo;
+    int fd;
+} FonteEvento;
+
+typedef struct Servico Servico;
+
+/* Uma conexão de cliente. Atende uma consulta por vez; requisições
+   enviadas em sequência (pipelining) esperam no buffer de entrada. */
+typedef struct Conexao {
+    FonteEvento fonte;          /* deve ser o primeiro campo */
+    Servico *servico;
+    char entrada[SERVICO_TAMANHO_REQUISICAO];
+    size_t tamanho_entrada;
+    char *saida;
+    size_t tamanho_saida;
+    size_t capacidade_saida;
+    size_t enviado;
+    int aguardando_escrita;     /* EPOLLOUT registrado */
+    int lendo;                  /* EPOLLIN registrado */
+    int fim_entrada;            /* o cliente não envia mais nada (shutdown ou close) */
+    int manter_viva;
+    int encerrar;               /* fechar depois de enviar o que falta */
+    int processando;
+    int consultando;
+    int fechada;                /* o cliente saiu com a consulta em andamento */
+    Consulta consulta;
+    struct Conexao *proxima_livre;
+} Conexao;
+
+/* Um socket de transferência do curl registrado no epoll */
+typedef struct SocketCurl {
+    FonteEvento fonte;          /* deve ser o primeiro campo */
+    struct SocketCurl *proximo_descartado;
+} SocketCurl;
+
+struct Servico {
+    const ConfigServico *config;
+    EstatisticasServico *estatisticas;
+    int epoll;
+    FonteEvento escuta;
+    Motor motor;
+    double prazo_curl;          /* quando chamar o timeout do curl (ms), < 0 = nenhum */
+    int conexoes_abertas;
+    Conexao *livres;
+    SocketCurl *descartados;    /* liberados ao fim da rodada de eventos */
+};
+
+static volatile sig_atomic_t parar_servico = 0;
+static volatile sig_atomic_t gravar_snapshot = 0;
+
+static void tratar_sinal(int sinal) {
+    if (sinal == SIGUSR1) {
+        gravar_snapshot = 1;
+    } else {
+        parar_servico = 1;
+    }
+}
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* ========================================================================
+   FUNÇÕES: socket_curl / timer_curl
+   ========================================================================
+   Callbacks do curl_multi: registram no epoll os sockets que o curl quer
+   acompanhar e guardam o próximo timeout pedido por ele.
+   ======================================================================== */
+static int socket_curl(CURL *easy, curl_socket_t s, int acao, void *userp, void *socketp) {
+    Servico *servico = (Servico *)userp;
+    SocketCurl *sc = (SocketCurl *)socketp;
+    struct epoll_event ev;
+    (void)easy;
+    
+    if (acao == CURL_POLL_REMOVE) {
+        if (sc) {
+            epoll_ctl(servico->epoll, EPOLL_CTL_DEL, s, NULL);
+            curl_multi_assign(servico->motor.multi, s, NULL);
+            /* Pode haver eventos deste socket ainda por tratar na rodada */
+            sc->fonte.fd = -1;
+            sc->proximo_descartado = servico->descartados;
+            servico->descartados = sc;
+        }
+        return 0;
+    }
+    
+    memset(&ev, 0, sizeof(ev));
+    ev.events = ((acao & CURL_POLL_IN) ? EPOLLIN : 0) | ((acao & CURL_POLL_OUT) ? EPOLLOUT : 0);
+    
+    if (!sc) {
+        sc = calloc(1, sizeof(SocketCurl));
+        if (!sc) {
+            fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+            return -1;
+        }
+        sc->fonte.tipo = FONTE_CURL;
+        sc->fonte.fd = s;
+        ev.data.ptr = sc;
+        curl_multi_assign(servico->motor.multi, s, sc);
+        epoll_ctl(servico->epoll, EPOLL_CTL_ADD, s, &ev);
+    } else {
+        ev.data.ptr = sc;
+        epoll_ctl(servico->epoll, EPOLL_CTL_MOD, s, &ev);
+    }
+    
+    return 0;
+}
+
+static int timer_curl(CURLM *multi, long timeout_ms, void *userp) {
+    Servico *servico = (Servico *)userp;
+    (void)multi;
+    
+    servico->prazo_curl = timeout_ms < 0 ? -1 : agora_ms() + timeout_ms;
+    return 0;
+}
+
+static void liberar_descartados(Servico *servico) {
+    while (servico->descartados) {
+        SocketCurl *sc = servico->descartados;
+        servico->descartados = sc->proximo_descartado;
+        free(sc);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: acrescentar_saida
+   ========================================================================
+   Acrescenta bytes ao buffer de saída da conexão (reaproveitado entre
+   respostas).
+   ======================================================================== */
+static int acrescentar_saida(Conexao *c, const char *dados, size_t tamanho) {
+    if (c->tamanho_saida + tamanho > c->capacidade_saida) {
+        size_t nova = c->capacidade_saida ? c->capacidade_saida * 2 : 8192;
+        while (nova < c->tamanho_saida + tamanho) nova *= 2;
+        char *ptr = realloc(c->saida, nova);
+        if (!ptr) {
+            fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+            return -1;
+        }
+        c->saida = ptr;
+        c->capacidade_saida = nova;
+    }
+    
+    memcpy(c->saida + c->tamanho_saida, dados, tamanho);
+    c->tamanho_saida += tamanho;
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: registrar_conexao
+   ========================================================================
+   Ajusta os eventos da conexão no epoll. EPOLLIN sai com o buffer de
+   entrada cheio (a consulta em andamento ainda não liberou espaço) e
+   depois do fim da entrada: em modo nível, o epoll avisaria de novo a
+   cada volta do laço sem que houvesse o que ler.
+   ======================================================================== */
+static void registrar_conexao(Conexao *c, int escrita) {
+    struct epoll_event ev;
+    int leitura = !c->fim_entrada && c->tamanho_entrada < sizeof(c->entrada) - 1;
+    
+    if (c->aguardando_escrita == escrita && c->lendo == leitura) {
+        return;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = (leitura ? EPOLLIN : 0) | (escrita ? EPOLLOUT : 0);
+    ev.data.ptr = c;
+    epoll_ctl(c->servico->epoll, EPOLL_CTL_MOD, c->fonte.fd, &ev);
+    c->aguardando_escrita = escrita;
+    c->lendo = leitura;
+}
+
+/* ========================================================================
+   FUNÇÃO: fechar_conexao
+   ========================================================================
+   Fecha o socket. Se houver consulta em andamento, a conexão só volta
+   para o pool quando o motor terminar a consulta.
+   ======================================================================== */
+static void fechar_conexao(Conexao *c) {
+    Servico *servico = c->servico;
+    
+    if (c->fonte.fd >= 0) {
+        epoll_ctl(servico->epoll, EPOLL_CTL_DEL, c->fonte.fd, NULL);
+        close(c->fonte.fd);
+        c->fonte.fd = -1;
+        servico->conexoes_abertas--;
+    }
+    
+    if (c->consultando) {
+        c->fechada = 1;
+        return;
+    }
+    
+    c->proxima_livre = servico->livres;
+    servico->livres = c;
+}
+
+/* ========================================================================
+   FUNÇÃO: escrever_conexao
+   ========================================================================
+   Envia o que houver no buffer de saída sem bloquear; o restante fica
+   para quando o socket aceitar escrita (EPOLLOUT).
+   ======================================================================== */
+static void escrever_conexao(Conexao *c) {
+    while (c->enviado < c->tamanho_saida) {
+        ssize_t n = send(c->fonte.fd, c->saida + c->enviado, c->tamanho_saida - c->enviado, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->enviado += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            registrar_conexao(c, 1);
+            return;
+        }
+        fechar_conexao(c);
+        return;
+    }
+    
+    c->tamanho_saida = 0;
+    c->enviado = 0;
+    registrar_conexao(c, 0);
+    
+    if (c->encerrar) {
+        fechar_conexao(c);
+    }
+}
+
+static const char *texto_status(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 431: return "Request Header Fields Too Large";
+        case 502: return "Bad Gateway";
+        default:  return "Internal Server Error";
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: responder
+   ========================================================================
+   Coloca uma resposta JSON completa no buffer de saída da conexão.
+   ======================================================================== */
+static void responder_conteudo(Conexao *c, int status, const char *tipo, const char *corpo, size_t tamanho) {
+    char cabecalho[256];
+    int len = snprintf(cabecalho, sizeof(cabecalho),
+                       "HTTP/1.1 %d %s\r\n"
+                       "Content-Type: %s\r\n"
+                       "Content-Length: %zu\r\n"
+                       "Connection: %s\r\n\r\n",
+                       status, texto_status(status), tipo, tamanho,
+                       c->manter_viva ? "keep-alive" : "close");
+    
+    if (!c->manter_viva) {
+        c->encerrar = 1;
+    }
+    
+    if (acrescentar_saida(c, cabecalho, len) != 0 || acrescentar_saida(c, corpo, tamanho) != 0) {
+        c->encerrar = 1;
+    }
+}
+
+static void responder(Conexao *c, int status, const char *corpo, size_t tamanho) {
+    responder_conteudo(c, status, "application/json; charset=utf-8", corpo, tamanho);
+}
+
+static void responder_erro(Conexao *c, int status, const char *mensagem) {
+    char corpo[256];
+    int len = snprintf(corpo, sizeof(corpo), "{\"erro\":\"%s\"}", mensagem);
+    responder(c, status, corpo, len);
+}
+
+/* ========================================================================
+   FUNÇÃO: responder_metricas
+   ========================================================================
+   GET /metricas (JSON) e GET /metrics (texto do Prometheus): histogramas
+   de fases por API acumulados desde o início do serviço.
+   ======================================================================== */
+static void responder_metricas(Conexao *c, FormatoMetricas formato) {
+    char *corpo = NULL;
+    size_t tamanho = 0;
+    FILE *saida = open_memstream(&corpo, &tamanho);
+    
+    if (!saida) {
+        responder_erro(c, 500, "falha ao gerar métricas");
+        return;
+    }
+    cliente_http_exportar_metricas(c->servico->config->cliente, saida, formato);
+    fclose(saida);
+    
+    responder_conteudo(c, 200, formato == METRICAS_PROMETHEUS ?
+                       "text/plain; version=0.0.4; charset=utf-8" : "application/json; charset=utf-8",
+                       corpo, tamanho);
+    free(corpo);
+}
+
+static void processar_requisicoes(Conexao *c);
+
+/* ========================================================================
+   FUNÇÃO: consulta_concluida
+   ========================================================================
+   Chamada pelo motor quando o CEP de uma conexão foi resolvido.
+   ======================================================================== */
+static void consulta_concluida(Consulta *consulta, void *contexto) {
+    Conexao *c = (Conexao *)contexto;
+    EstatisticasServico *estatisticas = c->servico->estatisticas;
+    char corpo[SERVICO_TAMANHO_CORPO];
+    
+    c->consultando = 0;
+    
+    if (consulta->erro == CONSULTA_NAO_ENCONTRADA) {
+        estatisticas->nao_encontrados++;
+    } else if (consulta->erro) {
+        estatisticas->falhas++;
+    } else {
+        estatisticas->sucesso++;
+    }
+    
+    if (c->fechada) {
+        c->fechada = 0;
+        fechar_conexao(c);
+        return;
+    }
+    
+    if (consulta->erro == CONSULTA_NAO_ENCONTRADA) {
+        responder_erro(c, 404, "CEP não encontrado");
+    } else if (consulta->erro) {
+        int len = snprintf(corpo, sizeof(corpo), "{\"erro\":\"falha ao consultar %s\",\"motivo\":",
+                           nome_etapa(consulta->etapa_erro));
+        len += saida_texto_json(corpo + len, sizeof(corpo) - len - 1,
+                                   consulta->motivo ? consulta->motivo : "");
+        corpo[len++] = '}';
+        responder(c, 502, corpo, len);
+    } else {
+        responder(c, 200, corpo, saida_consulta_json(consulta, corpo, sizeof(corpo)));
+    }
+    
+    escrever_conexao(c);
+    
+    /* Requisições que chegaram enquanto esta era atendida */
+    if (c->fonte.fd >= 0 && !c->processando) {
+        processar_requisicoes(c);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: atender_requisicao
+   ========================================================================
+   Interpreta uma requisição completa (linha inicial e cabeçalhos, já
+   terminados em '\0') e inicia a consulta ou responde direto.
+   ======================================================================== */
+static void atender_requisicao(Conexao *c, char *requisicao) {
+    Servico *servico = c->servico;
+    char *metodo = requisicao;
+    char *caminho = NULL;
+    char *versao = NULL;
+    char *fim_linha = strstr(requisicao, "\r\n");
+    long corpo = 0;
+    
+    servico->estatisticas->requisicoes++;
+    
+    if (fim_linha) {
+        *fim_linha = '\0';
+    }
+    caminho = strchr(metodo, ' ');
+    if (caminho) {
+        *caminho++ = '\0';
+        versao = strchr(caminho, ' ');
+        if (versao) {
+            *versao++ = '\0';
+        }
+    }
+    
+    if (!caminho || !versao || strncmp(versao, "HTTP/1.", 7) != 0) {
+        c->manter_viva = 0;
+        responder_erro(c, 400, "requisição inválida");
+        return;
+    }
+    
+    /* HTTP/1.1 mantém a conexão por padrão; HTTP/1.0 só se pedido */
+    c->manter_viva = strcmp(versao, "HTTP/1.1") == 0;
+    for (char *linha = fim_linha ? fim_linha + 2 : NULL; linha && *linha; ) {
+        char *proxima = strstr(linha, "\r\n");
+        if (proxima) {
+            *proxima = '\0';
+        }
+        if (strncasecmp(linha, "Connection:", 11) == 0) {
+            const char *valor = linha + 11 + strspn(linha + 11, " \t");
+            if (strncasecmp(valor, "close", 5) == 0) {
+                c->manter_viva = 0;
+            } else if (strncasecmp(valor, "keep-alive", 10) == 0) {
+                c->manter_viva = 1;
+            }
+        } else if (strncasecmp(linha, "Content-Length:", 15) == 0) {
+            corpo = atol(linha + 15);
+        }
+        linha = proxima ? proxima + 2 : NULL;
+    }
+    
+    /* Sem corpo para descartar, a conexão não fica em estado conhecido */
+    if (corpo != 0) {
+        c->manter_viva = 0;
+        responder_erro(c, 400, "corpo não suportado");
+        return;
+    }
+    
+    if (strcmp(metodo, "GET") != 0) {
+        responder_erro(c, 405, "método não suportado");
+        return;
+    }
+    
+    size_t rota = strcspn(caminho, "?");
+    if (rota == 9 && strncmp(caminho, "/metricas", 9) == 0) {
+        responder_metricas(c, METRICAS_JSON);
+        return;
+    }
+    if (rota == 8 && strncmp(caminho, "/metrics", 8) == 0) {
+        responder_metricas(c, METRICAS_PROMETHEUS);
+        return;
+    }
+    
+    if (strncmp(caminho, "/cep/", 5) != 0) {
+        responder_erro(c, 404, "rota não encontrada");
+        return;
+    }
+    
+    /* Aceita "01310100" ou "01310-100"; a validação não vai à rede */
+    char *cep = caminho + 5;
+    size_t tamanho = strcspn(cep, "?/");
+    uint32_t numero;
+    if (tamanho >= sizeof(c->consulta.cep)) {
+        responder_erro(c, 400, "CEP inválido");
+        return;
+    }
+    memcpy(c->consulta.cep, cep, tamanho);
+    c->consulta.cep[tamanho] = '\0';
+    if (cep_valido(c->consulta.cep, &numero) != 0) {
+        responder_erro(c, 400, "CEP inválido");
+        return;
+    }
+    
+    /* Guarda só os dígitos (mesma chave de cache para as duas formas) */
+    snprintf(c->consulta.cep, sizeof(c->consulta.cep), "%08u", (unsigned)numero);
+    
+    /* "?prioridade=lote" cede a vez às consultas interativas no limite do host */
+    const char *parametros = strchr(caminho, '?');
+    c->consulta.prioridade = parametros && strstr(parametros, "prioridade=lote")
+                             ? PRIORIDADE_LOTE : PRIORIDADE_INTERATIVA;
+    c->consultando = 1;
+    motor_submeter(&servico->motor, &c->consulta, consulta_concluida, c);
+}
+
+/* ========================================================================
+   FUNÇÃO: processar_requisicoes
+   ========================================================================
+   Atende, em ordem, as requisições completas do buffer de entrada. Para
+   enquanto houver consulta em andamento: a próxima resposta só pode sair
+   depois da atual. Depois do fim da entrada, a conexão fecha quando a
+   última resposta tiver saído.
+   ======================================================================== */
+static void processar_requisicoes(Conexao *c) {
+    c->processando = 1;
+    
+    while (c->fonte.fd >= 0 && !c->consultando && !c->encerrar) {
+        char *fim = NULL;
+    
+        if (c->tamanho_entrada > 0) {
+            c->entrada[c->tamanho_entrada < sizeof(c->entrada) ? c->tamanho_entrada : sizeof(c->entrada) - 1] = '\0';
+            fim = strstr(c->entrada, "\r\n\r\n");
+        }
+    
+        if (!fim) {
+            if (c->tamanho_entrada >= sizeof(c->entrada) - 1) {
+                c->manter_viva = 0;
+                responder_erro(c, 431, "requisição grande demais");
+                escrever_conexao(c);
+            }
+            break;
+        }
+    
+        size_t consumido = (size_t)(fim - c->entrada) + 4;
+        fim[2] = '\0';
+        atender_requisicao(c, c->entrada);
+    
+        memmove(c->entrada, c->entrada + consumido, c->tamanho_entrada - consumido);
+        c->tamanho_entrada -= consumido;
+    
+        if (!c->consultando) {
+            escrever_conexao(c);
+        }
+    }
+    
+    c->processando = 0;
+    
+    if (c->fonte.fd >= 0 && !c->consultando) {
+        if (c->fim_entrada && !c->encerrar) {
+            c->encerrar = 1;
+            escrever_conexao(c);
+        } else {
+            registrar_conexao(c, c->aguardando_escrita);
+        }
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: ler_conexao
+   ========================================================================
+   Lê o que houver no socket (sem bloquear) e atende as requisições. Um
+   cliente que fecha o envio (shutdown) ainda recebe as respostas das
+   requisições que já mandou.
+   ======================================================================== */
+static void ler_conexao(Conexao *c) {
+    for (;;) {
+        size_t livre = sizeof(c->entrada) - 1 - c->tamanho_entrada;
+        if (livre == 0) {
+            break;
+        }
+    
+        ssize_t n = recv(c->fonte.fd, c->entrada + c->tamanho_entrada, livre, 0);
+        if (n > 0) {
+            c->tamanho_entrada += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n == 0) {
+            c->fim_entrada = 1;
+            break;
+        }
+        fechar_conexao(c);
+        return;
+    }
+    
+    if (!c->processando) {
+        processar_requisicoes(c);
+    }
+    if (c->fonte.fd >= 0) {
+        registrar_conexao(c, c->aguardando_escrita);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: aceitar_conexoes
+   ======================================================================== */
+static void aceitar_conexoes(Servico *servico) {
+    for (;;) {
+        int fd = accept4(servico->escuta.fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("[ERRO] accept");
+            }
+            return;
+        }
+    
+        if (servico->conexoes_abertas >= servico->config->max_conexoes) {
+            close(fd);
+            continue;
+        }
+    
+        Conexao *c = servico->livres;
+        if (c) {
+            servico->livres = c->proxima_livre;
+        } else {
+            c = calloc(1, sizeof(Conexao));
+            if (!c) {
+                fprintf(stderr, "[ERRO] Falha ao alocar memória\n");
+                close(fd);
+                continue;
+            }
+        }
+    
+        char *saida = c->saida;
+        size_t capacidade = c->capacidade_saida;
+        memset(c, 0, offsetof(Conexao, consulta));
+        c->saida = saida;
+        c->capacidade_saida = capacidade;
+        c->fonte.tipo = FONTE_CONEXAO;
+        c->fonte.fd = fd;
+        c->servico = servico;
+    
+        int um = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+    
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        c->lendo = 1;
+        if (epoll_ctl(servico->epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            c->fonte.fd = -1;
+            c->proxima_livre = servico->livres;
+            servico->livres = c;
+            continue;
+        }
+    
+        servico->conexoes_abertas++;
+        servico->estatisticas->conexoes++;
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: abrir_escuta
+   ======================================================================== */
+static int abrir_escuta(const ConfigServico *config) {
+    struct sockaddr_in endereco;
+    int um = 1;
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    
+    if (fd < 0) {
+        perror("[ERRO] socket");
+        return -1;
+    }
+    
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+    
+    memset(&endereco, 0, sizeof(endereco));
+    endereco.sin_family = AF_INET;
+    endereco.sin_port = htons((uint16_t)config->porta);
+    endereco.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (config->endereco && inet_pton(AF_INET, config->endereco, &endereco.sin_addr) != 1) {
+        fprintf(stderr, "[ERRO] Endereço de escuta inválido: %s\n", config->endereco);
+        close(fd);
+        return -1;
+    }
+    
+    if (bind(fd, (struct sockaddr *)&endereco, sizeof(endereco)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror("[ERRO] Não foi possível escutar na porta");
+        close(fd);
+        return -1;
+    }
+    
+    return fd;
+}
+
+/* ========================================================================
+   FUNÇÃO: salvar_snapshot
+   ========================================================================
+   Grava os caches aquecidos pelo serviço (ver snapshot.c). A gravação
+   acontece no próprio laço: o arquivo tem poucos MB e é montado em
+   memória e escrito de uma vez.
+   ======================================================================== */
+static void salvar_snapshot(Servico *servico) {
+    ResumoSnapshot resumo;
+    
+    if (snapshot_salvar(servico->config->cliente, servico->config->snapshot, &resumo) == 0) {
+        snapshot_imprimir(stderr, "Gravado em", servico->config->snapshot, &resumo);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: executar_servico
+   ========================================================================
+   Roda o laço de eventos até receber SIGINT ou SIGTERM. Com snapshot
+   configurado, grava-o a cada 'intervalo_snapshot' segundos e a cada
+   SIGUSR1.
+   ======================================================================== */
+int executar_servico(const ConfigServico *config, EstatisticasServico *estatisticas) {
+    Servico servico;
+    struct epoll_event eventos[SERVICO_EVENTOS];
+    struct sigaction acao;
+    double proximo_snapshot = -1;
+    
+    memset(&servico, 0, sizeof(servico));
+    memset(estatisticas, 0, sizeof(*estatisticas));
+    servico.config = config;
+    servico.estatisticas = estatisticas;
+    servico.prazo_curl = -1;
+    
+    servico.escuta.tipo = FONTE_ESCUTA;
+    servico.escuta.fd = abrir_escuta(config);
+    if (servico.escuta.fd < 0) {
+        return -1;
+    }
+    
+    servico.epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (servico.epoll < 0 || motor_iniciar(&servico.motor, config->cliente) != 0) {
+        perror("[ERRO] Falha ao iniciar o laço de eventos");
+        close(servico.escuta.fd);
+        return -1;
+    }
+    
+    curl_multi_setopt(servico.motor.multi, CURLMOPT_SOCKETFUNCTION, socket_curl);
+    curl_multi_setopt(servico.motor.multi, CURLMOPT_SOCKETDATA, &servico);
+    curl_multi_setopt(servico.motor.multi, CURLMOPT_TIMERFUNCTION, timer_curl);
+    curl_multi_setopt(servico.motor.multi, CURLMOPT_TIMERDATA, &servico);
+    
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &servico.escuta;
+    epoll_ctl(servico.epoll, EPOLL_CTL_ADD, servico.escuta.fd, &ev);
+    
+    memset(&acao, 0, sizeof(acao));
+    acao.sa_handler = tratar_sinal;
+    sigaction(SIGINT, &acao, NULL);
+    sigaction(SIGTERM, &acao, NULL);
+    parar_servico = 0;
+    if (config->snapshot) {
+        sigaction(SIGUSR1, &acao, NULL);
+        gravar_snapshot = 0;
+        if (config->intervalo_snapshot > 0) {
+            proximo_snapshot = agora_ms() + config->intervalo_snapshot * 1e3;
+        }
+    }
+    
+    fprintf(stderr, "[SERVIÇO] Escutando em %s:%d (GET /cep/{cep})\n",
+            config->endereco ? config->endereco : "0.0.0.0", config->porta);
+    
+    while (!parar_servico) {
+        if (gravar_snapshot || (proximo_snapshot >= 0 && agora_ms() >= proximo_snapshot)) {
+            gravar_snapshot = 0;
+            salvar_snapshot(&servico);
+            if (proximo_snapshot >= 0) {
+                proximo_snapshot = agora_ms() + config->intervalo_snapshot * 1e3;
+            }
+        }
+    
+        int espera = motor_verificar_prazos(&servico.motor);
+    
+        if (servico.prazo_curl >= 0) {
+            double restante = servico.prazo_curl - agora_ms();
+            int espera_curl = restante > 0 ? (int)restante + 1 : 0;
+            if (espera < 0 || espera_curl < espera) {
+                espera = espera_curl;
+            }
+        }
+        if (proximo_snapshot >= 0) {
+            double restante = proximo_snapshot - agora_ms();
+            int espera_snapshot = restante > 0 ? (int)restante + 1 : 0;
+            if (espera < 0 || espera_snapshot < espera) {
+                espera = espera_snapshot;
+            }
+        }
+    
+        int n = epoll_wait(servico.epoll, eventos, SERVICO_EVENTOS, espera);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("[ERRO] epoll_wait");
+            break;
+        }
+    
+        for (int i = 0; i < n; i++) {
+            FonteEvento *fonte = (FonteEvento *)eventos[i].data.ptr;
+            uint32_t ev_mask = eventos[i].events;
+    
+            if (fonte->fd < 0) {
+                continue;
+            }
+    
+            switch (fonte->tipo) {
+                case FONTE_ESCUTA:
+                    aceitar_conexoes(&servico);
+                    break;
+                case FONTE_CONEXAO: {
+                    Conexao *c = (Conexao *)fonte;
+                    if (ev_mask & (EPOLLHUP | EPOLLERR)) {
+                        /* Não há mais a quem responder (e o epoll avisaria
+                           disto sem parar, mesmo sem EPOLLIN) */
+                        fechar_conexao(c);
+                        break;
+                    }
+                    if (ev_mask & EPOLLOUT) {
+                        escrever_conexao(c);
+                    }
+                    if (c->fonte.fd >= 0 && (ev_mask & EPOLLIN)) {
+                        ler_conexao(c);
+                    }
+                    break;
+                }
+                case FONTE_CURL: {
+                    int acoes = ((ev_mask & EPOLLIN) ? CURL_CSELECT_IN : 0) |
+                                ((ev_mask & EPOLLOUT) ? CURL_CSELECT_OUT : 0) |
+                                ((ev_mask & (EPOLLERR | EPOLLHUP)) ? CURL_CSELECT_ERR : 0);
+                    motor_acao_socket(&servico.motor, fonte->fd, acoes);
+                    break;
+                }
+            }
+        }
+    
+        if (servico.prazo_curl >= 0 && agora_ms() >= servico.prazo_curl) {
+            servico.prazo_curl = -1;
+            motor_acao_socket(&servico.motor, CURL_SOCKET_TIMEOUT, 0);
+        }
+    
+        liberar_descartados(&servico);
+    }
+    
+    fprintf(stderr, "\n[SERVIÇO] Encerrando...\n");
+    
+    estatisticas->contadores = servico.motor.contadores;
+    estatisticas->tempos = servico.motor.tempos;
+    motor_finalizar(&servico.motor);
+    liberar_descartados(&servico);
+    close(servico.escuta.fd);
+    close(servico.epoll);
+    
+    /* As conexões ativas estão fora do pool; só as livres são liberadas */
+    while (servico.livres) {
+        Conexao *c = servico.livres;
+        servico.livres = c->proxima_livre;
+        free(c->saida);
+        free(c);
+    }
+    
+    return 0;
+}
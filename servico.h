@@ -0,0 +1,32 @@
+#ifndef SERVICO_H
+#define SERVICO_H
+
+#include "cliente_http.h"
+#include "motor.h"
+
+/* Configuração do modo serviço */
+typedef struct {
+    ClienteHTTP *cliente;       /* share de conexões e caches usados por todas as requisições */
+    const char *endereco;       /* endereço de escuta (NULL = todas as interfaces) */
+    int porta;
+    int max_conexoes;           /* conexões de clientes abertas ao mesmo tempo */
+    const char *snapshot;       /* gravado a cada intervalo e com SIGUSR1 (NULL = nunca) */
+    int intervalo_snapshot;     /* segundos (0 = só com SIGUSR1) */
+} ConfigServico;
+
+/* Estatísticas de uma execução do serviço */
+typedef struct {
+    long conexoes;
+    long requisicoes;
+    long sucesso;
+    long nao_encontrados;
+    long falhas;
+    ContadoresMotor contadores;
+    TemposMotor tempos;
+} EstatisticasServico;
+
+#define SERVICO_MAX_CONEXOES_PADRAO 1024
+
+int executar_servico(const ConfigServico *config, EstatisticasServico *estatisticas);
+
+#endif
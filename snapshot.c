@@ -0,0 +1,485 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cache_feriados.h"
+#include "cache_negativo.h"
+#include "indice_ibge.h"
+#include "snapshot.h"
+
+/* ========================================================================
+   SNAPSHOT DOS CACHES EM MEMÓRIA
+   ========================================================================
+   Um processo reiniciado (serviço reimplantado, cada parte de um lote
+   dividido) começa com o índice do IBGE, os feriados e os CEPs
+   inexistentes vazios e refaz todas essas requisições. O snapshot guarda
+   esses caches em um único arquivo binário, lido com mmap e copiado
+   direto para as estruturas, sem parse:
+   
+     [cabeçalho][tabela de seções][dados de cada seção, alinhados a 8]
+   
+   O cabeçalho traz a versão do formato, o tamanho total e uma soma
+   FNV-1a de 64 bits de tudo o que vem depois dele; um arquivo truncado,
+   corrompido ou de outra versão é recusado inteiro e o processo segue
+   com os caches vazios. Os registros são gravados na ordem de bytes da
+   máquina, então um snapshot só vale para a arquitetura que o gravou.
+   O índice do IBGE e cada tabela de feriados levam a data em que foram
+   obtidos: a validade (TTL) continua contando de onde parou.
+   
+   A gravação monta o arquivo em memória e o escreve em ARQ.<pid>.tmp,
+   com fsync antes do rename: quem lê nunca vê um snapshot pela metade.
+   Os endereços não entram aqui: o cache de CEPs (--cache-cep) já é um
+   arquivo mapeado, persistente por construção.
+   ======================================================================== */
+
+#define SNAPSHOT_MAGICO "CEPSNAP1"
+#define SNAPSHOT_VERSAO 2
+#define SNAPSHOT_ORDEM_BYTES 0x01020304u
+#define SNAPSHOT_MAX_SECOES 4
+
+enum {
+    SECAO_MUNICIPIOS = 1,       /* MunicipioIBGE[] */
+    SECAO_NOMES_MUNICIPIOS,     /* pool de nomes do índice */
+    SECAO_FERIADOS,             /* por ano: AnoSnapshot, Feriado[], textos */
+    SECAO_CEPS_INEXISTENTES     /* EntradaNegativa[] ainda válidas */
+};
+
+typedef struct {
+    char magico[8];
+    uint32_t versao;
+    uint32_t secoes;
+    uint64_t tamanho;           /* arquivo inteiro */
+    uint64_t soma;              /* FNV-1a de tudo após o cabeçalho */
+    int64_t gravado_em;
+    uint32_t ordem_bytes;
+    uint32_t reservado;
+} CabecalhoSnapshot;
+
+typedef struct {
+    uint32_t tipo;
+    uint32_t itens;
+    uint64_t deslocamento;      /* a partir do início do arquivo */
+    uint64_t tamanho;
+    int64_t atualizado;         /* quando os dados foram obtidos (0 = não se aplica) */
+} SecaoSnapshot;
+
+/* Início da tabela de um ano na seção de feriados */
+typedef struct {
+    int32_t ano;
+    int32_t quantidade;
+    uint32_t tamanho_textos;
+    uint32_t reservado;
+    int64_t atualizado;
+} AnoSnapshot;
+
+/* Arquivo sendo montado em memória */
+typedef struct {
+    unsigned char *dados;
+    size_t tamanho;
+    size_t capacidade;
+    int erro;
+    SecaoSnapshot secoes[SNAPSHOT_MAX_SECOES];
+    uint32_t total_secoes;
+} Montagem;
+
+static double agora_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t somar(const unsigned char *dados, size_t tamanho) {
+    uint64_t h = 1469598103934665603ull;
+    
+    for (size_t i = 0; i < tamanho; i++) {
+        h = (h ^ dados[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+static void acrescentar(Montagem *m, const void *dados, size_t tamanho) {
+    if (m->erro) {
+        return;
+    }
+    
+    if (m->tamanho + tamanho > m->capacidade) {
+        size_t nova = m->capacidade ? m->capacidade * 2 : 64 * 1024;
+        while (nova < m->tamanho + tamanho) nova *= 2;
+        unsigned char *ptr = realloc(m->dados, nova);
+        if (!ptr) {
+            m->erro = 1;
+            return;
+        }
+        m->dados = ptr;
+        m->capacidade = nova;
+    }
+    
+    if (dados) {
+        memcpy(m->dados + m->tamanho, dados, tamanho);
+    } else {
+        memset(m->dados + m->tamanho, 0, tamanho);
+    }
+    m->tamanho += tamanho;
+}
+
+static void alinhar(Montagem *m) {
+    acrescentar(m, NULL, (8 - m->tamanho % 8) % 8);
+}
+
+static void abrir_secao(Montagem *m, uint32_t tipo) {
+    SecaoSnapshot *s = &m->secoes[m->total_secoes++];
+    alinhar(m);
+    s->tipo = tipo;
+    s->deslocamento = m->tamanho;
+}
+
+static void fechar_secao(Montagem *m, uint32_t itens) {
+    SecaoSnapshot *s = &m->secoes[m->total_secoes - 1];
+    s->itens = itens;
+    s->tamanho = m->tamanho - s->deslocamento;
+}
+
+/* ========================================================================
+   FUNÇÃO: montar_snapshot
+   ========================================================================
+   Serializa os caches presentes no cliente. O cabeçalho e a tabela de
+   seções são reservados no início e preenchidos ao final.
+   ======================================================================== */
+static void montar_snapshot(Montagem *m, const ClienteHTTP *cliente, ResumoSnapshot *resumo) {
+    CabecalhoSnapshot cabecalho;
+    time_t agora = time(NULL);
+    size_t inicio_tabela = sizeof(CabecalhoSnapshot);
+    
+    acrescentar(m, NULL, inicio_tabela + sizeof(m->secoes));
+    
+    const IndiceIBGE *indice = cliente->indice_ibge;
+    if (indice && indice->quantidade > 0) {
+        abrir_secao(m, SECAO_MUNICIPIOS);
+        acrescentar(m, indice->municipios, indice->quantidade * sizeof(MunicipioIBGE));
+        fechar_secao(m, (uint32_t)indice->quantidade);
+        m->secoes[m->total_secoes - 1].atualizado = (int64_t)indice->atualizado;
+        abrir_secao(m, SECAO_NOMES_MUNICIPIOS);
+        acrescentar(m, indice->nomes, indice->tamanho_nomes);
+        fechar_secao(m, 1);
+        resumo->municipios = indice->quantidade;
+    }
+    
+    /* Tabelas vazias (ano que não pôde ser baixado) ficam de fora, para
+       que o próximo processo tente de novo */
+    const CacheFeriados *feriados = cliente->cache_feriados;
+    if (feriados && feriados->total > 0) {
+        abrir_secao(m, SECAO_FERIADOS);
+        for (int i = 0; i < feriados->total; i++) {
+            const TabelaFeriados *t = &feriados->anos[i];
+            AnoSnapshot ano = {t->ano, t->quantidade, (uint32_t)t->tamanho_textos, 0, (int64_t)t->atualizado};
+            if (t->quantidade == 0) {
+                continue;
+            }
+            acrescentar(m, &ano, sizeof(ano));
+            acrescentar(m, t->feriados, t->quantidade * sizeof(Feriado));
+            acrescentar(m, t->textos, t->tamanho_textos);
+            alinhar(m);
+            resumo->anos_feriados++;
+        }
+        fechar_secao(m, (uint32_t)resumo->anos_feriados);
+    }
+    
+    const CacheNegativo *negativo = cliente->cache_negativo;
+    if (negativo && negativo->ocupadas > 0) {
+        abrir_secao(m, SECAO_CEPS_INEXISTENTES);
+        for (uint32_t i = 0; i < negativo->capacidade; i++) {
+            const EntradaNegativa *e = &negativo->entradas[i];
+            if (e->expira != 0 && (time_t)e->expira > agora) {
+                acrescentar(m, e, sizeof(*e));
+                resumo->ceps_inexistentes++;
+            }
+        }
+        fechar_secao(m, (uint32_t)resumo->ceps_inexistentes);
+    }
+    
+    if (m->erro) {
+        return;
+    }
+    
+    memcpy(m->dados + inicio_tabela, m->secoes, sizeof(m->secoes));
+    memset(&cabecalho, 0, sizeof(cabecalho));
+    memcpy(cabecalho.magico, SNAPSHOT_MAGICO, sizeof(cabecalho.magico));
+    cabecalho.versao = SNAPSHOT_VERSAO;
+    cabecalho.secoes = m->total_secoes;
+    cabecalho.tamanho = m->tamanho;
+    cabecalho.soma = somar(m->dados + sizeof(cabecalho), m->tamanho - sizeof(cabecalho));
+    cabecalho.gravado_em = (int64_t)agora;
+    cabecalho.ordem_bytes = SNAPSHOT_ORDEM_BYTES;
+    memcpy(m->dados, &cabecalho, sizeof(cabecalho));
+}
+
+/* ========================================================================
+   FUNÇÃO: snapshot_salvar
+   ========================================================================
+   Grava o índice do IBGE, as tabelas de feriados e os CEPs inexistentes
+   ainda válidos em 'caminho', substituindo o snapshot anterior de forma
+   atômica. Retorna 0 em caso de sucesso e -1 em caso de erro.
+   ======================================================================== */
+int snapshot_salvar(const ClienteHTTP *cliente, const char *caminho, ResumoSnapshot *resumo) {
+    Montagem m;
+    char temporario[1100];
+    double inicio = agora_ms();
+    size_t escrito = 0;
+    int fd;
+    
+    memset(&m, 0, sizeof(m));
+    memset(resumo, 0, sizeof(*resumo));
+    
+    montar_snapshot(&m, cliente, resumo);
+    if (m.erro) {
+        fprintf(stderr, "[ERRO] Falha ao alocar memória para o snapshot\n");
+        free(m.dados);
+        return -1;
+    }
+    
+    snprintf(temporario, sizeof(temporario), "%s.%d.tmp", caminho, (int)getpid());
+    fd = open(temporario, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "[ERRO] Não foi possível gravar o snapshot %s: %s\n", caminho, strerror(errno));
+        free(m.dados);
+        return -1;
+    }
+    
+    while (escrito < m.tamanho) {
+        ssize_t n = write(fd, m.dados + escrito, m.tamanho - escrito);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        escrito += (size_t)n;
+    }
+    
+    int ok = escrito == m.tamanho && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(temporario, caminho) != 0) {
+        fprintf(stderr, "[ERRO] Não foi possível gravar o snapshot %s: %s\n", caminho, strerror(errno));
+        unlink(temporario);
+        free(m.dados);
+        return -1;
+    }
+    
+    resumo->bytes = m.tamanho;
+    resumo->ms = agora_ms() - inicio;
+    free(m.dados);
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: localizar_secao
+   ======================================================================== */
+static const SecaoSnapshot *localizar_secao(const SecaoSnapshot *secoes, uint32_t total, uint32_t tipo) {
+    for (uint32_t i = 0; i < total; i++) {
+        if (secoes[i].tipo == tipo) {
+            return &secoes[i];
+        }
+    }
+    return NULL;
+}
+
+/* ========================================================================
+   FUNÇÃO: validar_snapshot
+   ========================================================================
+   Confere cabeçalho, soma e limites de cada seção antes de qualquer
+   cópia. Retorna NULL se o arquivo é válido, ou o motivo da recusa.
+   ======================================================================== */
+static const char *validar_snapshot(const unsigned char *mapa, size_t tamanho) {
+    const CabecalhoSnapshot *cabecalho = (const CabecalhoSnapshot *)mapa;
+    const SecaoSnapshot *secoes = (const SecaoSnapshot *)(mapa + sizeof(*cabecalho));
+    
+    if (tamanho < sizeof(*cabecalho) || memcmp(cabecalho->magico, SNAPSHOT_MAGICO, 8) != 0) {
+        return "não é um snapshot";
+    }
+    if (cabecalho->ordem_bytes != SNAPSHOT_ORDEM_BYTES) {
+        return "gravado em outra arquitetura";
+    }
+    if (cabecalho->versao != SNAPSHOT_VERSAO) {
+        return "versão diferente";
+    }
+    if (cabecalho->tamanho != tamanho || cabecalho->secoes > SNAPSHOT_MAX_SECOES ||
+        tamanho < sizeof(*cabecalho) + SNAPSHOT_MAX_SECOES * sizeof(SecaoSnapshot)) {
+        return "arquivo truncado";
+    }
+    if (somar(mapa + sizeof(*cabecalho), tamanho - sizeof(*cabecalho)) != cabecalho->soma) {
+        return "soma de verificação não confere";
+    }
+    
+    for (uint32_t i = 0; i < cabecalho->secoes; i++) {
+        const SecaoSnapshot *s = &secoes[i];
+        if (s->deslocamento % 8 != 0 || s->deslocamento > tamanho || s->tamanho > tamanho - s->deslocamento) {
+            return "seção fora do arquivo";
+        }
+        if ((s->tipo == SECAO_MUNICIPIOS && s->tamanho != (uint64_t)s->itens * sizeof(MunicipioIBGE)) ||
+            (s->tipo == SECAO_CEPS_INEXISTENTES && s->tamanho != (uint64_t)s->itens * sizeof(EntradaNegativa))) {
+            return "seção com tamanho inconsistente";
+        }
+    }
+    
+    return NULL;
+}
+
+/* ========================================================================
+   FUNÇÃO: restaurar_feriados
+   ======================================================================== */
+static int restaurar_feriados(CacheFeriados *cache, const unsigned char *dados, const SecaoSnapshot *s,
+                              ResumoSnapshot *resumo) {
+    size_t pos = 0;
+    
+    for (uint32_t i = 0; i < s->itens; i++) {
+        AnoSnapshot ano;
+        if (pos > s->tamanho || s->tamanho - pos < sizeof(ano)) {
+            return -1;
+        }
+        memcpy(&ano, dados + pos, sizeof(ano));
+        pos += sizeof(ano);
+    
+        size_t bytes_feriados = (size_t)ano.quantidade * sizeof(Feriado);
+        if (ano.quantidade <= 0 || s->tamanho - pos < bytes_feriados + ano.tamanho_textos ||
+            cache_feriados_restaurar(cache, ano.ano, (const Feriado *)(dados + pos), ano.quantidade,
+                                     (const char *)(dados + pos + bytes_feriados), ano.tamanho_textos,
+                                     (time_t)ano.atualizado) != 0) {
+            return -1;
+        }
+        pos += bytes_feriados + ano.tamanho_textos;
+        pos += (8 - pos % 8) % 8;
+        resumo->anos_feriados++;
+    }
+    
+    return 0;
+}
+
+/* ========================================================================
+   FUNÇÃO: restaurar_caches
+   ========================================================================
+   Copia cada seção para o cache correspondente do cliente. Seções de um
+   cache desligado (ex.: --ttl-negativo 0) são ignoradas.
+   ======================================================================== */
+static int restaurar_caches(ClienteHTTP *cliente, IndiceIBGE *indice, const unsigned char *mapa,
+                            ResumoSnapshot *resumo) {
+    const CabecalhoSnapshot *cabecalho = (const CabecalhoSnapshot *)mapa;
+    const SecaoSnapshot *secoes = (const SecaoSnapshot *)(mapa + sizeof(*cabecalho));
+    const SecaoSnapshot *municipios = localizar_secao(secoes, cabecalho->secoes, SECAO_MUNICIPIOS);
+    const SecaoSnapshot *nomes = localizar_secao(secoes, cabecalho->secoes, SECAO_NOMES_MUNICIPIOS);
+    const SecaoSnapshot *feriados = localizar_secao(secoes, cabecalho->secoes, SECAO_FERIADOS);
+    const SecaoSnapshot *negativos = localizar_secao(secoes, cabecalho->secoes, SECAO_CEPS_INEXISTENTES);
+    
+    if (municipios && nomes) {
+        if (indice_ibge_restaurar(indice, (const MunicipioIBGE *)(mapa + municipios->deslocamento),
+                                  (int)municipios->itens, (const char *)(mapa + nomes->deslocamento),
+                                  nomes->tamanho, (time_t)municipios->atualizado) != 0) {
+            return -1;
+        }
+        cliente->indice_ibge = indice;
+        resumo->municipios = indice->quantidade;
+    }
+    
+    if (feriados && cliente->cache_feriados &&
+        restaurar_feriados(cliente->cache_feriados, mapa + feriados->deslocamento, feriados, resumo) != 0) {
+        return -1;
+    }
+    
+    if (negativos && cliente->cache_negativo) {
+        const EntradaNegativa *e = (const EntradaNegativa *)(mapa + negativos->deslocamento);
+        time_t agora = time(NULL);
+        for (uint32_t i = 0; i < negativos->itens; i++) {
+            if (cache_negativo_restaurar(cliente->cache_negativo, e[i].cep, e[i].expira, agora) != 0) {
+                return -1;
+            }
+        }
+        resumo->ceps_inexistentes = cliente->cache_negativo->ocupadas;
+    }
+    
+    return 0;
+}
+
+/* Volta aos caches vazios depois de uma restauração interrompida */
+static void descartar_caches(ClienteHTTP *cliente, IndiceIBGE *indice) {
+    if (cliente->indice_ibge == indice) {
+        cliente->indice_ibge = NULL;
+    }
+    indice_ibge_finalizar(indice);
+    if (cliente->cache_feriados) {
+        cache_feriados_finalizar(cliente->cache_feriados);
+    }
+    if (cliente->cache_negativo) {
+        int ttl = cliente->cache_negativo->ttl;
+        cache_negativo_finalizar(cliente->cache_negativo);
+        cache_negativo_iniciar(cliente->cache_negativo, ttl);
+    }
+}
+
+/* ========================================================================
+   FUNÇÃO: snapshot_carregar
+   ========================================================================
+   Preenche os caches do cliente (ainda vazios) a partir de 'caminho'. Se
+   o snapshot tiver o índice do IBGE, ele é restaurado em 'indice' e
+   passa a ser usado pelo cliente.
+   Retorna 0 em caso de sucesso e -1 se o arquivo não existir ou for
+   recusado; nesse caso os caches continuam vazios.
+   ======================================================================== */
+int snapshot_carregar(ClienteHTTP *cliente, IndiceIBGE *indice, const char *caminho,
+                      ResumoSnapshot *resumo) {
+    struct stat st;
+    unsigned char *mapa;
+    const char *motivo;
+    double inicio = agora_ms();
+    int fd;
+    
+    memset(resumo, 0, sizeof(*resumo));
+    
+    fd = open(caminho, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            fprintf(stderr, "[AVISO] Não foi possível abrir o snapshot %s: %s\n", caminho, strerror(errno));
+        }
+        return -1;
+    }
+    
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        fprintf(stderr, "[AVISO] Snapshot %s vazio; começando com os caches vazios\n", caminho);
+        return -1;
+    }
+    
+    mapa = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapa == MAP_FAILED) {
+        fprintf(stderr, "[AVISO] Não foi possível mapear o snapshot %s: %s\n", caminho, strerror(errno));
+        return -1;
+    }
+    
+    motivo = validar_snapshot(mapa, (size_t)st.st_size);
+    if (!motivo && restaurar_caches(cliente, indice, mapa, resumo) != 0) {
+        descartar_caches(cliente, indice);
+        motivo = "conteúdo inconsistente";
+    }
+    munmap(mapa, (size_t)st.st_size);
+    
+    if (motivo) {
+        fprintf(stderr, "[AVISO] Snapshot %s recusado (%s); começando com os caches vazios\n",
+                caminho, motivo);
+        memset(resumo, 0, sizeof(*resumo));
+        return -1;
+    }
+    
+    resumo->bytes = (size_t)st.st_size;
+    resumo->ms = agora_ms() - inicio;
+    return 0;
+}
+
+void snapshot_imprimir(FILE *saida, const char *acao, const char *caminho, const ResumoSnapshot *resumo) {
+    fprintf(saida, "[SNAPSHOT] %s %s em %.1f ms: %d municípios, %d anos de feriados, "
+            "%ld CEPs inexistentes (%.1f KB)\n", acao, caminho, resumo->ms, resumo->municipios,
+            resumo->anos_feriados, resumo->ceps_inexistentes, resumo->bytes / 1024.0);
+}
@@ -0,0 +1,24 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include "cliente_http.h"
+
+/* O que um snapshot gravado ou carregado continha */
+typedef struct {
+    int municipios;
+    int anos_feriados;
+    long ceps_inexistentes;
+    size_t bytes;
+    double ms;
+} ResumoSnapshot;
+
+#define SNAPSHOT_INTERVALO_PADRAO 300   /* segundos, no modo serviço */
+
+int snapshot_salvar(const ClienteHTTP *cliente, const char *caminho, ResumoSnapshot *resumo);
+int snapshot_carregar(ClienteHTTP *cliente, IndiceIBGE *indice, const char *caminho,
+                      ResumoSnapshot *resumo);
+void snapshot_imprimir(FILE *saida, const char *acao, const char *caminho,
+                       const ResumoSnapshot *resumo);
+
+#endif